@@ -0,0 +1,146 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <optional>
+#include <print>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+
+import lib;
+
+namespace {
+    constexpr int k_grid_columns = 512;
+    constexpr int k_grid_rows = 256;
+
+    // A wavy height field, big enough that load times are dominated by
+    // the data rather than by opening files.
+    std::string make_grid_obj() {
+        std::string text;
+        for (int y = 0; y <= k_grid_rows; ++y) {
+            for (int x = 0; x <= k_grid_columns; ++x) {
+                text += std::format("v {} {} {}\nvt {} {}\nvn 0 1 0\n",
+                                    x * 0.01f, 0.02f * ((x ^ y) & 7),
+                                    y * 0.01f,
+                                    static_cast<float>(x) / k_grid_columns,
+                                    static_cast<float>(y) / k_grid_rows);
+            }
+        }
+        for (int y = 0; y < k_grid_rows; ++y) {
+            for (int x = 0; x < k_grid_columns; ++x) {
+                const int a = y * (k_grid_columns + 1) + x + 1;
+                const int b = a + k_grid_columns + 1;
+                text += std::format("f {}/{}/{} {}/{}/{} {}/{}/{} {}/{}/{}\n",
+                                    a, a, 1, b, b, 1, b + 1, b + 1, 1, a + 1,
+                                    a + 1, 1);
+            }
+        }
+        return text;
+    }
+}
+
+int
+main() {
+    const std::filesystem::path directory =
+      std::filesystem::temp_directory_path() / "metal-cpp-asset-file";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+
+    // Load times of the same mesh: parsing text against reading or
+    // mapping the packed asset. All numbers are with a warm page cache,
+    // the first run after a reboot pays for the disk as well.
+    const std::string obj = make_grid_obj();
+    const std::filesystem::path obj_path = directory / "grid.obj";
+    const std::filesystem::path mesh_path = directory / "grid.mesh";
+    std::ofstream(obj_path, std::ios::binary) << obj;
+
+    gpu::mesh_data grid;
+    (void)gpu::import_obj(obj, grid);
+    gpu::optimize_mesh(grid);
+    const gpu::packed_mesh packed = gpu::pack_mesh(grid);
+    gpu::save_mesh_cache(mesh_path, packed.view(), 7);
+    const std::size_t vertex_bytes =
+      packed.vertices.size() * sizeof(shader_types::packed_vertex_data);
+    const std::size_t upload_bytes = vertex_bytes + packed.indices.size();
+    // Stands in for the contents() of the GPU buffers.
+    std::vector<std::byte> upload(upload_bytes);
+    const auto copy_to_upload = [&](const gpu::mesh_view& p_mesh) {
+        std::memcpy(upload.data(), p_mesh.vertices.data(), vertex_bytes);
+        std::memcpy(upload.data() + vertex_bytes, p_mesh.indices.data(),
+                    p_mesh.indices.size());
+        benchmark::do_not_optimize(upload.data());
+    };
+
+    const auto time_ms = [](auto&& p_fn, int p_iterations) {
+        return benchmark::measure_ns(p_fn, p_iterations) * 1e-6;
+    };
+    const double parse_ms = time_ms(
+      [&] {
+          gpu::mesh_data mesh;
+          std::optional<std::vector<std::byte>> text = gpu::read_file(obj_path);
+          (void)gpu::import_mesh(*text, obj_path, mesh);
+          gpu::deduplicate_vertices(mesh);
+          copy_to_upload(gpu::pack_mesh(mesh).view());
+      },
+      3);
+    // The whole of gpu::load_mesh, source stat and key included. A miss
+    // imports, optimizes and writes the asset, a hit maps it.
+    const std::filesystem::path cache_directory = directory / "cache";
+    const double load_miss_ms = time_ms(
+      [&] {
+          std::filesystem::remove_all(cache_directory);
+          copy_to_upload(gpu::load_mesh(obj_path, cache_directory).view());
+      },
+      3);
+    const double load_hit_ms = time_ms(
+      [&] {
+          copy_to_upload(gpu::load_mesh(obj_path, cache_directory).view());
+      },
+      20);
+    const double read_ms = time_ms(
+      [&] { copy_to_upload(gpu::load_mesh_cache(mesh_path, 7)->view()); }, 20);
+    const double map_checked_ms = time_ms(
+      [&] {
+          copy_to_upload(
+            gpu::map_mesh_cache(mesh_path, 7, gpu::asset_verify::checksums)
+              ->view);
+      },
+      20);
+    const double map_ms = time_ms(
+      [&] {
+          copy_to_upload(
+            gpu::map_mesh_cache(mesh_path, 7, gpu::asset_verify::layout)->view);
+      },
+      20);
+    const double map_only_ms = time_ms(
+      [&] {
+          const auto mapped =
+            gpu::map_mesh_cache(mesh_path, 7, gpu::asset_verify::layout);
+          benchmark::do_not_optimize(mapped->view.vertices.data());
+      },
+      20);
+
+    std::println("grid {} vertices, {} indices, obj {:.1f} MiB, asset {:.1f} MiB",
+                 packed.vertices.size(), packed.index_count,
+                 obj.size() / 1048576.0,
+                 std::filesystem::file_size(mesh_path) / 1048576.0);
+    std::println("{:<34} {:>10} {:>9}", "load path", "ms", "vs parse");
+    const auto row = [&](const char* p_name, double p_ms) {
+        std::println("{:<34} {:>10.3f} {:>8.1f}x", p_name, p_ms,
+                     parse_ms / p_ms);
+    };
+    row("parse obj, dedup, pack, copy", parse_ms);
+    row("load_mesh miss, optimize, save", load_miss_ms);
+    row("load_mesh hit, copy", load_hit_ms);
+    row("read asset into memory, copy", read_ms);
+    row("map asset, checksums, copy", map_checked_ms);
+    row("map asset, copy", map_ms);
+    row("map asset, no-copy buffer", map_only_ms);
+
+    std::filesystem::remove_all(directory);
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <cstddef>
+#include <print>
+#include <vector>
+
+#include "benchmark.hpp"
+
+import lib;
+
+namespace {
+    constexpr std::size_t k_frames = 1000;
+    constexpr std::size_t k_sub_passes = 4;
+    // Roughly what renderer::draw sees per pass: command buffer, pass
+    // descriptor, encoder, drawable and a few transient descriptors.
+    constexpr std::size_t k_objects_per_pass = 6;
+    constexpr std::size_t k_budget = k_sub_passes * k_objects_per_pass;
+
+    using arena = ns::frame_arena<ns::mock_autorelease_pool>;
+
+    struct run_result {
+        ns::frame_arena_metrics metrics;
+        std::size_t peak_live = 0;
+        double ns_per_frame = 0.0;
+    };
+
+    // Runs k_frames frames, p_extra_every adds one stray object to every
+    // n-th frame to show the budget check catching it.
+    run_result simulate(ns::frame_arena_options p_options,
+                        std::size_t p_extra_every) {
+        run_result result;
+        std::vector<ns::mock_object> objects(k_budget + 1);
+
+        arena frames(p_options);
+        for (std::size_t frame = 0; frame < k_frames; ++frame) {
+            objects.assign(objects.size(), ns::mock_object{});
+            std::size_t used = 0;
+            {
+                auto frame_scope = frames.frame();
+                for (std::size_t pass = 0; pass < k_sub_passes; ++pass) {
+                    auto sub_pass = frames.sub_pass();
+                    std::size_t count = k_objects_per_pass;
+                    if (p_extra_every != 0 && frame % p_extra_every == 0 &&
+                        pass == 0) {
+                        ++count;
+                    }
+                    for (std::size_t i = 0; i < count; ++i) {
+                        sub_pass.autorelease(&objects[used++]);
+                    }
+
+                    // Objects still waiting for a pool to drain.
+                    std::size_t live = 0;
+                    for (std::size_t i = 0; i < used; ++i) {
+                        live += objects[i].destroyed() ? 0 : 1;
+                    }
+                    result.peak_live = std::max(result.peak_live, live);
+                }
+            }
+        }
+        result.metrics = frames.metrics();
+
+        arena timed(p_options);
+        result.ns_per_frame =
+          benchmark::measure_ns([&] {
+              for (std::size_t frame = 0; frame < k_frames; ++frame) {
+                  auto scope = timed.frame();
+                  for (std::size_t pass = 0; pass < k_sub_passes; ++pass) {
+                      auto sub_pass = timed.sub_pass();
+                      benchmark::do_not_optimize(sub_pass);
+                  }
+              }
+          }) /
+          static_cast<double>(k_frames);
+        return result;
+    }
+}
+
+int
+main() {
+    std::println("{:<22} {:>8} {:>9} {:>9} {:>9} {:>11} {:>9}",
+                 "mode", "obj/frm", "peak obj", "pools", "peak live",
+                 "over budget", "ns/frame");
+
+    struct mode {
+        const char* name;
+        ns::frame_arena_options options;
+        std::size_t extra_every;
+    };
+    const mode modes[] = {
+        { "batched", { .object_budget = k_budget }, 0 },
+        { "pool per sub-pass",
+          { .object_budget = k_budget, .pool_per_sub_pass = true },
+          0 },
+        { "batched + stray object", { .object_budget = k_budget }, 10 },
+    };
+    for (const mode& current : modes) {
+        const run_result result = simulate(current.options, current.extra_every);
+        const ns::frame_arena_metrics& metrics = result.metrics;
+        std::println("{:<22} {:>8.2f} {:>9} {:>9} {:>9} {:>11} {:>9.1f}",
+                     current.name, metrics.average_frame_objects(),
+                     metrics.peak_frame_objects, metrics.last_frame_pools,
+                     result.peak_live, metrics.over_budget_frames,
+                     result.ns_per_frame);
+    }
+
+    return 0;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <print>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace benchmark {
+    /**
+     * @brief Prints one pass/fail line of a performance claim the
+     * benchmark makes, correctness lives in tests/.
+     *
+     * @return p_ok, for `passed &= check(...)` and a failing exit code.
+     */
+    inline bool check(const char* p_name, bool p_ok) {
+        std::println("{:<44} {}", p_name, p_ok ? "ok" : "FAILED");
+        return p_ok;
+    }
+
+    /**
+     * @brief Runs p_fn p_iterations times after one warm-up call.
+     *
+     * @return best wall-clock time of a single call in nanoseconds. The
+     * minimum is less noisy than the mean on a shared CI host.
+     */
+    template<typename Fn>
+    double measure_ns(Fn&& p_fn, std::size_t p_iterations = 10) {
+        using clock = std::chrono::steady_clock;
+        p_fn();
+        double best = 0.0;
+        for (std::size_t i = 0; i < p_iterations; ++i) {
+            const auto start = clock::now();
+            p_fn();
+            const std::chrono::duration<double, std::nano> elapsed =
+              clock::now() - start;
+            best = (i == 0) ? elapsed.count() : std::min(best, elapsed.count());
+        }
+        return best;
+    }
+
+    //! Keeps the compiler from discarding results that are never read.
+    template<typename T>
+    void do_not_optimize(const T& p_value) {
+        asm volatile("" : : "g"(&p_value) : "memory");
+    }
+
+    /**
+     * @brief Core cycles spent by the calling thread, read from the
+     * hardware counter through perf_event_open on Linux.
+     *
+     * Elsewhere, or where the kernel refuses the counter, valid() is false
+     * and measure returns 0.
+     */
+    class cycle_counter {
+    public:
+        cycle_counter() {
+#if defined(__linux__)
+            perf_event_attr attributes{};
+            attributes.type = PERF_TYPE_HARDWARE;
+            attributes.size = sizeof(attributes);
+            attributes.config = PERF_COUNT_HW_CPU_CYCLES;
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+            m_fd = static_cast<int>(
+              syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+#endif
+        }
+
+        ~cycle_counter() {
+#if defined(__linux__)
+            if (m_fd >= 0) {
+                close(m_fd);
+            }
+#endif
+        }
+
+        cycle_counter(const cycle_counter&) = delete;
+        cycle_counter& operator=(const cycle_counter&) = delete;
+
+        [[nodiscard]] bool valid() const { return m_fd >= 0; }
+
+        //! Like measure_ns, in cycles.
+        template<typename Fn>
+        double measure(Fn&& p_fn, std::size_t p_iterations = 10) {
+            if (!valid()) {
+                return 0.0;
+            }
+            p_fn();
+            std::uint64_t best = 0;
+            for (std::size_t i = 0; i < p_iterations; ++i) {
+                const std::uint64_t start = read();
+                p_fn();
+                const std::uint64_t elapsed = read() - start;
+                best = (i == 0) ? elapsed : std::min(best, elapsed);
+            }
+            return static_cast<double>(best);
+        }
+
+    private:
+        std::uint64_t read() const {
+            std::uint64_t count = 0;
+#if defined(__linux__)
+            if (::read(m_fd, &count, sizeof(count)) != sizeof(count)) {
+                return 0;
+            }
+#endif
+            return count;
+        }
+
+        int m_fd = -1;
+    };
+}
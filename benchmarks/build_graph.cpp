@@ -0,0 +1,95 @@
+#include <chrono>
+#include <cstddef>
+#include <print>
+#include <thread>
+#include <vector>
+
+#include "benchmark.hpp"
+
+import lib;
+
+namespace {
+    using namespace std::chrono_literals;
+
+    // Simulated costs of the renderer's startup stages.
+    struct simulated_stage {
+        const char* name;
+        std::chrono::milliseconds cost;
+        bool needed_by_first_frame;
+    };
+
+    constexpr simulated_stage k_stages[] = {
+        { "shaders", 40ms, true },
+        { "compute_pipeline", 30ms, true },
+        { "depth_stencil", 1ms, true },
+        { "textures", 5ms, true },
+        { "buffers", 10ms, true },
+        { "instances", 8ms, true },
+        { "pipeline_warmup", 60ms, false },
+    };
+
+    double to_ms(double p_ns) { return p_ns * 1e-6; }
+}
+
+int
+main() {
+    jobs::scheduler workers(4);
+
+    // Renderer-shaped graph: instances need the buffers, everything else
+    // is independent, and a warm-up stage nothing waits for.
+    double serial_ms = 0.0;
+    double first_frame_serial_ms = 0.0;
+    for (const simulated_stage& stage : k_stages) {
+        serial_ms += static_cast<double>(stage.cost.count());
+        if (stage.needed_by_first_frame) {
+            first_frame_serial_ms = serial_ms;
+        }
+    }
+
+    jobs::build_graph graph;
+    auto simulate = [](const simulated_stage& p_stage) {
+        return [cost = p_stage.cost] { std::this_thread::sleep_for(cost); };
+    };
+    std::vector<jobs::stage_id> ids;
+    for (std::size_t i = 0; i < 5; ++i) {
+        ids.push_back(graph.add(k_stages[i].name, simulate(k_stages[i])));
+    }
+    const jobs::stage_id buffers = ids[4];
+    ids.push_back(
+      graph.add(k_stages[5].name, simulate(k_stages[5]), { buffers }));
+    ids.push_back(graph.add(k_stages[6].name, simulate(k_stages[6])));
+
+    const auto start = std::chrono::steady_clock::now();
+    graph.run(workers);
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        if (k_stages[i].needed_by_first_frame) {
+            graph.future(ids[i]).wait();
+        }
+    }
+    const double first_frame_ms =
+      std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start)
+        .count();
+    graph.wait();
+    const double all_ms = std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+
+    std::println("{:<18} {:>9} {:>9} {:>9} {:>9}",
+                 "stage", "ready ms", "start ms", "end ms", "run ms");
+    const std::vector<jobs::stage_timing> timings = graph.timings();
+    for (const jobs::stage_timing& timing : timings) {
+        std::println("{:<18} {:>9.2f} {:>9.2f} {:>9.2f} {:>9.2f}",
+                     timing.name, to_ms(timing.ready_ns),
+                     to_ms(timing.start_ns), to_ms(timing.end_ns),
+                     to_ms(timing.run_ns()));
+    }
+    std::println("\nfirst frame ready: {:.1f} ms (serial {:.1f} ms)",
+                 first_frame_ms, first_frame_serial_ms);
+    std::println("all stages done:   {:.1f} ms (serial {:.1f} ms)\n",
+                 all_ms, serial_ms);
+
+    const bool passed = benchmark::check(
+      "first frame beats the serial build", first_frame_ms < first_frame_serial_ms);
+    return passed ? 0 : 1;
+}
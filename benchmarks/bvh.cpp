@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numbers>
+#include <print>
+#include <random>
+#include <span>
+#include <vector>
+
+#include "benchmark.hpp"
+
+import lib;
+
+namespace {
+    constexpr std::size_t k_sizes[] = { 1'000, 10'000, 100'000, 1'000'000 };
+    constexpr float k_miss = std::numeric_limits<float>::infinity();
+
+    // Side of the cube instances are scattered over, keeping the density
+    // the same at every count.
+    float scene_side(std::size_t p_count) {
+        return 4.f * std::cbrt(static_cast<float>(p_count));
+    }
+
+    // Unit cubes rotated, scaled and scattered around the origin.
+    std::vector<shader_types::instance_data> random_instances(std::size_t p_count,
+                                                              std::uint32_t p_seed) {
+        std::mt19937 rng(p_seed);
+        const float half = scene_side(p_count) * 0.5f;
+        std::uniform_real_distribution<float> position(-half, half);
+        std::uniform_real_distribution<float> angle(-3.f, 3.f);
+        std::uniform_real_distribution<float> scale(0.3f, 1.5f);
+        std::vector<shader_types::instance_data> instances(p_count);
+        for (shader_types::instance_data& instance : instances) {
+            instance.instanceTransform =
+              math::make_translate({ position(rng), position(rng), position(rng) }) *
+              math::make_y_rotate(angle(rng)) * math::make_x_rotate(angle(rng)) *
+              math::make_scale({ scale(rng), scale(rng), scale(rng) });
+        }
+        return instances;
+    }
+
+    std::vector<math::aabb> instance_bounds(
+      std::span<const shader_types::instance_data> p_instances) {
+        const math::aabb cube = { { -1.f, -1.f, -1.f }, { 1.f, 1.f, 1.f } };
+        std::vector<math::aabb> bounds;
+        for (const shader_types::instance_data& instance : p_instances) {
+            bounds.push_back(math::transform_aabb(cube, instance.instanceTransform));
+        }
+        return bounds;
+    }
+
+    math::frustum camera_frustum(std::size_t p_count, float p_yaw) {
+        return math::make_frustum(
+          math::make_perspective({ .fov_radians = std::numbers::pi_v<float> / 3.f,
+                                   .aspect = 16.f / 9.f,
+                                   .znear = 0.1f,
+                                   .zfar = scene_side(p_count) * 0.5f }) *
+          math::make_y_rotate(p_yaw));
+    }
+
+    std::size_t brute_force_query(const math::frustum& p_frustum,
+                                  std::span<const math::aabb> p_bounds,
+                                  std::span<std::uint32_t> p_visible) {
+        std::size_t written = 0;
+        for (std::size_t i = 0; i < p_bounds.size(); ++i) {
+            if (math::intersects(p_frustum, p_bounds[i])) {
+                p_visible[written++] = static_cast<std::uint32_t>(i);
+            }
+        }
+        return written;
+    }
+
+    math::ray random_ray(std::mt19937& p_rng, std::size_t p_count) {
+        const float half = scene_side(p_count) * 0.5f;
+        std::uniform_real_distribution<float> position(-half, half);
+        std::normal_distribution<float> direction;
+        return { .origin = { position(p_rng), position(p_rng), position(p_rng) },
+                 .direction = math::normalize(
+                   { direction(p_rng), direction(p_rng), direction(p_rng) }) };
+    }
+
+    // Entry distance into a box in double, infinity on a miss.
+    double box_entry(const math::ray& p_ray, const math::aabb& p_box) {
+        double enter = 0.0;
+        double leave = p_ray.max_distance;
+        const float* origin = &p_ray.origin.x;
+        const float* direction = &p_ray.direction.x;
+        const float* lo = &p_box.min.x;
+        const float* hi = &p_box.max.x;
+        for (int a = 0; a < 3; ++a) {
+            if (direction[a] == 0.f) {
+                if (origin[a] < lo[a] || origin[a] > hi[a]) {
+                    return k_miss;
+                }
+                continue;
+            }
+            const double t0 = (lo[a] - static_cast<double>(origin[a])) / direction[a];
+            const double t1 = (hi[a] - static_cast<double>(origin[a])) / direction[a];
+            enter = std::max(enter, std::min(t0, t1));
+            leave = std::min(leave, std::max(t0, t1));
+        }
+        return enter <= leave ? enter : k_miss;
+    }
+
+    struct brute_force_hit {
+        std::uint32_t index = 0;
+        double distance = k_miss;
+    };
+
+    brute_force_hit brute_force_box_ray(const math::ray& p_ray,
+                                        std::span<const math::aabb> p_bounds) {
+        brute_force_hit best;
+        for (std::size_t i = 0; i < p_bounds.size(); ++i) {
+            const double distance = box_entry(p_ray, p_bounds[i]);
+            if (distance < best.distance) {
+                best = { static_cast<std::uint32_t>(i), distance };
+            }
+        }
+        return best;
+    }
+
+    // Moves p_count random instances by up to p_step along each axis.
+    void move_some(std::vector<math::aabb>& p_bounds,
+                   std::size_t p_count,
+                   float p_step,
+                   std::mt19937& p_rng,
+                   math::bvh& p_tree) {
+        std::uniform_int_distribution<std::size_t> pick(0, p_bounds.size() - 1);
+        std::uniform_real_distribution<float> step(-p_step, p_step);
+        for (std::size_t i = 0; i < p_count; ++i) {
+            const std::size_t index = pick(p_rng);
+            const math::float3 offset = { step(p_rng), step(p_rng), step(p_rng) };
+            p_bounds[index] = { p_bounds[index].min + offset, p_bounds[index].max + offset };
+            p_tree.set_bounds(index, p_bounds[index]);
+        }
+    }
+}
+
+int
+main() {
+    jobs::scheduler parallel(3);
+
+    const std::vector<math::aabb> scene = instance_bounds(random_instances(100'000, 4));
+    math::bvh tree;
+    tree.build(scene);
+
+    // SAH cost after moving everything and refitting, against a rebuild.
+    float refit_cost = 0.f;
+    float rebuilt_cost = 0.f;
+    {
+        std::vector<math::aabb> moved = scene;
+        math::bvh refitted;
+        refitted.build(moved);
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> step(-4.f, 4.f);
+        for (math::aabb& box : moved) {
+            const math::float3 offset = { step(rng), step(rng), step(rng) };
+            box = { box.min + offset, box.max + offset };
+        }
+        (void)refitted.update(moved);
+        refitted.refit(&parallel);
+        refit_cost = refitted.sah_cost();
+        math::bvh rebuilt;
+        rebuilt.build(moved);
+        rebuilt_cost = rebuilt.sah_cost();
+    }
+
+    std::println("simd backend: {} ({} lanes), {}-wide nodes, {} workers",
+                 math::simd_backend(), math::simd::lanes, math::bvh::width,
+                 jobs::scheduler::default_worker_count());
+    std::println("100k instances: sah cost {:.1f} built, {:.1f} after moving "
+                 "everything and refitting, {:.1f} rebuilt",
+                 tree.sah_cost(), refit_cost, rebuilt_cost);
+
+    jobs::scheduler pool;
+    std::println("\n{:>9} {:>7} {:>9} {:>9} {:>9} {:>9} {:>9} {:>9} {:>8} {:>9} {:>9} {:>8}",
+                 "instances", "nodes", "build ms", "par ms", "refit ms", "1% ms",
+                 "query us", "brute us", "visible", "ray us", "brute us", "hit");
+    for (const std::size_t count : k_sizes) {
+        std::vector<math::aabb> bounds = instance_bounds(random_instances(count, 30));
+        const std::size_t iterations = count >= 1'000'000 ? 3 : 10;
+        math::bvh timed;
+        const double build_ms =
+          benchmark::measure_ns([&] { timed.build(bounds); }, iterations) * 1e-6;
+        const double parallel_ms =
+          benchmark::measure_ns([&] { timed.build(bounds, &pool); }, iterations) * 1e-6;
+
+        const double refit_ms = benchmark::measure_ns(
+                                  [&] {
+                                      (void)timed.update(bounds);
+                                      timed.refit(&pool);
+                                  },
+                                  iterations) *
+                                1e-6;
+        std::mt19937 rng(31);
+        const double partial_ms = benchmark::measure_ns(
+                                    [&] {
+                                        move_some(bounds, count / 100, 0.1f, rng, timed);
+                                        timed.refit(&pool);
+                                    },
+                                    iterations) *
+                                  1e-6;
+
+        const math::frustum frustum = camera_frustum(count, 0.4f);
+        std::vector<std::uint32_t> visible(count);
+        std::size_t visible_count = 0;
+        const double query_us = benchmark::measure_ns(
+                                  [&] {
+                                      visible_count = timed.query(frustum, visible);
+                                      benchmark::do_not_optimize(visible.data());
+                                  },
+                                  iterations) *
+                                1e-3;
+        const double brute_query_us =
+          benchmark::measure_ns(
+            [&] {
+                benchmark::do_not_optimize(brute_force_query(frustum, bounds, visible));
+            },
+            iterations) *
+          1e-3;
+
+        std::mt19937 ray_rng(32);
+        std::vector<math::ray> rays;
+        for (int r = 0; r < 64; ++r) {
+            rays.push_back(random_ray(ray_rng, count));
+        }
+        std::size_t hits = 0;
+        const double ray_us = benchmark::measure_ns(
+                                [&] {
+                                    hits = 0;
+                                    for (const math::ray& ray : rays) {
+                                        hits += timed.raycast(ray).has_value();
+                                    }
+                                },
+                                iterations) *
+                              1e-3 / rays.size();
+        const double brute_ray_us =
+          benchmark::measure_ns(
+            [&] {
+                for (const math::ray& ray : rays) {
+                    benchmark::do_not_optimize(brute_force_box_ray(ray, bounds));
+                }
+            },
+            1) *
+          1e-3 / rays.size();
+
+        std::println("{:>9} {:>7} {:>9.2f} {:>9.2f} {:>9.3f} {:>9.3f} {:>9.1f} {:>9.1f} "
+                     "{:>7.1f}% {:>9.2f} {:>9.1f} {:>7.0f}%",
+                     count, timed.node_count(), build_ms, parallel_ms, refit_ms,
+                     partial_ms, query_us, brute_query_us,
+                     100.0 * visible_count / count, ray_us, brute_ray_us,
+                     100.0 * hits / rays.size());
+    }
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include <cstddef>
+#include <cstdint>
+#include <print>
+#include <vector>
+
+#include "benchmark.hpp"
+
+import lib;
+
+namespace {
+    using compute::kernel_thread;
+    using compute::thread_context;
+    using compute::uint3;
+
+    // Tree reduction through threadgroup memory, one partial sum per group.
+    struct group_sum {
+        const float* in;
+        float* out;
+        std::size_t count;
+
+        kernel_thread operator()(const thread_context& p_thread) const {
+            const std::span<float> shared = p_thread.threadgroup_memory<float>(0);
+            const std::uint32_t local = p_thread.thread_index_in_threadgroup;
+            const std::uint32_t global = p_thread.thread_position_in_grid.x;
+            shared[local] = global < count ? in[global] : 0.f;
+            co_await p_thread.barrier();
+
+            for (std::uint32_t stride = p_thread.threads_per_threadgroup.x / 2;
+                 stride > 0; stride /= 2) {
+                if (local < stride) {
+                    shared[local] += shared[local + stride];
+                }
+                co_await p_thread.barrier();
+            }
+            if (local == 0) {
+                out[p_thread.threadgroup_position_in_grid.x] = shared[0];
+            }
+        }
+    };
+}
+
+int
+main() {
+    jobs::scheduler workers;
+    compute::dispatcher encoder(workers);
+
+    // Same dispatch shape as generate_mandelbrot_texture: the whole grid
+    // with maxTotalThreadsPerThreadgroup-wide groups.
+    constexpr std::uint32_t width = 128;
+    constexpr std::uint32_t height = 128;
+    const uint3 threadgroup = {
+        compute::dispatcher::max_total_threads_per_threadgroup, 1, 1
+    };
+    std::vector<std::uint32_t> texture(width * height);
+    const std::uint32_t frame = 42;
+
+    // Threadgroup memory and barriers.
+    constexpr std::size_t count = 1 << 20;
+    constexpr std::uint32_t group_size = 256;
+    std::vector<float> values(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        values[i] = static_cast<float>(i % 7);
+    }
+    std::vector<float> partials((count + group_size - 1) / group_size);
+    encoder.set_threadgroup_memory_length(group_size * sizeof(float), 0);
+    const group_sum sum_kernel = { values.data(), partials.data(), count };
+    // Emulation overhead next to the hand-vectorized backend.
+    const double port_ns = benchmark::measure_ns([&] {
+        encoder.dispatch_threads({ width, height, 1 }, threadgroup,
+                                 compute::mandelbrot_kernel{ texture, frame });
+        benchmark::do_not_optimize(texture.data());
+    });
+    const double simd_ns = benchmark::measure_ns([&] {
+        compute::dispatch_mandelbrot(workers, width, height, frame, texture);
+        benchmark::do_not_optimize(texture.data());
+    });
+    const double reduce_ns = benchmark::measure_ns([&] {
+        encoder.dispatch_threads({ count, 1, 1 }, { group_size, 1, 1 },
+                                 sum_kernel);
+        benchmark::do_not_optimize(partials.data());
+    });
+    std::println("\n{} workers", workers.worker_count());
+    std::println("mandelbrot {}x{} kernel:        {:8.2f} ms", width, height,
+                 port_ns * 1e-6);
+    std::println("mandelbrot {}x{} simd backend:  {:8.2f} ms", width, height,
+                 simd_ns * 1e-6);
+    std::println("reduction {} floats, barriers: {:8.2f} ms ({:.1f} "
+                 "Mthreads/s)",
+                 count, reduce_ns * 1e-6,
+                 static_cast<double>(count) / reduce_ns * 1e3);
+
+    return 0;
+}
@@ -0,0 +1,246 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+#include <print>
+#include <random>
+#include <span>
+#include <vector>
+
+#include "benchmark.hpp"
+
+import lib;
+
+namespace {
+    constexpr int k_rings = 128;
+    constexpr int k_sides = 64;
+    constexpr std::size_t k_sphere_count = std::size_t{ 1 } << 20;
+
+    gpu::mesh_data make_torus() {
+        gpu::mesh_data mesh;
+        for (int r = 0; r < k_rings; ++r) {
+            for (int s = 0; s < k_sides; ++s) {
+                const float u = 2.f * std::numbers::pi_v<float> * r / k_rings;
+                const float v = 2.f * std::numbers::pi_v<float> * s / k_sides;
+                mesh.vertices.push_back(
+                  { .position = { std::cos(u) * (1.f + 0.35f * std::cos(v)),
+                                  std::sin(u) * (1.f + 0.35f * std::cos(v)),
+                                  0.35f * std::sin(v) },
+                    .normal = { std::cos(u) * std::cos(v),
+                                std::sin(u) * std::cos(v),
+                                std::sin(v) },
+                    .texcoord = { 0.f, 0.f } });
+            }
+        }
+        auto index = [](int p_ring, int p_side) {
+            return static_cast<std::uint32_t>((p_ring % k_rings) * k_sides +
+                                              p_side % k_sides);
+        };
+        for (int r = 0; r < k_rings; ++r) {
+            for (int s = 0; s < k_sides; ++s) {
+                const std::uint32_t a = index(r, s);
+                const std::uint32_t b = index(r + 1, s);
+                const std::uint32_t c = index(r + 1, s + 1);
+                const std::uint32_t d = index(r, s + 1);
+                mesh.indices.insert(mesh.indices.end(), { a, b, c, a, c, d });
+            }
+        }
+        gpu::optimize_vertex_cache(mesh.indices, mesh.vertices.size());
+        return mesh;
+    }
+
+    // Keeps every element in, so only the cone test decides.
+    math::frustum everything() {
+        math::frustum all;
+        std::ranges::fill(all.planes, math::float4{ 0.f, 0.f, 0.f, 1.f });
+        return all;
+    }
+
+    math::float4x4 camera_view_projection() {
+        return math::make_perspective({ .fov_radians = std::numbers::pi_v<float> / 3.f,
+                                        .aspect = 16.f / 9.f,
+                                        .znear = 0.1f,
+                                        .zfar = 100.f }) *
+               math::make_y_rotate(0.4f);
+    }
+
+    // What a straightforward per-element loop does, for the timings.
+    std::size_t cull_scalar(const math::frustum& p_frustum,
+                            const math::float3& p_camera,
+                            const math::bounds_soa& p_bounds,
+                            std::span<std::uint32_t> p_visible) {
+        std::size_t written = 0;
+        for (std::size_t i = 0; i < p_bounds.radius.size(); ++i) {
+            const math::float3 center = { p_bounds.center_x[i],
+                                          p_bounds.center_y[i],
+                                          p_bounds.center_z[i] };
+            const float radius = p_bounds.radius[i];
+            bool visible = true;
+            for (const math::float4& plane : p_frustum.planes) {
+                if (math::dot(plane.xyz(), center) + plane.w < -radius) {
+                    visible = false;
+                    break;
+                }
+            }
+            if (visible && !p_bounds.cone_cutoff.empty()) {
+                const math::float3 offset = center - p_camera;
+                const math::float3 axis = { p_bounds.cone_axis_x[i],
+                                            p_bounds.cone_axis_y[i],
+                                            p_bounds.cone_axis_z[i] };
+                visible = math::dot(offset, axis) <
+                          p_bounds.cone_cutoff[i] * math::length(offset) + radius;
+            }
+            if (visible) {
+                p_visible[written++] = static_cast<std::uint32_t>(i);
+            }
+        }
+        return written;
+    }
+
+    // Spheres scattered around the camera, with cones of random width.
+    math::bounds_storage random_bounds(std::size_t p_count, std::uint32_t p_seed) {
+        std::mt19937 rng(p_seed);
+        std::uniform_real_distribution<float> position(-40.f, 40.f);
+        std::uniform_real_distribution<float> radius(0.05f, 2.f);
+        std::normal_distribution<float> direction;
+        std::uniform_real_distribution<float> cutoff(0.f, 1.f);
+        math::bounds_storage bounds;
+        for (std::size_t i = 0; i < p_count; ++i) {
+            bounds.center_x.push_back(position(rng));
+            bounds.center_y.push_back(position(rng));
+            bounds.center_z.push_back(position(rng));
+            bounds.radius.push_back(radius(rng));
+            const math::float3 axis = math::normalize(
+              { direction(rng), direction(rng), direction(rng) });
+            bounds.cone_axis_x.push_back(axis.x);
+            bounds.cone_axis_y.push_back(axis.y);
+            bounds.cone_axis_z.push_back(axis.z);
+            bounds.cone_cutoff.push_back(cutoff(rng));
+        }
+        return bounds;
+    }
+
+    math::bounds_soa without_cones(math::bounds_soa p_bounds) {
+        p_bounds.cone_axis_x = {};
+        p_bounds.cone_axis_y = {};
+        p_bounds.cone_axis_z = {};
+        p_bounds.cone_cutoff = {};
+        return p_bounds;
+    }
+
+}
+
+int
+main() {
+    const gpu::mesh_data torus = make_torus();
+    const std::size_t triangle_count = torus.indices.size() / 3;
+
+    gpu::meshlet_data meshlets;
+    const double build_ms =
+      benchmark::measure_ns(
+        [&] { meshlets = gpu::build_meshlets(torus.indices, torus.vertices); }, 5) *
+      1e-6;
+
+    // Share of meshlets the cone test drops, seen from around the torus.
+    std::size_t cone_culled = 0;
+    std::size_t cone_tested = 0;
+    {
+        math::bounds_storage bounds;
+        math::split_bounds(meshlets.bounds, bounds);
+        std::mt19937 rng(20);
+        std::normal_distribution<float> direction;
+        std::uniform_real_distribution<float> distance(1.5f, 6.f);
+        std::vector<std::uint32_t> visible(bounds.size());
+        for (int view = 0; view < 256; ++view) {
+            const math::float3 camera =
+              math::normalize({ direction(rng), direction(rng), direction(rng) }) *
+              distance(rng);
+            cone_culled +=
+              bounds.size() -
+              math::cull_bounds(everything(), camera, bounds.view(), visible);
+            cone_tested += bounds.size();
+        }
+    }
+
+    const math::bounds_storage spheres = random_bounds(k_sphere_count, 22);
+    const math::frustum frustum = math::make_frustum(camera_view_projection());
+    const math::float3 camera = { 0.f, 0.f, 0.f };
+
+    // Throughput over a million spheres, frustum only and with cones.
+    std::vector<std::uint32_t> visible(k_sphere_count);
+    std::size_t frustum_visible = 0;
+    std::size_t cone_visible = 0;
+    const auto per_sphere = [&](auto&& p_fn) {
+        return benchmark::measure_ns(p_fn, 20) / k_sphere_count;
+    };
+    const double scalar_frustum_ns = per_sphere([&] {
+        benchmark::do_not_optimize(
+          cull_scalar(frustum, camera, without_cones(spheres.view()), visible));
+    });
+    const double simd_frustum_ns = per_sphere([&] {
+        frustum_visible = math::cull_bounds(
+          frustum, camera, without_cones(spheres.view()), visible);
+        benchmark::do_not_optimize(visible.data());
+    });
+    const double scalar_cone_ns = per_sphere([&] {
+        benchmark::do_not_optimize(
+          cull_scalar(frustum, camera, spheres.view(), visible));
+    });
+    const double simd_cone_ns = per_sphere([&] {
+        cone_visible = math::cull_bounds(frustum, camera, spheres.view(), visible);
+        benchmark::do_not_optimize(visible.data());
+    });
+
+    // The sandbox's 1000-instance grid, bounds placed and culled per frame.
+    std::vector<shader_types::instance_data> grid(1000);
+    for (std::size_t i = 0; i < grid.size(); ++i) {
+        grid[i].instanceTransform =
+          math::make_translate({ (i % 10) * 0.4f - 2.f,
+                                 (i / 10 % 10) * 0.4f - 2.f,
+                                 (i / 100) * 0.4f - 12.f }) *
+          math::make_scale({ 0.2f, 0.2f, 0.2f });
+    }
+    math::bounds_storage grid_bounds;
+    std::size_t grid_visible = 0;
+    const double grid_us =
+      benchmark::measure_ns(
+        [&] {
+            math::transform_bounds(
+              { .center = {}, .radius = std::sqrt(3.f) }, grid, grid_bounds);
+            grid_visible =
+              math::cull_bounds(frustum, camera, grid_bounds.view(), visible);
+        },
+        1000) *
+      1e-3;
+
+    std::size_t meshlet_vertices = 0;
+    for (const gpu::meshlet& m : meshlets.meshlets) {
+        meshlet_vertices += m.vertex_count;
+    }
+    std::println("simd backend: {} ({} lanes)", math::simd_backend(),
+                 math::simd::lanes);
+    std::println("torus {} triangles -> {} meshlets in {:.2f} ms, "
+                 "{:.1f} triangles and {:.1f} vertices each",
+                 triangle_count, meshlets.meshlets.size(), build_ms,
+                 static_cast<double>(triangle_count) / meshlets.meshlets.size(),
+                 static_cast<double>(meshlet_vertices) / meshlets.meshlets.size());
+    std::println("cone test drops {:.1f}% of meshlets over 256 views",
+                 100.0 * cone_culled / cone_tested);
+    std::println("\n{} spheres, {:.1f}% pass the frustum, {:.1f}% with cones",
+                 k_sphere_count, 100.0 * frustum_visible / k_sphere_count,
+                 100.0 * cone_visible / k_sphere_count);
+    std::println("{:<28} {:>10} {:>12} {:>9}", "test", "ns/sphere",
+                 "Mspheres/s", "speedup");
+    const auto row = [](const char* p_name, double p_ns, double p_scalar_ns) {
+        std::println("{:<28} {:>10.3f} {:>12.1f} {:>8.2f}x", p_name, p_ns,
+                     1e3 / p_ns, p_scalar_ns / p_ns);
+    };
+    row("frustum, scalar loop", scalar_frustum_ns, scalar_frustum_ns);
+    row("frustum, simd", simd_frustum_ns, scalar_frustum_ns);
+    row("frustum + cone, scalar loop", scalar_cone_ns, scalar_cone_ns);
+    row("frustum + cone, simd", simd_cone_ns, scalar_cone_ns);
+    std::println("\nsandbox grid: {} instances, place + cull {:.2f} us, {} visible",
+                 grid.size(), grid_us, grid_visible);
+    return 0;
+}
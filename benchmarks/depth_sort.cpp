@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+#include <numeric>
+#include <print>
+#include <random>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "benchmark.hpp"
+
+import lib;
+
+namespace {
+    constexpr std::size_t k_sizes[] = { 1'000, 10'000, 100'000, 1'000'000 };
+
+    // Side of the cube instances are scattered over, keeping the density
+    // the same at every count.
+    float scene_side(std::size_t p_count) {
+        return 4.f * std::cbrt(static_cast<float>(p_count));
+    }
+
+    math::bounds_storage random_bounds(std::size_t p_count, std::uint32_t p_seed) {
+        std::mt19937 rng(p_seed);
+        const float half = scene_side(p_count) * 0.5f;
+        std::uniform_real_distribution<float> position(-half, half);
+        std::uniform_real_distribution<float> radius(0.5f, 2.f);
+        math::bounds_storage bounds;
+        for (std::size_t i = 0; i < p_count; ++i) {
+            bounds.center_x.push_back(position(rng));
+            bounds.center_y.push_back(position(rng));
+            bounds.center_z.push_back(position(rng));
+            bounds.radius.push_back(radius(rng));
+        }
+        return bounds;
+    }
+
+    math::float4x4 camera(std::size_t p_count, float p_yaw) {
+        return math::make_perspective({ .fov_radians = std::numbers::pi_v<float> / 3.f,
+                                        .aspect = 16.f / 9.f,
+                                        .znear = 0.1f,
+                                        .zfar = scene_side(p_count) * 0.5f }) *
+               math::make_y_rotate(p_yaw);
+    }
+
+    std::vector<std::uint32_t> cull(const math::frustum& p_frustum,
+                                    const math::bounds_storage& p_bounds) {
+        std::vector<std::uint32_t> visible(p_bounds.size());
+        visible.resize(math::cull_bounds(p_frustum, {}, p_bounds.view(), visible));
+        return visible;
+    }
+
+    float view_depth(const math::frustum& p_frustum,
+                     const math::bounds_storage& p_bounds,
+                     std::uint32_t p_index) {
+        const math::float4& plane = p_frustum.planes[4];
+        return plane.x * p_bounds.center_x[p_index] +
+               plane.y * p_bounds.center_y[p_index] +
+               plane.z * p_bounds.center_z[p_index] + plane.w;
+    }
+
+    // Unit cube with counter-clockwise outward faces.
+    void unit_cube(std::vector<shader_types::vertex_data>& p_vertices,
+                   std::vector<std::uint32_t>& p_indices) {
+        for (int i = 0; i < 8; ++i) {
+            shader_types::vertex_data vertex{};
+            vertex.position = { i & 1 ? 0.5f : -0.5f, i & 2 ? 0.5f : -0.5f,
+                                i & 4 ? 0.5f : -0.5f };
+            p_vertices.push_back(vertex);
+        }
+        p_indices = { 0, 2, 3, 0, 3, 1, 4, 5, 7, 4, 7, 6, 0, 1, 5, 0, 5, 4,
+                      2, 6, 7, 2, 7, 3, 0, 4, 6, 0, 6, 2, 1, 3, 7, 1, 7, 5 };
+    }
+}
+
+int
+main() {
+    // Overdraw of a grid of cubes drawn in grid order, farthest row first,
+    // against sorted front to back and the reverse.
+    std::vector<shader_types::vertex_data> vertices;
+    std::vector<std::uint32_t> indices;
+    unit_cube(vertices, indices);
+    std::vector<shader_types::instance_data> grid;
+    math::bounds_storage grid_bounds;
+    for (int z = 0; z < 16; ++z) {
+        for (int y = 0; y < 16; ++y) {
+            for (int x = 0; x < 16; ++x) {
+                const math::float3 position = { (x - 7.5f) * 1.5f, (y - 7.5f) * 1.5f,
+                                                -40.f + z * 1.5f };
+                shader_types::instance_data instance{};
+                instance.instanceTransform = math::make_translate(position) *
+                                             math::make_y_rotate(0.4f * x) *
+                                             math::make_x_rotate(0.3f * y);
+                grid.push_back(instance);
+            }
+        }
+    }
+    math::transform_bounds({ .radius = std::sqrt(0.75f) }, grid, grid_bounds);
+    const math::float4x4 grid_camera = math::make_perspective(
+      { .fov_radians = std::numbers::pi_v<float> / 4.f, .aspect = 1.f, .znear = 0.03f, .zfar = 500.f });
+    const math::frustum grid_frustum = math::make_frustum(grid_camera);
+    const std::vector<std::uint32_t> grid_order = cull(grid_frustum, grid_bounds);
+    std::vector<std::uint32_t> sorted_order = grid_order;
+    math::depth_sorter grid_sorter;
+    grid_sorter.sort(grid_frustum, grid_bounds.view(), sorted_order);
+    const std::vector<std::uint32_t> reversed_order(sorted_order.rbegin(),
+                                                    sorted_order.rend());
+    auto overdraw = [&](std::span<const std::uint32_t> p_order) {
+        return gpu::estimate_overdraw(indices, vertices, grid, p_order, grid_camera, 512);
+    };
+    const gpu::overdraw_stats grid_stats = overdraw(grid_order);
+    const gpu::overdraw_stats sorted_stats = overdraw(sorted_order);
+    const gpu::overdraw_stats reversed_stats = overdraw(reversed_order);
+    std::println("{} instances visible of {}, 512x512 target", grid_order.size(), grid.size());
+    std::println("{:<14} {:>10} {:>10} {:>9}", "order", "covered", "shaded", "overdraw");
+    const std::pair<const char*, const gpu::overdraw_stats*> rows[] = {
+        { "grid", &grid_stats }, { "front to back", &sorted_stats },
+        { "back to front", &reversed_stats }
+    };
+    for (const auto& [name, stats] : rows) {
+        std::println("{:<14} {:>10} {:>10} {:>9.2f}", name, stats->covered,
+                     stats->shaded, stats->overdraw());
+    }
+
+    // Every instance is keyed, visible or not, so the sizes match the
+    // table headers.
+    jobs::scheduler pool;
+    std::println("\n{} workers", jobs::scheduler::default_worker_count());
+    std::println("{:>9} {:>9} {:>9} {:>9} {:>9} {:>9} {:>9} {:>9}", "instances",
+                 "radix ms", "par ms", "std ms", "full ms", "turn ms", "par ms",
+                 "fwd ms");
+    for (const std::size_t count : k_sizes) {
+        const std::size_t iterations = count >= 1'000'000 ? 5 : 20;
+        const math::bounds_storage bounds = random_bounds(count, 3);
+        const math::frustum frustum = math::make_frustum(camera(count, 0.f));
+        std::vector<std::uint32_t> keys(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            keys[i] = math::sortable_key(
+              view_depth(frustum, bounds, static_cast<std::uint32_t>(i)));
+        }
+
+        std::vector<std::uint32_t> sort_keys(count);
+        std::vector<std::uint32_t> values(count);
+        std::vector<std::uint32_t> key_scratch(count);
+        std::vector<std::uint32_t> value_scratch(count);
+        auto radix = [&](jobs::scheduler* p_jobs) {
+            return benchmark::measure_ns(
+                     [&] {
+                         sort_keys = keys;
+                         std::iota(values.begin(), values.end(), 0u);
+                         math::radix_sort(sort_keys, values, key_scratch,
+                                          value_scratch, p_jobs);
+                     },
+                     iterations) *
+                   1e-6;
+        };
+        const double radix_ms = radix(nullptr);
+        const double parallel_ms = radix(&pool);
+
+        std::vector<std::uint64_t> packed(count);
+        const double std_ms = benchmark::measure_ns(
+                                [&] {
+                                    for (std::size_t i = 0; i < count; ++i) {
+                                        packed[i] = std::uint64_t{ keys[i] } << 32 | i;
+                                    }
+                                    std::ranges::sort(packed);
+                                },
+                                iterations) *
+                              1e-6;
+
+        std::vector<std::uint32_t> all(count);
+        std::iota(all.begin(), all.end(), 0u);
+        std::vector<std::uint32_t> order(count);
+        math::depth_sorter sorter;
+        const double full_ms = benchmark::measure_ns(
+                                 [&] {
+                                     order = all;
+                                     sorter.reset();
+                                     sorter.sort(frustum, bounds.view(), order);
+                                 },
+                                 iterations) *
+                               1e-6;
+
+        // The camera turns 0.2 degrees or moves forward a tenth of an
+        // instance per frame.
+        float yaw = 0.f;
+        float forward = 0.f;
+        auto frame = [&](bool p_turn, jobs::scheduler* p_jobs) {
+            return benchmark::measure_ns(
+                     [&] {
+                         yaw += p_turn ? 0.0035f : 0.f;
+                         forward += p_turn ? 0.f : 0.1f;
+                         const math::frustum moved = math::make_frustum(
+                           camera(count, yaw) * math::make_translate({ 0.f, 0.f, forward }));
+                         // Culling hands over ascending indices every frame.
+                         order = all;
+                         sorter.sort(moved, bounds.view(), order, p_jobs);
+                     },
+                     iterations) *
+                   1e-6;
+        };
+        const double turn_ms = frame(true, nullptr);
+        const double parallel_turn_ms = frame(true, &pool);
+        const double forward_ms = frame(false, nullptr);
+
+        std::println("{:>9} {:>9.3f} {:>9.3f} {:>9.3f} {:>9.3f} {:>9.3f} {:>9.3f} {:>9.3f}",
+                     count, radix_ms, parallel_ms, std_ms, full_ms, turn_ms,
+                     parallel_turn_ms, forward_ms);
+    }
+
+    std::println("");
+    const bool passed = benchmark::check(
+      "front to back shades the fewest fragments",
+      sorted_stats.covered == grid_stats.covered &&
+        sorted_stats.shaded < grid_stats.shaded &&
+        sorted_stats.shaded < reversed_stats.shaded);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,69 @@
+#include <cstddef>
+#include <print>
+#include <random>
+#include <vector>
+
+#include "benchmark.hpp"
+
+import lib;
+
+namespace {
+    constexpr std::size_t k_instances = 100'000;
+    constexpr std::size_t k_stride = sizeof(shader_types::instance_data);
+    constexpr std::size_t k_page_size = 4096;
+
+    struct strategy {
+        const char* name;
+        gpu::dirty_range_options options;
+    };
+}
+
+int
+main() {
+    gpu::cpu_buffer buffer(k_instances * k_stride);
+
+    const strategy strategies[] = {
+        { "exact", { .max_ranges = k_instances } },
+        { "capped", {} },
+        { "gap 1KiB", { .merge_gap = 1024 } },
+        { "page 4KiB",
+          { .page_size = k_page_size, .buffer_length = buffer.length() } },
+    };
+
+    std::println("{:>8} {:>10} {:>14} {:>10} {:>14} {:>10}",
+                 "churn", "strategy", "flushed bytes", "flushes",
+                 "vs full flush", "us/frame");
+
+    std::mt19937 rng(42);
+    for (double churn : { 0.001, 0.01, 0.1, 1.0 }) {
+        std::vector<std::size_t> changed;
+        std::bernoulli_distribution pick(churn);
+        for (std::size_t i = 0; i < k_instances; ++i) {
+            if (pick(rng)) {
+                changed.push_back(i);
+            }
+        }
+
+        for (const strategy& s : strategies) {
+            gpu::dirty_range_tracker tracker(s.options);
+            const double ns = benchmark::measure_ns([&] {
+                buffer.reset_flush_stats();
+                for (std::size_t i : changed) {
+                    tracker.mark(i * k_stride, k_stride);
+                }
+                tracker.flush([&](std::size_t p_offset, std::size_t p_size) {
+                    buffer.did_modify_range(p_offset, p_size);
+                });
+            });
+
+            std::println("{:>7.1f}% {:>10} {:>14} {:>10} {:>13.2f}% {:>10.2f}",
+                         churn * 100.0, s.name, buffer.flushed_bytes(),
+                         buffer.flush_count(),
+                         100.0 * static_cast<double>(buffer.flushed_bytes()) /
+                           static_cast<double>(buffer.length()),
+                         ns * 1e-3);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <print>
+
+#include "benchmark.hpp"
+
+import lib;
+
+namespace {
+    constexpr std::size_t k_frames_in_flight = 3;
+    constexpr std::size_t k_frames = 1000;
+    // Frames the simulated GPU lags behind the CPU.
+    constexpr std::size_t k_gpu_latency = 2;
+
+    struct frame_stats {
+        std::size_t stalls = 0;
+        std::size_t peak_in_flight = 0;
+    };
+
+    frame_stats simulate(gpu::frame_ring_allocator<gpu::cpu_buffer>& p_ring,
+                         std::size_t p_instances) {
+        frame_stats stats;
+        std::deque<std::uint64_t> gpu_queue;
+        for (std::size_t frame = 0; frame < k_frames; ++frame) {
+            if (gpu_queue.size() > k_gpu_latency) {
+                p_ring.complete_frame(gpu_queue.front());
+                gpu_queue.pop_front();
+            }
+            while (!p_ring.begin_frame()) {
+                // Same as waiting on the frame semaphore in renderer::draw.
+                ++stats.stalls;
+                p_ring.complete_frame(gpu_queue.front());
+                gpu_queue.pop_front();
+            }
+
+            auto instances =
+              p_ring.allocate(p_instances * sizeof(shader_types::instance_data));
+            auto camera = p_ring.allocate(sizeof(shader_types::camera_data));
+            if (!instances || !camera) {
+                ++stats.stalls;
+            }
+            else {
+                std::memset(instances->data, 0, instances->size);
+                std::memset(camera->data, 0, camera->size);
+            }
+            stats.peak_in_flight =
+              std::max(stats.peak_in_flight, p_ring.bytes_in_flight());
+            gpu_queue.push_back(p_ring.end_frame());
+        }
+        return stats;
+    }
+}
+
+int
+main() {
+    std::println("{:>10} {:>14} {:>14} {:>10} {:>12} {:>7}",
+                 "instances", "fixed bytes", "ring bytes", "ratio",
+                 "us/frame", "stalls");
+
+    for (std::size_t count : { 1'000uz, 10'000uz, 100'000uz, 1'000'000uz }) {
+        // What renderer::build_buffers allocated before: three buffers, each
+        // already sized for all frames in flight.
+        const std::size_t fixed_bytes =
+          k_frames_in_flight *
+          (k_frames_in_flight * count * sizeof(shader_types::instance_data) +
+           k_frames_in_flight * sizeof(shader_types::camera_data));
+
+        const std::size_t per_frame =
+          count * sizeof(shader_types::instance_data) +
+          sizeof(shader_types::camera_data) + 2 * gpu::cpu_buffer::alignment;
+        gpu::cpu_buffer buffer(k_frames_in_flight * per_frame);
+
+        frame_stats stats;
+        const double ns = benchmark::measure_ns(
+          [&] {
+              gpu::frame_ring_allocator<gpu::cpu_buffer> ring(
+                &buffer, k_frames_in_flight);
+              stats = simulate(ring, count);
+          },
+          3);
+
+        std::println("{:>10} {:>14} {:>14} {:>9.2f}x {:>12.2f} {:>7}",
+                     count, fixed_bytes, buffer.length(),
+                     static_cast<double>(fixed_bytes) /
+                       static_cast<double>(buffer.length()),
+                     ns * 1e-3 / static_cast<double>(k_frames), stats.stalls);
+    }
+
+    return 0;
+}
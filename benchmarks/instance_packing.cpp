@@ -0,0 +1,133 @@
+#include <cstddef>
+#include <cstdint>
+#include <print>
+#include <random>
+#include <span>
+#include <vector>
+
+#include "benchmark.hpp"
+
+import lib;
+
+namespace {
+    constexpr std::size_t k_instances = 1'000'000;
+    constexpr std::size_t k_frames_in_flight = 3;
+
+    struct instance_streams {
+        std::vector<float> position_x;
+        std::vector<float> position_y;
+        std::vector<float> position_z;
+        std::vector<float> rotation_y;
+        std::vector<float> rotation_z;
+        std::vector<float> scale;
+
+        explicit instance_streams(std::size_t p_count) {
+            std::mt19937 rng(21);
+            std::uniform_real_distribution<float> position(-50.f, 50.f);
+            std::uniform_real_distribution<float> angle(-3.f, 3.f);
+            std::uniform_real_distribution<float> size(0.1f, 2.f);
+            for (std::size_t i = 0; i < p_count; ++i) {
+                position_x.push_back(position(rng));
+                position_y.push_back(position(rng));
+                position_z.push_back(position(rng));
+                rotation_y.push_back(angle(rng));
+                rotation_z.push_back(angle(rng));
+                scale.push_back(size(rng));
+            }
+        }
+
+        [[nodiscard]] math::instance_transform_soa view() const {
+            return { .position_x = position_x,
+                     .position_y = position_y,
+                     .position_z = position_z,
+                     .rotation_y = rotation_y,
+                     .rotation_z = rotation_z,
+                     .scale = scale };
+        }
+    };
+
+}
+
+int
+main() {
+    // Bytes and time to get a million moving instances to the GPU each
+    // frame, full layout against compact.
+    const instance_streams streams(k_instances);
+    gpu::instance_store store(k_instances, k_frames_in_flight);
+    constexpr std::size_t k_full_stride = sizeof(shader_types::instance_data);
+    constexpr std::size_t k_compact_stride =
+      sizeof(shader_types::compact_instance_data);
+    gpu::cpu_buffer full_buffer(k_frames_in_flight * k_instances * k_full_stride);
+    gpu::cpu_buffer compact_buffer(k_frames_in_flight * k_instances *
+                                   k_compact_stride);
+    auto* full_regions =
+      static_cast<shader_types::instance_data*>(full_buffer.contents());
+    auto* compact_regions = static_cast<shader_types::compact_instance_data*>(
+      compact_buffer.contents());
+
+    std::size_t frame = 0;
+    auto upload = [&](gpu::cpu_buffer& p_buffer, auto* p_regions, std::size_t p_stride) {
+        store.touch_all();
+        store.update(math::make_identity(), streams.view());
+        const std::size_t destination = frame++ % k_frames_in_flight;
+        const std::size_t base = destination * k_instances;
+        store.sync(destination,
+                   std::span(p_regions + base, k_instances),
+                   [&](std::size_t p_first, std::size_t p_count) {
+                       p_buffer.did_modify_range((base + p_first) * p_stride,
+                                                 p_count * p_stride);
+                   });
+    };
+    const double update_ns = benchmark::measure_ns(
+      [&] {
+          store.touch_all();
+          store.update(math::make_identity(), streams.view());
+      },
+      10);
+    full_buffer.reset_flush_stats();
+    const double full_ns = benchmark::measure_ns(
+      [&] { upload(full_buffer, full_regions, k_full_stride); }, 10);
+    const std::size_t full_bytes = full_buffer.flushed_bytes();
+    compact_buffer.reset_flush_stats();
+    const double compact_ns = benchmark::measure_ns(
+      [&] { upload(compact_buffer, compact_regions, k_compact_stride); }, 10);
+    const std::size_t compact_bytes = compact_buffer.flushed_bytes();
+
+    std::vector<math::float4> colors(k_instances, { 0.25f, 0.5f, 0.75f, 1.f });
+    std::vector<std::uint32_t> packed_colors(k_instances);
+    const double color_ns = benchmark::measure_ns(
+      [&] {
+          gpu::pack_colors(colors, packed_colors);
+          benchmark::do_not_optimize(packed_colors.data());
+      },
+      10);
+
+    const auto mib = [](std::size_t p_bytes) { return p_bytes / 1048576.0; };
+    std::println("simd backend: {} ({} lanes)", math::simd_backend(),
+                 math::simd::lanes);
+    std::println("{} instances, compose alone {:.2f} ms/frame\n", k_instances,
+                 update_ns * 1e-6);
+    std::println("{:<22} {:>6} {:>10} {:>10} {:>15} {:>8}", "layout",
+                 "bytes", "MiB/frame", "GiB/s @60", "compose+sync ms", "sync ms");
+    // Both syncs read the same full-precision store, so they are bound by
+    // those reads as much as by what they write.
+    const auto row = [&](const char* p_name, std::size_t p_stride, double p_ns) {
+        std::println("{:<22} {:>6} {:>10.1f} {:>10.2f} {:>15.2f} {:>8.2f}",
+                     p_name, p_stride, mib(k_instances * p_stride),
+                     k_instances * p_stride * 60.0 / (1u << 30), p_ns * 1e-6,
+                     (p_ns - update_ns) * 1e-6);
+    };
+    row("instance_data", k_full_stride, full_ns);
+    row("compact_instance_data", k_compact_stride, compact_ns);
+    std::println("\nstatic colors: {} bytes -> {} bytes each, packed in {:.2f} ms",
+                 sizeof(shader_types::instance_static_data),
+                 sizeof(shader_types::compact_instance_static_data),
+                 color_ns * 1e-6);
+
+    std::println("");
+    const bool passed = benchmark::check(
+      "compact frame flushes 48 bytes per instance",
+      compact_bytes * k_full_stride == full_bytes * k_compact_stride &&
+        full_bytes > 0);
+    return passed ? 0 : 1;
+}
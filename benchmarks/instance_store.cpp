@@ -0,0 +1,129 @@
+#include <cmath>
+#include <cstddef>
+#include <print>
+#include <span>
+#include <random>
+#include <vector>
+
+#include "benchmark.hpp"
+
+import lib;
+
+namespace {
+    constexpr std::size_t k_instances = 100'000;
+    constexpr std::size_t k_frames_in_flight = 3;
+    constexpr std::size_t k_frames = 30;
+    constexpr std::size_t k_stride = sizeof(shader_types::instance_data);
+
+    struct instance_streams {
+        std::vector<float> position_x;
+        std::vector<float> position_y;
+        std::vector<float> position_z;
+        std::vector<float> rotation_y;
+        std::vector<float> rotation_z;
+        std::vector<float> scale;
+
+        instance_streams()
+          : position_x(k_instances)
+          , position_y(k_instances)
+          , position_z(k_instances)
+          , rotation_y(k_instances)
+          , rotation_z(k_instances)
+          , scale(k_instances, 0.2f) {
+            for (std::size_t i = 0; i < k_instances; ++i) {
+                const float f = static_cast<float>(i);
+                position_x[i] = std::fmod(f, 100.f);
+                position_y[i] = std::fmod(f * 0.37f, 100.f);
+                position_z[i] = -f * 0.01f;
+                rotation_y[i] = std::cos(f);
+                rotation_z[i] = std::sin(f);
+            }
+        }
+
+        [[nodiscard]] math::instance_transform_soa view() const {
+            return { .position_x = position_x,
+                     .position_y = position_y,
+                     .position_z = position_z,
+                     .rotation_y = rotation_y,
+                     .rotation_z = rotation_z,
+                     .scale = scale };
+        }
+    };
+}
+
+int
+main() {
+    instance_streams streams;
+    const math::float4x4 parent = math::make_identity();
+    gpu::cpu_buffer buffer(k_frames_in_flight * k_instances * k_stride);
+    auto* regions =
+      static_cast<shader_types::instance_data*>(buffer.contents());
+
+    std::println("{:>7} {:>16} {:>16} {:>9} {:>16} {:>16}",
+                 "churn", "full us/frame", "store us/frame", "speedup",
+                 "full bytes", "store bytes");
+
+    std::mt19937 rng(7);
+    for (double churn : { 0.0, 0.01, 0.1, 1.0 }) {
+        std::vector<std::size_t> moved;
+        std::bernoulli_distribution pick(churn);
+        for (std::size_t i = 0; i < k_instances; ++i) {
+            if (pick(rng)) {
+                moved.push_back(i);
+            }
+        }
+
+        // Baseline: recompute and re-upload every instance every frame.
+        const double full_ns = benchmark::measure_ns(
+          [&] {
+              buffer.reset_flush_stats();
+              for (std::size_t frame = 0; frame < k_frames; ++frame) {
+                  std::span region(
+                    regions + (frame % k_frames_in_flight) * k_instances,
+                    k_instances);
+                  math::compose_instance_transforms(parent, streams.view(), region);
+                  buffer.did_modify_range(
+                    (frame % k_frames_in_flight) * k_instances * k_stride,
+                    k_instances * k_stride);
+              }
+          },
+          3);
+        const std::size_t full_bytes = buffer.flushed_bytes() / k_frames;
+
+        gpu::instance_store store(k_instances, k_frames_in_flight);
+        gpu::dirty_range_tracker dirty;
+        auto run_frames = [&] {
+            buffer.reset_flush_stats();
+            for (std::size_t frame = 0; frame < k_frames; ++frame) {
+                for (std::size_t i : moved) {
+                    store.touch(i);
+                }
+                store.update(parent, streams.view());
+
+                const std::size_t destination = frame % k_frames_in_flight;
+                const std::size_t base = destination * k_instances;
+                store.sync(destination,
+                           { regions + base, k_instances },
+                           [&](std::size_t p_first, std::size_t p_count) {
+                               dirty.mark((base + p_first) * k_stride,
+                                          p_count * k_stride);
+                           });
+                dirty.flush([&](std::size_t p_offset, std::size_t p_size) {
+                    buffer.did_modify_range(p_offset, p_size);
+                });
+            }
+        };
+        // Let the initial full upload reach every destination first.
+        run_frames();
+        const double store_ns = benchmark::measure_ns(run_frames, 3);
+        const std::size_t store_bytes = buffer.flushed_bytes() / k_frames;
+
+        const double frames = static_cast<double>(k_frames);
+        std::println("{:>6.0f}% {:>16.2f} {:>16.2f} {:>8.2f}x {:>16} {:>16}",
+                     churn * 100.0, full_ns * 1e-3 / frames,
+                     store_ns * 1e-3 / frames, full_ns / store_ns,
+                     full_bytes, store_bytes);
+    }
+
+    return 0;
+}
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <print>
+#include <vector>
+
+#include "benchmark.hpp"
+
+import lib;
+
+using math::float3;
+using math::float4x4;
+
+namespace {
+    constexpr float k_scale = 0.2f;
+    constexpr float k_angle = 0.75f;
+    constexpr float3 k_object_position = { 0.f, 0.f, -10.f };
+    // The batched path multiplies the transforms out in a different order,
+    // so it drifts a few float ulps from the loop on the largest grid
+    // coordinates (tens of units at a million instances), never more.
+    constexpr float k_tolerance = 1e-4f;
+
+    struct grid_instances {
+        std::vector<float> position_x;
+        std::vector<float> position_y;
+        std::vector<float> position_z;
+        std::vector<float> rotation_y;
+        std::vector<float> rotation_z;
+        std::vector<float> scale;
+
+        explicit grid_instances(std::size_t p_count) {
+            const std::size_t side = static_cast<std::size_t>(
+              std::ceil(std::cbrt(static_cast<double>(p_count))));
+            for (std::size_t i = 0; i < p_count; ++i) {
+                const float ix = static_cast<float>(i % side);
+                const float iy = static_cast<float>((i / side) % side);
+                const float iz = static_cast<float>(i / (side * side));
+                const float half = static_cast<float>(side) / 2.f;
+                position_x.push_back(k_object_position.x +
+                                     (ix - half) * (2.f * k_scale) + k_scale);
+                position_y.push_back(k_object_position.y +
+                                     (iy - half) * (2.f * k_scale) + k_scale);
+                position_z.push_back(k_object_position.z +
+                                     (iz - half) * (2.f * k_scale));
+                rotation_y.push_back(std::cos(iy));
+                rotation_z.push_back(std::sin(ix));
+                scale.push_back(k_scale);
+            }
+        }
+
+        [[nodiscard]] math::instance_transform_soa view() const {
+            return { .position_x = position_x,
+                     .position_y = position_y,
+                     .position_z = position_z,
+                     .rotation_y = rotation_y,
+                     .rotation_z = rotation_z,
+                     .scale = scale,
+                     .angle_scale = k_angle };
+        }
+    };
+
+    float4x4 object_rotation() {
+        return math::make_translate(k_object_position) *
+               math::make_y_rotate(-k_angle) *
+               math::make_x_rotate(k_angle * 0.5f) *
+               math::make_translate(-k_object_position);
+    }
+
+    // Mirrors the per-instance loop in renderer::draw.
+    void per_instance_loop(const float4x4& p_parent,
+                           const grid_instances& p_grid,
+                           std::vector<shader_types::instance_data>& p_out) {
+        for (std::size_t i = 0; i < p_out.size(); ++i) {
+            const float4x4 scale =
+              math::make_scale({ k_scale, k_scale, k_scale });
+            const float4x4 zrot =
+              math::make_z_rotate(k_angle * p_grid.rotation_z[i]);
+            const float4x4 yrot =
+              math::make_y_rotate(k_angle * p_grid.rotation_y[i]);
+            const float4x4 translate = math::make_translate(
+              { p_grid.position_x[i], p_grid.position_y[i], p_grid.position_z[i] });
+
+            p_out[i].instanceTransform =
+              p_parent * translate * yrot * zrot * scale;
+            p_out[i].instanceNormalTransform =
+              math::discard_translation(p_out[i].instanceTransform);
+        }
+    }
+
+    float max_difference(const std::vector<shader_types::instance_data>& p_a,
+                         const std::vector<shader_types::instance_data>& p_b) {
+        float diff = 0.f;
+        for (std::size_t i = 0; i < p_a.size(); ++i) {
+            const float* a = &p_a[i].instanceTransform.columns[0].x;
+            const float* b = &p_b[i].instanceTransform.columns[0].x;
+            for (std::size_t j = 0; j < 16; ++j) {
+                diff = std::max(diff, std::abs(a[j] - b[j]));
+            }
+        }
+        return diff;
+    }
+}
+
+int
+main() {
+    std::println("simd backend: {}", math::simd_backend());
+    std::println("{:>10} {:>14} {:>14} {:>9} {:>10}",
+                 "instances", "loop ns/inst", "batch ns/inst", "speedup",
+                 "max diff");
+
+    const float4x4 parent = object_rotation();
+    float worst_difference = 0.f;
+    for (std::size_t count : { 1'000uz, 10'000uz, 100'000uz, 1'000'000uz }) {
+        const grid_instances grid(count);
+        std::vector<shader_types::instance_data> reference(count);
+        std::vector<shader_types::instance_data> batched(count);
+
+        const double loop_ns = benchmark::measure_ns([&] {
+            per_instance_loop(parent, grid, reference);
+            benchmark::do_not_optimize(reference.data());
+        });
+        const double batch_ns = benchmark::measure_ns([&] {
+            math::compose_instance_transforms(parent, grid.view(), batched);
+            benchmark::do_not_optimize(batched.data());
+        });
+
+        const double n = static_cast<double>(count);
+        const float difference = max_difference(reference, batched);
+        worst_difference = std::max(worst_difference, difference);
+        std::println("{:>10} {:>14.2f} {:>14.2f} {:>8.2f}x {:>10.2e}",
+                     count, loop_ns / n, batch_ns / n, loop_ns / batch_ns,
+                     difference);
+    }
+
+    std::println("");
+    const bool passed = benchmark::check("batched matches the loop",
+                                         worst_difference <= k_tolerance);
+    return passed ? 0 : 1;
+}
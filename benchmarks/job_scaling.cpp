@@ -0,0 +1,88 @@
+#include <cmath>
+#include <cstddef>
+#include <print>
+#include <vector>
+
+#include "benchmark.hpp"
+
+import lib;
+
+namespace {
+    struct instance_streams {
+        std::vector<float> position_x;
+        std::vector<float> position_y;
+        std::vector<float> position_z;
+        std::vector<float> rotation_y;
+        std::vector<float> rotation_z;
+        std::vector<float> scale;
+
+        explicit instance_streams(std::size_t p_count)
+          : position_x(p_count)
+          , position_y(p_count)
+          , position_z(p_count)
+          , rotation_y(p_count)
+          , rotation_z(p_count)
+          , scale(p_count, 0.2f) {
+            for (std::size_t i = 0; i < p_count; ++i) {
+                const float f = static_cast<float>(i);
+                position_x[i] = std::fmod(f, 100.f);
+                position_y[i] = std::fmod(f * 0.37f, 100.f);
+                position_z[i] = -f * 0.01f;
+                rotation_y[i] = std::cos(f);
+                rotation_z[i] = std::sin(f);
+            }
+        }
+
+        [[nodiscard]] math::instance_transform_soa view() const {
+            return { .position_x = position_x,
+                     .position_y = position_y,
+                     .position_z = position_z,
+                     .rotation_y = rotation_y,
+                     .rotation_z = rotation_z,
+                     .scale = scale,
+                     .angle_scale = 0.75f };
+        }
+    };
+
+    constexpr std::size_t k_grain = 1024;
+}
+
+int
+main() {
+    const std::size_t max_threads = jobs::scheduler::default_worker_count() + 1;
+    const math::float4x4 parent = math::make_y_rotate(0.3f);
+
+    std::println("{:>10} {:>8} {:>12} {:>9}",
+                 "instances", "threads", "ms/frame", "speedup");
+
+    for (std::size_t count : { 1'000uz, 10'000uz, 100'000uz, 1'000'000uz }) {
+        const instance_streams streams(count);
+        const math::instance_transform_soa soa = streams.view();
+        std::vector<shader_types::instance_data> out(count);
+
+        double single_thread_ns = 0.0;
+        // Powers of two, then max_threads itself when it is not one.
+        for (std::size_t threads = 1; threads <= max_threads;
+             threads = (threads < max_threads && threads * 2 > max_threads)
+                         ? max_threads
+                         : threads * 2) {
+            jobs::scheduler scheduler(threads - 1);
+            const double ns = benchmark::measure_ns([&] {
+                scheduler.parallel_for(
+                  count, k_grain, [&](std::size_t p_begin, std::size_t p_end) {
+                      math::compose_instance_transforms(
+                        parent,
+                        soa,
+                        std::span(out).subspan(p_begin, p_end - p_begin),
+                        p_begin);
+                  });
+                benchmark::do_not_optimize(out.data());
+            });
+            if (threads == 1) {
+                single_thread_ns = ns;
+            }
+            std::println("{:>10} {:>8} {:>12.3f} {:>8.2f}x",
+                         count, threads, ns * 1e-6, single_thread_ns / ns);
+        }
+    }
+}
@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <print>
+#include <vector>
+
+#include "benchmark.hpp"
+
+import lib;
+
+namespace {
+    // The sandbox texture and its animation cycle.
+    constexpr std::uint32_t k_width = 128;
+    constexpr std::uint32_t k_height = 128;
+    constexpr std::size_t k_pixels = std::size_t{ k_width } * k_height;
+    constexpr std::uint32_t k_cycle = 5000;
+
+    // Same shading as the sandbox's CPU path.
+    constexpr compute::mandelbrot_options k_shading = { .boundary_tracing =
+                                                          true };
+    constexpr compute::mandelbrot_params k_params = { .interior_checks = true,
+                                                      .periodicity = true };
+
+    std::size_t mismatches(const std::vector<std::uint32_t>& p_a,
+                           const std::vector<std::uint32_t>& p_b) {
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < p_a.size(); ++i) {
+            count += p_a[i] != p_b[i];
+        }
+        return count;
+    }
+
+    struct run_result {
+        double ns_per_frame = 0.0;
+        //! Mean share of pixels that differ from a full recompute.
+        double mismatch = 0.0;
+        double worst_mismatch = 0.0;
+    };
+
+    // Plays one animation cycle, p_render(frame, out) produces each frame.
+    template<typename Render>
+    run_result play(const std::vector<std::vector<std::uint32_t>>& p_truth,
+                    Render&& p_render) {
+        std::vector<std::uint32_t> frame(k_pixels);
+        run_result result;
+        double total_ns = 0.0;
+        for (std::uint32_t i = 0; i < k_cycle; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            p_render(i, frame);
+            benchmark::do_not_optimize(frame.data());
+            total_ns += std::chrono::duration<double, std::nano>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+            if (!p_truth.empty()) {
+                const double share =
+                  static_cast<double>(mismatches(frame, p_truth[i])) /
+                  static_cast<double>(k_pixels);
+                result.mismatch += share;
+                result.worst_mismatch = std::max(result.worst_mismatch, share);
+            }
+        }
+        result.ns_per_frame = total_ns / k_cycle;
+        result.mismatch /= k_cycle;
+        return result;
+    }
+}
+
+int
+main() {
+    jobs::scheduler workers;
+
+    std::vector<std::vector<std::uint32_t>> truth(
+      k_cycle, std::vector<std::uint32_t>(k_pixels));
+    for (std::uint32_t i = 0; i < k_cycle; ++i) {
+        compute::dispatch_mandelbrot(workers, k_width, k_height, i, truth[i],
+                                     k_shading, k_params);
+    }
+
+    const run_result full =
+      play({}, [&](std::uint32_t p_frame, auto& p_out) {
+          compute::dispatch_mandelbrot(workers, k_width, k_height, p_frame,
+                                       p_out, k_shading, k_params);
+      });
+
+    struct config {
+        const char* name;
+        compute::mandelbrot_frame_cache_options options;
+        bool prefill;
+    };
+    const config configs[] = {
+        { "exact, 16 MiB", { .max_bytes = 16u << 20 }, true },
+        { "0.25 px, 16 MiB",
+          { .max_bytes = 16u << 20, .max_error = 0.25f },
+          false },
+        { "0.5 px, 4 MiB, prefill",
+          { .max_bytes = 4u << 20, .max_error = 0.5f },
+          true },
+        { "0.5 px, 16 MiB, prefill",
+          { .max_bytes = 16u << 20, .max_error = 0.5f },
+          true },
+        { "exact, whole cycle", { .max_bytes = k_cycle * k_pixels * 4 }, false },
+    };
+
+    std::println("{}x{}, {} frames per cycle, {} workers", k_width,
+                 k_height, k_cycle, workers.worker_count());
+    std::println("{:<28} {:>9} {:>8} {:>6} {:>6} {:>6} {:>9} {:>9}", "mode",
+                 "us/frame", "speedup", "hits", "reproj", "full",
+                 "mismatch", "worst");
+    std::println("{:<28} {:>9.1f} {:>7.1f}x", "full recompute",
+                 full.ns_per_frame * 1e-3, 1.0);
+    for (const config& c : configs) {
+        compute::mandelbrot_frame_cache cache(k_width, k_height, c.options,
+                                              k_shading, k_params);
+        if (c.prefill) {
+            cache.prefill(workers);
+        }
+        else {
+            // Without a prefill the second cycle is what a long-running
+            // sandbox sees.
+            play({}, [&](std::uint32_t p_frame, auto& p_out) {
+                cache.render(workers, p_frame, p_out);
+            });
+        }
+        const compute::mandelbrot_frame_cache_stats before = cache.stats();
+        const run_result steady =
+          play(truth, [&](std::uint32_t p_frame, auto& p_out) {
+              cache.render(workers, p_frame, p_out);
+          });
+        const compute::mandelbrot_frame_cache_stats& after = cache.stats();
+        std::println("{:<28} {:>9.1f} {:>7.1f}x {:>6} {:>6} {:>6} {:>8.2f}% "
+                     "{:>8.2f}%",
+                     c.name, steady.ns_per_frame * 1e-3,
+                     full.ns_per_frame / steady.ns_per_frame,
+                     after.hits - before.hits,
+                     after.reprojections - before.reprojections,
+                     after.computes - before.computes, steady.mismatch * 100,
+                     steady.worst_mismatch * 100);
+    }
+
+    return 0;
+}
@@ -0,0 +1,61 @@
+#include <cstddef>
+#include <cstdint>
+#include <print>
+#include <vector>
+
+#include "benchmark.hpp"
+
+import lib;
+
+namespace {
+    constexpr std::uint32_t k_width = 512;
+    constexpr std::uint32_t k_height = 512;
+    constexpr std::size_t k_pixels = std::size_t{ k_width } * k_height;
+
+    double mpixels_per_s(double p_ns) {
+        return static_cast<double>(k_pixels) / p_ns * 1e3;
+    }
+}
+
+int
+main() {
+    jobs::scheduler serial(0);
+    jobs::scheduler workers;
+    std::vector<std::uint32_t> reference(k_pixels);
+    std::vector<std::uint32_t> image(k_pixels);
+
+    std::println("{}x{} frame 0, {} workers, simd lanes {}", k_width,
+                 k_height, workers.worker_count(), math::simd::lanes);
+    std::println("{:<30} {:>10} {:>12} {:>9}", "backend", "ms", "Mpixel/s",
+                 "speedup");
+    const double reference_ns = benchmark::measure_ns(
+      [&] {
+          compute::dispatch_mandelbrot_reference(k_width, k_height, 0,
+                                                 reference);
+          benchmark::do_not_optimize(reference.data());
+      },
+      3);
+    auto report = [&](const char* p_name, double p_ns) {
+        std::println("{:<30} {:>10.2f} {:>12.1f} {:>8.1f}x", p_name,
+                     p_ns * 1e-6, mpixels_per_s(p_ns), reference_ns / p_ns);
+    };
+    report("scalar reference", reference_ns);
+
+    auto run = [&](jobs::scheduler& p_jobs,
+                   compute::mandelbrot_options p_options) {
+        return benchmark::measure_ns(
+          [&] {
+              compute::dispatch_mandelbrot(p_jobs, k_width, k_height, 0, image,
+                                           p_options);
+              benchmark::do_not_optimize(image.data());
+          },
+          5);
+    };
+    report("simd 1 register, 1 thread", run(serial, { .registers = 1 }));
+    report("simd 2 registers, 1 thread", run(serial, { .registers = 2 }));
+    report("simd 2 registers, all threads", run(workers, { .registers = 2 }));
+    report("  one tile per row band",
+           run(workers, { .tile_width = k_width, .tile_height = 64 }));
+
+    return 0;
+}
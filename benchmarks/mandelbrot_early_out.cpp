@@ -0,0 +1,72 @@
+#include <cstddef>
+#include <cstdint>
+#include <print>
+#include <vector>
+
+#include "benchmark.hpp"
+
+import lib;
+
+namespace {
+    constexpr std::uint32_t k_width = 512;
+    constexpr std::uint32_t k_height = 512;
+    constexpr std::size_t k_pixels = std::size_t{ k_width } * k_height;
+
+    // Frame 0 is the wide view with the most interior, 314 the deepest zoom.
+    constexpr std::uint32_t k_frames[] = { 0, 100, 314 };
+
+    struct variant {
+        const char* name;
+        compute::mandelbrot_options options;
+        compute::mandelbrot_params params;
+    };
+}
+
+int
+main() {
+    jobs::scheduler workers;
+    std::vector<std::uint32_t> image(k_pixels);
+
+    const compute::mandelbrot_params checked = { .interior_checks = true,
+                                                 .periodicity = true };
+    const variant variants[] = {
+        { "plain simd", {}, {} },
+        { "cardioid/bulb", {}, { .interior_checks = true } },
+        { "periodicity", {}, { .periodicity = true } },
+        { "boundary tracing", { .boundary_tracing = true }, {} },
+        { "all three", { .boundary_tracing = true }, checked },
+    };
+
+    std::println("{}x{} frame 0, {} workers, simd lanes {}", k_width,
+                 k_height, workers.worker_count(), math::simd::lanes);
+    std::println("{:<18} {:>14} {:>7} {:>9} {:>9} {:>9} {:>9} {:>8}",
+                 "variant", "lane iters", "saved", "interior", "periodic",
+                 "filled", "ms", "speedup");
+    std::uint64_t plain_iterations = 0;
+    double plain_ns = 0.0;
+    for (const variant& v : variants) {
+        const compute::mandelbrot_stats stats = compute::dispatch_mandelbrot(
+          workers, k_width, k_height, 0, image, v.options, v.params);
+        const double ns = benchmark::measure_ns(
+          [&] {
+              compute::dispatch_mandelbrot(workers, k_width, k_height, 0,
+                                           image, v.options, v.params);
+              benchmark::do_not_optimize(image.data());
+          },
+          5);
+        if (plain_iterations == 0) {
+            plain_iterations = stats.lane_iterations;
+            plain_ns = ns;
+        }
+        const double saved =
+          100.0 * (1.0 - static_cast<double>(stats.lane_iterations) /
+                           static_cast<double>(plain_iterations));
+        std::println("{:<18} {:>14} {:>6.1f}% {:>9} {:>9} {:>9} {:>9.2f} "
+                     "{:>7.1f}x",
+                     v.name, stats.lane_iterations, saved,
+                     stats.interior_pixels, stats.periodic_pixels,
+                     stats.filled_pixels, ns * 1e-6, plain_ns / ns);
+    }
+
+    return 0;
+}
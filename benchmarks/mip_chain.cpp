@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <print>
+#include <random>
+#include <span>
+#include <vector>
+
+#include "benchmark.hpp"
+
+import lib;
+
+namespace {
+    struct case_config {
+        const char* name;
+        gpu::texel_format format;
+        gpu::mip_filter filter;
+    };
+
+    constexpr case_config k_cases[] = {
+        { "rgba8 box", gpu::texel_format::rgba8_unorm, gpu::mip_filter::box },
+        { "rgba8 kaiser", gpu::texel_format::rgba8_unorm,
+          gpu::mip_filter::kaiser },
+        { "rgba16f box", gpu::texel_format::rgba16_float,
+          gpu::mip_filter::box },
+        { "rgba16f kaiser", gpu::texel_format::rgba16_float,
+          gpu::mip_filter::kaiser },
+    };
+
+    // A smooth gradient plus noise, so both the filter weights and the
+    // rounding get exercised.
+    std::vector<std::byte> make_image(gpu::texel_format p_format,
+                                      std::uint32_t p_width,
+                                      std::uint32_t p_height) {
+        std::vector<std::byte> image(std::size_t{ p_width } * p_height *
+                                     gpu::texel_bytes(p_format));
+        std::mt19937 random(p_width * 31 + p_height);
+        std::uniform_real_distribution<float> noise(-0.1f, 0.1f);
+        for (std::uint32_t y = 0; y < p_height; ++y) {
+            for (std::uint32_t x = 0; x < p_width; ++x) {
+                const std::size_t texel = std::size_t{ y } * p_width + x;
+                const float u = static_cast<float>(x) / p_width;
+                const float v = static_cast<float>(y) / p_height;
+                const float channels[4] = { u, v, 0.5f + 0.5f * std::sin(8 * u),
+                                            1.f - u * v };
+                for (int c = 0; c < 4; ++c) {
+                    const float value =
+                      std::clamp(channels[c] + noise(random), 0.f, 1.f);
+                    if (p_format == gpu::texel_format::rgba8_unorm) {
+                        image[texel * 4 + c] =
+                          static_cast<std::byte>(std::lround(value * 255.f));
+                    }
+                    else {
+                        const std::uint16_t half = gpu::float_to_half(value);
+                        std::memcpy(&image[texel * 8 + c * 2], &half, 2);
+                    }
+                }
+            }
+        }
+        return image;
+    }
+
+}
+
+int
+main() {
+    jobs::scheduler workers;
+
+    constexpr std::uint32_t k_size = 1024;
+    std::println("{}x{} level 0 to 1, {} workers, simd lanes {}", k_size,
+                 k_size, workers.worker_count(), math::simd::lanes);
+    std::println("{:<16} {:>12} {:>12} {:>8} {:>11}", "case", "simd ms",
+                 "scalar ms", "speedup", "chain ms");
+    for (const case_config& c : k_cases) {
+        const gpu::mip_chain_layout layout =
+          gpu::mip_chain_layout::make(c.format, k_size, k_size);
+        std::vector<std::byte> storage(layout.bytes);
+        const std::vector<std::byte> image = make_image(c.format, k_size, k_size);
+        std::ranges::copy(image, storage.begin());
+        const std::span<const std::byte> level0 =
+          std::span(storage).first(layout.levels[0].bytes());
+        const std::span<std::byte> level1 = std::span(storage).subspan(
+          layout.levels[1].offset, layout.levels[1].bytes());
+
+        const double simd_ns = benchmark::measure_ns(
+          [&] {
+              gpu::downsample(
+                workers, c.format, c.filter, level0, k_size, k_size, level1);
+              benchmark::do_not_optimize(level1.data());
+          },
+          10);
+        const double scalar_ns = benchmark::measure_ns(
+          [&] {
+              gpu::downsample_reference(
+                c.format, c.filter, level0, k_size, k_size, level1);
+              benchmark::do_not_optimize(level1.data());
+          },
+          3);
+        const double chain_ns = benchmark::measure_ns(
+          [&] {
+              gpu::build_mip_chain(workers, layout, c.filter, storage);
+              benchmark::do_not_optimize(storage.data());
+          },
+          10);
+        std::println("{:<16} {:>12.3f} {:>12.3f} {:>7.1f}x {:>11.3f}",
+                     c.name, simd_ns * 1e-6, scalar_ns * 1e-6,
+                     scalar_ns / simd_ns, chain_ns * 1e-6);
+    }
+
+    return 0;
+}
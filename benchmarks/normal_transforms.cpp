@@ -0,0 +1,102 @@
+#include <cstddef>
+#include <print>
+#include <random>
+#include <span>
+#include <vector>
+
+#include "benchmark.hpp"
+
+import lib;
+
+namespace {
+    constexpr std::size_t k_matrices = 1'000'000;
+    constexpr std::size_t k_cached_matrices = 4096;
+
+    // Rotation, scale and translation, scaled unevenly unless p_uniform,
+    // sheared now and then and mirrored now and then.
+    math::float4x4 random_transform(std::mt19937& p_rng, bool p_uniform) {
+        std::uniform_real_distribution<float> angle(-3.f, 3.f);
+        std::uniform_real_distribution<float> scale(0.2f, 5.f);
+        std::uniform_real_distribution<float> offset(-100.f, 100.f);
+        std::uniform_real_distribution<float> unit(0.f, 1.f);
+        const float s = scale(p_rng);
+        math::float3 scales = { s, s, s };
+        if (!p_uniform) {
+            scales = { scale(p_rng), scale(p_rng), scale(p_rng) };
+        }
+        if (unit(p_rng) < 0.25f) {
+            scales.x = -scales.x;
+        }
+        math::float4x4 m = math::make_translate({ offset(p_rng), offset(p_rng),
+                                                  offset(p_rng) }) *
+                           math::make_y_rotate(angle(p_rng)) *
+                           math::make_x_rotate(angle(p_rng)) *
+                           math::make_scale(scales);
+        if (!p_uniform && unit(p_rng) < 0.5f) {
+            math::float4x4 shear = math::make_identity();
+            shear.columns[1].x = unit(p_rng);
+            m = m * shear;
+        }
+        return m;
+    }
+
+}
+
+int
+main() {
+    std::mt19937 rng(23);
+
+    std::vector<math::float4x4> general(k_matrices);
+    std::vector<math::float4x4> uniform(k_matrices);
+    for (std::size_t i = 0; i < k_matrices; ++i) {
+        general[i] = random_transform(rng, false);
+        uniform[i] = random_transform(rng, true);
+    }
+    std::vector<math::float3x3> results(k_matrices);
+
+    std::println("simd backend: {} ({} lanes)", math::simd_backend(),
+                 math::simd::lanes);
+
+    // A batch that stays in cache shows the arithmetic, a million matrices
+    // mostly show memory bandwidth.
+    for (std::size_t count : { k_cached_matrices, k_matrices }) {
+        const std::size_t iterations = count == k_matrices ? 10 : 1000;
+        const auto per_matrix = [&](auto&& p_fn) {
+            return benchmark::measure_ns(p_fn, iterations) / count;
+        };
+        const std::span<const math::float4x4> general_in(general.data(), count);
+        const std::span<const math::float4x4> uniform_in(uniform.data(), count);
+        const std::span<math::float3x3> out(results.data(), count);
+        const double scalar_ns = per_matrix([&] {
+            for (std::size_t i = 0; i < count; ++i) {
+                out[i] = math::normal_transform(general_in[i]);
+            }
+            benchmark::do_not_optimize(out.data());
+        });
+        const double general_ns = per_matrix([&] {
+            math::normal_transforms(general_in, out);
+            benchmark::do_not_optimize(out.data());
+        });
+        const double uniform_ns = per_matrix([&] {
+            math::normal_transforms(uniform_in, out);
+            benchmark::do_not_optimize(out.data());
+        });
+        const double discard_ns = per_matrix([&] {
+            for (std::size_t i = 0; i < count; ++i) {
+                out[i] = math::discard_translation(general_in[i]);
+            }
+            benchmark::do_not_optimize(out.data());
+        });
+
+        std::println("\n{} matrices", count);
+        std::println("{:<34} {:>10} {:>9}", "kernel", "ns/matrix", "speedup");
+        const auto row = [&](const char* p_name, double p_ns) {
+            std::println("{:<34} {:>10.3f} {:>8.2f}x", p_name, p_ns, scalar_ns / p_ns);
+        };
+        row("normal_transform, scalar loop", scalar_ns);
+        row("normal_transforms, general", general_ns);
+        row("normal_transforms, uniform", uniform_ns);
+        row("discard_translation (wrong)", discard_ns);
+    }
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include <cstddef>
+#include <filesystem>
+#include <format>
+#include <print>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+
+import lib;
+
+namespace {
+    constexpr std::size_t k_pipelines = 64;
+    constexpr std::size_t k_source_bytes = 16 * 1024;
+
+    struct pipeline_source {
+        std::string source;
+        std::uint32_t color_format;
+        std::uint32_t depth_format;
+    };
+
+    std::vector<pipeline_source> make_sources() {
+        std::vector<pipeline_source> sources;
+        for (std::size_t i = 0; i < k_pipelines; ++i) {
+            std::string source = std::format("// pipeline {:04}\n", i);
+            while (source.size() < k_source_bytes) {
+                source += "float4 shade(float4 c) { return c * 0.5; }\n";
+            }
+            sources.push_back({ std::move(source), 81, 250 });
+        }
+        return sources;
+    }
+
+    gpu::pipeline_key key_of(const pipeline_source& p_source) {
+        return gpu::pipeline_hasher{}
+          .add(p_source.source)
+          .add(std::string_view("vertexMain"))
+          .add(std::string_view("fragmentMain"))
+          .add(p_source.color_format)
+          .add(p_source.depth_format)
+          .finish();
+    }
+
+    // Builds every pipeline through the cache, returning how many compiled.
+    std::size_t build_all(gpu::pipeline_cache& p_cache,
+                          const std::vector<pipeline_source>& p_sources) {
+        gpu::fake_shader_compiler compiler;
+        for (const pipeline_source& source : p_sources) {
+            auto artifact = p_cache.load_or_compile(
+              key_of(source), [&] { return compiler(source.source); });
+            benchmark::do_not_optimize(artifact.data());
+        }
+        return compiler.compile_count();
+    }
+}
+
+int
+main() {
+    const std::filesystem::path directory =
+      std::filesystem::temp_directory_path() / "metal-cpp-pipeline-cache";
+    std::filesystem::remove_all(directory);
+
+    const std::vector<pipeline_source> sources = make_sources();
+
+    // Startup cost of resolving every pipeline from a warm cache.
+    gpu::pipeline_cache cache(directory);
+    build_all(cache, sources);
+    const double warm_ns = benchmark::measure_ns([&] {
+        gpu::pipeline_cache reopened(directory);
+        build_all(reopened, sources);
+    });
+    std::println("warm open + {} lookups: {:.1f} us ({:.2f} us/pipeline, "
+                 "{} KiB cached)",
+                 k_pipelines, warm_ns * 1e-3,
+                 warm_ns * 1e-3 / static_cast<double>(k_pipelines),
+                 cache.size_bytes() / 1024);
+
+    std::filesystem::remove_all(directory);
+    return 0;
+}
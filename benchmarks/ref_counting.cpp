@@ -0,0 +1,55 @@
+#include <cstddef>
+#include <print>
+#include <utility>
+#include <vector>
+
+#include "benchmark.hpp"
+
+import lib;
+
+namespace {
+    constexpr std::size_t k_handles = 100'000;
+}
+
+int
+main() {
+    // Moving handles around should cost the same as moving raw pointers.
+    std::vector<ns::mock_object> objects(k_handles);
+    std::vector<ns::mock_object*> raw(k_handles);
+    std::vector<ns::ref<ns::mock_object>> owned;
+    for (std::size_t i = 0; i < k_handles; ++i) {
+        raw[i] = &objects[i];
+        objects[i].retain();
+        owned.push_back(ns::adopt(&objects[i]));
+    }
+
+    const double raw_ns = benchmark::measure_ns([&] {
+        std::vector<ns::mock_object*> moved = std::move(raw);
+        for (std::size_t i = 0; i + 1 < moved.size(); i += 2) {
+            std::swap(moved[i], moved[i + 1]);
+        }
+        raw = std::move(moved);
+        benchmark::do_not_optimize(raw.data());
+    });
+    const double ref_ns = benchmark::measure_ns([&] {
+        std::vector<ns::ref<ns::mock_object>> moved = std::move(owned);
+        for (std::size_t i = 0; i + 1 < moved.size(); i += 2) {
+            swap(moved[i], moved[i + 1]);
+        }
+        owned = std::move(moved);
+        benchmark::do_not_optimize(owned.data());
+    });
+
+    int traffic = 0;
+    for (const ns::mock_object& object : objects) {
+        traffic += object.retains() + object.releases() - 1;
+    }
+    std::println("swapping {} handles: raw {:.1f} us, ref {:.1f} us, "
+                 "refcount calls {}",
+                 k_handles, raw_ns * 1e-3, ref_ns * 1e-3, traffic);
+
+    std::println("");
+    const bool passed =
+      benchmark::check("moving handles costs no refcount calls", traffic == 0);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,83 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <print>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "benchmark.hpp"
+
+import lib;
+
+namespace {
+    using compute::uint3;
+
+    constexpr uint3 k_grid = { 128, 128, 1 };
+    constexpr std::uint32_t k_max_total_threads = 1024;
+    // Apple GPUs run 32-wide SIMD groups.
+    constexpr std::uint32_t k_execution_width = 32;
+}
+
+int
+main() {
+    const std::filesystem::path table =
+      std::filesystem::temp_directory_path() / "metal-cpp-threadgroup-tuner" /
+      "threadgroups";
+    std::filesystem::remove_all(table.parent_path());
+
+    jobs::scheduler workers;
+    compute::dispatcher encoder(workers);
+    std::vector<std::uint32_t> texture(k_grid.volume());
+
+    const gpu::pipeline_key kernel =
+      gpu::pipeline_hasher{}.add(std::string_view("mandelbrot_set")).finish();
+    const compute::tuning_key key =
+      compute::tuning_key::make(kernel, "cpu dispatcher", k_grid);
+
+    const std::vector<uint3> candidates = compute::candidate_threadgroups(
+      k_grid, k_max_total_threads, k_execution_width);
+
+    // Best time per shape, to show what the tuner chose between.
+    std::map<std::pair<std::uint32_t, std::uint32_t>, double> timings;
+    auto measure = [&](uint3 p_threadgroup) {
+        const auto start = std::chrono::steady_clock::now();
+        encoder.dispatch_threads(k_grid, p_threadgroup,
+                                 compute::mandelbrot_kernel{ texture, 7 });
+        benchmark::do_not_optimize(texture.data());
+        const double ns = std::chrono::duration<double, std::nano>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+        auto [it, inserted] = timings.try_emplace(
+          { p_threadgroup.x, p_threadgroup.y }, ns);
+        it->second = std::min(it->second, ns);
+        return ns;
+    };
+
+    compute::tuning_result tuned;
+    {
+        compute::threadgroup_tuner tuner(table, { .samples = 3 });
+        tuned = tuner.tune(key, candidates, measure).value_or(tuned);
+    }
+
+    std::println("\n{:>6} {:>6} {:>10}", "width", "height", "ms");
+    for (const auto& [shape, ns] : timings) {
+        std::println("{:>6} {:>6} {:>10.3f}{}", shape.first, shape.second,
+                     ns * 1e-6,
+                     shape.first == tuned.threadgroup.x &&
+                         shape.second == tuned.threadgroup.y
+                       ? "  <- tuned"
+                       : "");
+    }
+    const double baseline_ns = timings[{ k_max_total_threads, 1 }];
+    std::println("\ntuned {}x{}: {:.3f} ms, 1D {}x1 baseline {:.3f} ms\n",
+                 tuned.threadgroup.x, tuned.threadgroup.y, tuned.ns * 1e-6,
+                 k_max_total_threads, baseline_ns * 1e-6);
+    const bool passed = benchmark::check(
+      "tuned shape no slower than 1D baseline", tuned.ns <= baseline_ns);
+
+    std::filesystem::remove_all(table.parent_path());
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <print>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "benchmark.hpp"
+
+import lib;
+
+namespace {
+    using math::simd::precision;
+    using math::simd::vfloat;
+
+    constexpr std::size_t k_lanes = math::simd::lanes;
+    constexpr std::size_t k_block = 4096;
+
+    // Applies p_fn to p_count floats, simd::lanes at a time. p_count is a
+    // multiple of the lane count.
+    template<typename Fn>
+    void apply(const float* p_in, float* p_out, std::size_t p_count, Fn&& p_fn) {
+        for (std::size_t i = 0; i < p_count; i += k_lanes) {
+            p_fn(vfloat::load(p_in + i)).store(p_out + i);
+        }
+    }
+}
+
+int
+main() {
+    std::mt19937 rng(23);
+
+    std::println("simd backend: {} ({} lanes)", math::simd_backend(),
+                 math::simd::lanes);
+
+    // Per element over a block that stays in cache, against the scalar
+    // libm float functions.
+    std::vector<float> in(k_block);
+    std::vector<float> second(k_block);
+    std::vector<float> out(k_block);
+    std::uniform_real_distribution<float> range(-10.f, 10.f);
+    std::uniform_real_distribution<float> base(0.1f, 10.f);
+    for (std::size_t i = 0; i < k_block; ++i) {
+        in[i] = range(rng);
+        second[i] = base(rng);
+    }
+    benchmark::cycle_counter cycles;
+    const auto per_element = [&](auto&& p_fn) {
+        const double ns = benchmark::measure_ns(p_fn, 200) / k_block;
+        const double cycle_count = cycles.measure(p_fn, 200) / k_block;
+        return std::pair{ ns, cycle_count };
+    };
+    const auto unary = [&](auto&& p_fn) {
+        return per_element([&] {
+            apply(in.data(), out.data(), k_block, p_fn);
+            benchmark::do_not_optimize(out.data());
+        });
+    };
+    const auto binary = [&](auto&& p_fn) {
+        return per_element([&] {
+            for (std::size_t i = 0; i < k_block; i += k_lanes) {
+                p_fn(vfloat::load(&second[i]), vfloat::load(&in[i])).store(&out[i]);
+            }
+            benchmark::do_not_optimize(out.data());
+        });
+    };
+    const auto scalar = [&](auto&& p_fn) {
+        return per_element([&] {
+            for (std::size_t i = 0; i < k_block; ++i) {
+                out[i] = p_fn(second[i], in[i]);
+            }
+            benchmark::do_not_optimize(out.data());
+        });
+    };
+
+    std::println("{:<8} {:>18} {:>18} {:>18}", "", "accurate", "fast", "libm");
+    const char* unit = cycles.valid() ? "ns / cycles" : "ns";
+    std::println("{:<8} {:>18} {:>18} {:>18}", "function", unit, unit, unit);
+    using timing = std::pair<double, double>;
+    const auto row = [&](const char* p_name, timing p_accurate, timing p_fast,
+                         timing p_libm) {
+        const auto cell = [&](timing p_time) {
+            return cycles.valid()
+                     ? std::format("{:.2f} / {:.1f}", p_time.first, p_time.second)
+                     : std::format("{:.2f}", p_time.first);
+        };
+        std::println("{:<8} {:>18} {:>18} {:>18}", p_name, cell(p_accurate), cell(p_fast),
+                     cell(p_libm));
+    };
+    row("sincos",
+        unary([](vfloat p_x) {
+            vfloat s, c;
+            math::simd::sincos(p_x, s, c);
+            return s + c;
+        }),
+        unary([](vfloat p_x) {
+            vfloat s, c;
+            math::simd::sincos<precision::fast>(p_x, s, c);
+            return s + c;
+        }),
+        scalar([](float, float p_x) { return std::sin(p_x) + std::cos(p_x); }));
+    row("exp", unary([](vfloat p_x) { return math::simd::exp(p_x); }),
+        unary([](vfloat p_x) { return math::simd::exp<precision::fast>(p_x); }),
+        scalar([](float, float p_x) { return std::exp(p_x); }));
+    row("atan2", binary([](vfloat p_y, vfloat p_x) { return math::simd::atan2(p_y, p_x); }),
+        binary([](vfloat p_y, vfloat p_x) {
+            return math::simd::atan2<precision::fast>(p_y, p_x);
+        }),
+        scalar([](float p_y, float p_x) { return std::atan2(p_y, p_x); }));
+    row("pow", binary([](vfloat p_x, vfloat p_y) { return math::simd::pow(p_x, p_y); }),
+        binary([](vfloat p_x, vfloat p_y) {
+            return math::simd::pow<precision::fast>(p_x, p_y);
+        }),
+        scalar([](float p_x, float p_y) { return std::pow(p_x, p_y); }));
+    if (!cycles.valid()) {
+        std::println("(no cycle counter, perf_event_open unavailable)");
+    }
+    return 0;
+}
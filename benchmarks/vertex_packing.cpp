@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <print>
+#include <random>
+#include <vector>
+
+#include "benchmark.hpp"
+
+import lib;
+
+namespace {
+    // Odd on purpose, so the last block is a partial one.
+    constexpr std::size_t k_vertices = 100'003;
+
+    std::vector<shader_types::vertex_data> make_mesh() {
+        std::mt19937 random(17);
+        std::uniform_real_distribution<float> x(-3.f, 5.f);
+        std::uniform_real_distribution<float> y(0.f, 2.f);
+        std::uniform_real_distribution<float> z(-0.5f, 0.5f);
+        std::uniform_real_distribution<float> uv(-1.f, 3.f);
+        std::normal_distribution<float> direction;
+
+        std::vector<shader_types::vertex_data> mesh(k_vertices);
+        for (shader_types::vertex_data& vertex : mesh) {
+            math::float3 n = { direction(random),
+                               direction(random),
+                               direction(random) };
+            const float length = std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+            vertex = { .position = { x(random), y(random), z(random) },
+                       .normal = { n.x / length, n.y / length, n.z / length },
+                       .texcoord = { uv(random), uv(random) } };
+        }
+        // Axis-aligned normals sit on the octahedron's edges and folds.
+        const math::float3 axes[] = { { 1.f, 0.f, 0.f },  { -1.f, 0.f, 0.f },
+                                      { 0.f, 1.f, 0.f },  { 0.f, -1.f, 0.f },
+                                      { 0.f, 0.f, 1.f },  { 0.f, 0.f, -1.f },
+                                      { 0.f, -0.f, -1.f } };
+        for (std::size_t i = 0; i < std::size(axes); ++i) {
+            mesh[i].normal = axes[i];
+        }
+        return mesh;
+    }
+
+}
+
+int
+main() {
+    const std::vector<shader_types::vertex_data> mesh = make_mesh();
+    const shader_types::vertex_quantization quantization =
+      gpu::make_vertex_quantization(mesh);
+
+    std::vector<shader_types::packed_vertex_data> packed(k_vertices);
+    std::vector<shader_types::vertex_data> unpacked(k_vertices);
+
+    std::println("{} vertices, simd lanes {}", k_vertices, math::simd::lanes);
+    std::println("vertex size {} -> {} bytes",
+                 sizeof(shader_types::vertex_data),
+                 sizeof(shader_types::packed_vertex_data));
+
+    const double pack_ns = benchmark::measure_ns(
+      [&] {
+          gpu::pack_vertices(quantization, mesh, packed);
+          benchmark::do_not_optimize(packed.data());
+      },
+      20);
+    const double pack_scalar_ns = benchmark::measure_ns(
+      [&] {
+          for (std::size_t i = 0; i < k_vertices; ++i) {
+              packed[i] = gpu::pack_vertex(quantization, mesh[i]);
+          }
+          benchmark::do_not_optimize(packed.data());
+      },
+      20);
+    const double unpack_ns = benchmark::measure_ns(
+      [&] {
+          gpu::unpack_vertices(quantization, packed, unpacked);
+          benchmark::do_not_optimize(unpacked.data());
+      },
+      20);
+    const double unpack_scalar_ns = benchmark::measure_ns(
+      [&] {
+          for (std::size_t i = 0; i < k_vertices; ++i) {
+              unpacked[i] = gpu::unpack_vertex(quantization, packed[i]);
+          }
+          benchmark::do_not_optimize(unpacked.data());
+      },
+      20);
+    std::println("{:<10} {:>12} {:>12} {:>8}", "", "simd ns/v", "scalar ns/v",
+                 "speedup");
+    std::println("{:<10} {:>12.2f} {:>12.2f} {:>7.1f}x", "pack",
+                 pack_ns / k_vertices, pack_scalar_ns / k_vertices,
+                 pack_scalar_ns / pack_ns);
+    std::println("{:<10} {:>12.2f} {:>12.2f} {:>7.1f}x", "unpack",
+                 unpack_ns / k_vertices, unpack_scalar_ns / k_vertices,
+                 unpack_scalar_ns / unpack_ns);
+
+    return 0;
+}
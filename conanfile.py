@@ -16,7 +16,7 @@ class LibraryRecipe(ConanFile):
     options = {"shared": [True, False], "fPIC": [True, False]}
     default_options = {"shared": False, "fPIC": True}
 
-    exports_sources = "metal-cpp/*", "tests/*", "CMakeLists.txt", "LICENSE"
+    exports_sources = "metal-cpp/*", "benchmarks/*", "tests/*", "CMakeLists.txt", "LICENSE"
     def build_requirements(self):
         self.tool_requires("cmake/[^4.0.0]")
         self.tool_requires("ninja/[^1.3.0]")
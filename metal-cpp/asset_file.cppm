@@ -0,0 +1,396 @@
+module;
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+export module lib:asset_file;
+
+import :atomic_file;
+
+export namespace gpu {
+    //! Four ASCII characters packed into a section tag, first one lowest.
+    [[nodiscard]] constexpr std::uint32_t asset_tag(std::string_view p_name) {
+        std::uint32_t tag = 0;
+        for (std::size_t i = 0; i < 4 && i < p_name.size(); ++i) {
+            tag |= static_cast<std::uint32_t>(static_cast<unsigned char>(p_name[i]))
+                   << (8 * i);
+        }
+        return tag;
+    }
+
+    //! Page size of Apple silicon, which also covers the 4 KiB pages of
+    //! Intel Macs and Linux, so sections can back no-copy buffers.
+    constexpr std::uint32_t k_asset_page_alignment = 16384;
+
+    /**
+     * @brief 64-bit checksum of asset sections.
+     *
+     * Four independent multiply-xorshift lanes over 8-byte words, several
+     * times faster than the byte-wise FNV-1a of pipeline_hasher. It catches
+     * truncation and bit rot, not deliberate tampering.
+     */
+    [[nodiscard]] std::uint64_t asset_checksum(std::span<const std::byte> p_bytes);
+
+    /**
+     * @brief Read-only memory mapping of a whole file.
+     *
+     * Pages are loaded on first touch, so opening is cheap and costs the
+     * same for any file size. Uses POSIX mmap, which both macOS and the
+     * Linux benchmark hosts provide.
+     */
+    class mapped_file {
+    public:
+        mapped_file() = default;
+        ~mapped_file() { close(); }
+
+        mapped_file(mapped_file&& p_other) noexcept
+          : m_data(std::exchange(p_other.m_data, nullptr))
+          , m_size(std::exchange(p_other.m_size, 0)) {}
+
+        mapped_file& operator=(mapped_file&& p_other) noexcept {
+            if (this != &p_other) {
+                close();
+                m_data = std::exchange(p_other.m_data, nullptr);
+                m_size = std::exchange(p_other.m_size, 0);
+            }
+            return *this;
+        }
+
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        //! Replaces any current mapping. Empty files fail, mmap rejects them.
+        bool open(const std::filesystem::path& p_path);
+        void close();
+
+        [[nodiscard]] std::span<const std::byte> bytes() const {
+            return { static_cast<const std::byte*>(m_data), m_size };
+        }
+        [[nodiscard]] bool is_open() const { return m_data != nullptr; }
+
+    private:
+        void* m_data = nullptr;
+        std::size_t m_size = 0;
+    };
+
+    enum class asset_status : std::uint8_t {
+        ok,
+        unreadable,
+        //! Wrong magic, or a header or section table that does not fit.
+        not_an_asset,
+        version_mismatch,
+        //! Shorter than the header says, the file was cut off.
+        truncated,
+        //! A checksum did not match.
+        corrupt,
+    };
+
+    enum class asset_verify : std::uint8_t {
+        //! Header, section table and bounds only. Touches one page.
+        layout,
+        //! Also every section checksum, which reads the whole file.
+        checksums,
+    };
+
+    /**
+     * @brief Writes a versioned container of tagged binary sections.
+     *
+     * Layout, all integers in host byte order:
+     *
+     *   0   magic "MTLASSET"
+     *   8   u32 format version, u32 section count
+     *   16  u64 file size, u64 section table checksum
+     *   32  u32 section alignment, 28 reserved zero bytes
+     *   64  section table, 32 bytes per section:
+     *       u32 tag, u32 reserved, u64 offset, u64 size, u64 checksum
+     *
+     * Every payload starts on a multiple of the alignment and is zero
+     * padded up to the next one, so a mapped section is valid as the
+     * contents of a no-copy GPU buffer without any fix-up.
+     */
+    class asset_writer {
+    public:
+        explicit asset_writer(std::uint32_t p_alignment = k_asset_page_alignment)
+          : m_alignment(p_alignment) {}
+
+        //! p_payload is not copied, it has to outlive write().
+        void add(std::uint32_t p_tag, std::span<const std::byte> p_payload) {
+            m_sections.push_back({ p_tag, p_payload });
+        }
+
+        //! Writes to a temporary next to p_path and renames it into place.
+        bool write(const std::filesystem::path& p_path) const;
+
+    private:
+        struct section {
+            std::uint32_t tag;
+            std::span<const std::byte> payload;
+        };
+
+        std::uint32_t m_alignment;
+        std::vector<section> m_sections;
+    };
+
+    /**
+     * @brief Maps a container written by asset_writer and hands out its
+     * sections as spans into the mapping.
+     *
+     * The spans stay valid while the reader lives, including across moves.
+     */
+    class asset_reader {
+    public:
+        static constexpr std::uint32_t version = 1;
+
+        [[nodiscard]] asset_status open(
+          const std::filesystem::path& p_path,
+          asset_verify p_verify = asset_verify::checksums);
+
+        //! @return the first section tagged p_tag, unpadded, or an empty
+        //! span if there is none.
+        [[nodiscard]] std::span<const std::byte> find(std::uint32_t p_tag) const;
+
+        [[nodiscard]] bool contains(std::uint32_t p_tag) const;
+        [[nodiscard]] std::uint32_t alignment() const { return m_alignment; }
+        [[nodiscard]] std::size_t section_count() const {
+            return m_sections.size();
+        }
+        [[nodiscard]] std::span<const std::byte> file() const {
+            return m_file.bytes();
+        }
+
+    private:
+        struct section {
+            std::uint32_t tag;
+            std::span<const std::byte> payload;
+        };
+
+        mapped_file m_file;
+        std::vector<section> m_sections;
+        std::uint32_t m_alignment = 0;
+    };
+
+    //! Rounds p_size up to a multiple of p_alignment, a power of two.
+    [[nodiscard]] constexpr std::uint64_t align_up(std::uint64_t p_size,
+                                                   std::uint64_t p_alignment) {
+        return (p_size + p_alignment - 1) & ~(p_alignment - 1);
+    }
+}
+
+namespace gpu {
+    namespace {
+        constexpr char k_magic[8] = { 'M', 'T', 'L', 'A', 'S', 'S', 'E', 'T' };
+        constexpr std::size_t k_header_bytes = 64;
+        constexpr std::size_t k_table_entry_bytes = 32;
+        // Enough for any sane asset, and small enough that a corrupt count
+        // cannot make the table size overflow.
+        constexpr std::uint32_t k_max_sections = 1 << 16;
+
+        template<typename T>
+        void store(std::byte* p_at, T p_value) {
+            std::memcpy(p_at, &p_value, sizeof(T));
+        }
+
+        template<typename T>
+        T load(const std::byte* p_at) {
+            T value;
+            std::memcpy(&value, p_at, sizeof(T));
+            return value;
+        }
+
+        constexpr std::uint64_t k_checksum_prime = 0x9e3779b97f4a7c15ull;
+
+        std::uint64_t mix(std::uint64_t p_lane, std::uint64_t p_word) {
+            p_lane = (p_lane ^ p_word) * k_checksum_prime;
+            return p_lane ^ (p_lane >> 29);
+        }
+    }
+
+    std::uint64_t asset_checksum(std::span<const std::byte> p_bytes) {
+        std::uint64_t lanes[4] = { 1, 2, 3, 4 };
+        const std::byte* at = p_bytes.data();
+        std::size_t left = p_bytes.size();
+        for (; left >= 32; left -= 32, at += 32) {
+            for (int i = 0; i < 4; ++i) {
+                lanes[i] = mix(lanes[i], load<std::uint64_t>(at + 8 * i));
+            }
+        }
+        std::uint64_t tail = 0;
+        for (int lane = 0; left > 0; lane = (lane + 1) & 3) {
+            const std::size_t n = std::min<std::size_t>(left, 8);
+            tail = 0;
+            std::memcpy(&tail, at, n);
+            lanes[lane] = mix(lanes[lane], tail);
+            at += n;
+            left -= n;
+        }
+        std::uint64_t hash = p_bytes.size();
+        for (std::uint64_t lane : lanes) {
+            hash = mix(hash, lane);
+        }
+        return mix(hash, hash >> 32);
+    }
+
+    bool mapped_file::open(const std::filesystem::path& p_path) {
+        close();
+        const int descriptor = ::open(p_path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (descriptor < 0) {
+            return false;
+        }
+        struct stat info {};
+        if (::fstat(descriptor, &info) != 0 || info.st_size <= 0) {
+            ::close(descriptor);
+            return false;
+        }
+        const auto size = static_cast<std::size_t>(info.st_size);
+        void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        // The mapping keeps the file alive on its own.
+        ::close(descriptor);
+        if (data == MAP_FAILED) {
+            return false;
+        }
+        m_data = data;
+        m_size = size;
+        return true;
+    }
+
+    void mapped_file::close() {
+        if (m_data != nullptr) {
+            ::munmap(m_data, m_size);
+            m_data = nullptr;
+            m_size = 0;
+        }
+    }
+
+    bool asset_writer::write(const std::filesystem::path& p_path) const {
+        const std::size_t table_bytes = m_sections.size() * k_table_entry_bytes;
+        std::vector<std::byte> head(
+          align_up(k_header_bytes + table_bytes, m_alignment));
+        std::uint64_t offset = head.size();
+        for (std::size_t i = 0; i < m_sections.size(); ++i) {
+            std::byte* entry = &head[k_header_bytes + i * k_table_entry_bytes];
+            store(entry, m_sections[i].tag);
+            store(entry + 8, offset);
+            store(entry + 16,
+                  static_cast<std::uint64_t>(m_sections[i].payload.size()));
+            store(entry + 24, asset_checksum(m_sections[i].payload));
+            offset += align_up(m_sections[i].payload.size(), m_alignment);
+        }
+        std::memcpy(head.data(), k_magic, sizeof(k_magic));
+        store(&head[8], asset_reader::version);
+        store(&head[12], static_cast<std::uint32_t>(m_sections.size()));
+        store(&head[16], offset);
+        store(&head[24],
+              asset_checksum(std::span(head).subspan(k_header_bytes, table_bytes)));
+        store(&head[32], m_alignment);
+
+        return write_file_atomically(p_path, [&](std::ofstream& p_file) {
+            p_file.write(reinterpret_cast<const char*>(head.data()),
+                         static_cast<std::streamsize>(head.size()));
+            const std::vector<char> padding(m_alignment, 0);
+            for (const section& s : m_sections) {
+                p_file.write(reinterpret_cast<const char*>(s.payload.data()),
+                             static_cast<std::streamsize>(s.payload.size()));
+                p_file.write(padding.data(),
+                             static_cast<std::streamsize>(
+                               align_up(s.payload.size(), m_alignment) -
+                               s.payload.size()));
+            }
+        });
+    }
+
+    asset_status asset_reader::open(const std::filesystem::path& p_path,
+                                    asset_verify p_verify) {
+        m_sections.clear();
+        m_alignment = 0;
+        if (!m_file.open(p_path)) {
+            return asset_status::unreadable;
+        }
+        const std::span<const std::byte> file = m_file.bytes();
+        const auto fail = [&](asset_status p_status) {
+            m_file.close();
+            m_sections.clear();
+            return p_status;
+        };
+        if (file.size() < k_header_bytes ||
+            std::memcmp(file.data(), k_magic, sizeof(k_magic)) != 0) {
+            return fail(asset_status::not_an_asset);
+        }
+        if (load<std::uint32_t>(&file[8]) != version) {
+            return fail(asset_status::version_mismatch);
+        }
+        const auto count = load<std::uint32_t>(&file[12]);
+        const auto file_bytes = load<std::uint64_t>(&file[16]);
+        const auto table_checksum = load<std::uint64_t>(&file[24]);
+        const auto alignment = load<std::uint32_t>(&file[32]);
+        if (count > k_max_sections || alignment < 16 ||
+            !std::has_single_bit(alignment)) {
+            return fail(asset_status::not_an_asset);
+        }
+        if (file.size() < file_bytes) {
+            return fail(asset_status::truncated);
+        }
+        const std::size_t table_bytes = std::size_t{ count } * k_table_entry_bytes;
+        if (file_bytes != file.size() ||
+            k_header_bytes + table_bytes > file.size()) {
+            return fail(asset_status::not_an_asset);
+        }
+        const std::span<const std::byte> table =
+          file.subspan(k_header_bytes, table_bytes);
+        if (asset_checksum(table) != table_checksum) {
+            return fail(asset_status::corrupt);
+        }
+
+        m_sections.reserve(count);
+        for (std::uint32_t i = 0; i < count; ++i) {
+            const std::byte* entry = &table[i * k_table_entry_bytes];
+            const auto offset = load<std::uint64_t>(entry + 8);
+            const auto size = load<std::uint64_t>(entry + 16);
+            if (offset % alignment != 0 || offset > file.size() ||
+                size > file.size() - offset) {
+                return fail(asset_status::not_an_asset);
+            }
+            const std::span<const std::byte> payload =
+              file.subspan(static_cast<std::size_t>(offset),
+                           static_cast<std::size_t>(size));
+            if (p_verify == asset_verify::checksums &&
+                asset_checksum(payload) != load<std::uint64_t>(entry + 24)) {
+                return fail(asset_status::corrupt);
+            }
+            m_sections.push_back({ load<std::uint32_t>(entry), payload });
+        }
+        m_alignment = alignment;
+        return asset_status::ok;
+    }
+
+    std::span<const std::byte> asset_reader::find(std::uint32_t p_tag) const {
+        for (const section& s : m_sections) {
+            if (s.tag == p_tag) {
+                return s.payload;
+            }
+        }
+        return {};
+    }
+
+    bool asset_reader::contains(std::uint32_t p_tag) const {
+        for (const section& s : m_sections) {
+            if (s.tag == p_tag) {
+                return true;
+            }
+        }
+        return false;
+    }
+}
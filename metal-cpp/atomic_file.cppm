@@ -0,0 +1,142 @@
+module;
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <span>
+#include <system_error>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+export module lib:atomic_file;
+
+export namespace gpu {
+    /**
+     * @brief A path next to p_path that no other writer uses.
+     *
+     * The name carries the process id, a hash of the calling thread's id
+     * and a per-process counter, so neither concurrent threads nor
+     * processes sharing a cache directory ever pick the same one.
+     */
+    [[nodiscard]] std::filesystem::path unique_temporary_path(
+      const std::filesystem::path& p_path);
+
+    /**
+     * @brief Renames p_temporary over p_path, removing p_temporary if that
+     * fails.
+     */
+    bool replace_file(const std::filesystem::path& p_temporary,
+                      const std::filesystem::path& p_path);
+
+    /**
+     * @brief Writes p_path so readers see either its old contents or the
+     * complete new ones.
+     *
+     * p_write(std::ofstream&) fills a unique_temporary_path() next to
+     * p_path, which is then renamed into place. Missing parent directories
+     * are created, and the temporary is removed on any failure.
+     *
+     * @return false when writing or renaming failed.
+     */
+    template<typename Fn>
+    bool write_file_atomically(const std::filesystem::path& p_path,
+                               Fn&& p_write) {
+        std::error_code error;
+        if (p_path.has_parent_path()) {
+            std::filesystem::create_directories(p_path.parent_path(), error);
+        }
+        const std::filesystem::path temporary = unique_temporary_path(p_path);
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            p_write(file);
+            file.flush();
+            if (!file) {
+                std::filesystem::remove(temporary, error);
+                return false;
+            }
+        }
+        return replace_file(temporary, p_path);
+    }
+
+    //! write_file_atomically() of one block of bytes.
+    bool write_file_atomically(const std::filesystem::path& p_path,
+                               std::span<const std::byte> p_bytes);
+
+    /**
+     * @brief Exclusive advisory lock on p_path, created if missing, held
+     * until destruction.
+     *
+     * Serializes read-modify-write cycles on files that several processes
+     * share. The lock belongs to this object, so two instances exclude
+     * each other even within one process. locked() is false if the file
+     * could not be opened or locked, callers then carry on unlocked.
+     */
+    class file_lock {
+    public:
+        explicit file_lock(const std::filesystem::path& p_path);
+        ~file_lock();
+
+        file_lock(const file_lock&) = delete;
+        file_lock& operator=(const file_lock&) = delete;
+
+        [[nodiscard]] bool locked() const { return m_fd >= 0; }
+
+    private:
+        int m_fd = -1;
+    };
+}
+
+namespace gpu {
+    std::filesystem::path unique_temporary_path(
+      const std::filesystem::path& p_path) {
+        static std::atomic<std::uint64_t> counter = 0;
+        std::filesystem::path temporary = p_path;
+        temporary += std::format(
+          ".tmp.{}.{:x}.{}",
+          static_cast<long>(::getpid()),
+          std::hash<std::thread::id>{}(std::this_thread::get_id()),
+          counter.fetch_add(1, std::memory_order_relaxed));
+        return temporary;
+    }
+
+    bool replace_file(const std::filesystem::path& p_temporary,
+                      const std::filesystem::path& p_path) {
+        std::error_code error;
+        std::filesystem::rename(p_temporary, p_path, error);
+        if (error) {
+            std::filesystem::remove(p_temporary, error);
+            return false;
+        }
+        return true;
+    }
+
+    bool write_file_atomically(const std::filesystem::path& p_path,
+                               std::span<const std::byte> p_bytes) {
+        return write_file_atomically(p_path, [&](std::ofstream& p_file) {
+            p_file.write(reinterpret_cast<const char*>(p_bytes.data()),
+                         static_cast<std::streamsize>(p_bytes.size()));
+        });
+    }
+
+    file_lock::file_lock(const std::filesystem::path& p_path) {
+        m_fd = ::open(p_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (m_fd >= 0 && ::flock(m_fd, LOCK_EX) != 0) {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+    }
+
+    file_lock::~file_lock() {
+        if (m_fd >= 0) {
+            // Closing the descriptor releases the lock.
+            ::close(m_fd);
+        }
+    }
+}
@@ -0,0 +1,172 @@
+module;
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <utility>
+
+export module lib:autorelease_arena;
+
+import :ref;
+
+export namespace ns {
+    /**
+     * @brief NS::AutoreleasePool shaped type: alloc()->init() opens a pool
+     * on the calling thread and release() drains and closes it.
+     */
+    template<typename Pool>
+    concept autorelease_pool = requires(Pool& p_pool) {
+        { Pool::alloc()->init() } -> std::same_as<Pool*>;
+        p_pool.release();
+    };
+
+    struct frame_arena_options {
+        //! Autoreleased objects a frame may produce, 0 disables the check.
+        std::size_t object_budget = 0;
+        //! Give every sub-pass its own pool instead of batching them into
+        //! the frame pool. Lowers the peak when sub-passes are heavy.
+        bool pool_per_sub_pass = false;
+    };
+
+    struct frame_arena_metrics {
+        std::size_t frames = 0;
+        std::size_t last_frame_objects = 0;
+        std::size_t last_frame_pools = 0;
+        std::size_t peak_frame_objects = 0;
+        std::size_t total_objects = 0;
+        std::size_t over_budget_frames = 0;
+
+        [[nodiscard]] double average_frame_objects() const {
+            return frames == 0 ? 0.0
+                               : static_cast<double>(total_objects) /
+                                   static_cast<double>(frames);
+        }
+    };
+
+    /**
+     * @brief Per-frame autorelease pool with object accounting.
+     *
+     * frame() opens the frame's pool and returns a scope that closes it.
+     * sub_pass() scopes inside a frame either batch into the frame pool or
+     * get their own, depending on frame_arena_options::pool_per_sub_pass.
+     *
+     * The autorelease pool itself cannot be asked how many objects it holds,
+     * so objects are counted as they go through a scope: autorelease() for
+     * objects the caller autoreleases, track() for objects an API returned
+     * already autoreleased (commandBuffer(), currentDrawable(), ...).
+     * Like the pools it wraps, an arena belongs to one thread.
+     */
+    template<autorelease_pool Pool>
+    class frame_arena {
+    public:
+        class scope {
+        public:
+            scope(const scope&) = delete;
+            scope& operator=(const scope&) = delete;
+
+            scope(scope&& p_other) noexcept
+              : m_arena(std::exchange(p_other.m_arena, nullptr))
+              , m_pool(std::exchange(p_other.m_pool, nullptr))
+              , m_objects(p_other.m_objects)
+              , m_frame(p_other.m_frame) {}
+
+            scope& operator=(scope&&) = delete;
+
+            ~scope() {
+                if (m_pool != nullptr) {
+                    m_pool->release();
+                }
+                if (m_arena != nullptr && m_frame) {
+                    m_arena->end_frame();
+                }
+            }
+
+            //! Autoreleases p_object into the innermost pool and counts it.
+            template<typename T>
+            T* autorelease(T* p_object) {
+                p_object->autorelease();
+                return track(p_object);
+            }
+
+            //! Counts an object an API call already autoreleased.
+            template<typename T>
+            T* track(T* p_object) {
+                if (p_object != nullptr) {
+                    ++m_objects;
+                    ++m_arena->m_frame_objects;
+                }
+                return p_object;
+            }
+
+            //! Objects counted through this scope.
+            [[nodiscard]] std::size_t objects() const { return m_objects; }
+
+        private:
+            friend class frame_arena;
+
+            scope(frame_arena* p_arena, bool p_open_pool, bool p_frame)
+              : m_arena(p_arena)
+              , m_frame(p_frame) {
+                if (p_open_pool) {
+                    m_pool = Pool::alloc()->init();
+                    ++m_arena->m_frame_pools;
+                }
+            }
+
+            frame_arena* m_arena;
+            Pool* m_pool = nullptr;
+            std::size_t m_objects = 0;
+            bool m_frame;
+        };
+
+        explicit frame_arena(frame_arena_options p_options = {})
+          : m_options(p_options) {}
+
+        frame_arena(const frame_arena&) = delete;
+        frame_arena& operator=(const frame_arena&) = delete;
+
+        //! Opens the frame pool, the metrics are updated when it closes.
+        [[nodiscard]] scope frame() {
+            m_frame_objects = 0;
+            m_frame_pools = 0;
+            return scope(this, true, true);
+        }
+
+        //! Scope for one pass inside the current frame.
+        [[nodiscard]] scope sub_pass() {
+            return scope(this, m_options.pool_per_sub_pass, false);
+        }
+
+        [[nodiscard]] const frame_arena_metrics& metrics() const {
+            return m_metrics;
+        }
+
+        [[nodiscard]] const frame_arena_options& options() const {
+            return m_options;
+        }
+
+        //! @return true if the last closed frame stayed within the budget.
+        [[nodiscard]] bool within_budget() const {
+            return m_options.object_budget == 0 ||
+                   m_metrics.last_frame_objects <= m_options.object_budget;
+        }
+
+    private:
+        void end_frame() {
+            ++m_metrics.frames;
+            m_metrics.last_frame_objects = m_frame_objects;
+            m_metrics.last_frame_pools = m_frame_pools;
+            m_metrics.peak_frame_objects =
+              std::max(m_metrics.peak_frame_objects, m_frame_objects);
+            m_metrics.total_objects += m_frame_objects;
+            if (!within_budget()) {
+                ++m_metrics.over_budget_frames;
+            }
+        }
+
+        frame_arena_options m_options;
+        frame_arena_metrics m_metrics;
+        std::size_t m_frame_objects = 0;
+        std::size_t m_frame_pools = 0;
+    };
+}
@@ -0,0 +1,218 @@
+module;
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <vector>
+
+export module lib:build_graph;
+
+import :job_system;
+
+export namespace jobs {
+    using stage_id = std::size_t;
+
+    //! Times in nanoseconds since build_graph::run() was called.
+    struct stage_timing {
+        std::string name;
+        //! When the last dependency finished and the stage was queued.
+        double ready_ns = 0.0;
+        double start_ns = 0.0;
+        double end_ns = 0.0;
+
+        [[nodiscard]] double queued_ns() const { return start_ns - ready_ns; }
+        [[nodiscard]] double run_ns() const { return end_ns - start_ns; }
+    };
+
+    /**
+     * @brief DAG of startup build stages run on a jobs::scheduler.
+     *
+     * Stages are added with the stages they depend on, which must already
+     * exist, so the graph cannot contain cycles. run() queues every stage
+     * without dependencies and returns immediately; each finished stage
+     * queues the dependents it unblocked. future() lets callers block on or
+     * poll exactly the stages they need.
+     *
+     * A stage that throws fails its future, and every stage depending on it
+     * is skipped and fails with the same exception. The graph waits for
+     * outstanding stages when destroyed.
+     */
+    class build_graph {
+    public:
+        build_graph() = default;
+        ~build_graph() { wait(); }
+
+        build_graph(const build_graph&) = delete;
+        build_graph& operator=(const build_graph&) = delete;
+
+        stage_id add(std::string p_name,
+                     std::function<void()> p_build,
+                     std::initializer_list<stage_id> p_dependencies = {});
+
+        //! Queues the ready stages on p_jobs. Call once, after every add().
+        void run(scheduler& p_jobs);
+
+        [[nodiscard]] std::shared_future<void> future(stage_id p_stage) const {
+            return m_stages[p_stage]->done;
+        }
+
+        [[nodiscard]] bool ready(stage_id p_stage) const {
+            return m_stages[p_stage]->finished.load(std::memory_order_acquire);
+        }
+
+        //! @return true once every stage has finished, failed or not.
+        [[nodiscard]] bool finished() const {
+            return m_pending.load(std::memory_order_acquire) == 0;
+        }
+
+        //! Helps run queued jobs until every stage has finished.
+        void wait();
+
+        //! Valid for stages that have finished.
+        [[nodiscard]] std::vector<stage_timing> timings() const;
+
+    private:
+        using clock = std::chrono::steady_clock;
+
+        struct stage {
+            build_graph* graph;
+            std::string name;
+            std::function<void()> build;
+            std::vector<stage_id> dependents;
+            std::size_t dependency_count = 0;
+            std::atomic<std::size_t> waiting_on{ 0 };
+            std::promise<void> promise;
+            std::shared_future<void> done;
+            std::exception_ptr error;
+            std::atomic<bool> failed_dependency{ false };
+            std::atomic<bool> finished{ false };
+            clock::time_point ready;
+            clock::time_point start;
+            clock::time_point end;
+        };
+
+        void queue(stage& p_stage);
+        static void execute(void* p_stage);
+
+        std::vector<std::unique_ptr<stage>> m_stages;
+        scheduler* m_jobs = nullptr;
+        clock::time_point m_origin;
+        std::atomic<std::size_t> m_pending{ 0 };
+        // Spawned jobs still inside scheduler code, joined by wait().
+        std::atomic<std::size_t> m_running{ 0 };
+    };
+}
+
+namespace jobs {
+    stage_id build_graph::add(std::string p_name,
+                              std::function<void()> p_build,
+                              std::initializer_list<stage_id> p_dependencies) {
+        const stage_id id = m_stages.size();
+        auto created = std::make_unique<stage>();
+        created->graph = this;
+        created->name = std::move(p_name);
+        created->build = std::move(p_build);
+        created->dependency_count = p_dependencies.size();
+        created->done = created->promise.get_future().share();
+        for (stage_id dependency : p_dependencies) {
+            m_stages[dependency]->dependents.push_back(id);
+        }
+        m_stages.push_back(std::move(created));
+        return id;
+    }
+
+    void build_graph::run(scheduler& p_jobs) {
+        m_jobs = &p_jobs;
+        m_origin = clock::now();
+        m_pending.store(m_stages.size(), std::memory_order_relaxed);
+        for (const auto& current : m_stages) {
+            current->waiting_on.store(current->dependency_count,
+                                      std::memory_order_relaxed);
+        }
+        // Collect the roots first, an inline scheduler would otherwise run
+        // dependents before their counters are set.
+        std::vector<stage*> roots;
+        for (const auto& current : m_stages) {
+            if (current->dependency_count == 0) {
+                roots.push_back(current.get());
+            }
+        }
+        for (stage* root : roots) {
+            queue(*root);
+        }
+    }
+
+    void build_graph::queue(stage& p_stage) {
+        p_stage.ready = clock::now();
+        m_jobs->spawn(&build_graph::execute, &p_stage, m_running);
+    }
+
+    void build_graph::execute(void* p_stage) {
+        stage& current = *static_cast<stage*>(p_stage);
+        build_graph& graph = *current.graph;
+
+        current.start = clock::now();
+        if (!current.failed_dependency.load(std::memory_order_acquire)) {
+            try {
+                current.build();
+            }
+            catch (...) {
+                current.error = std::current_exception();
+            }
+        }
+        current.end = clock::now();
+
+        // Resolve dependents before publishing, so a caller that sees every
+        // stage finished also sees their failure flags.
+        for (stage_id dependent_id : current.dependents) {
+            stage& dependent = *graph.m_stages[dependent_id];
+            // The first failed dependency decides the propagated error.
+            if (current.error &&
+                !dependent.failed_dependency.exchange(
+                  true, std::memory_order_acq_rel)) {
+                dependent.error = current.error;
+            }
+            if (dependent.waiting_on.fetch_sub(1, std::memory_order_acq_rel) ==
+                1) {
+                graph.queue(dependent);
+            }
+        }
+
+        if (current.error) {
+            current.promise.set_exception(current.error);
+        }
+        else {
+            current.promise.set_value();
+        }
+        current.finished.store(true, std::memory_order_release);
+        graph.m_pending.fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    void build_graph::wait() {
+        if (m_jobs != nullptr) {
+            m_jobs->wait(m_running);
+        }
+    }
+
+    std::vector<stage_timing> build_graph::timings() const {
+        auto since_origin = [this](clock::time_point p_time) {
+            return std::chrono::duration<double, std::nano>(p_time - m_origin)
+              .count();
+        };
+        std::vector<stage_timing> result;
+        result.reserve(m_stages.size());
+        for (const auto& current : m_stages) {
+            result.push_back({ current->name,
+                               since_origin(current->ready),
+                               since_origin(current->start),
+                               since_origin(current->end) });
+        }
+        return result;
+    }
+}
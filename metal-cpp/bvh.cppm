@@ -0,0 +1,959 @@
+module;
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+export module lib:bvh;
+
+import :math;
+import :simd;
+import :job_system;
+import :culling;
+
+export namespace math {
+    //! Axis-aligned box, empty when any min component exceeds its max.
+    struct aabb {
+        float3 min{};
+        float3 max{};
+    };
+
+    //! Bounds of p_local once placed by p_transform.
+    [[nodiscard]] aabb transform_aabb(const aabb& p_local,
+                                      const float4x4& p_transform);
+
+    /**
+     * @brief Whether p_box may be inside p_frustum: false only when the box
+     * lies entirely behind one of the planes.
+     */
+    [[nodiscard]] bool intersects(const frustum& p_frustum, const aabb& p_box);
+
+    struct ray {
+        float3 origin{};
+        float3 direction{};
+        float max_distance = std::numeric_limits<float>::infinity();
+    };
+
+    //! Distance along the ray in units of its direction's length.
+    struct ray_hit {
+        std::uint32_t index = 0;
+        float distance = 0.f;
+    };
+
+    /**
+     * @brief Bounding volume hierarchy over instance bounds.
+     *
+     * Nodes hold bvh::width children, 8 with AVX2 and 4 otherwise, with
+     * their boxes stored component by component so a node is tested against
+     * a plane or a ray in simd::lanes-wide steps. Every child covers a
+     * contiguous range of instances, leaves hold at most four.
+     *
+     * build() splits by the surface area heuristic over binned centroids.
+     * Moving instances only needs set_bounds() and refit(), which grows
+     * the boxes on the paths to the changed leaves without touching the
+     * topology. Boxes loosen as instances drift from where the tree was
+     * built; compare sah_cost() against its value after build() to decide
+     * when a rebuild pays off. Adding or removing instances needs build().
+     */
+    class bvh {
+    public:
+        static constexpr std::size_t width = simd::lanes < 4 ? 4 : simd::lanes;
+
+        /**
+         * @brief Builds the hierarchy over p_bounds, instance i being
+         * element i.
+         *
+         * Large subtrees are built in parallel on p_jobs, and the top
+         * levels split their binning over it, when one is given.
+         */
+        void build(std::span<const aabb> p_bounds,
+                   jobs::scheduler* p_jobs = nullptr);
+
+        //! Changes the bounds of instance p_index, seen once refit() runs.
+        void set_bounds(std::size_t p_index, const aabb& p_bounds);
+
+        /**
+         * @brief Replaces the bounds of every instance, seen once refit()
+         * runs.
+         *
+         * @return false, changing nothing, when p_bounds does not have
+         * size() elements.
+         */
+        [[nodiscard]] bool update(std::span<const aabb> p_bounds);
+
+        /**
+         * @brief Brings the boxes of every node above a changed instance
+         * up to date, children before parents.
+         *
+         * Leaf boxes are recomputed on p_jobs when one is given and enough
+         * nodes changed.
+         */
+        void refit(jobs::scheduler* p_jobs = nullptr);
+
+        /**
+         * @brief Expected cost of a query: nodes visited plus instances
+         * tested, each weighted by its box's area relative to the root's.
+         */
+        [[nodiscard]] float sah_cost() const;
+
+        [[nodiscard]] std::size_t size() const { return m_bounds.size(); }
+
+        [[nodiscard]] std::size_t node_count() const { return m_nodes.size(); }
+
+        [[nodiscard]] std::span<const aabb> bounds() const { return m_bounds; }
+
+        /**
+         * @brief Writes the index of every instance whose box intersects
+         * p_frustum, in no particular order.
+         *
+         * Subtrees entirely inside the frustum are copied out without
+         * testing their instances. p_visible needs room for size()
+         * indices.
+         *
+         * @return number of indices written.
+         */
+        std::size_t query(const frustum& p_frustum,
+                          std::span<std::uint32_t> p_visible) const;
+
+        //! Nearest instance whose box p_ray enters within max_distance.
+        [[nodiscard]] std::optional<ray_hit> raycast(const ray& p_ray) const;
+
+        /**
+         * @brief Nearest instance for which p_intersect(index, ray) returns
+         * a distance within max_distance, visiting boxes front to back.
+         *
+         * p_intersect returns infinity on a miss. It is only called for
+         * instances whose box the ray enters, and ties go to the lower
+         * index.
+         */
+        template<typename Fn>
+        [[nodiscard]] std::optional<ray_hit> raycast(const ray& p_ray,
+                                                     Fn&& p_intersect) const {
+            using fn_type = std::remove_reference_t<Fn>;
+            auto invoke = [](void* p_context,
+                             std::uint32_t p_index,
+                             const ray& p_r) -> float {
+                return (*static_cast<fn_type*>(p_context))(p_index, p_r);
+            };
+            return closest_hit(
+              p_ray,
+              invoke,
+              const_cast<void*>(static_cast<const void*>(&p_intersect)));
+        }
+
+    private:
+        // child is a node index, or k_leaf for a leaf. first and count give
+        // the instances under the slot as a range of m_indices. Slots at
+        // and past slots are unused.
+        struct alignas(32) node {
+            float bounds[6][width];
+            std::uint32_t child[width];
+            std::uint32_t first[width];
+            std::uint32_t count[width];
+            std::uint32_t parent;
+            std::uint32_t parent_slot;
+            std::uint32_t slots;
+        };
+
+        // Instances first to first + count of the build's refs, with their
+        // boxes' union and the bounds of their doubled centers.
+        struct range {
+            aabb bounds;
+            aabb centroids;
+            std::uint32_t first;
+            std::uint32_t count;
+        };
+
+        // An instance as the build moves it around: splits shuffle these
+        // in place, so every pass reads them in order.
+        struct build_ref {
+            aabb bounds;
+            std::uint32_t index;
+        };
+
+        struct build_state;
+
+        void build_subtree(build_state& p_state,
+                           std::uint32_t p_node,
+                           const range& p_range);
+        void split(build_state& p_state,
+                   const range& p_range,
+                   range& p_left,
+                   range& p_right);
+        void refit_leaves(std::uint32_t p_node);
+        void refit_parent(std::uint32_t p_node);
+
+        std::optional<ray_hit> closest_hit(
+          const ray& p_ray,
+          float (*p_intersect)(void*, std::uint32_t, const ray&),
+          void* p_context) const;
+
+        std::vector<aabb> m_bounds;
+        std::vector<node> m_nodes;
+        // Instances in leaf order, and the node holding each instance.
+        std::vector<std::uint32_t> m_indices;
+        std::vector<std::uint32_t> m_leaf_node;
+        // Instances changed since the last refit, and which nodes a refit
+        // has already queued.
+        std::vector<std::uint32_t> m_changed;
+        std::vector<std::uint8_t> m_changed_flags;
+        std::vector<std::uint8_t> m_node_flags;
+        std::vector<std::uint32_t> m_refit_nodes;
+        bool m_all_changed = false;
+    };
+}
+
+namespace math {
+    namespace {
+        using simd::vfloat;
+        using simd::vmask;
+
+        constexpr float k_box_infinity = std::numeric_limits<float>::infinity();
+        constexpr std::uint32_t k_leaf = std::numeric_limits<std::uint32_t>::max();
+        constexpr std::uint32_t k_leaf_size = 4;
+        constexpr std::size_t k_sah_bins = 16;
+        // Ranges of at least two chunks this large bin their centroids in
+        // parallel.
+        constexpr std::size_t k_parallel_bin_grain = std::size_t{ 1 } << 15;
+        // Subtrees this large build their children in parallel.
+        constexpr std::uint32_t k_parallel_subtree = 1u << 12;
+        constexpr std::size_t k_refit_grain = 64;
+        constexpr std::size_t k_node_groups = bvh::width / simd::lanes;
+
+        // Component p_axis of p_v, 0 to 2.
+        float component(const float3& p_v, int p_axis) {
+            return (&p_v.x)[p_axis];
+        }
+
+        aabb empty_box() {
+            return { { k_box_infinity, k_box_infinity, k_box_infinity },
+                     { -k_box_infinity, -k_box_infinity, -k_box_infinity } };
+        }
+
+        void grow(aabb& p_box, const aabb& p_other) {
+            p_box.min = { std::min(p_box.min.x, p_other.min.x),
+                          std::min(p_box.min.y, p_other.min.y),
+                          std::min(p_box.min.z, p_other.min.z) };
+            p_box.max = { std::max(p_box.max.x, p_other.max.x),
+                          std::max(p_box.max.y, p_other.max.y),
+                          std::max(p_box.max.z, p_other.max.z) };
+        }
+
+        void grow(aabb& p_box, const float3& p_point) {
+            grow(p_box, { p_point, p_point });
+        }
+
+        // Half the surface area, zero for empty boxes.
+        float half_area(const aabb& p_box) {
+            const float3 d = p_box.max - p_box.min;
+            if (d.x < 0.f || d.y < 0.f || d.z < 0.f) {
+                return 0.f;
+            }
+            return d.x * d.y + d.y * d.z + d.z * d.x;
+        }
+
+        float3 box_center(const aabb& p_box) {
+            return (p_box.min + p_box.max) * 0.5f;
+        }
+
+        // Entry distance of p_ray into p_box, infinity on a miss. Shares
+        // its arithmetic with the node test below.
+        float box_distance(const aabb& p_box,
+                           const float3& p_origin,
+                           const float3& p_inverse,
+                           float p_max_distance) {
+            float enter = 0.f;
+            float leave = p_max_distance;
+            for (int a = 0; a < 3; ++a) {
+                const float inverse = component(p_inverse, a);
+                const float lo = component(p_box.min, a);
+                const float hi = component(p_box.max, a);
+                const float o = component(p_origin, a);
+                const float t0 = ((inverse >= 0.f ? lo : hi) - o) * inverse;
+                const float t1 = ((inverse >= 0.f ? hi : lo) - o) * inverse;
+                enter = std::max(enter, t0);
+                leave = std::min(leave, t1);
+            }
+            return enter <= leave ? enter : k_box_infinity;
+        }
+
+        // 1 / direction, with zero components turned into huge values of
+        // the sign the slab test assumes so no lane computes 0 * inf.
+        float3 ray_inverse(const float3& p_direction) {
+            auto inverse = [](float p_d) {
+                if (std::abs(p_d) > 1e-30f) {
+                    return 1.f / p_d;
+                }
+                return p_d >= 0.f ? 1e30f : -1e30f;
+            };
+            return { inverse(p_direction.x), inverse(p_direction.y),
+                     inverse(p_direction.z) };
+        }
+
+        // Box centers scaled by two, which is all binning needs and leaves
+        // nothing for the compiler to contract into an fma differently at
+        // each use.
+        float3 doubled_center(const aabb& p_box) {
+            return p_box.min + p_box.max;
+        }
+
+        // One centroid bin: the union of its boxes, mins then maxes, and
+        // how many there are. Plain floats keep the binning loop in scalar
+        // registers.
+        struct sah_bin {
+            float bounds[6] = { k_box_infinity,  k_box_infinity,  k_box_infinity,
+                                -k_box_infinity, -k_box_infinity, -k_box_infinity };
+            std::uint32_t count = 0;
+        };
+
+        struct sah_bins {
+            sah_bin axes[3][k_sah_bins];
+        };
+
+        void add_to_bin(sah_bin& p_bin, const float (&p_bounds)[6]) {
+            for (int k = 0; k < 3; ++k) {
+                p_bin.bounds[k] = std::min(p_bin.bounds[k], p_bounds[k]);
+                p_bin.bounds[3 + k] = std::max(p_bin.bounds[3 + k], p_bounds[3 + k]);
+            }
+        }
+
+        aabb bin_box(const sah_bin& p_bin) {
+            return { { p_bin.bounds[0], p_bin.bounds[1], p_bin.bounds[2] },
+                     { p_bin.bounds[3], p_bin.bounds[4], p_bin.bounds[5] } };
+        }
+
+        void merge_bins(sah_bins& p_into, const sah_bins& p_from) {
+            for (int a = 0; a < 3; ++a) {
+                for (std::size_t b = 0; b < k_sah_bins; ++b) {
+                    add_to_bin(p_into.axes[a][b], p_from.axes[a][b].bounds);
+                    p_into.axes[a][b].count += p_from.axes[a][b].count;
+                }
+            }
+        }
+
+        // Maps doubled centers to bins along each axis.
+        struct centroid_grid {
+            float origin[3];
+            float scale[3];
+
+            [[nodiscard]] std::uint32_t bin(float p_center, int p_axis) const {
+                const float t = (p_center - origin[p_axis]) * scale[p_axis];
+                return std::min(static_cast<std::uint32_t>(std::max(t, 0.f)),
+                                static_cast<std::uint32_t>(k_sah_bins - 1));
+            }
+        };
+
+        // Precomputed per plane: coefficients in every lane, and which
+        // bounds rows hold the box corner furthest along the normal and the
+        // one furthest against it.
+        struct plane_lanes {
+            vfloat x;
+            vfloat y;
+            vfloat z;
+            vfloat w;
+            int outer[3];
+            int inner[3];
+        };
+
+        void make_plane_lanes(const frustum& p_frustum, plane_lanes (&p_out)[6]) {
+            for (int i = 0; i < 6; ++i) {
+                const float4& plane = p_frustum.planes[i];
+                p_out[i] = { vfloat::splat(plane.x), vfloat::splat(plane.y),
+                             vfloat::splat(plane.z), vfloat::splat(plane.w),
+                             {},                     {} };
+                const float normal[] = { plane.x, plane.y, plane.z };
+                for (int a = 0; a < 3; ++a) {
+                    p_out[i].outer[a] = normal[a] >= 0.f ? 3 + a : a;
+                    p_out[i].inner[a] = normal[a] >= 0.f ? a : 3 + a;
+                }
+            }
+        }
+
+        // Bits of the slots whose boxes may intersect the frustum, and of
+        // those entirely inside it.
+        void frustum_slots(const plane_lanes (&p_planes)[6],
+                           const float (&p_bounds)[6][bvh::width],
+                           std::uint32_t& p_visible,
+                           std::uint32_t& p_inside) {
+            p_visible = 0;
+            p_inside = 0;
+            for (std::size_t g = 0; g < k_node_groups; ++g) {
+                const std::size_t at = g * simd::lanes;
+                auto distance = [&](const plane_lanes& p_plane, const int (&p_rows)[3]) {
+                    vfloat d = simd::fma(p_plane.x,
+                                         vfloat::load(&p_bounds[p_rows[0]][at]),
+                                         p_plane.w);
+                    d = simd::fma(p_plane.y, vfloat::load(&p_bounds[p_rows[1]][at]), d);
+                    return simd::fma(p_plane.z, vfloat::load(&p_bounds[p_rows[2]][at]), d);
+                };
+                const vfloat zero = vfloat::splat(0.f);
+                vmask visible = distance(p_planes[0], p_planes[0].outer) >= zero;
+                vmask inside = distance(p_planes[0], p_planes[0].inner) >= zero;
+                for (int i = 1; i < 6; ++i) {
+                    visible = visible & (distance(p_planes[i], p_planes[i].outer) >= zero);
+                    inside = inside & (distance(p_planes[i], p_planes[i].inner) >= zero);
+                }
+                p_visible |= simd::bits(visible) << at;
+                p_inside |= simd::bits(inside) << at;
+            }
+        }
+
+        // Entry distances of p_ray into every slot, infinity where it
+        // misses or enters past p_max_distance.
+        void ray_slots(const float (&p_bounds)[6][bvh::width],
+                       const float3& p_origin,
+                       const float3& p_inverse,
+                       float p_max_distance,
+                       float (&p_distances)[bvh::width]) {
+            int near_rows[3];
+            int far_rows[3];
+            for (int a = 0; a < 3; ++a) {
+                const bool positive = component(p_inverse, a) >= 0.f;
+                near_rows[a] = positive ? a : 3 + a;
+                far_rows[a] = positive ? 3 + a : a;
+            }
+            const vfloat origin[] = { vfloat::splat(p_origin.x),
+                                      vfloat::splat(p_origin.y),
+                                      vfloat::splat(p_origin.z) };
+            const vfloat inverse[] = { vfloat::splat(p_inverse.x),
+                                       vfloat::splat(p_inverse.y),
+                                       vfloat::splat(p_inverse.z) };
+            for (std::size_t g = 0; g < k_node_groups; ++g) {
+                const std::size_t at = g * simd::lanes;
+                vfloat enter = vfloat::splat(0.f);
+                vfloat leave = vfloat::splat(p_max_distance);
+                for (int a = 0; a < 3; ++a) {
+                    const vfloat near_plane = vfloat::load(&p_bounds[near_rows[a]][at]);
+                    const vfloat far_plane = vfloat::load(&p_bounds[far_rows[a]][at]);
+                    enter = simd::max(enter, (near_plane - origin[a]) * inverse[a]);
+                    leave = simd::min(leave, (far_plane - origin[a]) * inverse[a]);
+                }
+                simd::select(enter <= leave, enter, vfloat::splat(k_box_infinity))
+                  .store(&p_distances[at]);
+            }
+        }
+
+        float box_hit(void* p_context, std::uint32_t p_index, const ray& p_ray) {
+            const aabb* bounds = static_cast<const aabb*>(p_context);
+            return box_distance(bounds[p_index], p_ray.origin,
+                                ray_inverse(p_ray.direction), p_ray.max_distance);
+        }
+    }
+
+    struct bvh::build_state {
+        build_ref* refs;
+        node* nodes;
+        std::atomic<std::uint32_t> next_node;
+        jobs::scheduler* jobs;
+    };
+
+    aabb transform_aabb(const aabb& p_local, const float4x4& p_transform) {
+        // Center moved by the full matrix, half extents by its absolute
+        // value.
+        const float3 center = box_center(p_local);
+        const float3 extent = (p_local.max - p_local.min) * 0.5f;
+        float3 placed_center = p_transform.columns[3].xyz();
+        float3 placed_extent{};
+        for (int c = 0; c < 3; ++c) {
+            const float3 column = p_transform.columns[c].xyz();
+            placed_center = placed_center + column * component(center, c);
+            placed_extent =
+              placed_extent + float3{ std::abs(column.x), std::abs(column.y),
+                                      std::abs(column.z) } *
+                                component(extent, c);
+        }
+        return { placed_center - placed_extent, placed_center + placed_extent };
+    }
+
+    bool intersects(const frustum& p_frustum, const aabb& p_box) {
+        for (const float4& plane : p_frustum.planes) {
+            const float3 corner = { plane.x >= 0.f ? p_box.max.x : p_box.min.x,
+                                    plane.y >= 0.f ? p_box.max.y : p_box.min.y,
+                                    plane.z >= 0.f ? p_box.max.z : p_box.min.z };
+            if (dot(plane.xyz(), corner) + plane.w < 0.f) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void bvh::build(std::span<const aabb> p_bounds, jobs::scheduler* p_jobs) {
+        const auto count = static_cast<std::uint32_t>(p_bounds.size());
+        m_bounds.assign(p_bounds.begin(), p_bounds.end());
+        m_indices.resize(count);
+        m_leaf_node.assign(count, 0);
+        m_changed.clear();
+        m_changed_flags.assign(count, 0);
+        m_all_changed = false;
+        m_nodes.clear();
+        if (count == 0) {
+            m_node_flags.clear();
+            return;
+        }
+
+        std::vector<build_ref> refs(count);
+        range root = { empty_box(), empty_box(), 0, count };
+        for (std::uint32_t i = 0; i < count; ++i) {
+            refs[i] = { m_bounds[i], i };
+            grow(root.bounds, m_bounds[i]);
+            grow(root.centroids, doubled_center(m_bounds[i]));
+        }
+
+        // Every node but a lone root splits into two or more slots and
+        // every slot holds an instance, so count nodes always suffice.
+        // Left uninitialized, only the nodes handed out get touched.
+        const std::unique_ptr<node[]> nodes(new node[count]);
+        build_state state{ refs.data(), nodes.get(), 1, p_jobs };
+        nodes[0].parent = k_leaf;
+        nodes[0].parent_slot = 0;
+        build_subtree(state, 0, root);
+        m_nodes.assign(nodes.get(), nodes.get() + state.next_node.load());
+        m_node_flags.assign(m_nodes.size(), 0);
+    }
+
+    void bvh::build_subtree(build_state& p_state,
+                            std::uint32_t p_node,
+                            const range& p_range) {
+        // Split the range with the largest box, among those too big for a
+        // leaf, until the node is full.
+        range ranges[width];
+        ranges[0] = p_range;
+        std::size_t used = 1;
+        while (used < width) {
+            std::size_t pick = width;
+            float largest = -1.f;
+            for (std::size_t i = 0; i < used; ++i) {
+                const float area = half_area(ranges[i].bounds);
+                if (ranges[i].count > k_leaf_size && area > largest) {
+                    pick = i;
+                    largest = area;
+                }
+            }
+            if (pick == width) {
+                break;
+            }
+            const range whole = ranges[pick];
+            split(p_state, whole, ranges[pick], ranges[used]);
+            ++used;
+        }
+
+        node& n = p_state.nodes[p_node];
+        n.slots = static_cast<std::uint32_t>(used);
+        std::uint32_t interior[width];
+        std::size_t interior_count = 0;
+        for (std::size_t s = 0; s < width; ++s) {
+            const aabb box = s < used ? ranges[s].bounds : empty_box();
+            for (int a = 0; a < 3; ++a) {
+                n.bounds[a][s] = component(box.min, a);
+                n.bounds[3 + a][s] = component(box.max, a);
+            }
+            n.child[s] = k_leaf;
+            n.first[s] = s < used ? ranges[s].first : 0;
+            n.count[s] = s < used ? ranges[s].count : 0;
+            if (s >= used) {
+                continue;
+            }
+            if (ranges[s].count > k_leaf_size) {
+                const std::uint32_t child = p_state.next_node.fetch_add(1);
+                p_state.nodes[child].parent = p_node;
+                p_state.nodes[child].parent_slot = static_cast<std::uint32_t>(s);
+                n.child[s] = child;
+                interior[interior_count++] = static_cast<std::uint32_t>(s);
+                continue;
+            }
+            for (std::uint32_t i = 0; i < ranges[s].count; ++i) {
+                const std::uint32_t index = p_state.refs[ranges[s].first + i].index;
+                m_indices[ranges[s].first + i] = index;
+                m_leaf_node[index] = p_node;
+            }
+        }
+
+        auto build_children = [&](std::size_t p_begin, std::size_t p_end) {
+            for (std::size_t i = p_begin; i < p_end; ++i) {
+                const std::uint32_t s = interior[i];
+                build_subtree(p_state, n.child[s], ranges[s]);
+            }
+        };
+        if (p_state.jobs && p_range.count >= k_parallel_subtree) {
+            p_state.jobs->parallel_for(interior_count, 1, build_children);
+        }
+        else {
+            build_children(0, interior_count);
+        }
+    }
+
+    void bvh::split(build_state& p_state,
+                    const range& p_range,
+                    range& p_left,
+                    range& p_right) {
+        build_ref* const refs = p_state.refs + p_range.first;
+        const std::uint32_t count = p_range.count;
+        const float3 extent = p_range.centroids.max - p_range.centroids.min;
+
+        centroid_grid grid{ { p_range.centroids.min.x, p_range.centroids.min.y,
+                              p_range.centroids.min.z },
+                            {} };
+        int best_axis = -1;
+        std::uint32_t best_bin = 0;
+        if (extent.x > 0.f || extent.y > 0.f || extent.z > 0.f) {
+            for (int a = 0; a < 3; ++a) {
+                const float e = component(extent, a);
+                grid.scale[a] = e > 0.f ? k_sah_bins / e : 0.f;
+            }
+
+            sah_bins bins;
+            const bool parallel = p_state.jobs && count >= 2 * k_parallel_bin_grain;
+            std::vector<sah_bins> partial(
+              parallel ? (count + k_parallel_bin_grain - 1) / k_parallel_bin_grain : 0);
+            auto bin = [&](std::size_t p_begin, std::size_t p_end) {
+                sah_bins& local =
+                  parallel ? partial[p_begin / k_parallel_bin_grain] : bins;
+                for (std::size_t i = p_begin; i < p_end; ++i) {
+                    const aabb& box = refs[i].bounds;
+                    const float bounds[6] = { box.min.x, box.min.y, box.min.z,
+                                              box.max.x, box.max.y, box.max.z };
+                    for (int a = 0; a < 3; ++a) {
+                        sah_bin& b =
+                          local.axes[a][grid.bin(bounds[a] + bounds[3 + a], a)];
+                        add_to_bin(b, bounds);
+                        ++b.count;
+                    }
+                }
+            };
+            if (parallel) {
+                p_state.jobs->parallel_for(count, k_parallel_bin_grain, bin);
+            }
+            else {
+                bin(0, count);
+            }
+            for (const sah_bins& chunk : partial) {
+                merge_bins(bins, chunk);
+            }
+
+            // Cost of splitting after bin b: area times count on each side.
+            float best_cost = k_box_infinity;
+            for (int a = 0; a < 3; ++a) {
+                if (component(extent, a) <= 0.f) {
+                    continue;
+                }
+                float right_cost[k_sah_bins];
+                aabb right = empty_box();
+                std::uint32_t right_count = 0;
+                for (std::size_t b = k_sah_bins - 1; b > 0; --b) {
+                    grow(right, bin_box(bins.axes[a][b]));
+                    right_count += bins.axes[a][b].count;
+                    right_cost[b] = half_area(right) * right_count;
+                }
+                aabb left = empty_box();
+                std::uint32_t left_count = 0;
+                for (std::size_t b = 0; b + 1 < k_sah_bins; ++b) {
+                    grow(left, bin_box(bins.axes[a][b]));
+                    left_count += bins.axes[a][b].count;
+                    const float cost = half_area(left) * left_count + right_cost[b + 1];
+                    if (left_count > 0 && left_count < count && cost < best_cost) {
+                        best_axis = a;
+                        best_bin = static_cast<std::uint32_t>(b);
+                        best_cost = cost;
+                    }
+                }
+            }
+        }
+
+        // Each side's boxes grow in locals as instances settle on it.
+        aabb sides[2][2] = { { empty_box(), empty_box() }, { empty_box(), empty_box() } };
+        auto take = [&](int p_side, const build_ref& p_ref) {
+            grow(sides[p_side][0], p_ref.bounds);
+            grow(sides[p_side][1], doubled_center(p_ref.bounds));
+        };
+        std::uint32_t left_count = count / 2;
+        if (best_axis >= 0) {
+            // Both ends move inwards, swapping pairs on the wrong side.
+            auto goes_left = [&](const build_ref& p_ref) {
+                const float center = component(p_ref.bounds.min, best_axis) +
+                                     component(p_ref.bounds.max, best_axis);
+                return grid.bin(center, best_axis) <= best_bin;
+            };
+            std::uint32_t lo = 0;
+            std::uint32_t hi = count;
+            for (;;) {
+                for (; lo < hi && goes_left(refs[lo]); ++lo) {
+                    take(0, refs[lo]);
+                }
+                for (; lo < hi && !goes_left(refs[hi - 1]); --hi) {
+                    take(1, refs[hi - 1]);
+                }
+                if (lo == hi) {
+                    break;
+                }
+                std::swap(refs[lo], refs[hi - 1]);
+            }
+            left_count = lo;
+        }
+        else {
+            // Centroids all in one spot: halve the range as it stands.
+            for (std::uint32_t i = 0; i < count; ++i) {
+                take(i < left_count ? 0 : 1, refs[i]);
+            }
+        }
+        p_left = { sides[0][0], sides[0][1], p_range.first, left_count };
+        p_right = { sides[1][0], sides[1][1], p_range.first + left_count,
+                    count - left_count };
+    }
+
+    void bvh::set_bounds(std::size_t p_index, const aabb& p_bounds) {
+        m_bounds[p_index] = p_bounds;
+        if (!m_changed_flags[p_index]) {
+            m_changed_flags[p_index] = 1;
+            m_changed.push_back(static_cast<std::uint32_t>(p_index));
+        }
+    }
+
+    bool bvh::update(std::span<const aabb> p_bounds) {
+        if (p_bounds.size() != m_bounds.size()) {
+            return false;
+        }
+        std::ranges::copy(p_bounds, m_bounds.begin());
+        m_all_changed = true;
+        return true;
+    }
+
+    void bvh::refit_leaves(std::uint32_t p_node) {
+        node& n = m_nodes[p_node];
+        for (std::uint32_t s = 0; s < n.slots; ++s) {
+            if (n.child[s] != k_leaf) {
+                continue;
+            }
+            aabb box = empty_box();
+            for (std::uint32_t i = 0; i < n.count[s]; ++i) {
+                grow(box, m_bounds[m_indices[n.first[s] + i]]);
+            }
+            for (int a = 0; a < 3; ++a) {
+                n.bounds[a][s] = component(box.min, a);
+                n.bounds[3 + a][s] = component(box.max, a);
+            }
+        }
+    }
+
+    void bvh::refit_parent(std::uint32_t p_node) {
+        const node& n = m_nodes[p_node];
+        if (n.parent == k_leaf) {
+            return;
+        }
+        node& parent = m_nodes[n.parent];
+        for (int row = 0; row < 6; ++row) {
+            float value = n.bounds[row][0];
+            for (std::uint32_t s = 1; s < n.slots; ++s) {
+                value = row < 3 ? std::min(value, n.bounds[row][s])
+                                : std::max(value, n.bounds[row][s]);
+            }
+            parent.bounds[row][n.parent_slot] = value;
+        }
+    }
+
+    void bvh::refit(jobs::scheduler* p_jobs) {
+        if (m_nodes.empty()) {
+            m_changed.clear();
+            m_all_changed = false;
+            return;
+        }
+
+        // Children always come after their parents, so walking nodes from
+        // the back settles every child slot before its parent reads it.
+        if (m_all_changed) {
+            auto leaves = [&](std::size_t p_begin, std::size_t p_end) {
+                for (std::size_t i = p_begin; i < p_end; ++i) {
+                    refit_leaves(static_cast<std::uint32_t>(i));
+                }
+            };
+            if (p_jobs) {
+                p_jobs->parallel_for(m_nodes.size(), k_refit_grain, leaves);
+            }
+            else {
+                leaves(0, m_nodes.size());
+            }
+            for (std::size_t i = m_nodes.size(); i-- > 1;) {
+                refit_parent(static_cast<std::uint32_t>(i));
+            }
+        }
+        else {
+            // The leaf nodes of every changed instance and their ancestors,
+            // each once.
+            m_refit_nodes.clear();
+            for (const std::uint32_t index : m_changed) {
+                for (std::uint32_t n = m_leaf_node[index];
+                     n != k_leaf && !m_node_flags[n];
+                     n = m_nodes[n].parent) {
+                    m_node_flags[n] = 1;
+                    m_refit_nodes.push_back(n);
+                }
+            }
+            std::ranges::sort(m_refit_nodes, std::greater<>{});
+            auto leaves = [&](std::size_t p_begin, std::size_t p_end) {
+                for (std::size_t i = p_begin; i < p_end; ++i) {
+                    refit_leaves(m_refit_nodes[i]);
+                }
+            };
+            if (p_jobs) {
+                p_jobs->parallel_for(m_refit_nodes.size(), k_refit_grain, leaves);
+            }
+            else {
+                leaves(0, m_refit_nodes.size());
+            }
+            for (const std::uint32_t n : m_refit_nodes) {
+                refit_parent(n);
+                m_node_flags[n] = 0;
+            }
+        }
+
+        for (const std::uint32_t index : m_changed) {
+            m_changed_flags[index] = 0;
+        }
+        m_changed.clear();
+        m_all_changed = false;
+    }
+
+    float bvh::sah_cost() const {
+        if (m_nodes.empty()) {
+            return 0.f;
+        }
+        aabb root = empty_box();
+        double cost = 0.0;
+        for (const node& n : m_nodes) {
+            for (std::uint32_t s = 0; s < n.slots; ++s) {
+                const aabb box = { { n.bounds[0][s], n.bounds[1][s], n.bounds[2][s] },
+                                   { n.bounds[3][s], n.bounds[4][s], n.bounds[5][s] } };
+                if (&n == &m_nodes[0]) {
+                    grow(root, box);
+                }
+                cost += static_cast<double>(half_area(box)) *
+                        (n.child[s] == k_leaf ? n.count[s] : 1u);
+            }
+        }
+        const float area = half_area(root);
+        return area > 0.f ? static_cast<float>(1.0 + cost / area) : 1.f;
+    }
+
+    std::size_t bvh::query(const frustum& p_frustum,
+                           std::span<std::uint32_t> p_visible) const {
+        if (m_nodes.empty()) {
+            return 0;
+        }
+        plane_lanes planes[6];
+        make_plane_lanes(p_frustum, planes);
+
+        std::size_t written = 0;
+        std::vector<std::uint32_t> stack = { 0 };
+        while (!stack.empty()) {
+            const node& n = m_nodes[stack.back()];
+            stack.pop_back();
+            std::uint32_t visible = 0;
+            std::uint32_t inside = 0;
+            frustum_slots(planes, n.bounds, visible, inside);
+            visible &= (1u << n.slots) - 1u;
+            for (; visible != 0; visible &= visible - 1) {
+                const int s = std::countr_zero(visible);
+                const std::uint32_t* indices = &m_indices[n.first[s]];
+                if (inside >> s & 1u) {
+                    std::copy_n(indices, n.count[s], &p_visible[written]);
+                    written += n.count[s];
+                }
+                else if (n.child[s] != k_leaf) {
+                    stack.push_back(n.child[s]);
+                }
+                else {
+                    for (std::uint32_t i = 0; i < n.count[s]; ++i) {
+                        p_visible[written] = indices[i];
+                        written += intersects(p_frustum, m_bounds[indices[i]]);
+                    }
+                }
+            }
+        }
+        return written;
+    }
+
+    std::optional<ray_hit> bvh::raycast(const ray& p_ray) const {
+        return closest_hit(p_ray, box_hit, const_cast<aabb*>(m_bounds.data()));
+    }
+
+    std::optional<ray_hit> bvh::closest_hit(
+      const ray& p_ray,
+      float (*p_intersect)(void*, std::uint32_t, const ray&),
+      void* p_context) const {
+        if (m_nodes.empty()) {
+            return std::nullopt;
+        }
+        const float3 inverse = ray_inverse(p_ray.direction);
+        float best = p_ray.max_distance;
+        std::uint32_t best_index = k_leaf;
+
+        struct entry {
+            std::uint32_t node;
+            float distance;
+        };
+        std::vector<entry> stack = { { 0, 0.f } };
+        while (!stack.empty()) {
+            const entry top = stack.back();
+            stack.pop_back();
+            if (top.distance > best) {
+                continue;
+            }
+            const node& n = m_nodes[top.node];
+            alignas(32) float distances[width];
+            ray_slots(n.bounds, p_ray.origin, inverse, best, distances);
+
+            // Slots entered, nearest first.
+            std::uint32_t order[width];
+            std::size_t hits = 0;
+            for (std::uint32_t s = 0; s < n.slots; ++s) {
+                if (distances[s] == k_box_infinity) {
+                    continue;
+                }
+                std::size_t at = hits++;
+                for (; at > 0 && distances[order[at - 1]] > distances[s]; --at) {
+                    order[at] = order[at - 1];
+                }
+                order[at] = s;
+            }
+
+            // Leaves are tested now, nearest first, so best shrinks before
+            // the farther children are pushed, farthest at the bottom.
+            for (std::size_t h = 0; h < hits; ++h) {
+                const std::uint32_t s = order[h];
+                if (n.child[s] != k_leaf || distances[s] > best) {
+                    continue;
+                }
+                for (std::uint32_t i = 0; i < n.count[s]; ++i) {
+                    const std::uint32_t index = m_indices[n.first[s] + i];
+                    const float distance = p_intersect(p_context, index, p_ray);
+                    if (distance == k_box_infinity || distance > best) {
+                        continue;
+                    }
+                    if (distance < best || index < best_index) {
+                        best = distance;
+                        best_index = index;
+                    }
+                }
+            }
+            for (std::size_t h = hits; h-- > 0;) {
+                const std::uint32_t s = order[h];
+                if (n.child[s] != k_leaf && distances[s] <= best) {
+                    stack.push_back({ n.child[s], distances[s] });
+                }
+            }
+        }
+        if (best_index == k_leaf) {
+            return std::nullopt;
+        }
+        return ray_hit{ best_index, best };
+    }
+}
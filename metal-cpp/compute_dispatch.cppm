@@ -0,0 +1,334 @@
+module;
+
+#include <algorithm>
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+export module lib:compute_dispatch;
+
+import :job_system;
+
+export namespace compute {
+    //! Mirrors MTL::Size and the uint3 attributes of MSL kernels.
+    struct uint3 {
+        std::uint32_t x = 1;
+        std::uint32_t y = 1;
+        std::uint32_t z = 1;
+
+        [[nodiscard]] std::size_t volume() const {
+            return std::size_t{ x } * y * z;
+        }
+
+        friend bool operator==(const uint3&, const uint3&) = default;
+    };
+
+    /**
+     * @brief Coroutine return type for kernels that use threadgroup
+     * barriers.
+     *
+     * A kernel written as `kernel_thread fn(const thread_context& t)` may
+     * `co_await t.barrier()`. Every thread of the threadgroup is suspended
+     * at the barrier before any of them continues, the same contract as
+     * threadgroup_barrier(mem_flags::mem_threadgroup) in MSL.
+     */
+    class kernel_thread {
+    public:
+        struct promise_type {
+            kernel_thread get_return_object() {
+                return kernel_thread(
+                  std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; }
+            void return_void() {}
+            //! Kernels must not throw, same as scheduler jobs.
+            void unhandled_exception() { std::terminate(); }
+        };
+
+        kernel_thread(kernel_thread&& p_other) noexcept
+          : m_handle(std::exchange(p_other.m_handle, {})) {}
+        kernel_thread& operator=(kernel_thread&& p_other) noexcept {
+            std::swap(m_handle, p_other.m_handle);
+            return *this;
+        }
+        ~kernel_thread() {
+            if (m_handle) {
+                m_handle.destroy();
+            }
+        }
+
+        //! Runs the thread up to its next barrier or its end.
+        //! @return false once the kernel has returned.
+        bool resume() {
+            m_handle.resume();
+            return !m_handle.done();
+        }
+
+    private:
+        explicit kernel_thread(std::coroutine_handle<promise_type> p_handle)
+          : m_handle(p_handle) {}
+
+        std::coroutine_handle<promise_type> m_handle;
+    };
+
+    //! Per-thread attributes, named after their MSL counterparts.
+    struct thread_context {
+        uint3 thread_position_in_grid;
+        uint3 threads_per_grid;
+        uint3 thread_position_in_threadgroup;
+        //! Size of this threadgroup, smaller than requested at the grid
+        //! edges of a non-uniform dispatchThreads.
+        uint3 threads_per_threadgroup;
+        uint3 threadgroup_position_in_grid;
+        uint3 threadgroups_per_grid;
+        std::uint32_t thread_index_in_threadgroup = 0;
+
+        //! Suspends until every thread of the threadgroup arrives.
+        [[nodiscard]] std::suspend_always barrier() const { return {}; }
+
+        /**
+         * @return the threadgroup memory bound at p_index as an array of T,
+         * shared by every thread in the threadgroup. Like Metal it starts
+         * out uninitialised and is not cleared between threadgroups.
+         */
+        template<typename T>
+        [[nodiscard]] std::span<T> threadgroup_memory(std::size_t p_index) const {
+            const std::span<std::byte> bytes = memory[p_index];
+            return { reinterpret_cast<T*>(bytes.data()),
+                     bytes.size() / sizeof(T) };
+        }
+
+        std::span<const std::span<std::byte>> memory;
+    };
+
+    enum class dispatch_status : std::uint8_t {
+        ok,
+        //! Zero-sized or larger than max_total_threads_per_threadgroup.
+        invalid_threadgroup_size,
+        //! Some threads of a threadgroup returned while others waited on a
+        //! barrier, undefined behaviour on the GPU.
+        barrier_divergence,
+    };
+
+    /**
+     * @brief CPU stand-in for MTL::ComputeCommandEncoder.
+     *
+     * Kernels are functors taking a `const thread_context&`. Kernels that
+     * return void run their threads one after another; kernels returning
+     * kernel_thread are coroutines and may synchronize on barriers, the
+     * dispatcher then steps all threads of a group to the next barrier in
+     * turn. Threadgroups are the unit of work spread over the scheduler,
+     * so kernels must only share memory through threadgroup memory or
+     * their own synchronization, just as on the GPU.
+     */
+    class dispatcher {
+    public:
+        static constexpr std::uint32_t max_total_threads_per_threadgroup = 1024;
+
+        explicit dispatcher(jobs::scheduler& p_jobs)
+          : m_jobs(&p_jobs) {}
+
+        //! Mirrors setThreadgroupMemoryLength(), rounded up to 16 bytes.
+        void set_threadgroup_memory_length(std::size_t p_length,
+                                           std::size_t p_index) {
+            if (m_memory_lengths.size() <= p_index) {
+                m_memory_lengths.resize(p_index + 1, 0);
+            }
+            m_memory_lengths[p_index] = (p_length + 15) & ~std::size_t{ 15 };
+        }
+
+        //! dispatchThreads: p_grid threads, edge threadgroups are partial.
+        template<typename Kernel>
+        dispatch_status dispatch_threads(uint3 p_grid,
+                                         uint3 p_threadgroup,
+                                         Kernel&& p_kernel) {
+            const uint3 groups = { divide_up(p_grid.x, p_threadgroup.x),
+                                   divide_up(p_grid.y, p_threadgroup.y),
+                                   divide_up(p_grid.z, p_threadgroup.z) };
+            return dispatch(p_grid, groups, p_threadgroup, p_kernel);
+        }
+
+        //! dispatchThreadgroups: the grid is a whole number of groups.
+        template<typename Kernel>
+        dispatch_status dispatch_threadgroups(uint3 p_threadgroups,
+                                              uint3 p_threadgroup,
+                                              Kernel&& p_kernel) {
+            const uint3 grid = { p_threadgroups.x * p_threadgroup.x,
+                                 p_threadgroups.y * p_threadgroup.y,
+                                 p_threadgroups.z * p_threadgroup.z };
+            return dispatch(grid, p_threadgroups, p_threadgroup, p_kernel);
+        }
+
+    private:
+        static std::uint32_t divide_up(std::uint32_t p_a, std::uint32_t p_b) {
+            return p_b == 0 ? 0 : (p_a + p_b - 1) / p_b;
+        }
+
+        // State one worker thread reuses for every threadgroup it runs,
+        // across dispatches. Blocks only grow.
+        struct group_scratch {
+            std::vector<std::unique_ptr<std::byte[]>> blocks;
+            std::vector<std::size_t> capacities;
+            std::vector<std::span<std::byte>> memory;
+            std::vector<thread_context> contexts;
+            std::vector<kernel_thread> threads;
+            bool in_use = false;
+        };
+
+        static group_scratch& worker_scratch() {
+            thread_local group_scratch scratch;
+            return scratch;
+        }
+
+        void prepare_scratch(group_scratch& p_scratch) const {
+            p_scratch.memory.clear();
+            for (std::size_t i = 0; i < m_memory_lengths.size(); ++i) {
+                const std::size_t length = m_memory_lengths[i];
+                if (i == p_scratch.blocks.size()) {
+                    p_scratch.blocks.emplace_back();
+                    p_scratch.capacities.push_back(0);
+                }
+                if (p_scratch.capacities[i] < length) {
+                    p_scratch.blocks[i] =
+                      std::make_unique_for_overwrite<std::byte[]>(length);
+                    p_scratch.capacities[i] = length;
+                }
+                p_scratch.memory.emplace_back(p_scratch.blocks[i].get(), length);
+            }
+        }
+
+        template<typename Kernel>
+        dispatch_status dispatch(uint3 p_grid,
+                                 uint3 p_groups,
+                                 uint3 p_threadgroup,
+                                 Kernel& p_kernel) {
+            if (p_threadgroup.volume() == 0 ||
+                p_threadgroup.volume() > max_total_threads_per_threadgroup) {
+                return dispatch_status::invalid_threadgroup_size;
+            }
+            if (p_grid.volume() == 0) {
+                return dispatch_status::ok;
+            }
+
+            std::atomic<bool> diverged{ false };
+            m_jobs->parallel_for(
+              p_groups.volume(),
+              1,
+              [&](std::size_t p_begin, std::size_t p_end) {
+                  // A kernel waiting on the scheduler may run a chunk of
+                  // another dispatch on this thread, that one gets its own.
+                  group_scratch local;
+                  group_scratch& reused = worker_scratch();
+                  group_scratch& scratch = reused.in_use ? local : reused;
+                  scratch.in_use = true;
+                  prepare_scratch(scratch);
+                  for (std::size_t group = p_begin; group < p_end; ++group) {
+                      const uint3 group_position = {
+                          static_cast<std::uint32_t>(group % p_groups.x),
+                          static_cast<std::uint32_t>(group / p_groups.x %
+                                                     p_groups.y),
+                          static_cast<std::uint32_t>(group / p_groups.x /
+                                                     p_groups.y)
+                      };
+                      if (!run_group(p_kernel, p_grid, p_groups, p_threadgroup,
+                                     group_position, scratch)) {
+                          diverged.store(true, std::memory_order_relaxed);
+                      }
+                  }
+                  // Coroutine frames must not outlive the kernel.
+                  scratch.threads.clear();
+                  scratch.in_use = false;
+              });
+            return diverged.load(std::memory_order_relaxed)
+                     ? dispatch_status::barrier_divergence
+                     : dispatch_status::ok;
+        }
+
+        template<typename Kernel>
+        static bool run_group(Kernel& p_kernel,
+                              uint3 p_grid,
+                              uint3 p_groups,
+                              uint3 p_threadgroup,
+                              uint3 p_group_position,
+                              group_scratch& p_scratch) {
+            thread_context context;
+            context.threads_per_grid = p_grid;
+            context.threadgroups_per_grid = p_groups;
+            context.threadgroup_position_in_grid = p_group_position;
+            context.memory = p_scratch.memory;
+
+            const uint3 origin = { p_group_position.x * p_threadgroup.x,
+                                   p_group_position.y * p_threadgroup.y,
+                                   p_group_position.z * p_threadgroup.z };
+            const uint3 size = {
+                std::min(p_threadgroup.x, p_grid.x - origin.x),
+                std::min(p_threadgroup.y, p_grid.y - origin.y),
+                std::min(p_threadgroup.z, p_grid.z - origin.z)
+            };
+            context.threads_per_threadgroup = size;
+
+            auto for_each_thread = [&](auto&& p_fn) {
+                std::uint32_t index = 0;
+                for (std::uint32_t z = 0; z < size.z; ++z) {
+                    for (std::uint32_t y = 0; y < size.y; ++y) {
+                        for (std::uint32_t x = 0; x < size.x; ++x) {
+                            context.thread_position_in_threadgroup = { x, y, z };
+                            context.thread_position_in_grid = {
+                                origin.x + x, origin.y + y, origin.z + z
+                            };
+                            context.thread_index_in_threadgroup = index++;
+                            p_fn();
+                        }
+                    }
+                }
+            };
+
+            using result = std::invoke_result_t<Kernel&, const thread_context&>;
+            if constexpr (std::is_void_v<result>) {
+                for_each_thread([&] { p_kernel(std::as_const(context)); });
+                return true;
+            }
+            else {
+                static_assert(std::is_same_v<result, kernel_thread>,
+                              "kernels return void or compute::kernel_thread");
+                // A coroutine keeps a reference to its context across
+                // suspensions, so every thread gets its own stable copy.
+                std::vector<thread_context>& contexts = p_scratch.contexts;
+                std::vector<kernel_thread>& threads = p_scratch.threads;
+                threads.clear();
+                contexts.clear();
+                contexts.reserve(size.volume());
+                for_each_thread([&] { contexts.push_back(context); });
+                for (const thread_context& thread : contexts) {
+                    threads.push_back(p_kernel(thread));
+                }
+
+                // Each round moves every thread to its next barrier. A
+                // round in which only some threads return is divergence.
+                bool running = true;
+                while (running) {
+                    std::size_t suspended = 0;
+                    for (kernel_thread& thread : threads) {
+                        suspended += thread.resume();
+                    }
+                    if (suspended != 0 && suspended != threads.size()) {
+                        return false;
+                    }
+                    running = suspended != 0;
+                }
+                return true;
+            }
+        }
+
+        jobs::scheduler* m_jobs;
+        std::vector<std::size_t> m_memory_lengths;
+    };
+}
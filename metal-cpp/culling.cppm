@@ -0,0 +1,292 @@
+module;
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+export module lib:culling;
+
+import :math;
+import :simd;
+import :shader_types;
+
+export namespace math {
+    /**
+     * @brief The six clip planes of a view-projection matrix.
+     *
+     * A point p is inside plane i when dot(planes[i].xyz(), p) +
+     * planes[i].w >= 0. The xyz parts are unit length, so the same sum is a
+     * signed distance and spheres are tested against their radius.
+     */
+    struct frustum {
+        float4 planes[6];
+    };
+
+    /**
+     * @brief Extracts the planes of p_view_projection, which maps into
+     * Metal's clip space: x and y in [-w, w], z in [0, w].
+     */
+    [[nodiscard]] frustum make_frustum(const float4x4& p_view_projection);
+
+    /**
+     * @brief Bounding sphere and normal cone of a cluster of triangles.
+     *
+     * The cluster is entirely back facing for a camera at c when
+     * dot(center - c, cone_axis) >= cone_cutoff * length(center - c) +
+     * radius. A cone_cutoff of 1 never passes, which is what clusters whose
+     * normals spread over a hemisphere or more get.
+     */
+    struct cluster_bounds {
+        float3 center{};
+        float radius = 0.f;
+        float3 cone_axis{};
+        float cone_cutoff = 1.f;
+    };
+
+    /**
+     * @brief Structure-of-arrays bounds as cull_bounds reads them.
+     *
+     * The cone arrays are optional: leave them empty and only the frustum
+     * test runs.
+     */
+    struct bounds_soa {
+        std::span<const float> center_x;
+        std::span<const float> center_y;
+        std::span<const float> center_z;
+        std::span<const float> radius;
+        std::span<const float> cone_axis_x;
+        std::span<const float> cone_axis_y;
+        std::span<const float> cone_axis_z;
+        std::span<const float> cone_cutoff;
+    };
+
+    //! Owning storage behind a bounds_soa.
+    struct bounds_storage {
+        std::vector<float> center_x;
+        std::vector<float> center_y;
+        std::vector<float> center_z;
+        std::vector<float> radius;
+        std::vector<float> cone_axis_x;
+        std::vector<float> cone_axis_y;
+        std::vector<float> cone_axis_z;
+        std::vector<float> cone_cutoff;
+
+        [[nodiscard]] std::size_t size() const { return radius.size(); }
+
+        [[nodiscard]] bounds_soa view() const {
+            return { center_x,    center_y,    center_z,    radius,
+                     cone_axis_x, cone_axis_y, cone_axis_z, cone_cutoff };
+        }
+    };
+
+    //! Copies p_bounds into p_out, cones included.
+    void split_bounds(std::span<const cluster_bounds> p_bounds,
+                      bounds_storage& p_out);
+
+    /**
+     * @brief Places p_local at every instance of p_instances, writing
+     * element i of p_out for instance i.
+     *
+     * Radii grow by the largest axis scale. Cones survive rotation and
+     * uniform scale, instances scaled unevenly get cone_cutoff 1. A
+     * p_local without a usable cone leaves p_out's cone arrays empty, so
+     * culling skips the test altogether.
+     */
+    void transform_bounds(const cluster_bounds& p_local,
+                          std::span<const shader_types::instance_data> p_instances,
+                          bounds_storage& p_out);
+
+    /**
+     * @brief Writes the indices of the elements of p_bounds that survive
+     * the frustum and, when p_bounds has cones, the back-face test, in
+     * ascending order.
+     *
+     * simd::lanes elements are tested per step and compacted without
+     * branching on the result. Indices are offset by p_first so callers can
+     * split the work into chunks. p_visible needs room for every element.
+     *
+     * @return number of indices written.
+     */
+    std::size_t cull_bounds(const frustum& p_frustum,
+                            const float3& p_camera_position,
+                            const bounds_soa& p_bounds,
+                            std::span<std::uint32_t> p_visible,
+                            std::uint32_t p_first = 0);
+}
+
+namespace math {
+    namespace {
+        using simd::vfloat;
+        using simd::vmask;
+
+        float4 normalized_plane(const float4& p_plane) {
+            const float scale = 1.f / length(p_plane.xyz());
+            return p_plane * scale;
+        }
+
+        // Loads p_count <= lanes floats, zero filling the rest.
+        vfloat load_lanes(const float* p_src, std::size_t p_count) {
+            if (p_count == simd::lanes) {
+                return vfloat::load(p_src);
+            }
+            float padded[simd::lanes] = {};
+            std::copy_n(p_src, p_count, padded);
+            return vfloat::load(padded);
+        }
+
+        // Frustum and optional cone test of p_count elements from p_index.
+        std::uint32_t visible_lanes(const frustum& p_frustum,
+                                    const float3& p_camera,
+                                    const bounds_soa& p_bounds,
+                                    std::size_t p_index,
+                                    std::size_t p_count) {
+            const vfloat x = load_lanes(&p_bounds.center_x[p_index], p_count);
+            const vfloat y = load_lanes(&p_bounds.center_y[p_index], p_count);
+            const vfloat z = load_lanes(&p_bounds.center_z[p_index], p_count);
+            const vfloat radius = load_lanes(&p_bounds.radius[p_index], p_count);
+            const vfloat neg_radius = -radius;
+
+            auto inside = [&](const float4& p_plane) {
+                vfloat distance = simd::fma(vfloat::splat(p_plane.x), x,
+                                            vfloat::splat(p_plane.w));
+                distance = simd::fma(vfloat::splat(p_plane.y), y, distance);
+                distance = simd::fma(vfloat::splat(p_plane.z), z, distance);
+                return distance >= neg_radius;
+            };
+            vmask visible = inside(p_frustum.planes[0]);
+            for (int i = 1; i < 6; ++i) {
+                visible = visible & inside(p_frustum.planes[i]);
+            }
+
+            if (!p_bounds.cone_cutoff.empty()) {
+                const vfloat dx = x - vfloat::splat(p_camera.x);
+                const vfloat dy = y - vfloat::splat(p_camera.y);
+                const vfloat dz = z - vfloat::splat(p_camera.z);
+                const vfloat distance =
+                  simd::sqrt(simd::fma(dx, dx, simd::fma(dy, dy, dz * dz)));
+                const vfloat ax =
+                  load_lanes(&p_bounds.cone_axis_x[p_index], p_count);
+                const vfloat ay =
+                  load_lanes(&p_bounds.cone_axis_y[p_index], p_count);
+                const vfloat az =
+                  load_lanes(&p_bounds.cone_axis_z[p_index], p_count);
+                const vfloat cutoff =
+                  load_lanes(&p_bounds.cone_cutoff[p_index], p_count);
+                const vfloat along = simd::fma(ax, dx, simd::fma(ay, dy, az * dz));
+                visible = visible & (along < simd::fma(cutoff, distance, radius));
+            }
+            // Padding lanes have zero radius and may well pass.
+            return simd::bits(visible) & ((1u << p_count) - 1u);
+        }
+    }
+
+    frustum make_frustum(const float4x4& p_view_projection) {
+        // Row r of the column-major matrix.
+        auto row = [&](int p_r) {
+            auto at = [&](int p_c) {
+                const float4& column = p_view_projection.columns[p_c];
+                return p_r == 0 ? column.x
+                       : p_r == 1 ? column.y
+                       : p_r == 2 ? column.z
+                                  : column.w;
+            };
+            return float4{ at(0), at(1), at(2), at(3) };
+        };
+        const float4 x = row(0);
+        const float4 y = row(1);
+        const float4 z = row(2);
+        const float4 w = row(3);
+        return { { normalized_plane(w + x),
+                   normalized_plane(w + x * -1.f),
+                   normalized_plane(w + y),
+                   normalized_plane(w + y * -1.f),
+                   normalized_plane(z),
+                   normalized_plane(w + z * -1.f) } };
+    }
+
+    void split_bounds(std::span<const cluster_bounds> p_bounds,
+                      bounds_storage& p_out) {
+        p_out = {};
+        for (const cluster_bounds& bounds : p_bounds) {
+            p_out.center_x.push_back(bounds.center.x);
+            p_out.center_y.push_back(bounds.center.y);
+            p_out.center_z.push_back(bounds.center.z);
+            p_out.radius.push_back(bounds.radius);
+            p_out.cone_axis_x.push_back(bounds.cone_axis.x);
+            p_out.cone_axis_y.push_back(bounds.cone_axis.y);
+            p_out.cone_axis_z.push_back(bounds.cone_axis.z);
+            p_out.cone_cutoff.push_back(bounds.cone_cutoff);
+        }
+    }
+
+    void transform_bounds(const cluster_bounds& p_local,
+                          std::span<const shader_types::instance_data> p_instances,
+                          bounds_storage& p_out) {
+        const std::size_t count = p_instances.size();
+        const bool cones = p_local.cone_cutoff < 1.f;
+        p_out.center_x.resize(count);
+        p_out.center_y.resize(count);
+        p_out.center_z.resize(count);
+        p_out.radius.resize(count);
+        for (std::vector<float>* cone :
+             { &p_out.cone_axis_x, &p_out.cone_axis_y, &p_out.cone_axis_z,
+               &p_out.cone_cutoff }) {
+            cone->resize(cones ? count : 0);
+        }
+
+        const float3& c = p_local.center;
+        const float3& a = p_local.cone_axis;
+        for (std::size_t i = 0; i < count; ++i) {
+            const float4x4& m = p_instances[i].instanceTransform;
+            const float3 x = m.columns[0].xyz();
+            const float3 y = m.columns[1].xyz();
+            const float3 z = m.columns[2].xyz();
+            const float3 center = x * c.x + y * c.y + z * c.z + m.columns[3].xyz();
+            const float sx = dot(x, x);
+            const float sy = dot(y, y);
+            const float sz = dot(z, z);
+            const float largest = std::max({ sx, sy, sz });
+            p_out.center_x[i] = center.x;
+            p_out.center_y[i] = center.y;
+            p_out.center_z[i] = center.z;
+            p_out.radius[i] = p_local.radius * std::sqrt(largest);
+            if (!cones) {
+                continue;
+            }
+
+            const float3 axis = x * a.x + y * a.y + z * a.z;
+            const float axis_length = length(axis);
+            const bool uniform = std::min({ sx, sy, sz }) >= largest * 0.999f;
+            const float inverse = axis_length > 0.f ? 1.f / axis_length : 0.f;
+            p_out.cone_axis_x[i] = axis.x * inverse;
+            p_out.cone_axis_y[i] = axis.y * inverse;
+            p_out.cone_axis_z[i] = axis.z * inverse;
+            p_out.cone_cutoff[i] =
+              uniform && axis_length > 0.f ? p_local.cone_cutoff : 1.f;
+        }
+    }
+
+    std::size_t cull_bounds(const frustum& p_frustum,
+                            const float3& p_camera_position,
+                            const bounds_soa& p_bounds,
+                            std::span<std::uint32_t> p_visible,
+                            std::uint32_t p_first) {
+        const std::size_t count = p_bounds.radius.size();
+        std::size_t written = 0;
+        for (std::size_t i = 0; i < count; i += simd::lanes) {
+            const std::size_t lanes = std::min(simd::lanes, count - i);
+            const std::uint32_t bits =
+              visible_lanes(p_frustum, p_camera_position, p_bounds, i, lanes);
+            // Every lane is stored, only visible ones advance the cursor.
+            // written never passes i + j, so the stores stay in bounds.
+            for (std::size_t j = 0; j < lanes; ++j) {
+                p_visible[written] = p_first + static_cast<std::uint32_t>(i + j);
+                written += (bits >> j) & 1u;
+            }
+        }
+        return written;
+    }
+}
@@ -0,0 +1,389 @@
+module;
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+export module lib:depth_sort;
+
+import :math;
+import :job_system;
+import :culling;
+
+export namespace math {
+    /**
+     * @brief Maps p_value to an unsigned key with the same order, so an
+     * integer sort orders floats.
+     *
+     * Negative values flip every bit and positive ones only the sign bit,
+     * which puts -0 just before +0.
+     */
+    [[nodiscard]] constexpr std::uint32_t sortable_key(float p_value) {
+        const auto bits = std::bit_cast<std::uint32_t>(p_value);
+        return bits ^ ((bits >> 31) != 0 ? 0xffffffffu : 0x80000000u);
+    }
+
+    /**
+     * @brief Stable least significant digit radix sort of p_values by
+     * p_keys, ascending.
+     *
+     * Four passes over 8-bit digits, skipping every pass whose digit is the
+     * same for all keys. The scratch spans need room for p_keys.size()
+     * elements, the result always ends up in p_keys and p_values.
+     *
+     * With p_jobs and enough keys every pass is split into chunks that
+     * count and scatter their own range in parallel. Chunks write their
+     * share of a digit in chunk order, so the sort stays stable.
+     */
+    void radix_sort(std::span<std::uint32_t> p_keys,
+                    std::span<std::uint32_t> p_values,
+                    std::span<std::uint32_t> p_key_scratch,
+                    std::span<std::uint32_t> p_value_scratch,
+                    jobs::scheduler* p_jobs = nullptr);
+
+    /**
+     * @brief Orders visible instance lists front to back, so a less-than
+     * depth test rejects the fragments of farther instances early.
+     *
+     * Instances are keyed by how far the center of their bounds lies in
+     * front of the frustum's near plane. Each sort() remembers its result:
+     * when most of this frame's instances were visible last frame, that
+     * order is reused, instances that just came into view are merged in and
+     * an insertion sort fixes up what the camera motion moved. When that
+     * would take more than a few moves per instance it falls back to a full
+     * radix_sort() and waits a few frames before trying again, and lists of
+     * more than 2^18 instances always take the radix sort.
+     *
+     * Both paths start from last frame's order and are stable, so
+     * instances at equal depth keep the order they were drawn in last frame
+     * and do not flicker between frames. Instances that just came into view
+     * follow them in p_visible order.
+     */
+    class depth_sorter {
+    public:
+        /**
+         * @brief Sorts p_visible, indices into p_bounds, nearest first.
+         *
+         * p_jobs computes keys and splits the radix sort on large lists.
+         */
+        void sort(const frustum& p_frustum,
+                  const bounds_soa& p_bounds,
+                  std::span<std::uint32_t> p_visible,
+                  jobs::scheduler* p_jobs = nullptr);
+
+        //! Forgets the previous order, the next sort() is a full one.
+        void reset() {
+            m_previous.clear();
+            m_skip = 0;
+            m_backoff = 0;
+        }
+
+        //! Whether the last sort() fell back to a full radix sort.
+        [[nodiscard]] bool full_sort() const { return m_full_sort; }
+
+        //! Elements the last insertion sort fix-up moved.
+        [[nodiscard]] std::size_t fixup_moves() const { return m_moves; }
+
+    private:
+        std::vector<std::uint32_t> m_previous;
+        std::vector<std::uint32_t> m_order;
+        std::vector<std::uint32_t> m_keys;
+        std::vector<std::uint32_t> m_order_scratch;
+        std::vector<std::uint32_t> m_key_scratch;
+        std::vector<std::uint64_t> m_fresh;
+        // Per instance: its key this frame and when it was last seen,
+        // side by side since the previous order visits them at random.
+        struct instance_state {
+            std::uint32_t key = 0;
+            std::uint32_t stamp = 0;
+        };
+        std::vector<instance_state> m_instances;
+        std::uint32_t m_frame = 0;
+        // Frames left before the fix-up is tried again, and the wait after
+        // its next failure.
+        std::uint32_t m_skip = 0;
+        std::uint32_t m_backoff = 0;
+        std::size_t m_moves = 0;
+        bool m_full_sort = true;
+    };
+}
+
+namespace math {
+    namespace {
+        constexpr std::size_t k_radix_digits = 256;
+        // Smallest chunk worth its own job in a parallel radix pass.
+        constexpr std::size_t k_radix_chunk = 1 << 16;
+        constexpr std::size_t k_key_grain = 1 << 14;
+        // Moves per element the fix-up may spend, past that the radix
+        // sort is cheaper.
+        constexpr std::size_t k_fixup_moves = 2;
+        // Most frames a scene that never settles falls back to the full
+        // sort without trying the fix-up first.
+        constexpr std::uint32_t k_max_backoff = 16;
+        // Past this many instances gathering keys in last frame's order,
+        // one cache miss each, costs as much as the radix passes.
+        constexpr std::size_t k_max_fixup = 1 << 18;
+
+        using digit_counts = std::array<std::uint32_t, k_radix_digits>;
+
+        std::uint32_t radix_digit(std::uint32_t p_key, int p_pass) {
+            return (p_key >> (p_pass * 8)) & 0xff;
+        }
+
+        void count_digits(std::span<const std::uint32_t> p_keys,
+                          int p_pass,
+                          digit_counts& p_counts) {
+            p_counts.fill(0);
+            for (std::uint32_t key : p_keys) {
+                ++p_counts[radix_digit(key, p_pass)];
+            }
+        }
+
+        // Stable insertion sort of p_keys and p_values that gives up after
+        // p_budget moves, leaving both arrays a permutation of their input.
+        bool insertion_fixup(std::span<std::uint32_t> p_keys,
+                             std::span<std::uint32_t> p_values,
+                             std::size_t p_budget,
+                             std::size_t& p_moves) {
+            p_moves = 0;
+            for (std::size_t i = 1; i < p_keys.size(); ++i) {
+                const std::uint32_t key = p_keys[i];
+                if (p_keys[i - 1] <= key) {
+                    continue;
+                }
+                const std::uint32_t value = p_values[i];
+                std::size_t j = i;
+                while (j > 0 && p_keys[j - 1] > key && p_moves < p_budget) {
+                    p_keys[j] = p_keys[j - 1];
+                    p_values[j] = p_values[j - 1];
+                    --j;
+                    ++p_moves;
+                }
+                p_keys[j] = key;
+                p_values[j] = value;
+                if (p_moves == p_budget) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+
+    void radix_sort(std::span<std::uint32_t> p_keys,
+                    std::span<std::uint32_t> p_values,
+                    std::span<std::uint32_t> p_key_scratch,
+                    std::span<std::uint32_t> p_value_scratch,
+                    jobs::scheduler* p_jobs) {
+        const std::size_t count = p_keys.size();
+        if (count < 2) {
+            return;
+        }
+        const std::size_t chunks =
+          p_jobs ? std::clamp<std::size_t>(
+                     count / k_radix_chunk, 1, p_jobs->worker_count() + 1)
+                 : 1;
+        const std::size_t chunk_size = (count + chunks - 1) / chunks;
+        auto chunk_keys = [&](std::span<const std::uint32_t> p_from,
+                              std::size_t p_chunk) {
+            const std::size_t begin = std::min(p_chunk * chunk_size, count);
+            return p_from.subspan(begin,
+                                  std::min(chunk_size, count - begin));
+        };
+
+        // One read counts every digit. Those totals decide which passes
+        // can be skipped and, with a single chunk, are its counts as well.
+        std::array<digit_counts, 4> totals{};
+        for (digit_counts& counts : totals) {
+            counts.fill(0);
+        }
+        for (std::uint32_t key : p_keys) {
+            ++totals[0][key & 0xff];
+            ++totals[1][(key >> 8) & 0xff];
+            ++totals[2][(key >> 16) & 0xff];
+            ++totals[3][key >> 24];
+        }
+
+        std::vector<digit_counts> offsets(chunks);
+        std::span<std::uint32_t> keys = p_keys;
+        std::span<std::uint32_t> values = p_values.first(count);
+        std::span<std::uint32_t> key_out = p_key_scratch.first(count);
+        std::span<std::uint32_t> value_out = p_value_scratch.first(count);
+        for (int pass = 0; pass < 4; ++pass) {
+            if (std::ranges::find(totals[pass], count) != totals[pass].end()) {
+                continue;
+            }
+
+            if (chunks == 1) {
+                offsets[0] = totals[pass];
+            } else {
+                p_jobs->parallel_for(
+                  chunks, 1, [&](std::size_t p_begin, std::size_t p_end) {
+                      for (std::size_t c = p_begin; c < p_end; ++c) {
+                          count_digits(chunk_keys(keys, c), pass, offsets[c]);
+                      }
+                  });
+            }
+            // Exclusive prefix over digits, then chunks within a digit.
+            std::uint32_t next = 0;
+            for (std::size_t digit = 0; digit < k_radix_digits; ++digit) {
+                for (digit_counts& counts : offsets) {
+                    const std::uint32_t in_chunk = counts[digit];
+                    counts[digit] = next;
+                    next += in_chunk;
+                }
+            }
+
+            auto scatter = [&](std::size_t p_begin, std::size_t p_end) {
+                for (std::size_t c = p_begin; c < p_end; ++c) {
+                    digit_counts& cursor = offsets[c];
+                    const std::size_t first = c * chunk_size;
+                    const std::size_t last =
+                      std::min(first + chunk_size, count);
+                    for (std::size_t i = first; i < last; ++i) {
+                        const std::uint32_t slot =
+                          cursor[radix_digit(keys[i], pass)]++;
+                        key_out[slot] = keys[i];
+                        value_out[slot] = values[i];
+                    }
+                }
+            };
+            if (chunks == 1) {
+                scatter(0, 1);
+            } else {
+                p_jobs->parallel_for(chunks, 1, scatter);
+            }
+            std::swap(keys, key_out);
+            std::swap(values, value_out);
+        }
+
+        if (keys.data() != p_keys.data()) {
+            std::ranges::copy(keys, p_keys.begin());
+            std::ranges::copy(values, p_values.begin());
+        }
+    }
+
+    void depth_sorter::sort(const frustum& p_frustum,
+                            const bounds_soa& p_bounds,
+                            std::span<std::uint32_t> p_visible,
+                            jobs::scheduler* p_jobs) {
+        const std::size_t count = p_visible.size();
+        const std::size_t instances = p_bounds.radius.size();
+        m_moves = 0;
+        m_full_sort = true;
+        if (m_instances.size() != instances ||
+            m_frame > std::numeric_limits<std::uint32_t>::max() - 2) {
+            m_instances.assign(instances, {});
+            m_previous.clear();
+            m_frame = 0;
+        }
+        // Instances visible this frame get stamp visible, those also
+        // visible last frame are moved on to retained.
+        m_frame += 2;
+        const std::uint32_t visible = m_frame;
+        const std::uint32_t retained = m_frame + 1;
+
+        const float4 near_plane = p_frustum.planes[4];
+        auto depth_key = [&](std::uint32_t p_index) {
+            return sortable_key(near_plane.x * p_bounds.center_x[p_index] +
+                                near_plane.y * p_bounds.center_y[p_index] +
+                                near_plane.z * p_bounds.center_z[p_index] +
+                                near_plane.w);
+        };
+        auto for_each_visible = [&](auto&& p_fn) {
+            if (p_jobs) {
+                p_jobs->parallel_for(count, k_key_grain, p_fn);
+            } else {
+                p_fn(std::size_t{ 0 }, count);
+            }
+        };
+
+        const bool coherent = m_skip == 0 && count <= k_max_fixup;
+        m_skip -= m_skip > 0 ? 1 : 0;
+        for_each_visible([&](std::size_t p_begin, std::size_t p_end) {
+            for (std::size_t i = p_begin; i < p_end; ++i) {
+                const std::uint32_t index = p_visible[i];
+                m_instances[index] = { depth_key(index), visible };
+            }
+        });
+        // Instances also visible last frame, in last frame's order. Both
+        // paths start from this list, so equal keys keep that order.
+        m_order.clear();
+        m_keys.clear();
+        for (std::uint32_t index : m_previous) {
+            instance_state& state = m_instances[index];
+            if (state.stamp == visible) {
+                state.stamp = retained;
+                m_order.push_back(index);
+                m_keys.push_back(state.key);
+            }
+        }
+
+        if (count > 0 && coherent && m_order.size() >= count / 2) {
+            // Newcomers sorted by key then by their place in p_visible,
+            // which is what a stable sort of them would give.
+            m_fresh.clear();
+            for (std::size_t i = 0; i < count; ++i) {
+                const instance_state& state = m_instances[p_visible[i]];
+                if (state.stamp == visible) {
+                    m_fresh.push_back(std::uint64_t{ state.key } << 32 | i);
+                }
+            }
+            if (!m_fresh.empty()) {
+                std::ranges::sort(m_fresh);
+                // Stable merge, retained instances go first on equal keys.
+                m_order_scratch.resize(count);
+                m_key_scratch.resize(count);
+                std::size_t from_retained = 0;
+                std::size_t from_fresh = 0;
+                for (std::size_t i = 0; i < count; ++i) {
+                    const bool take_fresh =
+                      from_fresh < m_fresh.size() &&
+                      (from_retained == m_order.size() ||
+                       (m_fresh[from_fresh] >> 32) < m_keys[from_retained]);
+                    if (take_fresh) {
+                        const std::uint64_t fresh = m_fresh[from_fresh++];
+                        m_key_scratch[i] =
+                          static_cast<std::uint32_t>(fresh >> 32);
+                        m_order_scratch[i] =
+                          p_visible[static_cast<std::uint32_t>(fresh)];
+                    } else {
+                        m_key_scratch[i] = m_keys[from_retained];
+                        m_order_scratch[i] = m_order[from_retained++];
+                    }
+                }
+                std::swap(m_order, m_order_scratch);
+                std::swap(m_keys, m_key_scratch);
+            }
+
+            m_full_sort = !insertion_fixup(
+              m_keys, m_order, count * k_fixup_moves, m_moves);
+            // Scenes that keep exhausting the budget try again less often.
+            m_backoff = m_full_sort ? std::clamp<std::uint32_t>(
+                                        m_backoff * 2, 1, k_max_backoff)
+                                    : 0;
+            m_skip = m_backoff;
+        } else {
+            // Newcomers follow in p_visible order for the radix sort.
+            for (std::uint32_t index : p_visible) {
+                const instance_state& state = m_instances[index];
+                if (state.stamp == visible) {
+                    m_order.push_back(index);
+                    m_keys.push_back(state.key);
+                }
+            }
+        }
+
+        if (m_full_sort) {
+            m_order_scratch.resize(count);
+            m_key_scratch.resize(count);
+            radix_sort(m_keys, m_order, m_key_scratch, m_order_scratch, p_jobs);
+        }
+        std::ranges::copy(m_order, p_visible.begin());
+        std::swap(m_previous, m_order);
+    }
+}
@@ -0,0 +1,175 @@
+module;
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+export module lib:dirty_ranges;
+
+export namespace gpu {
+    struct byte_range {
+        std::size_t offset;
+        std::size_t size;
+
+        [[nodiscard]] std::size_t end() const { return offset + size; }
+    };
+
+    struct dirty_range_options {
+        //! Ranges closer than this many bytes are flushed as one.
+        std::size_t merge_gap = 0;
+        //! When non-zero, ranges are widened to multiples of this size
+        //! (typically the VM page size) before merging.
+        std::size_t page_size = 0;
+        //! Page-widened ranges are clamped to this length when non-zero.
+        std::size_t buffer_length = 0;
+        //! Upper bound on tracked ranges, 0 counts as 1. Beyond it, ranges
+        //! are coalesced and then the closest neighbours are merged until
+        //! half the budget is free, which keeps the extra flushed bytes
+        //! minimal.
+        std::size_t max_ranges = 1024;
+    };
+
+    /**
+     * @brief Records the regions of a mapped buffer written this frame and
+     * flushes the smallest set of merged ranges.
+     *
+     * flush() hands each merged range to a callable instead of a buffer
+     * type, so it works for MTL::Buffer::didModifyRange as well as
+     * gpu::cpu_buffer::did_modify_range in tests.
+     */
+    class dirty_range_tracker {
+    public:
+        explicit dirty_range_tracker(dirty_range_options p_options = {})
+          : m_options(p_options) {
+            m_ranges.reserve(std::min<std::size_t>(m_options.max_ranges, 256));
+        }
+
+        void mark(std::size_t p_offset, std::size_t p_size) {
+            if (p_size == 0) {
+                return;
+            }
+            const byte_range range = widen({ p_offset, p_size });
+
+            // Sequential writes are the common case, extend the last range
+            // instead of recording a new one.
+            if (!m_ranges.empty()) {
+                byte_range& last = m_ranges.back();
+                if (range.offset >= last.offset &&
+                    range.offset <= last.end() + m_options.merge_gap) {
+                    last.size = std::max(last.end(), range.end()) - last.offset;
+                    return;
+                }
+            }
+
+            m_ranges.push_back(range);
+            if (m_ranges.size() > std::max<std::size_t>(m_options.max_ranges, 1)) {
+                shrink();
+            }
+        }
+
+        void mark(byte_range p_range) { mark(p_range.offset, p_range.size); }
+
+        //! @return merged ranges without clearing them.
+        [[nodiscard]] const std::vector<byte_range>& ranges() {
+            coalesce();
+            return m_ranges;
+        }
+
+        [[nodiscard]] bool empty() const { return m_ranges.empty(); }
+
+        /**
+         * @brief Calls p_flush(offset, size) for every merged range and
+         * clears the tracker.
+         *
+         * @return number of bytes flushed.
+         */
+        template<typename Fn>
+        std::size_t flush(Fn&& p_flush) {
+            coalesce();
+            std::size_t bytes = 0;
+            for (const byte_range& range : m_ranges) {
+                p_flush(range.offset, range.size);
+                bytes += range.size;
+            }
+            m_ranges.clear();
+            return bytes;
+        }
+
+    private:
+        [[nodiscard]] byte_range widen(byte_range p_range) const {
+            if (m_options.page_size == 0) {
+                return p_range;
+            }
+            const std::size_t page = m_options.page_size;
+            const std::size_t begin = p_range.offset / page * page;
+            std::size_t end = (p_range.end() + page - 1) / page * page;
+            if (m_options.buffer_length != 0) {
+                end = std::min(end, m_options.buffer_length);
+            }
+            return { begin, end - begin };
+        }
+
+        void coalesce() {
+            if (m_ranges.size() < 2) {
+                return;
+            }
+            std::sort(m_ranges.begin(),
+                      m_ranges.end(),
+                      [](const byte_range& p_a, const byte_range& p_b) {
+                          return p_a.offset < p_b.offset;
+                      });
+
+            std::size_t merged = 0;
+            for (std::size_t i = 1; i < m_ranges.size(); ++i) {
+                byte_range& current = m_ranges[merged];
+                const byte_range& next = m_ranges[i];
+                if (next.offset <= current.end() + m_options.merge_gap) {
+                    current.size =
+                      std::max(current.end(), next.end()) - current.offset;
+                }
+                else {
+                    m_ranges[++merged] = next;
+                }
+            }
+            m_ranges.resize(merged + 1);
+        }
+
+        void shrink() {
+            coalesce();
+            // Never zero, merging cannot go below one range.
+            const std::size_t target =
+              std::max<std::size_t>(m_options.max_ranges / 2, 1);
+            if (m_ranges.size() <= target) {
+                return;
+            }
+
+            // Merging every gap up to the (size - target)th smallest one
+            // brings the count down to roughly target.
+            m_gaps.clear();
+            for (std::size_t i = 1; i < m_ranges.size(); ++i) {
+                m_gaps.push_back(m_ranges[i].offset - m_ranges[i - 1].end());
+            }
+            const std::size_t merges = m_ranges.size() - target;
+            std::nth_element(
+              m_gaps.begin(), m_gaps.begin() + (merges - 1), m_gaps.end());
+            const std::size_t threshold = m_gaps[merges - 1];
+
+            std::size_t merged = 0;
+            for (std::size_t i = 1; i < m_ranges.size(); ++i) {
+                byte_range& current = m_ranges[merged];
+                const byte_range& next = m_ranges[i];
+                if (next.offset - current.end() <= threshold) {
+                    current.size = next.end() - current.offset;
+                }
+                else {
+                    m_ranges[++merged] = next;
+                }
+            }
+            m_ranges.resize(merged + 1);
+        }
+
+        dirty_range_options m_options;
+        std::vector<byte_range> m_ranges;
+        std::vector<std::size_t> m_gaps;
+    };
+}
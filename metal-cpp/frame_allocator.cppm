@@ -0,0 +1,200 @@
+module;
+
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <vector>
+
+export module lib:frame_allocator;
+
+export namespace gpu {
+    /**
+     * @brief Anything exposing a CPU mapping of GPU-visible memory.
+     *
+     * MTL::Buffer satisfies this directly, gpu::cpu_buffer stands in for it
+     * on hosts without Metal.
+     */
+    template<typename T>
+    concept mappable_buffer = requires(T& p_buffer) {
+        { p_buffer.contents() } -> std::convertible_to<void*>;
+        { p_buffer.length() } -> std::convertible_to<std::size_t>;
+    };
+
+    /**
+     * @brief Heap-backed buffer with the same mapping interface as
+     * MTL::Buffer.
+     *
+     * did_modify_range() mirrors MTL::Buffer::didModifyRange() and only keeps
+     * count of what would have been synchronized, which is what upload tests
+     * and benchmarks assert on.
+     */
+    class cpu_buffer {
+    public:
+        static constexpr std::size_t alignment = 256;
+
+        explicit cpu_buffer(std::size_t p_length)
+          : m_data(static_cast<std::byte*>(
+              ::operator new(p_length, std::align_val_t{ alignment })))
+          , m_length(p_length) {}
+
+        [[nodiscard]] void* contents() const { return m_data.get(); }
+        [[nodiscard]] std::size_t length() const { return m_length; }
+
+        void did_modify_range(std::size_t p_offset, std::size_t p_size) {
+            (void)p_offset;
+            m_flushed_bytes += p_size;
+            ++m_flush_count;
+        }
+
+        [[nodiscard]] std::size_t flushed_bytes() const {
+            return m_flushed_bytes;
+        }
+        [[nodiscard]] std::size_t flush_count() const { return m_flush_count; }
+
+        void reset_flush_stats() {
+            m_flushed_bytes = 0;
+            m_flush_count = 0;
+        }
+
+    private:
+        struct aligned_delete {
+            void operator()(std::byte* p_data) const {
+                ::operator delete(p_data, std::align_val_t{ alignment });
+            }
+        };
+
+        std::unique_ptr<std::byte, aligned_delete> m_data;
+        std::size_t m_length;
+        std::size_t m_flushed_bytes = 0;
+        std::size_t m_flush_count = 0;
+    };
+
+    template<mappable_buffer Buffer>
+    struct frame_allocation {
+        Buffer* buffer;
+        std::size_t offset;
+        std::size_t size;
+        void* data;
+
+        template<typename T>
+        [[nodiscard]] T* as() const {
+            return static_cast<T*>(data);
+        }
+    };
+
+    /**
+     * @brief Linear ring allocator that hands out per-frame slices of one
+     * large GPU buffer.
+     *
+     * Every transient upload of a frame (instances, camera, ...) is bump
+     * allocated between begin_frame() and end_frame(). end_frame() returns a
+     * fence value, and once the GPU has finished with that frame the
+     * completion handler passes it to complete_frame() so the bytes can be
+     * reused. Only complete_frame() may be called from another thread.
+     *
+     * Because slices are sized by what a frame actually writes, one buffer of
+     * frames_in_flight * per_frame_bytes replaces per-frame buffer arrays.
+     */
+    template<mappable_buffer Buffer>
+    class frame_ring_allocator {
+    public:
+        frame_ring_allocator(Buffer* p_buffer, std::size_t p_max_frames_in_flight)
+          : m_buffer(p_buffer)
+          , m_capacity(static_cast<std::size_t>(p_buffer->length()))
+          , m_frame_ends(p_max_frames_in_flight) {}
+
+        //! @return false while max frames are still in flight on the GPU.
+        bool begin_frame() {
+            reclaim();
+            return m_frame - m_retired < m_frame_ends.size();
+        }
+
+        /**
+         * @return a p_alignment-aligned slice of p_size bytes, or nullopt if
+         * the ring is exhausted by frames the GPU still reads from.
+         */
+        std::optional<frame_allocation<Buffer>> allocate(
+          std::size_t p_size,
+          std::size_t p_alignment = cpu_buffer::alignment) {
+            if (p_size > m_capacity) {
+                return std::nullopt;
+            }
+
+            const std::size_t head_offset = m_head % m_capacity;
+            std::uint64_t wrap_start = m_head - head_offset;
+            std::size_t offset = align_up(head_offset, p_alignment);
+            if (offset + p_size > m_capacity) {
+                // The slice would straddle the end, skip to the wrap point.
+                offset = 0;
+                wrap_start += m_capacity;
+            }
+            const std::uint64_t start = wrap_start + offset;
+            if (start + p_size - m_tail > m_capacity) {
+                return std::nullopt;
+            }
+
+            m_head = start + p_size;
+            return frame_allocation<Buffer>{
+                m_buffer,
+                offset,
+                p_size,
+                static_cast<std::byte*>(m_buffer->contents()) + offset
+            };
+        }
+
+        //! @return fence value to hand to complete_frame() once the GPU is
+        //! done with this frame.
+        std::uint64_t end_frame() {
+            m_frame_ends[m_frame % m_frame_ends.size()] = m_head;
+            return m_frame++;
+        }
+
+        //! Marks every frame up to and including p_fence as finished.
+        void complete_frame(std::uint64_t p_fence) {
+            std::uint64_t completed = m_completed.load(std::memory_order_relaxed);
+            while (completed < p_fence + 1 &&
+                   !m_completed.compare_exchange_weak(
+                     completed, p_fence + 1, std::memory_order_release)) {
+            }
+        }
+
+        [[nodiscard]] std::size_t capacity() const { return m_capacity; }
+
+        //! @return bytes still owned by frames the GPU has not finished.
+        [[nodiscard]] std::size_t bytes_in_flight() const {
+            return static_cast<std::size_t>(m_head - m_tail);
+        }
+
+        [[nodiscard]] Buffer* buffer() const { return m_buffer; }
+
+    private:
+        static std::size_t align_up(std::size_t p_value,
+                                    std::size_t p_alignment) {
+            return (p_value + p_alignment - 1) / p_alignment * p_alignment;
+        }
+
+        void reclaim() {
+            const std::uint64_t completed =
+              m_completed.load(std::memory_order_acquire);
+            while (m_retired < completed) {
+                m_tail = m_frame_ends[m_retired % m_frame_ends.size()];
+                ++m_retired;
+            }
+        }
+
+        Buffer* m_buffer;
+        std::size_t m_capacity;
+        // Positions are monotonic byte counters, the offset into the buffer
+        // is the counter modulo capacity.
+        std::uint64_t m_head = 0;
+        std::uint64_t m_tail = 0;
+        std::uint64_t m_frame = 0;
+        std::uint64_t m_retired = 0;
+        std::vector<std::uint64_t> m_frame_ends;
+        std::atomic<std::uint64_t> m_completed{ 0 };
+    };
+}
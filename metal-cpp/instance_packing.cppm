@@ -0,0 +1,207 @@
+module;
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+export module lib:instance_packing;
+
+import :math;
+import :simd;
+import :shader_types;
+
+export namespace gpu {
+    /**
+     * @brief Writes the affine rows of every instanceTransform in
+     * p_instances into p_out, one instance per step with the transpose
+     * done in simd registers.
+     *
+     * instanceNormalTransform is dropped: instance_normal_transform
+     * rebuilds it from the rows, exactly for any invertible affine
+     * transform, where the 3x3 the full layout carries is only right for
+     * uniform scale.
+     */
+    void pack_instances(std::span<const shader_types::instance_data> p_instances,
+                        std::span<shader_types::compact_instance_data> p_out);
+
+    //! Converts p_colors to RGBA8 unorm, simd::lanes colors at a time.
+    //! Channels clamp to [0, 1] and round to the nearest step.
+    void pack_colors(std::span<const math::float4> p_colors,
+                     std::span<std::uint32_t> p_out);
+
+    //! One instance at a time, the scalar definition of pack_instances.
+    [[nodiscard]] shader_types::compact_instance_data pack_instance(
+      const shader_types::instance_data& p_instance);
+
+    //! One color at a time, the scalar definition of pack_colors.
+    [[nodiscard]] std::uint32_t pack_color(const math::float4& p_color);
+
+    [[nodiscard]] math::float4 unpack_color(std::uint32_t p_packed);
+
+    [[nodiscard]] math::float4x4 unpack_instance_transform(
+      const shader_types::compact_instance_data& p_instance);
+
+    /**
+     * @brief The normal transform vertexMain derives from the rows: the
+     * cofactor matrix, the inverse transpose times |det|. Shaded normals
+     * are renormalized, so the scale does not matter, and the sign keeps
+     * mirrored instances facing out.
+     */
+    [[nodiscard]] math::float3x3 instance_normal_transform(
+      const shader_types::compact_instance_data& p_instance);
+}
+
+namespace gpu {
+    namespace {
+        using math::simd::vfloat;
+        using math::simd::vint;
+        using shader_types::compact_instance_data;
+        using shader_types::instance_data;
+
+        constexpr std::size_t k_matrix_vectors = 16 / math::simd::lanes;
+        static_assert(16 % math::simd::lanes == 0);
+
+        // Transposing a 4x4 matrix moves element c * 4 + r to r * 4 + c,
+        // which is two perfect unshuffles of its 16 floats. Each round
+        // deinterleaves pairs of registers, at any simd width. Only the
+        // first three rows are written to p_out.
+        void transpose_affine(const math::float4x4& p_matrix, float* p_out) {
+            const float* src = &p_matrix.columns[0].x;
+            vint v[k_matrix_vectors];
+            for (std::size_t i = 0; i < k_matrix_vectors; ++i) {
+                v[i] = math::simd::as_int(vfloat::load(src + i * math::simd::lanes));
+            }
+            for (int round = 0; round < 2; ++round) {
+                vint t[k_matrix_vectors];
+                for (std::size_t k = 0; k < k_matrix_vectors / 2; ++k) {
+                    math::simd::deinterleave(
+                      v[2 * k], v[2 * k + 1], t[k], t[k_matrix_vectors / 2 + k]);
+                }
+                std::copy_n(t, k_matrix_vectors, v);
+            }
+            // Whole registers straight out, the one holding the end of
+            // row 2 and the start of row 3 through the stack.
+            constexpr std::size_t whole = 12 / math::simd::lanes;
+            for (std::size_t i = 0; i < whole; ++i) {
+                math::simd::as_float(v[i]).store(p_out + i * math::simd::lanes);
+            }
+            if constexpr (whole < k_matrix_vectors) {
+                constexpr std::size_t rest = 12 - whole * math::simd::lanes;
+                alignas(32) float last[math::simd::lanes];
+                math::simd::as_float(v[whole]).store(last);
+                std::memcpy(p_out + whole * math::simd::lanes, last,
+                            rest * sizeof(float));
+            }
+        }
+
+        vint quantize_unorm8(vfloat p_x) {
+            const vfloat clamped = math::simd::min(
+              math::simd::max(p_x, vfloat::splat(0.f)), vfloat::splat(1.f));
+            return math::simd::to_int(clamped * vfloat::splat(255.f));
+        }
+
+        // Packs p_count <= lanes colors from p_src.
+        void pack_color_lanes(const math::float4* p_src,
+                              std::size_t p_count,
+                              std::uint32_t* p_out) {
+            constexpr std::size_t lanes = math::simd::lanes;
+            alignas(32) float padded[4 * lanes] = {};
+            const float* src = &p_src->x;
+            if (p_count < lanes) {
+                std::memcpy(padded, src, p_count * sizeof(math::float4));
+                src = padded;
+            }
+            vint v[4];
+            for (std::size_t i = 0; i < 4; ++i) {
+                v[i] = quantize_unorm8(vfloat::load(src + i * lanes));
+            }
+            // r g b a r g b a ... into r r ..., g g ..., b b ..., a a ...
+            vint red_blue[2];
+            vint green_alpha[2];
+            math::simd::deinterleave(v[0], v[1], red_blue[0], green_alpha[0]);
+            math::simd::deinterleave(v[2], v[3], red_blue[1], green_alpha[1]);
+            vint red, green, blue, alpha;
+            math::simd::deinterleave(red_blue[0], red_blue[1], red, blue);
+            math::simd::deinterleave(green_alpha[0], green_alpha[1], green, alpha);
+            const vint packed = red | green << 8 | blue << 16 | alpha << 24;
+
+            alignas(32) std::int32_t words[lanes];
+            packed.store(words);
+            std::memcpy(p_out, words, p_count * sizeof(std::uint32_t));
+        }
+    }
+
+    void pack_instances(std::span<const instance_data> p_instances,
+                        std::span<compact_instance_data> p_out) {
+        for (std::size_t i = 0; i < p_instances.size(); ++i) {
+            transpose_affine(p_instances[i].instanceTransform,
+                             &p_out[i].instanceRows[0].x);
+        }
+    }
+
+    void pack_colors(std::span<const math::float4> p_colors,
+                     std::span<std::uint32_t> p_out) {
+        const std::size_t count = p_colors.size();
+        for (std::size_t i = 0; i < count; i += math::simd::lanes) {
+            pack_color_lanes(&p_colors[i],
+                             std::min(math::simd::lanes, count - i),
+                             &p_out[i]);
+        }
+    }
+
+    compact_instance_data pack_instance(const instance_data& p_instance) {
+        const math::float4x4& m = p_instance.instanceTransform;
+        compact_instance_data packed;
+        for (int r = 0; r < 3; ++r) {
+            auto at = [&](int p_c) {
+                const math::float4& column = m.columns[p_c];
+                return r == 0 ? column.x : r == 1 ? column.y : column.z;
+            };
+            packed.instanceRows[r] = { at(0), at(1), at(2), at(3) };
+        }
+        return packed;
+    }
+
+    std::uint32_t pack_color(const math::float4& p_color) {
+        std::uint32_t packed = 0;
+        int shift = 0;
+        for (float channel : { p_color.x, p_color.y, p_color.z, p_color.w }) {
+            const float clamped = std::clamp(channel, 0.f, 1.f);
+            packed |= static_cast<std::uint32_t>(std::nearbyint(clamped * 255.f))
+                      << shift;
+            shift += 8;
+        }
+        return packed;
+    }
+
+    math::float4 unpack_color(std::uint32_t p_packed) {
+        auto channel = [&](int p_shift) {
+            return static_cast<float>((p_packed >> p_shift) & 0xff) / 255.f;
+        };
+        return { channel(0), channel(8), channel(16), channel(24) };
+    }
+
+    math::float4x4 unpack_instance_transform(
+      const compact_instance_data& p_instance) {
+        const math::float4* rows = p_instance.instanceRows;
+        return { { { rows[0].x, rows[1].x, rows[2].x, 0.f },
+                   { rows[0].y, rows[1].y, rows[2].y, 0.f },
+                   { rows[0].z, rows[1].z, rows[2].z, 0.f },
+                   { rows[0].w, rows[1].w, rows[2].w, 1.f } } };
+    }
+
+    math::float3x3 instance_normal_transform(
+      const compact_instance_data& p_instance) {
+        const math::float4x4 m = unpack_instance_transform(p_instance);
+        const math::float3 c0 = m.columns[0].xyz();
+        const math::float3 c1 = m.columns[1].xyz();
+        const math::float3 c2 = m.columns[2].xyz();
+        const math::float3 x = math::cross(c1, c2);
+        const float sign = math::dot(c0, x) < 0.f ? -1.f : 1.f;
+        return { { x * sign, math::cross(c2, c0) * sign,
+                   math::cross(c0, c1) * sign } };
+    }
+}
@@ -0,0 +1,275 @@
+module;
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+export module lib:instance_store;
+
+import :math;
+import :shader_types;
+import :instance_transforms;
+import :instance_packing;
+import :job_system;
+
+export namespace gpu {
+    /**
+     * @brief Persistent instance transforms with per-instance change
+     * generations.
+     *
+     * Callers touch() the instances whose inputs changed, update()
+     * recomputes only those, and sync() copies only the instances a given
+     * destination has not seen yet. Destinations are persistent regions, one
+     * per frame in flight, so each one is identified by an index and
+     * remembers the generation it was last synced to.
+     *
+     * Static attributes (colors) do not belong here, they live in
+     * shader_types::instance_static_data and are uploaded once.
+     */
+    class instance_store {
+    public:
+        //! Largest run handed to one job by update().
+        static constexpr std::size_t chunk_size = 256;
+        //! Shorter runs are gathered so every SIMD block stays full.
+        static constexpr std::size_t min_run = 8;
+
+        instance_store(std::size_t p_count, std::size_t p_destinations)
+          : m_instances(p_count)
+          , m_changed(p_count, 0)
+          , m_touched(p_count, 0)
+          , m_synced(p_destinations, 0) {
+            // Nothing has been computed yet.
+            touch_all();
+        }
+
+        [[nodiscard]] std::size_t size() const { return m_instances.size(); }
+
+        [[nodiscard]] std::uint64_t generation() const { return m_generation; }
+
+        //! @return instances changed by the last update().
+        [[nodiscard]] std::size_t last_update_count() const {
+            return m_last_update_count;
+        }
+
+        void touch(std::size_t p_index) {
+            if (!m_touched[p_index]) {
+                m_touched[p_index] = 1;
+                m_dirty.push_back(static_cast<std::uint32_t>(p_index));
+            }
+        }
+
+        void touch_all() { m_all_touched = true; }
+
+        /**
+         * @brief Recomputes every touched instance from p_inputs.
+         *
+         * Runs of adjacent touched instances are composed together, isolated
+         * ones through the gather variant, and the work is spread over p_jobs
+         * when one is given.
+         */
+        void update(const math::float4x4& p_parent,
+                    const math::instance_transform_soa& p_inputs,
+                    jobs::scheduler* p_jobs = nullptr);
+
+        /**
+         * @brief Copies every instance changed since destination
+         * p_destination was last synced into p_dst.
+         *
+         * p_on_copy(first, count) is called for each copied run, typically
+         * to mark it in a gpu::dirty_range_tracker.
+         *
+         * @return number of instances copied.
+         */
+        template<typename Fn>
+        std::size_t sync(std::size_t p_destination,
+                         std::span<shader_types::instance_data> p_dst,
+                         Fn&& p_on_copy) {
+            return sync_runs(p_destination, p_dst, p_on_copy);
+        }
+
+        //! sync() into the compact layout, packing runs on the way out.
+        template<typename Fn>
+        std::size_t sync(std::size_t p_destination,
+                         std::span<shader_types::compact_instance_data> p_dst,
+                         Fn&& p_on_copy) {
+            return sync_runs(p_destination, p_dst, p_on_copy);
+        }
+
+        [[nodiscard]] std::span<const shader_types::instance_data> instances()
+          const {
+            return m_instances;
+        }
+
+    private:
+        struct run {
+            std::size_t first;
+            std::size_t count;
+        };
+
+        template<typename Dst, typename Fn>
+        std::size_t sync_runs(std::size_t p_destination,
+                              std::span<Dst> p_dst,
+                              Fn& p_on_copy) {
+            std::uint64_t& synced = m_synced[p_destination];
+            if (synced >= m_last_change) {
+                return 0;
+            }
+
+            std::size_t copied = 0;
+            auto copy_run = [&](std::size_t p_first, std::size_t p_count) {
+                if constexpr (std::is_same_v<Dst, shader_types::instance_data>) {
+                    std::memcpy(p_dst.data() + p_first,
+                                m_instances.data() + p_first,
+                                p_count * sizeof(shader_types::instance_data));
+                }
+                else {
+                    pack_instances(
+                      std::span(m_instances).subspan(p_first, p_count),
+                      p_dst.subspan(p_first, p_count));
+                }
+                p_on_copy(p_first, p_count);
+                copied += p_count;
+            };
+
+            if (synced < m_all_changed) {
+                copy_run(0, m_instances.size());
+            }
+            else {
+                std::size_t i = 0;
+                while (i < m_instances.size()) {
+                    if (m_changed[i] <= synced) {
+                        ++i;
+                        continue;
+                    }
+                    const std::size_t first = i;
+                    while (i < m_instances.size() && m_changed[i] > synced) {
+                        ++i;
+                    }
+                    copy_run(first, i - first);
+                }
+            }
+            synced = m_generation;
+            return copied;
+        }
+
+        std::vector<shader_types::instance_data> m_instances;
+        // Generation each instance last changed in.
+        std::vector<std::uint64_t> m_changed;
+        std::vector<std::uint8_t> m_touched;
+        std::vector<std::uint32_t> m_dirty;
+        std::vector<run> m_runs;
+        std::vector<std::uint32_t> m_scattered;
+        // Generation each destination was last synced to.
+        std::vector<std::uint64_t> m_synced;
+        std::uint64_t m_generation = 0;
+        std::uint64_t m_last_change = 0;
+        std::uint64_t m_all_changed = 0;
+        std::size_t m_last_update_count = 0;
+        bool m_all_touched = false;
+    };
+}
+
+namespace gpu {
+    void instance_store::update(const math::float4x4& p_parent,
+                                const math::instance_transform_soa& p_inputs,
+                                jobs::scheduler* p_jobs) {
+        ++m_generation;
+        m_runs.clear();
+        m_scattered.clear();
+
+        if (m_all_touched || m_dirty.size() == m_instances.size()) {
+            for (std::size_t i = 0; i < m_instances.size(); i += chunk_size) {
+                m_runs.push_back(
+                  { i, std::min(chunk_size, m_instances.size() - i) });
+            }
+            m_all_changed = m_generation;
+            m_last_update_count = m_instances.size();
+        }
+        else {
+            auto add_to_runs = [this](std::size_t p_index) {
+                m_changed[p_index] = m_generation;
+                if (!m_runs.empty() &&
+                    m_runs.back().first + m_runs.back().count == p_index &&
+                    m_runs.back().count < chunk_size) {
+                    ++m_runs.back().count;
+                }
+                else {
+                    m_runs.push_back({ p_index, 1 });
+                }
+            };
+
+            // Sorting a dense dirty list costs more than walking the flags.
+            if (m_dirty.size() > m_instances.size() / 16) {
+                for (std::size_t i = 0; i < m_instances.size(); ++i) {
+                    if (m_touched[i]) {
+                        add_to_runs(i);
+                    }
+                }
+            }
+            else {
+                std::sort(m_dirty.begin(), m_dirty.end());
+                for (std::uint32_t index : m_dirty) {
+                    add_to_runs(index);
+                }
+            }
+            m_last_update_count = m_dirty.size();
+        }
+
+        if (m_last_update_count != 0) {
+            m_last_change = m_generation;
+        }
+
+        // Isolated instances would waste most of a SIMD block, move them to
+        // the gather list.
+        std::erase_if(m_runs, [this](const run& p_run) {
+            if (p_run.count >= min_run) {
+                return false;
+            }
+            for (std::size_t i = 0; i < p_run.count; ++i) {
+                m_scattered.push_back(
+                  static_cast<std::uint32_t>(p_run.first + i));
+            }
+            return true;
+        });
+
+        const std::size_t gather_jobs =
+          (m_scattered.size() + chunk_size - 1) / chunk_size;
+        auto compose = [&](std::size_t p_begin, std::size_t p_end) {
+            for (std::size_t r = p_begin; r < p_end; ++r) {
+                if (r < m_runs.size()) {
+                    const run& work = m_runs[r];
+                    math::compose_instance_transforms(
+                      p_parent,
+                      p_inputs,
+                      std::span(m_instances).subspan(work.first, work.count),
+                      work.first);
+                    continue;
+                }
+                const std::size_t first = (r - m_runs.size()) * chunk_size;
+                math::compose_instance_transforms(
+                  p_parent,
+                  p_inputs,
+                  std::span<const std::uint32_t>(m_scattered)
+                    .subspan(first,
+                             std::min(chunk_size, m_scattered.size() - first)),
+                  m_instances);
+            }
+        };
+        if (p_jobs != nullptr) {
+            p_jobs->parallel_for(m_runs.size() + gather_jobs, 4, compose);
+        }
+        else {
+            compose(0, m_runs.size() + gather_jobs);
+        }
+
+        for (std::uint32_t index : m_dirty) {
+            m_touched[index] = 0;
+        }
+        m_dirty.clear();
+        m_all_touched = false;
+    }
+}
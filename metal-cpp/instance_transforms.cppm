@@ -0,0 +1,223 @@
+module;
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+export module lib:instance_transforms;
+
+import :math;
+import :simd;
+import :transcendental;
+import :shader_types;
+
+export namespace math {
+    /**
+     * @brief Structure-of-arrays description of the instances to transform.
+     *
+     * Each instance is translate(position) * rotate_y * rotate_z *
+     * scale(uniform). Rotation angles are multiplied by angle_scale, so
+     * animated instances can keep a constant per-instance rate and only
+     * angle_scale changes per frame.
+     */
+    struct instance_transform_soa {
+        std::span<const float> position_x;
+        std::span<const float> position_y;
+        std::span<const float> position_z;
+        std::span<const float> rotation_y;
+        std::span<const float> rotation_z;
+        std::span<const float> scale;
+        float angle_scale = 1.f;
+    };
+
+    /**
+     * @brief Computes parent * TRS for every instance and writes the result
+     * straight into the GPU instance layout.
+     *
+     * sin/cos are evaluated simd::lanes instances at a time and the rotation
+     * and scale are folded analytically instead of going through four 4x4
+     * multiplies. p_out[i] receives instance p_first + i, which lets callers
+     * split the work into chunks. p_parent is expected to be affine.
+     */
+    void compose_instance_transforms(
+      const float4x4& p_parent,
+      const instance_transform_soa& p_instances,
+      std::span<shader_types::instance_data> p_out,
+      std::size_t p_first = 0);
+
+    /**
+     * @brief Gather/scatter variant for scattered updates: instance
+     * p_indices[i] is read from p_instances and written to
+     * p_out[p_indices[i]], still simd::lanes instances per step.
+     */
+    void compose_instance_transforms(
+      const float4x4& p_parent,
+      const instance_transform_soa& p_instances,
+      std::span<const std::uint32_t> p_indices,
+      std::span<shader_types::instance_data> p_out);
+}
+
+namespace math {
+    namespace {
+        using simd::vfloat;
+
+        using lane_matrices = float[4][3][simd::lanes];
+
+        // Evaluates parent * TRS for one block of lanes. p_inputs holds
+        // position x/y/z, rotation y/z and scale.
+        void compute_lanes(const float4x4& p_parent,
+                           const vfloat (&p_inputs)[6],
+                           float p_angle_scale,
+                           lane_matrices& p_model) {
+            const vfloat angle_scale = vfloat::splat(p_angle_scale);
+            vfloat sin_y;
+            vfloat cos_y;
+            vfloat sin_z;
+            vfloat cos_z;
+            simd::sincos(p_inputs[3] * angle_scale, sin_y, cos_y);
+            simd::sincos(p_inputs[4] * angle_scale, sin_z, cos_z);
+            const vfloat scale = p_inputs[5];
+
+            // Columns of rotate_y * rotate_z * scale.
+            const vfloat local[3][3] = {
+                { cos_y * cos_z * scale, -sin_z * scale, -(sin_y * cos_z) * scale },
+                { cos_y * sin_z * scale, cos_z * scale, -(sin_y * sin_z) * scale },
+                { sin_y * scale, vfloat::splat(0.f), cos_y * scale }
+            };
+
+            vfloat parent[4][3];
+            for (int c = 0; c < 4; ++c) {
+                parent[c][0] = vfloat::splat(p_parent.columns[c].x);
+                parent[c][1] = vfloat::splat(p_parent.columns[c].y);
+                parent[c][2] = vfloat::splat(p_parent.columns[c].z);
+            }
+
+            for (int c = 0; c < 3; ++c) {
+                for (int r = 0; r < 3; ++r) {
+                    vfloat v = parent[0][r] * local[c][0];
+                    v = simd::fma(parent[1][r], local[c][1], v);
+                    v = simd::fma(parent[2][r], local[c][2], v);
+                    v.store(p_model[c][r]);
+                }
+            }
+            for (int r = 0; r < 3; ++r) {
+                vfloat v = simd::fma(parent[0][r], p_inputs[0], parent[3][r]);
+                v = simd::fma(parent[1][r], p_inputs[1], v);
+                v = simd::fma(parent[2][r], p_inputs[2], v);
+                v.store(p_model[3][r]);
+            }
+        }
+
+        void write_lane(const lane_matrices& p_model,
+                        std::size_t p_lane,
+                        shader_types::instance_data& p_out) {
+            for (int c = 0; c < 3; ++c) {
+                const float4 column = { p_model[c][0][p_lane],
+                                        p_model[c][1][p_lane],
+                                        p_model[c][2][p_lane],
+                                        0.f };
+                p_out.instanceTransform.columns[c] = column;
+                p_out.instanceNormalTransform.columns[c] = column.xyz();
+            }
+            p_out.instanceTransform.columns[3] = { p_model[3][0][p_lane],
+                                                   p_model[3][1][p_lane],
+                                                   p_model[3][2][p_lane],
+                                                   1.f };
+        }
+
+        // Computes up to simd::lanes consecutive instances starting at
+        // p_index and writes the first p_count lanes into p_out.
+        void compose_lanes(const float4x4& p_parent,
+                           const instance_transform_soa& p_in,
+                           std::size_t p_index,
+                           std::size_t p_count,
+                           shader_types::instance_data* p_out) {
+            const std::span<const float>* streams[] = {
+                &p_in.position_x, &p_in.position_y, &p_in.position_z,
+                &p_in.rotation_y, &p_in.rotation_z, &p_in.scale
+            };
+
+            vfloat inputs[6];
+            for (std::size_t s = 0; s < 6; ++s) {
+                const float* src = streams[s]->data() + p_index;
+                if (p_count == simd::lanes) {
+                    inputs[s] = vfloat::load(src);
+                }
+                else {
+                    float padded[simd::lanes] = {};
+                    for (std::size_t j = 0; j < p_count; ++j) {
+                        padded[j] = src[j];
+                    }
+                    inputs[s] = vfloat::load(padded);
+                }
+            }
+
+            alignas(32) lane_matrices model;
+            compute_lanes(p_parent, inputs, p_in.angle_scale, model);
+            for (std::size_t j = 0; j < p_count; ++j) {
+                write_lane(model, j, p_out[j]);
+            }
+        }
+
+        // Same as compose_lanes for up to simd::lanes scattered instances.
+        void compose_gathered_lanes(const float4x4& p_parent,
+                                    const instance_transform_soa& p_in,
+                                    const std::uint32_t* p_indices,
+                                    std::size_t p_count,
+                                    shader_types::instance_data* p_out) {
+            const std::span<const float>* streams[] = {
+                &p_in.position_x, &p_in.position_y, &p_in.position_z,
+                &p_in.rotation_y, &p_in.rotation_z, &p_in.scale
+            };
+
+            vfloat inputs[6];
+            for (std::size_t s = 0; s < 6; ++s) {
+                const float* src = streams[s]->data();
+                float gathered[simd::lanes] = {};
+                for (std::size_t j = 0; j < p_count; ++j) {
+                    gathered[j] = src[p_indices[j]];
+                }
+                inputs[s] = vfloat::load(gathered);
+            }
+
+            alignas(32) lane_matrices model;
+            compute_lanes(p_parent, inputs, p_in.angle_scale, model);
+            for (std::size_t j = 0; j < p_count; ++j) {
+                write_lane(model, j, p_out[p_indices[j]]);
+            }
+        }
+    }
+
+    void compose_instance_transforms(
+      const float4x4& p_parent,
+      const instance_transform_soa& p_instances,
+      std::span<shader_types::instance_data> p_out,
+      std::size_t p_first) {
+        const std::size_t count = p_out.size();
+        std::size_t i = 0;
+        for (; i + simd::lanes <= count; i += simd::lanes) {
+            compose_lanes(
+              p_parent, p_instances, p_first + i, simd::lanes, &p_out[i]);
+        }
+        if (i < count) {
+            compose_lanes(
+              p_parent, p_instances, p_first + i, count - i, &p_out[i]);
+        }
+    }
+
+    void compose_instance_transforms(
+      const float4x4& p_parent,
+      const instance_transform_soa& p_instances,
+      std::span<const std::uint32_t> p_indices,
+      std::span<shader_types::instance_data> p_out) {
+        const std::size_t count = p_indices.size();
+        for (std::size_t i = 0; i < count; i += simd::lanes) {
+            compose_gathered_lanes(p_parent,
+                                   p_instances,
+                                   p_indices.data() + i,
+                                   std::min(simd::lanes, count - i),
+                                   p_out.data());
+        }
+    }
+}
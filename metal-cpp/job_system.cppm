@@ -0,0 +1,281 @@
+module;
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+export module lib:job_system;
+
+export namespace jobs {
+    /**
+     * @brief Work-stealing scheduler for data-parallel CPU work.
+     *
+     * Every worker owns a deque. Work is pushed round-robin, a worker pops
+     * its own deque from the back and steals from the front of the others
+     * when it runs dry. The thread calling parallel_for helps execute chunks
+     * while it waits, so nested parallel_for calls from inside a job cannot
+     * deadlock and a scheduler with zero workers simply runs inline.
+     *
+     * Jobs must not throw.
+     */
+    class scheduler {
+    public:
+        //! @param p_worker_count number of background threads, the caller
+        //! of parallel_for acts as one extra worker.
+        explicit scheduler(std::size_t p_worker_count = default_worker_count());
+        ~scheduler();
+
+        scheduler(const scheduler&) = delete;
+        scheduler& operator=(const scheduler&) = delete;
+
+        //! @return hardware threads minus the calling thread.
+        static std::size_t default_worker_count();
+
+        [[nodiscard]] std::size_t worker_count() const {
+            return m_workers.size();
+        }
+
+        /**
+         * @brief Splits [0, p_count) into chunks of at most p_grain elements
+         * and calls p_fn(begin, end) for each chunk, returning once every
+         * chunk has finished.
+         */
+        template<typename Fn>
+        void parallel_for(std::size_t p_count, std::size_t p_grain, Fn&& p_fn) {
+            if (p_count == 0) {
+                return;
+            }
+            p_grain = std::max<std::size_t>(p_grain, 1);
+            if (p_count <= p_grain || m_workers.empty()) {
+                p_fn(std::size_t{ 0 }, p_count);
+                return;
+            }
+
+            using fn_type = std::remove_reference_t<Fn>;
+            auto invoke = [](void* p_context,
+                             std::size_t p_begin,
+                             std::size_t p_end) {
+                (*static_cast<fn_type*>(p_context))(p_begin, p_end);
+            };
+
+            std::atomic<std::size_t> pending{ 0 };
+            submit(invoke,
+                   const_cast<void*>(static_cast<const void*>(&p_fn)),
+                   p_count,
+                   p_grain,
+                   pending);
+            wait(pending);
+        }
+
+        /**
+         * @brief Queues one call to p_invoke(p_context) and returns without
+         * waiting for it.
+         *
+         * p_pending is incremented now and decremented once the call has
+         * returned, so a group of spawned tasks can share one counter and
+         * be joined with wait(). With zero workers the call runs inline.
+         */
+        void spawn(void (*p_invoke)(void*),
+                   void* p_context,
+                   std::atomic<std::size_t>& p_pending);
+
+        //! Runs queued jobs on the calling thread until p_pending is zero.
+        void wait(const std::atomic<std::size_t>& p_pending);
+
+    private:
+        struct job {
+            void (*invoke)(void*, std::size_t, std::size_t);
+            void* context;
+            std::size_t begin;
+            std::size_t end;
+            std::atomic<std::size_t>* pending;
+        };
+
+        struct job_queue {
+            std::mutex mutex;
+            std::deque<job> jobs;
+        };
+
+        void submit(void (*p_invoke)(void*, std::size_t, std::size_t),
+                    void* p_context,
+                    std::size_t p_count,
+                    std::size_t p_grain,
+                    std::atomic<std::size_t>& p_pending);
+        std::optional<job> find_job(std::size_t p_queue);
+        void run(const job& p_job);
+        void worker_loop(std::size_t p_queue);
+
+        // Queue 0 belongs to threads outside the pool, queue i + 1 to
+        // worker i.
+        std::vector<std::unique_ptr<job_queue>> m_queues;
+        std::vector<std::thread> m_workers;
+        std::atomic<std::size_t> m_queued{ 0 };
+        std::atomic<std::size_t> m_next_queue{ 0 };
+        std::mutex m_sleep_mutex;
+        std::condition_variable m_wake;
+        bool m_stop = false;
+    };
+}
+
+namespace jobs {
+    namespace {
+        // Which scheduler the current thread works for and the queue it owns.
+        thread_local const scheduler* current_scheduler = nullptr;
+        thread_local std::size_t current_queue = 0;
+    }
+
+    scheduler::scheduler(std::size_t p_worker_count) {
+        for (std::size_t i = 0; i < p_worker_count + 1; ++i) {
+            m_queues.push_back(std::make_unique<job_queue>());
+        }
+        m_workers.reserve(p_worker_count);
+        for (std::size_t i = 0; i < p_worker_count; ++i) {
+            m_workers.emplace_back([this, i] { worker_loop(i + 1); });
+        }
+    }
+
+    scheduler::~scheduler() {
+        {
+            std::lock_guard lock(m_sleep_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (std::thread& worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    std::size_t scheduler::default_worker_count() {
+        const unsigned hardware = std::thread::hardware_concurrency();
+        return hardware > 1 ? hardware - 1 : 0;
+    }
+
+    void scheduler::submit(void (*p_invoke)(void*, std::size_t, std::size_t),
+                           void* p_context,
+                           std::size_t p_count,
+                           std::size_t p_grain,
+                           std::atomic<std::size_t>& p_pending) {
+        const std::size_t chunks = (p_count + p_grain - 1) / p_grain;
+        p_pending.fetch_add(chunks, std::memory_order_relaxed);
+        m_queued.fetch_add(chunks, std::memory_order_release);
+
+        std::size_t queue =
+          m_next_queue.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+        for (std::size_t begin = 0; begin < p_count; begin += p_grain) {
+            const job work = { p_invoke,
+                               p_context,
+                               begin,
+                               std::min(begin + p_grain, p_count),
+                               &p_pending };
+            {
+                std::lock_guard lock(m_queues[queue]->mutex);
+                m_queues[queue]->jobs.push_back(work);
+            }
+            queue = (queue + 1) % m_queues.size();
+        }
+
+        {
+            std::lock_guard lock(m_sleep_mutex);
+        }
+        m_wake.notify_all();
+    }
+
+    void scheduler::spawn(void (*p_invoke)(void*),
+                          void* p_context,
+                          std::atomic<std::size_t>& p_pending) {
+        if (m_workers.empty()) {
+            p_pending.fetch_add(1, std::memory_order_relaxed);
+            p_invoke(p_context);
+            p_pending.fetch_sub(1, std::memory_order_release);
+            return;
+        }
+
+        // The job's range carries nothing, the task only needs its context.
+        struct task {
+            void (*invoke)(void*);
+            void* context;
+        };
+        auto trampoline = [](void* p_task, std::size_t, std::size_t) {
+            const task* work = static_cast<task*>(p_task);
+            const task copy = *work;
+            delete work;
+            copy.invoke(copy.context);
+        };
+        submit(trampoline, new task{ p_invoke, p_context }, 1, 1, p_pending);
+    }
+
+    void scheduler::wait(const std::atomic<std::size_t>& p_pending) {
+        const std::size_t own_queue =
+          (current_scheduler == this) ? current_queue : 0;
+        while (p_pending.load(std::memory_order_acquire) != 0) {
+            if (std::optional<job> work = find_job(own_queue)) {
+                run(*work);
+            }
+            else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    std::optional<scheduler::job> scheduler::find_job(std::size_t p_queue) {
+        if (m_queued.load(std::memory_order_acquire) == 0) {
+            return std::nullopt;
+        }
+
+        {
+            job_queue& own = *m_queues[p_queue];
+            std::lock_guard lock(own.mutex);
+            if (!own.jobs.empty()) {
+                const job work = own.jobs.back();
+                own.jobs.pop_back();
+                m_queued.fetch_sub(1, std::memory_order_relaxed);
+                return work;
+            }
+        }
+
+        for (std::size_t i = 1; i < m_queues.size(); ++i) {
+            job_queue& victim = *m_queues[(p_queue + i) % m_queues.size()];
+            std::lock_guard lock(victim.mutex);
+            if (!victim.jobs.empty()) {
+                const job work = victim.jobs.front();
+                victim.jobs.pop_front();
+                m_queued.fetch_sub(1, std::memory_order_relaxed);
+                return work;
+            }
+        }
+        return std::nullopt;
+    }
+
+    void scheduler::run(const job& p_job) {
+        p_job.invoke(p_job.context, p_job.begin, p_job.end);
+        p_job.pending->fetch_sub(1, std::memory_order_release);
+    }
+
+    void scheduler::worker_loop(std::size_t p_queue) {
+        current_scheduler = this;
+        current_queue = p_queue;
+
+        while (true) {
+            if (std::optional<job> work = find_job(p_queue)) {
+                run(*work);
+                continue;
+            }
+
+            std::unique_lock lock(m_sleep_mutex);
+            m_wake.wait(lock, [this] {
+                return m_stop || m_queued.load(std::memory_order_acquire) != 0;
+            });
+            if (m_stop && m_queued.load(std::memory_order_acquire) == 0) {
+                return;
+            }
+        }
+    }
+}
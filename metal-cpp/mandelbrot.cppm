@@ -0,0 +1,728 @@
+module;
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+export module lib:mandelbrot;
+
+import :simd;
+import :job_system;
+import :compute_dispatch;
+
+export namespace compute {
+    //! Constants of the sandbox's mandelbrot_set kernel.
+    struct mandelbrot_params {
+        std::uint32_t max_iterations = 1000;
+        float animation_frequency = 0.01f;
+        float animation_speed = 4.f;
+        float animation_scale_low = 0.62f;
+        float animation_scale = 0.38f;
+        float pixel_offset_x = -0.2f;
+        float pixel_offset_y = -0.35f;
+        float origin_x = -1.2f;
+        float origin_y = -0.32f;
+        float scale_x = 2.2f;
+        float scale_y = 2.f;
+        //! Points inside the main cardioid or the period-2 bulb never
+        //! escape, so they get max_iterations without iterating.
+        bool interior_checks = false;
+        //! An orbit that revisits a saved point bit for bit is periodic in
+        //! float arithmetic and can never escape. Points are saved at
+        //! power-of-two iteration counts (Brent), so a cycle is caught
+        //! within about twice its length after the orbit enters it.
+        bool periodicity = false;
+    };
+
+    struct mandelbrot_options {
+        //! Vector registers iterated together: 1 gives simd::lanes pixels
+        //! per step, 2 interleaves two independent chains (16 pixels with
+        //! AVX2) to hide the multiply latency of the escape loop.
+        std::size_t registers = 2;
+        //! Tiles are the unit of work handed to the scheduler. Escape time
+        //! varies a lot across the image, small tiles keep workers busy.
+        std::uint32_t tile_width = 64;
+        std::uint32_t tile_height = 8;
+        /**
+         * Mariani-Silver: compute a tile's border first and, when every
+         * border pixel is in the set, fill the inside without computing it.
+         * Otherwise the inside is split in four and traced the same way.
+         * The set is connected and has no holes, so this only misses
+         * detail thinner than a pixel. Tiles are trace_tile pixels square.
+         */
+        bool boundary_tracing = false;
+        std::uint32_t trace_tile = 64;
+    };
+
+    //! Where the work of a dispatch went.
+    struct mandelbrot_stats {
+        //! Escape-loop steps times the pixels per step, masked lanes
+        //! included: the work actually done.
+        std::uint64_t lane_iterations = 0;
+        //! Resolved by the cardioid/bulb test.
+        std::uint64_t interior_pixels = 0;
+        //! Stopped early on a detected cycle.
+        std::uint64_t periodic_pixels = 0;
+        //! Filled by boundary tracing without being computed.
+        std::uint64_t filled_pixels = 0;
+    };
+
+    //! @return the zoom the kernel derives from the animation frame.
+    float mandelbrot_zoom(std::uint32_t p_frame,
+                          const mandelbrot_params& p_params = {});
+
+    //! @return the RGBA8 pixel, red in the lowest byte, the kernel writes
+    //! for p_iterations.
+    std::uint32_t mandelbrot_color(std::uint32_t p_iterations);
+
+    /**
+     * @brief CPU backend of the mandelbrot_set compute kernel.
+     *
+     * Runs the kernel over a p_width x p_height grid exactly as
+     * dispatchThreads would, writing tightly packed RGBA8 rows into p_out,
+     * ready for MTL::Texture::replaceRegion on an RGBA8Unorm texture.
+     * Escape-time iteration runs simd::lanes pixels per register, lanes
+     * that escaped are masked off and a step ends early once every lane of
+     * every register has escaped. Tiles are spread over p_jobs.
+     */
+    mandelbrot_stats dispatch_mandelbrot(jobs::scheduler& p_jobs,
+                                         std::uint32_t p_width,
+                                         std::uint32_t p_height,
+                                         std::uint32_t p_frame,
+                                         std::span<std::uint32_t> p_out,
+                                         const mandelbrot_options& p_options = {},
+                                         const mandelbrot_params& p_params = {});
+
+    /**
+     * @brief Shades only the listed pixels of a p_width x p_height
+     * dispatch, p_pixels holds y * p_width + x. Results match
+     * dispatch_mandelbrot for the same pixels, tracing does not apply.
+     */
+    mandelbrot_stats dispatch_mandelbrot_pixels(
+      jobs::scheduler& p_jobs,
+      std::uint32_t p_width,
+      std::uint32_t p_height,
+      std::uint32_t p_frame,
+      std::span<const std::uint32_t> p_pixels,
+      std::span<std::uint32_t> p_out,
+      const mandelbrot_options& p_options = {},
+      const mandelbrot_params& p_params = {});
+
+    /**
+     * @brief The mandelbrot_set kernel, thread for thread, for
+     * compute::dispatcher. Each thread shades the texel at its
+     * thread_position_in_grid of a threads_per_grid-sized RGBA8 texture.
+     */
+    struct mandelbrot_kernel {
+        std::span<std::uint32_t> texture;
+        std::uint32_t frame = 0;
+        mandelbrot_params params = {};
+
+        void operator()(const thread_context& p_thread) const;
+    };
+
+    //! One pixel at a time, the statement-by-statement port of the kernel
+    //! the SIMD backend is validated against. Honours the early-out
+    //! switches of p_params the same way the MSL kernel does.
+    void dispatch_mandelbrot_reference(std::uint32_t p_width,
+                                       std::uint32_t p_height,
+                                       std::uint32_t p_frame,
+                                       std::span<std::uint32_t> p_out,
+                                       const mandelbrot_params& p_params = {});
+}
+
+namespace compute {
+    namespace {
+        using namespace math::simd;
+
+        constexpr std::uint32_t k_color_table_size = 4096;
+        // Below this a tile is computed directly, its border would be most
+        // of it.
+        constexpr std::uint32_t k_min_trace_size = 8;
+
+        std::uint32_t pack_gray(float p_color) {
+            const float clamped = std::clamp(p_color, 0.f, 1.f);
+            const auto value =
+              static_cast<std::uint32_t>(std::lround(clamped * 255.f));
+            return value | (value << 8) | (value << 16) | 0xff000000u;
+        }
+
+        // Iteration counts are small integers, so the cos() of the colour
+        // ramp is a table lookup.
+        const std::array<std::uint32_t, k_color_table_size>& color_table() {
+            static const auto table = [] {
+                std::array<std::uint32_t, k_color_table_size> values{};
+                for (std::uint32_t i = 0; i < k_color_table_size; ++i) {
+                    values[i] = pack_gray(
+                      0.5f + 0.5f * std::cos(3.f + static_cast<float>(i) * 0.15f));
+                }
+                return values;
+            }();
+            return table;
+        }
+
+        std::uint32_t color_of(std::uint32_t p_count) {
+            return p_count < k_color_table_size ? color_table()[p_count]
+                                                : mandelbrot_color(p_count);
+        }
+
+        std::uint64_t lane_count(vmask p_mask) {
+            return static_cast<std::uint64_t>(std::popcount(bits(p_mask)));
+        }
+
+        struct grid_mapping {
+            float zoom_scale_x;
+            float zoom_scale_y;
+            float width;
+            float height;
+        };
+
+        /**
+         * Shades lines and rectangles of one dispatch for a worker. Rows
+         * and columns both map onto lanes, which is what boundary tracing
+         * needs for tile borders.
+         */
+        template<std::size_t Registers, bool Periodicity>
+        class tile_shader {
+        public:
+            static constexpr std::size_t step = Registers * lanes;
+            // Rows narrower than this would leave most lanes of a step
+            // masked off, computing them directly is cheaper.
+            static constexpr std::uint32_t k_min_trace_width =
+              std::max(k_min_trace_size, static_cast<std::uint32_t>(2 * step));
+
+            tile_shader(const mandelbrot_params& p_params,
+                        const grid_mapping& p_map,
+                        std::span<std::uint32_t> p_out,
+                        std::uint32_t p_width)
+              : m_params(p_params)
+              , m_map(p_map)
+              , m_out(p_out)
+              , m_width(p_width) {}
+
+            /**
+             * Shades pixels [p_begin, p_end) of row p_fixed, or of column
+             * p_fixed when p_vertical. Escape counts are also written to
+             * p_counts when it is not null.
+             */
+            void shade_line(std::uint32_t p_fixed,
+                            std::uint32_t p_begin,
+                            std::uint32_t p_end,
+                            bool p_vertical,
+                            std::int32_t* p_counts) {
+                const vfloat fixed = vfloat::splat(
+                  p_vertical ? map_x(static_cast<float>(p_fixed))
+                             : map_y(static_cast<float>(p_fixed)));
+                alignas(32) std::int32_t counts[step];
+
+                for (std::uint32_t begin = p_begin; begin < p_end;
+                     begin += step) {
+                    vfloat x0[Registers];
+                    vfloat y0[Registers];
+                    for (std::size_t r = 0; r < Registers; ++r) {
+                        const vfloat index =
+                          vfloat::iota() +
+                          vfloat::splat(static_cast<float>(begin + r * lanes));
+                        x0[r] = p_vertical ? fixed : map_x(index);
+                        y0[r] = p_vertical ? map_y(index) : fixed;
+                    }
+                    const std::uint32_t valid =
+                      std::min<std::uint32_t>(step, p_end - begin);
+                    escape_counts(x0, y0, valid, counts);
+
+                    for (std::uint32_t lane = 0; lane < valid; ++lane) {
+                        const std::uint32_t along = begin + lane;
+                        const std::size_t pixel =
+                          p_vertical
+                            ? std::size_t{ along } * m_width + p_fixed
+                            : std::size_t{ p_fixed } * m_width + along;
+                        m_out[pixel] =
+                          color_of(static_cast<std::uint32_t>(counts[lane]));
+                    }
+                    if (p_counts != nullptr) {
+                        std::copy_n(counts, valid, p_counts + (begin - p_begin));
+                    }
+                }
+            }
+
+            void shade_rect(std::uint32_t p_x0,
+                            std::uint32_t p_y0,
+                            std::uint32_t p_x1,
+                            std::uint32_t p_y1) {
+                for (std::uint32_t y = p_y0; y < p_y1; ++y) {
+                    shade_line(y, p_x0, p_x1, false, nullptr);
+                }
+            }
+
+            //! Shades scattered pixels, p_pixels holds y * width + x.
+            void shade_pixels(std::span<const std::uint32_t> p_pixels) {
+                alignas(32) float xs[step];
+                alignas(32) float ys[step];
+                alignas(32) std::int32_t counts[step];
+                for (std::size_t begin = 0; begin < p_pixels.size();
+                     begin += step) {
+                    const auto valid = static_cast<std::uint32_t>(
+                      std::min(step, p_pixels.size() - begin));
+                    for (std::size_t lane = 0; lane < step; ++lane) {
+                        // Lanes past the end repeat the last pixel, they
+                        // are masked off anyway.
+                        const std::uint32_t pixel =
+                          p_pixels[begin + std::min<std::size_t>(lane, valid - 1)];
+                        xs[lane] = static_cast<float>(pixel % m_width);
+                        ys[lane] = static_cast<float>(pixel / m_width);
+                    }
+                    vfloat x0[Registers];
+                    vfloat y0[Registers];
+                    for (std::size_t r = 0; r < Registers; ++r) {
+                        x0[r] = map_x(vfloat::load(xs + r * lanes));
+                        y0[r] = map_y(vfloat::load(ys + r * lanes));
+                    }
+                    escape_counts(x0, y0, valid, counts);
+                    for (std::uint32_t lane = 0; lane < valid; ++lane) {
+                        m_out[p_pixels[begin + lane]] =
+                          color_of(static_cast<std::uint32_t>(counts[lane]));
+                    }
+                }
+            }
+
+            //! Mariani-Silver over [p_x0, p_x1) x [p_y0, p_y1).
+            void trace_rect(std::uint32_t p_x0,
+                            std::uint32_t p_y0,
+                            std::uint32_t p_x1,
+                            std::uint32_t p_y1) {
+                const std::uint32_t width = p_x1 - p_x0;
+                const std::uint32_t height = p_y1 - p_y0;
+                if (width < k_min_trace_width || height < k_min_trace_size) {
+                    shade_rect(p_x0, p_y0, p_x1, p_y1);
+                    return;
+                }
+
+                // Every border pixel is computed exactly once, recursion
+                // only covers the inside.
+                m_border.resize(2 * width + 2 * (height - 2));
+                std::int32_t* border = m_border.data();
+                shade_line(p_y0, p_x0, p_x1, false, border);
+                shade_line(p_y1 - 1, p_x0, p_x1, false, border + width);
+                shade_line(p_x0, p_y0 + 1, p_y1 - 1, true, border + 2 * width);
+                shade_line(p_x1 - 1, p_y0 + 1, p_y1 - 1, true,
+                           border + 2 * width + (height - 2));
+
+                const auto in_set =
+                  static_cast<std::int32_t>(m_params.max_iterations);
+                const bool interior = std::ranges::all_of(
+                  m_border,
+                  [in_set](std::int32_t p_count) { return p_count == in_set; });
+                if (interior) {
+                    const std::uint32_t color = color_of(m_params.max_iterations);
+                    for (std::uint32_t y = p_y0 + 1; y < p_y1 - 1; ++y) {
+                        std::uint32_t* row =
+                          m_out.data() + std::size_t{ y } * m_width;
+                        std::fill(row + p_x0 + 1, row + p_x1 - 1, color);
+                    }
+                    m_stats.filled_pixels +=
+                      std::uint64_t{ width - 2 } * (height - 2);
+                    return;
+                }
+
+                const std::uint32_t x_mid = p_x0 + 1 + (width - 2) / 2;
+                const std::uint32_t y_mid = p_y0 + 1 + (height - 2) / 2;
+                trace_rect(p_x0 + 1, p_y0 + 1, x_mid, y_mid);
+                trace_rect(x_mid, p_y0 + 1, p_x1 - 1, y_mid);
+                trace_rect(p_x0 + 1, y_mid, x_mid, p_y1 - 1);
+                trace_rect(x_mid, y_mid, p_x1 - 1, p_y1 - 1);
+            }
+
+            [[nodiscard]] const mandelbrot_stats& stats() const {
+                return m_stats;
+            }
+
+        private:
+            [[nodiscard]] float map_x(float p_index) const {
+                return m_map.zoom_scale_x *
+                         (p_index / m_map.width + m_params.pixel_offset_x) +
+                       m_params.origin_x;
+            }
+            [[nodiscard]] float map_y(float p_index) const {
+                return m_map.zoom_scale_y *
+                         (p_index / m_map.height + m_params.pixel_offset_y) +
+                       m_params.origin_y;
+            }
+            [[nodiscard]] vfloat map_x(vfloat p_index) const {
+                return vfloat::splat(m_map.zoom_scale_x) *
+                         (p_index / vfloat::splat(m_map.width) +
+                          vfloat::splat(m_params.pixel_offset_x)) +
+                       vfloat::splat(m_params.origin_x);
+            }
+            [[nodiscard]] vfloat map_y(vfloat p_index) const {
+                return vfloat::splat(m_map.zoom_scale_y) *
+                         (p_index / vfloat::splat(m_map.height) +
+                          vfloat::splat(m_params.pixel_offset_y)) +
+                       vfloat::splat(m_params.origin_y);
+            }
+
+            // Lanes from p_valid on lie past the end of the line and are
+            // masked off from the start. Short border lines are common
+            // when tracing and would otherwise iterate pixels nobody wants.
+            void escape_counts(const vfloat (&p_x0)[Registers],
+                               const vfloat (&p_y0)[Registers],
+                               std::uint32_t p_valid,
+                               std::int32_t* p_counts) {
+                const vfloat four = vfloat::splat(4.f);
+                const vint one = vint::splat(1);
+                const vint in_set =
+                  vint::splat(static_cast<std::int32_t>(m_params.max_iterations));
+
+                vfloat x[Registers];
+                vfloat y[Registers];
+                vfloat saved_x[Registers];
+                vfloat saved_y[Registers];
+                vint iterations[Registers];
+                // Lanes still iterating: not rejected and not caught cycling.
+                vmask live[Registers];
+                for (std::size_t r = 0; r < Registers; ++r) {
+                    x[r] = vfloat::splat(0.f);
+                    y[r] = vfloat::splat(0.f);
+                    saved_x[r] = x[r];
+                    saved_y[r] = y[r];
+                    iterations[r] = vint::splat(0);
+                    live[r] = vfloat::iota() +
+                                vfloat::splat(static_cast<float>(r * lanes)) <
+                              vfloat::splat(static_cast<float>(p_valid));
+                    if (m_params.interior_checks) {
+                        const vfloat xq = p_x0[r] - vfloat::splat(0.25f);
+                        const vfloat y2 = p_y0[r] * p_y0[r];
+                        const vfloat q = xq * xq + y2;
+                        const vfloat xb = p_x0[r] + vfloat::splat(1.f);
+                        const vmask interior =
+                          (q * (q + xq) <= vfloat::splat(0.25f) * y2) |
+                          (xb * xb + y2 <= vfloat::splat(0.0625f));
+                        const vmask rejected = live[r] & interior;
+                        iterations[r] = select(rejected, in_set, iterations[r]);
+                        live[r] = live[r] & ~interior;
+                        m_stats.interior_pixels += lane_count(rejected);
+                    }
+                }
+
+                std::uint32_t next_save = 1;
+                for (std::uint32_t i = 0; i < m_params.max_iterations; ++i) {
+                    vmask active[Registers];
+                    for (std::size_t r = 0; r < Registers; ++r) {
+                        const vfloat xx = x[r] * x[r];
+                        const vfloat yy = y[r] * y[r];
+                        const vfloat xy = x[r] * y[r];
+                        active[r] = live[r] & ((xx + yy) <= four);
+                        // Escaped lanes keep their last z and count.
+                        x[r] = select(active[r], xx - yy + p_x0[r], x[r]);
+                        y[r] = select(active[r], xy + xy + p_y0[r], y[r]);
+                        iterations[r] =
+                          select(active[r], iterations[r] + one, iterations[r]);
+                    }
+                    vmask any_active = active[0];
+                    for (std::size_t r = 1; r < Registers; ++r) {
+                        any_active = any_active | active[r];
+                    }
+                    if (!any(any_active)) {
+                        break;
+                    }
+                    m_stats.lane_iterations += step;
+
+                    if constexpr (Periodicity) {
+                        for (std::size_t r = 0; r < Registers; ++r) {
+                            const vmask cycle = active[r] &
+                                                (x[r] == saved_x[r]) &
+                                                (y[r] == saved_y[r]);
+                            if (any(cycle)) {
+                                iterations[r] =
+                                  select(cycle, in_set, iterations[r]);
+                                live[r] = live[r] & ~cycle;
+                                m_stats.periodic_pixels += lane_count(cycle);
+                            }
+                        }
+                        // Every active lane has now run i + 1 iterations.
+                        if (i + 1 == next_save) {
+                            for (std::size_t r = 0; r < Registers; ++r) {
+                                saved_x[r] = x[r];
+                                saved_y[r] = y[r];
+                            }
+                            next_save *= 2;
+                        }
+                    }
+                }
+
+                for (std::size_t r = 0; r < Registers; ++r) {
+                    iterations[r].store(p_counts + r * lanes);
+                }
+            }
+
+            const mandelbrot_params& m_params;
+            grid_mapping m_map;
+            std::span<std::uint32_t> m_out;
+            std::uint32_t m_width;
+            std::vector<std::int32_t> m_border;
+            mandelbrot_stats m_stats;
+        };
+
+        struct tile_grid {
+            std::uint32_t tile_width;
+            std::uint32_t tile_height;
+            std::uint32_t tiles_x;
+            bool trace;
+        };
+
+        // Runs p_fn on the tile_shader instantiation p_registers and
+        // p_params.periodicity select, returning the shader's stats.
+        template<typename Fn>
+        mandelbrot_stats with_shader(std::size_t p_registers,
+                                     const mandelbrot_params& p_params,
+                                     const grid_mapping& p_map,
+                                     std::span<std::uint32_t> p_out,
+                                     std::uint32_t p_width,
+                                     Fn&& p_fn) {
+            auto run = [&]<std::size_t Registers, bool Periodicity>() {
+                tile_shader<Registers, Periodicity> shader(
+                  p_params, p_map, p_out, p_width);
+                p_fn(shader);
+                return shader.stats();
+            };
+            if (p_registers >= 2) {
+                return p_params.periodicity
+                         ? run.template operator()<2, true>()
+                         : run.template operator()<2, false>();
+            }
+            return p_params.periodicity ? run.template operator()<1, true>()
+                                        : run.template operator()<1, false>();
+        }
+
+        // Totals of the workers of one dispatch.
+        struct stats_accumulator {
+            std::atomic<std::uint64_t> lane_iterations = 0;
+            std::atomic<std::uint64_t> interior_pixels = 0;
+            std::atomic<std::uint64_t> periodic_pixels = 0;
+            std::atomic<std::uint64_t> filled_pixels = 0;
+
+            void add(const mandelbrot_stats& p_stats) {
+                lane_iterations.fetch_add(p_stats.lane_iterations,
+                                          std::memory_order_relaxed);
+                interior_pixels.fetch_add(p_stats.interior_pixels,
+                                          std::memory_order_relaxed);
+                periodic_pixels.fetch_add(p_stats.periodic_pixels,
+                                          std::memory_order_relaxed);
+                filled_pixels.fetch_add(p_stats.filled_pixels,
+                                        std::memory_order_relaxed);
+            }
+
+            [[nodiscard]] mandelbrot_stats load() const {
+                return { lane_iterations.load(),
+                         interior_pixels.load(),
+                         periodic_pixels.load(),
+                         filled_pixels.load() };
+            }
+        };
+
+        // The kernel body for one thread, statement by statement.
+        std::uint32_t shade_pixel(float p_zoom,
+                                  std::uint32_t p_index_x,
+                                  std::uint32_t p_index_y,
+                                  std::uint32_t p_width,
+                                  std::uint32_t p_height,
+                                  const mandelbrot_params& p_params) {
+            const float x0 =
+              p_zoom * p_params.scale_x *
+                (static_cast<float>(p_index_x) / static_cast<float>(p_width) +
+                 p_params.pixel_offset_x) +
+              p_params.origin_x;
+            const float y0 =
+              p_zoom * p_params.scale_y *
+                (static_cast<float>(p_index_y) / static_cast<float>(p_height) +
+                 p_params.pixel_offset_y) +
+              p_params.origin_y;
+
+            if (p_params.interior_checks) {
+                const float xq = x0 - 0.25f;
+                const float y2 = y0 * y0;
+                const float q = xq * xq + y2;
+                const float xb = x0 + 1.f;
+                if (q * (q + xq) <= 0.25f * y2 || xb * xb + y2 <= 0.0625f) {
+                    return mandelbrot_color(p_params.max_iterations);
+                }
+            }
+
+            float x = 0.f;
+            float y = 0.f;
+            float saved_x = 0.f;
+            float saved_y = 0.f;
+            std::uint32_t next_save = 1;
+            std::uint32_t iteration = 0;
+            while (x * x + y * y <= 4.f && iteration < p_params.max_iterations) {
+                const float xtmp = x * x - y * y + x0;
+                y = 2.f * x * y + y0;
+                x = xtmp;
+                iteration += 1;
+                if (p_params.periodicity) {
+                    if (x == saved_x && y == saved_y) {
+                        iteration = p_params.max_iterations;
+                        break;
+                    }
+                    if (iteration == next_save) {
+                        saved_x = x;
+                        saved_y = y;
+                        next_save *= 2;
+                    }
+                }
+            }
+            return mandelbrot_color(iteration);
+        }
+
+        grid_mapping map_grid(std::uint32_t p_width,
+                              std::uint32_t p_height,
+                              std::uint32_t p_frame,
+                              const mandelbrot_params& p_params) {
+            const float zoom = mandelbrot_zoom(p_frame, p_params);
+            return { zoom * p_params.scale_x,
+                     zoom * p_params.scale_y,
+                     static_cast<float>(p_width),
+                     static_cast<float>(p_height) };
+        }
+    }
+
+    float mandelbrot_zoom(std::uint32_t p_frame,
+                          const mandelbrot_params& p_params) {
+        const float zoom =
+          p_params.animation_scale_low +
+          p_params.animation_scale *
+            std::cos(p_params.animation_frequency *
+                     static_cast<float>(p_frame));
+        return std::pow(zoom, p_params.animation_speed);
+    }
+
+    std::uint32_t mandelbrot_color(std::uint32_t p_iterations) {
+        if (p_iterations < k_color_table_size) {
+            return color_table()[p_iterations];
+        }
+        return pack_gray(
+          0.5f + 0.5f * std::cos(3.f + static_cast<float>(p_iterations) * 0.15f));
+    }
+
+    mandelbrot_stats dispatch_mandelbrot(jobs::scheduler& p_jobs,
+                                         std::uint32_t p_width,
+                                         std::uint32_t p_height,
+                                         std::uint32_t p_frame,
+                                         std::span<std::uint32_t> p_out,
+                                         const mandelbrot_options& p_options,
+                                         const mandelbrot_params& p_params) {
+        if (p_width == 0 || p_height == 0) {
+            return {};
+        }
+        const grid_mapping map = map_grid(p_width, p_height, p_frame, p_params);
+        tile_grid grid = { .tile_width = std::max(p_options.tile_width, 1u),
+                           .tile_height = std::max(p_options.tile_height, 1u),
+                           .tiles_x = 0,
+                           .trace = p_options.boundary_tracing };
+        if (grid.trace) {
+            grid.tile_width = std::max(p_options.trace_tile, k_min_trace_size);
+            grid.tile_height = grid.tile_width;
+        }
+        grid.tiles_x = (p_width + grid.tile_width - 1) / grid.tile_width;
+        const std::uint32_t tiles_y =
+          (p_height + grid.tile_height - 1) / grid.tile_height;
+        // Touch the table before the workers race to build it.
+        (void)color_table();
+
+        stats_accumulator totals;
+        p_jobs.parallel_for(
+          std::size_t{ grid.tiles_x } * tiles_y,
+          1,
+          [&](std::size_t p_begin, std::size_t p_end) {
+              totals.add(with_shader(
+                p_options.registers, p_params, map, p_out, p_width,
+                [&](auto& p_shader) {
+                    for (std::size_t tile = p_begin; tile < p_end; ++tile) {
+                        const auto tile_x =
+                          static_cast<std::uint32_t>(tile % grid.tiles_x);
+                        const auto tile_y =
+                          static_cast<std::uint32_t>(tile / grid.tiles_x);
+                        const std::uint32_t x0 = tile_x * grid.tile_width;
+                        const std::uint32_t y0 = tile_y * grid.tile_height;
+                        const std::uint32_t x1 =
+                          std::min(x0 + grid.tile_width, p_width);
+                        const std::uint32_t y1 =
+                          std::min(y0 + grid.tile_height, p_height);
+                        if (grid.trace) {
+                            p_shader.trace_rect(x0, y0, x1, y1);
+                        }
+                        else {
+                            p_shader.shade_rect(x0, y0, x1, y1);
+                        }
+                    }
+                }));
+          });
+        return totals.load();
+    }
+
+    mandelbrot_stats dispatch_mandelbrot_pixels(
+      jobs::scheduler& p_jobs,
+      std::uint32_t p_width,
+      std::uint32_t p_height,
+      std::uint32_t p_frame,
+      std::span<const std::uint32_t> p_pixels,
+      std::span<std::uint32_t> p_out,
+      const mandelbrot_options& p_options,
+      const mandelbrot_params& p_params) {
+        if (p_pixels.empty()) {
+            return {};
+        }
+        const grid_mapping map = map_grid(p_width, p_height, p_frame, p_params);
+        (void)color_table();
+
+        // A tile's worth of pixels per job, like the full dispatch.
+        const std::size_t grain = std::max<std::size_t>(
+          std::size_t{ p_options.tile_width } * p_options.tile_height, 1);
+        stats_accumulator totals;
+        p_jobs.parallel_for(
+          (p_pixels.size() + grain - 1) / grain,
+          1,
+          [&](std::size_t p_begin, std::size_t p_end) {
+              const std::size_t first = p_begin * grain;
+              const std::size_t last =
+                std::min(p_end * grain, p_pixels.size());
+              totals.add(with_shader(
+                p_options.registers, p_params, map, p_out, p_width,
+                [&](auto& p_shader) {
+                    p_shader.shade_pixels(p_pixels.subspan(first, last - first));
+                }));
+          });
+        return totals.load();
+    }
+
+    void mandelbrot_kernel::operator()(const thread_context& p_thread) const {
+        const uint3 index = p_thread.thread_position_in_grid;
+        const uint3 grid_size = p_thread.threads_per_grid;
+        texture[std::size_t{ index.y } * grid_size.x + index.x] =
+          shade_pixel(mandelbrot_zoom(frame, params),
+                      index.x,
+                      index.y,
+                      grid_size.x,
+                      grid_size.y,
+                      params);
+    }
+
+    void dispatch_mandelbrot_reference(std::uint32_t p_width,
+                                       std::uint32_t p_height,
+                                       std::uint32_t p_frame,
+                                       std::span<std::uint32_t> p_out,
+                                       const mandelbrot_params& p_params) {
+        const float zoom = mandelbrot_zoom(p_frame, p_params);
+        for (std::uint32_t index_y = 0; index_y < p_height; ++index_y) {
+            for (std::uint32_t index_x = 0; index_x < p_width; ++index_x) {
+                p_out[std::size_t{ index_y } * p_width + index_x] = shade_pixel(
+                  zoom, index_x, index_y, p_width, p_height, p_params);
+            }
+        }
+    }
+}
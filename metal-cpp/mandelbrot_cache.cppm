@@ -0,0 +1,338 @@
+module;
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numbers>
+#include <span>
+#include <vector>
+
+export module lib:mandelbrot_cache;
+
+import :job_system;
+import :mandelbrot;
+
+export namespace compute {
+    struct mandelbrot_frame_cache_options {
+        //! Frames are kept while their pixels fit in this many bytes, 0
+        //! disables caching.
+        std::size_t max_bytes = 16u << 20;
+        /**
+         * Largest distance, in pixels, between a pixel's centre and the
+         * cached sample reused for it when a frame is reprojected from a
+         * cached frame at a nearby zoom. Pixels further off are recomputed.
+         * 0 keeps every frame exact: only frames whose zoom is cached are
+         * reused. At 0.5 every frame can be reprojected, a nearest-sample
+         * resize of the closest cached zoom, which changes the escape count
+         * of some boundary pixels.
+         */
+        float max_error = 0.f;
+    };
+
+    struct mandelbrot_frame_cache_stats {
+        //! Frames copied from a cached frame of the same zoom.
+        std::size_t hits = 0;
+        //! Frames built from a cached frame at a nearby zoom.
+        std::size_t reprojections = 0;
+        //! Frames computed in full.
+        std::size_t computes = 0;
+        std::size_t evictions = 0;
+        std::uint64_t reused_pixels = 0;
+        std::uint64_t shaded_pixels = 0;
+    };
+
+    /**
+     * @brief Temporal reuse for the animated Mandelbrot texture.
+     *
+     * A frame only depends on its zoom, and the animation sweeps the same
+     * zooms back and forth, so computed frames are kept by zoom within a
+     * memory budget. A frame whose zoom is cached is a copy. Otherwise the
+     * nearest cached zoom is reprojected: the grid mapping is separable, so
+     * each column and row either finds a cached sample within max_error
+     * pixels or is recomputed through dispatch_mandelbrot_pixels. When
+     * too little would be reused the frame is computed in full and cached.
+     *
+     * Only exact frames are cached, so errors never compound. Once the
+     * budget is full a new frame replaces the entry closest in zoom to
+     * another one, when that spreads the cached zooms further. Not thread
+     * safe, render() spreads its own work over the scheduler.
+     */
+    class mandelbrot_frame_cache {
+    public:
+        mandelbrot_frame_cache(std::uint32_t p_width,
+                               std::uint32_t p_height,
+                               mandelbrot_frame_cache_options p_options = {},
+                               mandelbrot_options p_shading = {},
+                               mandelbrot_params p_params = {});
+
+        //! Writes frame p_frame, p_width x p_height RGBA8 pixels, to p_out.
+        void render(jobs::scheduler& p_jobs,
+                    std::uint32_t p_frame,
+                    std::span<std::uint32_t> p_out);
+
+        /**
+         * @brief Fills the budget with frames spread evenly over the zoom
+         * range, one half period of the animation, so the first pass
+         * through the animation is already served from the cache.
+         */
+        void prefill(jobs::scheduler& p_jobs);
+
+        [[nodiscard]] const mandelbrot_frame_cache_stats& stats() const {
+            return m_stats;
+        }
+        [[nodiscard]] std::size_t entry_count() const {
+            return m_entries.size();
+        }
+        [[nodiscard]] std::size_t capacity() const { return m_capacity; }
+        [[nodiscard]] std::size_t memory_bytes() const {
+            return m_entries.size() * frame_pixels() * sizeof(std::uint32_t);
+        }
+
+    private:
+        struct entry {
+            float zoom;
+            std::vector<std::uint32_t> pixels;
+        };
+
+        [[nodiscard]] std::size_t frame_pixels() const {
+            return std::size_t{ m_width } * m_height;
+        }
+        //! @return the cached entry with the zoom nearest p_zoom, or null.
+        [[nodiscard]] const entry* nearest(float p_zoom) const;
+        bool reproject(jobs::scheduler& p_jobs,
+                       const entry& p_source,
+                       std::uint32_t p_frame,
+                       float p_zoom,
+                       std::span<std::uint32_t> p_out);
+        void map_axis(std::uint32_t p_size,
+                      float p_offset,
+                      double p_ratio,
+                      std::vector<std::int32_t>& p_source) const;
+        void insert(float p_zoom, std::span<const std::uint32_t> p_pixels);
+
+        std::uint32_t m_width;
+        std::uint32_t m_height;
+        mandelbrot_frame_cache_options m_options;
+        mandelbrot_options m_shading;
+        mandelbrot_params m_params;
+        std::size_t m_capacity;
+        //! Sorted by zoom.
+        std::vector<entry> m_entries;
+        std::vector<std::int32_t> m_source_x;
+        std::vector<std::int32_t> m_source_y;
+        std::vector<std::uint32_t> m_recompute;
+        mandelbrot_frame_cache_stats m_stats;
+    };
+}
+
+namespace compute {
+    namespace {
+        // Below this share of reused pixels gathering the rest costs more
+        // than computing the whole frame with tiles.
+        constexpr double k_min_reuse = 0.5;
+
+        //! Zooms compare by ratio, the reprojection error scales with it.
+        double zoom_distance(float p_a, float p_b) {
+            return std::abs(std::log(static_cast<double>(p_a) / p_b));
+        }
+    }
+
+    mandelbrot_frame_cache::mandelbrot_frame_cache(
+      std::uint32_t p_width,
+      std::uint32_t p_height,
+      mandelbrot_frame_cache_options p_options,
+      mandelbrot_options p_shading,
+      mandelbrot_params p_params)
+      : m_width(p_width)
+      , m_height(p_height)
+      , m_options(p_options)
+      , m_shading(p_shading)
+      , m_params(p_params)
+      , m_capacity(frame_pixels() == 0
+                     ? 0
+                     : p_options.max_bytes /
+                         (frame_pixels() * sizeof(std::uint32_t))) {}
+
+    void mandelbrot_frame_cache::render(jobs::scheduler& p_jobs,
+                                        std::uint32_t p_frame,
+                                        std::span<std::uint32_t> p_out) {
+        const float zoom = mandelbrot_zoom(p_frame, m_params);
+        if (const entry* source = nearest(zoom)) {
+            if (source->zoom == zoom) {
+                std::ranges::copy(source->pixels, p_out.begin());
+                ++m_stats.hits;
+                m_stats.reused_pixels += frame_pixels();
+                return;
+            }
+            if (reproject(p_jobs, *source, p_frame, zoom, p_out)) {
+                return;
+            }
+        }
+        dispatch_mandelbrot(
+          p_jobs, m_width, m_height, p_frame, p_out, m_shading, m_params);
+        ++m_stats.computes;
+        m_stats.shaded_pixels += frame_pixels();
+        insert(zoom, p_out.first(frame_pixels()));
+    }
+
+    void mandelbrot_frame_cache::prefill(jobs::scheduler& p_jobs) {
+        const auto half_period = static_cast<std::uint32_t>(
+          std::numbers::pi_v<float> / m_params.animation_frequency);
+        const std::size_t count =
+          std::min<std::size_t>(m_capacity, std::size_t{ half_period } + 1);
+        std::vector<std::uint32_t> pixels(frame_pixels());
+        for (std::size_t i = 0; i < count; ++i) {
+            const auto frame = static_cast<std::uint32_t>(
+              count == 1 ? 0 : i * half_period / (count - 1));
+            const float zoom = mandelbrot_zoom(frame, m_params);
+            const entry* cached = nearest(zoom);
+            if (cached != nullptr && cached->zoom == zoom) {
+                continue;
+            }
+            dispatch_mandelbrot(
+              p_jobs, m_width, m_height, frame, pixels, m_shading, m_params);
+            ++m_stats.computes;
+            m_stats.shaded_pixels += frame_pixels();
+            insert(zoom, pixels);
+        }
+    }
+
+    const mandelbrot_frame_cache::entry* mandelbrot_frame_cache::nearest(
+      float p_zoom) const {
+        if (m_entries.empty()) {
+            return nullptr;
+        }
+        auto above = std::ranges::lower_bound(
+          m_entries, p_zoom, {}, [](const entry& p_entry) {
+              return p_entry.zoom;
+          });
+        if (above == m_entries.end()) {
+            return &m_entries.back();
+        }
+        if (above == m_entries.begin()) {
+            return &*above;
+        }
+        auto below = above - 1;
+        return zoom_distance(below->zoom, p_zoom) <=
+                   zoom_distance(above->zoom, p_zoom)
+                 ? &*below
+                 : &*above;
+    }
+
+    bool mandelbrot_frame_cache::reproject(jobs::scheduler& p_jobs,
+                                           const entry& p_source,
+                                           std::uint32_t p_frame,
+                                           float p_zoom,
+                                           std::span<std::uint32_t> p_out) {
+        if (m_options.max_error <= 0.f) {
+            return false;
+        }
+        const double ratio = static_cast<double>(p_zoom) / p_source.zoom;
+        map_axis(m_width, m_params.pixel_offset_x, ratio, m_source_x);
+        map_axis(m_height, m_params.pixel_offset_y, ratio, m_source_y);
+        const auto usable = [](const std::vector<std::int32_t>& p_source) {
+            return std::ranges::count_if(
+              p_source, [](std::int32_t p_index) { return p_index >= 0; });
+        };
+        const auto reused = static_cast<std::size_t>(usable(m_source_x) *
+                                                     usable(m_source_y));
+        if (static_cast<double>(reused) <
+            k_min_reuse * static_cast<double>(frame_pixels())) {
+            return false;
+        }
+
+        m_recompute.clear();
+        for (std::uint32_t y = 0; y < m_height; ++y) {
+            std::uint32_t* row = p_out.data() + std::size_t{ y } * m_width;
+            const std::int32_t source_y = m_source_y[y];
+            if (source_y < 0) {
+                for (std::uint32_t x = 0; x < m_width; ++x) {
+                    m_recompute.push_back(y * m_width + x);
+                }
+                continue;
+            }
+            const std::uint32_t* source_row =
+              p_source.pixels.data() + std::size_t(source_y) * m_width;
+            for (std::uint32_t x = 0; x < m_width; ++x) {
+                if (m_source_x[x] < 0) {
+                    m_recompute.push_back(y * m_width + x);
+                }
+                else {
+                    row[x] = source_row[m_source_x[x]];
+                }
+            }
+        }
+        dispatch_mandelbrot_pixels(p_jobs,
+                                   m_width,
+                                   m_height,
+                                   p_frame,
+                                   m_recompute,
+                                   p_out,
+                                   m_shading,
+                                   m_params);
+        ++m_stats.reprojections;
+        m_stats.reused_pixels += reused;
+        m_stats.shaded_pixels += m_recompute.size();
+        return true;
+    }
+
+    void mandelbrot_frame_cache::map_axis(
+      std::uint32_t p_size,
+      float p_offset,
+      double p_ratio,
+      std::vector<std::int32_t>& p_source) const {
+        // Pixel i sits at zoom * scale * (i / size + offset) + origin, so
+        // the source image holds it at ((ratio * (i / size + offset)) -
+        // offset) * size, ratio being zoom over the source zoom.
+        p_source.resize(p_size);
+        const double size = p_size;
+        for (std::uint32_t i = 0; i < p_size; ++i) {
+            const double at =
+              (p_ratio * (i / size + p_offset) - p_offset) * size;
+            const double nearest = std::round(at);
+            // Measured in pixels of the frame being built.
+            const double error = std::abs(at - nearest) / p_ratio;
+            const bool inside = nearest >= 0.0 && nearest < size;
+            p_source[i] = inside && error <= m_options.max_error
+                            ? static_cast<std::int32_t>(nearest)
+                            : -1;
+        }
+    }
+
+    void mandelbrot_frame_cache::insert(float p_zoom,
+                                        std::span<const std::uint32_t> p_pixels) {
+        if (m_capacity == 0) {
+            return;
+        }
+        auto by_zoom = [](const entry& p_entry) { return p_entry.zoom; };
+        if (m_entries.size() == m_capacity) {
+            // The entry closest to a neighbour adds the least coverage.
+            std::size_t victim = 0;
+            double victim_gap = std::numeric_limits<double>::infinity();
+            for (std::size_t i = 0; i + 1 < m_entries.size(); ++i) {
+                const double gap =
+                  zoom_distance(m_entries[i].zoom, m_entries[i + 1].zoom);
+                if (gap < victim_gap) {
+                    victim = i;
+                    victim_gap = gap;
+                }
+            }
+            const entry* closest = nearest(p_zoom);
+            if (m_entries.size() > 1 &&
+                zoom_distance(closest->zoom, p_zoom) <= victim_gap) {
+                return;
+            }
+            m_entries.erase(m_entries.begin() +
+                            static_cast<std::ptrdiff_t>(victim));
+            ++m_stats.evictions;
+        }
+        auto position =
+          std::ranges::upper_bound(m_entries, p_zoom, {}, by_zoom);
+        m_entries.insert(
+          position,
+          entry{ p_zoom, std::vector<std::uint32_t>(p_pixels.begin(),
+                                                    p_pixels.end()) });
+    }
+}
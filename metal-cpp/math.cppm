@@ -0,0 +1,326 @@
+module;
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+export module lib:math;
+
+/**
+ * @brief Portable replacement for the subset of Apple's <simd/simd.h> that
+ * the renderer relies on.
+ *
+ * Vector and matrix types follow the Metal Shading Language layout rules so
+ * they can be memcpy'd straight into GPU buffers: float3 is padded to 16
+ * bytes, float3x3 is three padded columns (48 bytes) and matrices are stored
+ * column-major.
+ *
+ * The hot-path kernels (matrix * matrix, matrix * vector) pick AVX2, SSE or
+ * NEON at compile time and fall back to scalar code everywhere else.
+ */
+export namespace math {
+    struct alignas(8) float2 {
+        float x;
+        float y;
+    };
+
+    // alignas(16) pads the struct to 16 bytes, matching MSL's float3.
+    struct alignas(16) float3 {
+        float x;
+        float y;
+        float z;
+    };
+
+    struct alignas(16) float4 {
+        float x;
+        float y;
+        float z;
+        float w;
+
+        [[nodiscard]] constexpr float3 xyz() const { return { x, y, z }; }
+    };
+
+    struct float3x3 {
+        float3 columns[3];
+    };
+
+    struct float4x4 {
+        float4 columns[4];
+    };
+
+    struct perspective_params {
+        float fov_radians;
+        float aspect;
+        float znear;
+        float zfar;
+    };
+
+    static_assert(sizeof(float2) == 8);
+    static_assert(sizeof(float3) == 16 && alignof(float3) == 16);
+    static_assert(sizeof(float4) == 16 && alignof(float4) == 16);
+    static_assert(sizeof(float3x3) == 48);
+    static_assert(sizeof(float4x4) == 64);
+
+    //! @return name of the SIMD backend selected at compile time.
+    constexpr const char* simd_backend() {
+#if defined(__AVX2__) && defined(__FMA__)
+        return "avx2";
+#elif defined(__SSE2__) || defined(_M_X64)
+        return "sse";
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        return "neon";
+#else
+        return "scalar";
+#endif
+    }
+
+    constexpr float3 operator+(const float3& p_a, const float3& p_b) {
+        return { p_a.x + p_b.x, p_a.y + p_b.y, p_a.z + p_b.z };
+    }
+
+    constexpr float3 operator-(const float3& p_a, const float3& p_b) {
+        return { p_a.x - p_b.x, p_a.y - p_b.y, p_a.z - p_b.z };
+    }
+
+    constexpr float3 operator-(const float3& p_v) {
+        return { -p_v.x, -p_v.y, -p_v.z };
+    }
+
+    constexpr float3 operator*(const float3& p_v, float p_s) {
+        return { p_v.x * p_s, p_v.y * p_s, p_v.z * p_s };
+    }
+
+    constexpr float4 operator+(const float4& p_a, const float4& p_b) {
+        return { p_a.x + p_b.x, p_a.y + p_b.y, p_a.z + p_b.z, p_a.w + p_b.w };
+    }
+
+    constexpr float4 operator*(const float4& p_v, float p_s) {
+        return { p_v.x * p_s, p_v.y * p_s, p_v.z * p_s, p_v.w * p_s };
+    }
+
+    constexpr float3 add(const float3& p_a, const float3& p_b) {
+        return p_a + p_b;
+    }
+
+    constexpr float dot(const float3& p_a, const float3& p_b) {
+        return p_a.x * p_b.x + p_a.y * p_b.y + p_a.z * p_b.z;
+    }
+
+    constexpr float dot(const float4& p_a, const float4& p_b) {
+        return p_a.x * p_b.x + p_a.y * p_b.y + p_a.z * p_b.z + p_a.w * p_b.w;
+    }
+
+    constexpr float3 cross(const float3& p_a, const float3& p_b) {
+        return { p_a.y * p_b.z - p_a.z * p_b.y,
+                 p_a.z * p_b.x - p_a.x * p_b.z,
+                 p_a.x * p_b.y - p_a.y * p_b.x };
+    }
+
+    inline float length(const float3& p_v) {
+        return std::sqrt(dot(p_v, p_v));
+    }
+
+    inline float3 normalize(const float3& p_v) {
+        return p_v * (1.f / length(p_v));
+    }
+
+    float4 operator*(const float4x4& p_m, const float4& p_v);
+    float4x4 operator*(const float4x4& p_a, const float4x4& p_b);
+
+    constexpr float3 operator*(const float3x3& p_m, const float3& p_v) {
+        return p_m.columns[0] * p_v.x + p_m.columns[1] * p_v.y +
+               p_m.columns[2] * p_v.z;
+    }
+
+    constexpr float4x4 transpose(const float4x4& p_m) {
+        const auto& c = p_m.columns;
+        return { { { c[0].x, c[1].x, c[2].x, c[3].x },
+                   { c[0].y, c[1].y, c[2].y, c[3].y },
+                   { c[0].z, c[1].z, c[2].z, c[3].z },
+                   { c[0].w, c[1].w, c[2].w, c[3].w } } };
+    }
+
+    constexpr float4x4 make_identity() {
+        return { { { 1.f, 0.f, 0.f, 0.f },
+                   { 0.f, 1.f, 0.f, 0.f },
+                   { 0.f, 0.f, 1.f, 0.f },
+                   { 0.f, 0.f, 0.f, 1.f } } };
+    }
+
+    inline float4x4 make_perspective(perspective_params p_params) {
+        const float ys = 1.f / std::tan(p_params.fov_radians * 0.5f);
+        const float xs = ys / p_params.aspect;
+        const float zs = p_params.zfar / (p_params.znear - p_params.zfar);
+        return { { { xs, 0.f, 0.f, 0.f },
+                   { 0.f, ys, 0.f, 0.f },
+                   { 0.f, 0.f, zs, -1.f },
+                   { 0.f, 0.f, p_params.znear * zs, 0.f } } };
+    }
+
+    inline float4x4 make_x_rotate(float p_angle_radians) {
+        const float c = std::cos(p_angle_radians);
+        const float s = std::sin(p_angle_radians);
+        return { { { 1.f, 0.f, 0.f, 0.f },
+                   { 0.f, c, -s, 0.f },
+                   { 0.f, s, c, 0.f },
+                   { 0.f, 0.f, 0.f, 1.f } } };
+    }
+
+    inline float4x4 make_y_rotate(float p_angle_radians) {
+        const float c = std::cos(p_angle_radians);
+        const float s = std::sin(p_angle_radians);
+        return { { { c, 0.f, -s, 0.f },
+                   { 0.f, 1.f, 0.f, 0.f },
+                   { s, 0.f, c, 0.f },
+                   { 0.f, 0.f, 0.f, 1.f } } };
+    }
+
+    inline float4x4 make_z_rotate(float p_angle_radians) {
+        const float c = std::cos(p_angle_radians);
+        const float s = std::sin(p_angle_radians);
+        return { { { c, -s, 0.f, 0.f },
+                   { s, c, 0.f, 0.f },
+                   { 0.f, 0.f, 1.f, 0.f },
+                   { 0.f, 0.f, 0.f, 1.f } } };
+    }
+
+    constexpr float4x4 make_translate(const float3& p_v) {
+        return { { { 1.f, 0.f, 0.f, 0.f },
+                   { 0.f, 1.f, 0.f, 0.f },
+                   { 0.f, 0.f, 1.f, 0.f },
+                   { p_v.x, p_v.y, p_v.z, 1.f } } };
+    }
+
+    constexpr float4x4 make_scale(const float3& p_v) {
+        return { { { p_v.x, 0.f, 0.f, 0.f },
+                   { 0.f, p_v.y, 0.f, 0.f },
+                   { 0.f, 0.f, p_v.z, 0.f },
+                   { 0.f, 0.f, 0.f, 1.f } } };
+    }
+
+    //! @return upper 3x3 of the matrix, only a valid normal transform for
+    //! rotations combined with uniform scale, see normal_transform.
+    constexpr float3x3 discard_translation(const float4x4& p_m) {
+        return { { p_m.columns[0].xyz(),
+                   p_m.columns[1].xyz(),
+                   p_m.columns[2].xyz() } };
+    }
+}
+
+namespace math {
+#if defined(__AVX2__) && defined(__FMA__)
+    float4 operator*(const float4x4& p_m, const float4& p_v) {
+        const float* m = &p_m.columns[0].x;
+        __m128 r = _mm_mul_ps(_mm_load_ps(m), _mm_set1_ps(p_v.x));
+        r = _mm_fmadd_ps(_mm_load_ps(m + 4), _mm_set1_ps(p_v.y), r);
+        r = _mm_fmadd_ps(_mm_load_ps(m + 8), _mm_set1_ps(p_v.z), r);
+        r = _mm_fmadd_ps(_mm_load_ps(m + 12), _mm_set1_ps(p_v.w), r);
+        float4 out;
+        _mm_store_ps(&out.x, r);
+        return out;
+    }
+
+    float4x4 operator*(const float4x4& p_a, const float4x4& p_b) {
+        // Each 256-bit register holds two columns of the result, so the whole
+        // product is two passes of four FMAs.
+        const float* a = &p_a.columns[0].x;
+        const __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a));
+        const __m256 a1 =
+          _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 4));
+        const __m256 a2 =
+          _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 8));
+        const __m256 a3 =
+          _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 12));
+
+        float4x4 out;
+        for (int i = 0; i < 4; i += 2) {
+            const __m256 b = _mm256_loadu_ps(&p_b.columns[i].x);
+            __m256 r = _mm256_mul_ps(a0, _mm256_shuffle_ps(b, b, 0x00));
+            r = _mm256_fmadd_ps(a1, _mm256_shuffle_ps(b, b, 0x55), r);
+            r = _mm256_fmadd_ps(a2, _mm256_shuffle_ps(b, b, 0xaa), r);
+            r = _mm256_fmadd_ps(a3, _mm256_shuffle_ps(b, b, 0xff), r);
+            _mm256_storeu_ps(&out.columns[i].x, r);
+        }
+        return out;
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    float4 operator*(const float4x4& p_m, const float4& p_v) {
+        const float* m = &p_m.columns[0].x;
+        __m128 r = _mm_mul_ps(_mm_load_ps(m), _mm_set1_ps(p_v.x));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_load_ps(m + 4), _mm_set1_ps(p_v.y)));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_load_ps(m + 8), _mm_set1_ps(p_v.z)));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_load_ps(m + 12), _mm_set1_ps(p_v.w)));
+        float4 out;
+        _mm_store_ps(&out.x, r);
+        return out;
+    }
+
+    float4x4 operator*(const float4x4& p_a, const float4x4& p_b) {
+        const float* a = &p_a.columns[0].x;
+        const __m128 a0 = _mm_load_ps(a);
+        const __m128 a1 = _mm_load_ps(a + 4);
+        const __m128 a2 = _mm_load_ps(a + 8);
+        const __m128 a3 = _mm_load_ps(a + 12);
+
+        float4x4 out;
+        for (int i = 0; i < 4; ++i) {
+            const __m128 b = _mm_load_ps(&p_b.columns[i].x);
+            __m128 r = _mm_mul_ps(a0, _mm_shuffle_ps(b, b, 0x00));
+            r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_shuffle_ps(b, b, 0x55)));
+            r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_shuffle_ps(b, b, 0xaa)));
+            r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_shuffle_ps(b, b, 0xff)));
+            _mm_store_ps(&out.columns[i].x, r);
+        }
+        return out;
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    float4 operator*(const float4x4& p_m, const float4& p_v) {
+        const float* m = &p_m.columns[0].x;
+        const float32x4_t v = vld1q_f32(&p_v.x);
+        float32x4_t r = vmulq_laneq_f32(vld1q_f32(m), v, 0);
+        r = vfmaq_laneq_f32(r, vld1q_f32(m + 4), v, 1);
+        r = vfmaq_laneq_f32(r, vld1q_f32(m + 8), v, 2);
+        r = vfmaq_laneq_f32(r, vld1q_f32(m + 12), v, 3);
+        float4 out;
+        vst1q_f32(&out.x, r);
+        return out;
+    }
+
+    float4x4 operator*(const float4x4& p_a, const float4x4& p_b) {
+        const float* a = &p_a.columns[0].x;
+        const float32x4_t a0 = vld1q_f32(a);
+        const float32x4_t a1 = vld1q_f32(a + 4);
+        const float32x4_t a2 = vld1q_f32(a + 8);
+        const float32x4_t a3 = vld1q_f32(a + 12);
+
+        float4x4 out;
+        for (int i = 0; i < 4; ++i) {
+            const float32x4_t b = vld1q_f32(&p_b.columns[i].x);
+            float32x4_t r = vmulq_laneq_f32(a0, b, 0);
+            r = vfmaq_laneq_f32(r, a1, b, 1);
+            r = vfmaq_laneq_f32(r, a2, b, 2);
+            r = vfmaq_laneq_f32(r, a3, b, 3);
+            vst1q_f32(&out.columns[i].x, r);
+        }
+        return out;
+    }
+#else
+    float4 operator*(const float4x4& p_m, const float4& p_v) {
+        const auto& c = p_m.columns;
+        return c[0] * p_v.x + c[1] * p_v.y + c[2] * p_v.z + c[3] * p_v.w;
+    }
+
+    float4x4 operator*(const float4x4& p_a, const float4x4& p_b) {
+        float4x4 out;
+        for (int i = 0; i < 4; ++i) {
+            out.columns[i] = p_a * p_b.columns[i];
+        }
+        return out;
+    }
+#endif
+}
@@ -0,0 +1,411 @@
+module;
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+export module lib:mesh_cache;
+
+import :shader_types;
+import :pipeline_cache;
+import :vertex_packing;
+import :mesh_import;
+import :mesh_optimizer;
+import :asset_file;
+
+export namespace gpu {
+    //! Non-owning view of a packed mesh, in memory or in a mapped file.
+    struct mesh_view {
+        shader_types::vertex_quantization quantization{};
+        std::span<const shader_types::packed_vertex_data> vertices;
+        index_format format = index_format::uint16;
+        std::uint32_t index_count = 0;
+        std::span<const std::byte> indices;
+    };
+
+    //! A mesh ready for upload: quantized vertices and narrowed indices.
+    struct packed_mesh {
+        shader_types::vertex_quantization quantization{};
+        std::vector<shader_types::packed_vertex_data> vertices;
+        index_format format = index_format::uint16;
+        std::uint32_t index_count = 0;
+        std::vector<std::byte> indices;
+
+        [[nodiscard]] mesh_view view() const {
+            return { quantization, vertices, format, index_count, indices };
+        }
+    };
+
+    [[nodiscard]] packed_mesh pack_mesh(const mesh_data& p_mesh);
+
+    /**
+     * @brief Writes p_mesh to p_path as an asset file tagged with
+     * p_source_key.
+     *
+     * A small MESH section holds the counts, index format, key and
+     * quantization. VERT and INDX hold the vertex and index arrays exactly
+     * as the GPU reads them, page aligned, so a load maps the file and
+     * uploads straight out of it.
+     */
+    bool save_mesh_cache(const std::filesystem::path& p_path,
+                         const mesh_view& p_mesh,
+                         std::uint64_t p_source_key);
+
+    //! A mesh whose arrays point into a mapped asset file.
+    struct mapped_mesh {
+        asset_reader asset;
+        mesh_view view;
+    };
+
+    /**
+     * @return the mapped mesh, or nullopt if the file is missing, damaged,
+     * from another format version or was built from another source.
+     * p_verify picks whether the arrays are checksummed up front.
+     */
+    [[nodiscard]] std::optional<mapped_mesh> map_mesh_cache(
+      const std::filesystem::path& p_path,
+      std::uint64_t p_source_key,
+      asset_verify p_verify = asset_verify::checksums);
+
+    //! map_mesh_cache followed by a copy into owned storage.
+    [[nodiscard]] std::optional<packed_mesh> load_mesh_cache(
+      const std::filesystem::path& p_path,
+      std::uint64_t p_source_key);
+
+    struct mesh_cache_options {
+        //! Least recently used entries are removed past this size.
+        std::uintmax_t max_bytes = 256ull << 20;
+    };
+
+    struct mesh_load_result {
+        mesh_import_status status = mesh_import_status::ok;
+        bool from_cache = false;
+        //! The imported mesh, empty on a cache hit.
+        packed_mesh mesh;
+        //! The cached mesh, set on a cache hit.
+        std::optional<mapped_mesh> mapped;
+        //! Only filled in when the mesh was imported and optimized.
+        mesh_optimize_stats stats;
+
+        [[nodiscard]] mesh_view view() const {
+            return mapped ? mapped->view : mesh.view();
+        }
+    };
+
+    /**
+     * @brief Loads p_source through the cache in p_cache_directory,
+     * importing, optimizing and packing it on a miss.
+     *
+     * Entries are keyed on the source's absolute path, size and
+     * modification time and on p_options, so a hit neither reads nor
+     * hashes the source. Saving the file or changing an option rebuilds.
+     * An edit that keeps both size and timestamp does not, and neither do
+     * changes to buffers a .gltf references by file name. Hits are mapped
+     * and only their layout is checked.
+     *
+     * Each source path and option set owns one <key>.mesh file, so a
+     * rebuild replaces the entry it invalidated. Hits refresh the file's
+     * timestamp, and after a rebuild the least recently used entries are
+     * removed until the directory fits p_cache_options.max_bytes.
+     */
+    [[nodiscard]] mesh_load_result load_mesh(
+      const std::filesystem::path& p_source,
+      const std::filesystem::path& p_cache_directory,
+      const mesh_optimize_options& p_options = {},
+      const mesh_cache_options& p_cache_options = {});
+}
+
+namespace gpu {
+    namespace {
+        //! Bump whenever the MESH record, the packed vertex layout or the
+        //! optimizer output changes.
+        constexpr std::uint32_t k_mesh_version = 3;
+        constexpr std::uint32_t k_mesh_tag = asset_tag("MESH");
+        constexpr std::uint32_t k_vertex_tag = asset_tag("VERT");
+        constexpr std::uint32_t k_index_tag = asset_tag("INDX");
+        constexpr std::size_t k_record_bytes = 64;
+
+        // Version, vertex count, index count, index format and three zero
+        // bytes, source key, then the ten quantization floats and padding.
+        class record_writer {
+        public:
+            template<typename T>
+            void put(const T& p_value) {
+                std::memcpy(&m_bytes[m_at], &p_value, sizeof(T));
+                m_at += sizeof(T);
+            }
+
+            void skip(std::size_t p_bytes) { m_at += p_bytes; }
+
+            [[nodiscard]] std::span<const std::byte> bytes() const {
+                return m_bytes;
+            }
+
+        private:
+            std::array<std::byte, k_record_bytes> m_bytes{};
+            std::size_t m_at = 0;
+        };
+
+        class record_reader {
+        public:
+            explicit record_reader(std::span<const std::byte> p_bytes)
+              : m_bytes(p_bytes) {}
+
+            template<typename T>
+            T get() {
+                T value;
+                std::memcpy(&value, &m_bytes[m_at], sizeof(T));
+                m_at += sizeof(T);
+                return value;
+            }
+
+            void skip(std::size_t p_bytes) { m_at += p_bytes; }
+
+        private:
+            std::span<const std::byte> m_bytes;
+            std::size_t m_at = 0;
+        };
+
+        struct cache_keys {
+            //! Names the entry: absolute path and options.
+            std::uint64_t entry;
+            //! Stored in the entry: also the source's size and mtime.
+            std::uint64_t source;
+        };
+
+        std::optional<cache_keys> cache_keys_of(
+          const std::filesystem::path& p_source,
+          const mesh_optimize_options& p_options) {
+            std::error_code error;
+            const std::filesystem::path absolute =
+              std::filesystem::absolute(p_source, error);
+            if (error) {
+                return std::nullopt;
+            }
+            const std::uintmax_t size =
+              std::filesystem::file_size(p_source, error);
+            if (error) {
+                return std::nullopt;
+            }
+            const std::filesystem::file_time_type modified =
+              std::filesystem::last_write_time(p_source, error);
+            if (error) {
+                return std::nullopt;
+            }
+            pipeline_hasher hasher;
+            hasher.add(k_mesh_version)
+              .add(std::string_view(absolute.native()))
+              .add(p_options.cache_size)
+              .add(std::bit_cast<std::uint32_t>(p_options.overdraw_threshold))
+              .add(p_options.overdraw);
+            const std::uint64_t entry = hasher.finish().value;
+            hasher.add(static_cast<std::uint64_t>(size))
+              .add(static_cast<std::int64_t>(
+                modified.time_since_epoch().count()));
+            return cache_keys{ entry, hasher.finish().value };
+        }
+
+        // Removes *.mesh files, least recently used first, until the ones
+        // in p_directory fit p_max_bytes. p_keep was just written and
+        // stays. Failures leave files behind for the next trim.
+        void trim_mesh_cache(const std::filesystem::path& p_directory,
+                             const std::filesystem::path& p_keep,
+                             std::uintmax_t p_max_bytes) {
+            struct entry {
+                std::filesystem::file_time_type used;
+                std::uintmax_t size;
+                std::filesystem::path path;
+            };
+            std::vector<entry> entries;
+            std::uintmax_t total = 0;
+            std::error_code error;
+            for (const auto& file :
+                 std::filesystem::directory_iterator(p_directory, error)) {
+                if (file.path().extension() != ".mesh") {
+                    continue;
+                }
+                std::error_code entry_error;
+                const std::uintmax_t size = file.file_size(entry_error);
+                const auto used = file.last_write_time(entry_error);
+                if (entry_error) {
+                    continue;
+                }
+                total += size;
+                if (file.path() != p_keep) {
+                    entries.push_back({ used, size, file.path() });
+                }
+            }
+            std::ranges::sort(entries, {}, &entry::used);
+            for (const entry& stale : entries) {
+                if (total <= p_max_bytes) {
+                    break;
+                }
+                if (std::filesystem::remove(stale.path, error)) {
+                    total -= stale.size;
+                }
+            }
+        }
+    }
+
+    packed_mesh pack_mesh(const mesh_data& p_mesh) {
+        packed_mesh packed;
+        packed.quantization = make_vertex_quantization(p_mesh.vertices);
+        packed.vertices.resize(p_mesh.vertices.size());
+        pack_vertices(packed.quantization, p_mesh.vertices, packed.vertices);
+        packed.format = choose_index_format(p_mesh.vertices.size());
+        packed.index_count = static_cast<std::uint32_t>(p_mesh.indices.size());
+        packed.indices = encode_indices(p_mesh.indices, packed.format);
+        return packed;
+    }
+
+    bool save_mesh_cache(const std::filesystem::path& p_path,
+                         const mesh_view& p_mesh,
+                         std::uint64_t p_source_key) {
+        const shader_types::vertex_quantization& q = p_mesh.quantization;
+        record_writer record;
+        record.put(k_mesh_version);
+        record.put(static_cast<std::uint32_t>(p_mesh.vertices.size()));
+        record.put(p_mesh.index_count);
+        record.put(static_cast<std::uint8_t>(p_mesh.format));
+        record.skip(3);
+        record.put(p_source_key);
+        for (float value : { q.positionOffset.x, q.positionOffset.y,
+                             q.positionOffset.z, q.positionScale.x,
+                             q.positionScale.y, q.positionScale.z,
+                             q.texcoordOffset.x, q.texcoordOffset.y,
+                             q.texcoordScale.x, q.texcoordScale.y }) {
+            record.put(value);
+        }
+
+        asset_writer writer;
+        writer.add(k_mesh_tag, record.bytes());
+        writer.add(k_vertex_tag, std::as_bytes(p_mesh.vertices));
+        writer.add(k_index_tag, p_mesh.indices);
+        return writer.write(p_path);
+    }
+
+    std::optional<mapped_mesh> map_mesh_cache(
+      const std::filesystem::path& p_path,
+      std::uint64_t p_source_key,
+      asset_verify p_verify) {
+        mapped_mesh mapped;
+        if (mapped.asset.open(p_path, p_verify) != asset_status::ok) {
+            return std::nullopt;
+        }
+        const std::span<const std::byte> bytes = mapped.asset.find(k_mesh_tag);
+        if (bytes.size() != k_record_bytes) {
+            return std::nullopt;
+        }
+
+        record_reader record(bytes);
+        mesh_view& mesh = mapped.view;
+        const auto version = record.get<std::uint32_t>();
+        const auto vertex_count = record.get<std::uint32_t>();
+        mesh.index_count = record.get<std::uint32_t>();
+        const auto format = record.get<std::uint8_t>();
+        record.skip(3);
+        const auto key = record.get<std::uint64_t>();
+        if (version != k_mesh_version || key != p_source_key ||
+            format > static_cast<std::uint8_t>(index_format::uint32)) {
+            return std::nullopt;
+        }
+        mesh.format = static_cast<index_format>(format);
+        shader_types::vertex_quantization& q = mesh.quantization;
+        for (float* value : { &q.positionOffset.x, &q.positionOffset.y,
+                              &q.positionOffset.z, &q.positionScale.x,
+                              &q.positionScale.y, &q.positionScale.z,
+                              &q.texcoordOffset.x, &q.texcoordOffset.y,
+                              &q.texcoordScale.x, &q.texcoordScale.y }) {
+            *value = record.get<float>();
+        }
+
+        // Sections start page aligned, so the vertex cast is aligned too.
+        const std::span<const std::byte> vertices =
+          mapped.asset.find(k_vertex_tag);
+        mesh.indices = mapped.asset.find(k_index_tag);
+        if (vertices.size() != std::size_t{ vertex_count } *
+                                 sizeof(shader_types::packed_vertex_data) ||
+            mesh.indices.size() !=
+              std::size_t{ mesh.index_count } * index_size(mesh.format)) {
+            return std::nullopt;
+        }
+        mesh.vertices = {
+            reinterpret_cast<const shader_types::packed_vertex_data*>(
+              vertices.data()),
+            vertex_count
+        };
+        return mapped;
+    }
+
+    std::optional<packed_mesh> load_mesh_cache(
+      const std::filesystem::path& p_path,
+      std::uint64_t p_source_key) {
+        const std::optional<mapped_mesh> mapped =
+          map_mesh_cache(p_path, p_source_key);
+        if (!mapped) {
+            return std::nullopt;
+        }
+        const mesh_view& view = mapped->view;
+        packed_mesh mesh;
+        mesh.quantization = view.quantization;
+        mesh.vertices.assign(view.vertices.begin(), view.vertices.end());
+        mesh.format = view.format;
+        mesh.index_count = view.index_count;
+        mesh.indices.assign(view.indices.begin(), view.indices.end());
+        return mesh;
+    }
+
+    mesh_load_result load_mesh(const std::filesystem::path& p_source,
+                               const std::filesystem::path& p_cache_directory,
+                               const mesh_optimize_options& p_options,
+                               const mesh_cache_options& p_cache_options) {
+        mesh_load_result result;
+        const std::optional<cache_keys> keys = cache_keys_of(p_source, p_options);
+        if (!keys) {
+            result.status = mesh_import_status::unreadable;
+            return result;
+        }
+        const std::filesystem::path cached =
+          p_cache_directory / (pipeline_key{ keys->entry }.hex() + ".mesh");
+        // The key already vouches for the contents, checksumming would
+        // read the whole file again.
+        result.mapped = map_mesh_cache(cached, keys->source, asset_verify::layout);
+        if (result.mapped) {
+            result.from_cache = true;
+            // The timestamp is the LRU order trim_mesh_cache goes by.
+            std::error_code error;
+            std::filesystem::last_write_time(
+              cached, std::filesystem::file_time_type::clock::now(), error);
+            return result;
+        }
+
+        const std::optional<std::vector<std::byte>> file = read_file(p_source);
+        if (!file) {
+            result.status = mesh_import_status::unreadable;
+            return result;
+        }
+
+        mesh_data mesh;
+        result.status = import_mesh(*file, p_source, mesh);
+        if (result.status != mesh_import_status::ok) {
+            return result;
+        }
+        result.stats = optimize_mesh(mesh, p_options);
+        result.mesh = pack_mesh(mesh);
+        // A failed write only costs the next load an import.
+        if (save_mesh_cache(cached, result.mesh.view(), keys->source)) {
+            trim_mesh_cache(p_cache_directory, cached, p_cache_options.max_bytes);
+        }
+        return result;
+    }
+}
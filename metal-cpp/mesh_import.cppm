@@ -0,0 +1,1131 @@
+module;
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+export module lib:mesh_import;
+
+import :math;
+import :shader_types;
+
+export namespace gpu {
+    //! Indexed triangle list, what the importers produce and the mesh
+    //! optimizer works on.
+    struct mesh_data {
+        std::vector<shader_types::vertex_data> vertices;
+        std::vector<std::uint32_t> indices;
+    };
+
+    enum class mesh_import_status : std::uint8_t {
+        ok,
+        //! The file, or a buffer it references, could not be read.
+        unreadable,
+        //! Syntax errors, indices or accessors out of range.
+        malformed,
+        //! Valid but outside what the importers handle, see import_gltf.
+        unsupported,
+    };
+
+    /**
+     * @brief Appends the triangles of a Wavefront OBJ file to p_mesh.
+     *
+     * Reads v, vt, vn and f, including negative indices. Polygons are
+     * fanned into triangles and every corner becomes its own vertex,
+     * deduplicate_vertices merges them again. Corners without a normal get
+     * the face normal, V is flipped for Metal's top-left texture origin.
+     * Everything else (groups, materials, lines) is ignored. p_mesh is left
+     * unchanged unless the whole file imports.
+     */
+    [[nodiscard]] mesh_import_status import_obj(std::string_view p_text,
+                                                mesh_data& p_mesh);
+
+    /**
+     * @brief Appends every triangle primitive of a glTF 2.0 asset, .glb or
+     * .gltf, to p_mesh.
+     *
+     * Reads POSITION, NORMAL and TEXCOORD_0 and the index accessor. Buffers
+     * come from the GLB binary chunk, base64 data URIs or files relative to
+     * p_base_directory. Node transforms are not applied. Primitives without
+     * normals get flat normals as the spec asks. Sparse accessors, other
+     * primitive modes and Draco or meshopt compression are unsupported.
+     * p_mesh is left unchanged unless every primitive imports.
+     */
+    [[nodiscard]] mesh_import_status import_gltf(
+      std::span<const std::byte> p_file,
+      const std::filesystem::path& p_base_directory,
+      mesh_data& p_mesh);
+
+    //! Picks the importer from the extension: .obj, .gltf or .glb.
+    [[nodiscard]] mesh_import_status import_mesh(
+      const std::filesystem::path& p_path,
+      mesh_data& p_mesh);
+
+    //! import_mesh for a file already in memory, p_path names its format
+    //! and where relative glTF buffers are found.
+    [[nodiscard]] mesh_import_status import_mesh(
+      std::span<const std::byte> p_file,
+      const std::filesystem::path& p_path,
+      mesh_data& p_mesh);
+
+    [[nodiscard]] std::optional<std::vector<std::byte>> read_file(
+      const std::filesystem::path& p_path);
+}
+
+namespace gpu {
+    namespace {
+        using math::float2;
+        using math::float3;
+        using shader_types::vertex_data;
+
+        constexpr float3 k_default_normal = { 0.f, 0.f, 1.f };
+
+        float3 normalized_or_default(const float3& p_v) {
+            const float length =
+              std::sqrt(p_v.x * p_v.x + p_v.y * p_v.y + p_v.z * p_v.z);
+            if (!(length > 0.f) || !std::isfinite(length)) {
+                return k_default_normal;
+            }
+            return { p_v.x / length, p_v.y / length, p_v.z / length };
+        }
+
+        float3 face_normal(const float3& p_a, const float3& p_b, const float3& p_c) {
+            return normalized_or_default(math::cross(p_b - p_a, p_c - p_a));
+        }
+
+        // strtof on a bounded copy, the views into the file are not null
+        // terminated.
+        bool parse_float(std::string_view p_token, float& p_value) {
+            std::array<char, 64> buffer;
+            if (p_token.empty() || p_token.size() >= buffer.size()) {
+                return false;
+            }
+            std::memcpy(buffer.data(), p_token.data(), p_token.size());
+            buffer[p_token.size()] = '\0';
+            char* end = nullptr;
+            p_value = std::strtof(buffer.data(), &end);
+            return end == buffer.data() + p_token.size();
+        }
+
+        bool parse_int(std::string_view p_token, long& p_value) {
+            std::array<char, 32> buffer;
+            if (p_token.empty() || p_token.size() >= buffer.size()) {
+                return false;
+            }
+            std::memcpy(buffer.data(), p_token.data(), p_token.size());
+            buffer[p_token.size()] = '\0';
+            char* end = nullptr;
+            p_value = std::strtol(buffer.data(), &end, 10);
+            return end == buffer.data() + p_token.size();
+        }
+
+        bool is_space(char p_c) {
+            return p_c == ' ' || p_c == '\t' || p_c == '\r' || p_c == '\f' ||
+                   p_c == '\v';
+        }
+
+        //! Splits one line into whitespace-separated tokens.
+        class tokenizer {
+        public:
+            explicit tokenizer(std::string_view p_line)
+              : m_rest(p_line) {}
+
+            bool next(std::string_view& p_token) {
+                std::size_t start = 0;
+                while (start < m_rest.size() && is_space(m_rest[start])) {
+                    ++start;
+                }
+                std::size_t end = start;
+                while (end < m_rest.size() && !is_space(m_rest[end])) {
+                    ++end;
+                }
+                p_token = m_rest.substr(start, end - start);
+                m_rest = m_rest.substr(end);
+                return !p_token.empty();
+            }
+
+        private:
+            std::string_view m_rest;
+        };
+
+        // Resolves a 1-based or negative OBJ index against p_count
+        // elements, -1 for a missing component.
+        bool resolve_obj_index(std::string_view p_token,
+                               std::size_t p_count,
+                               long& p_index) {
+            if (p_token.empty()) {
+                p_index = -1;
+                return true;
+            }
+            long value = 0;
+            if (!parse_int(p_token, value) || value == 0) {
+                return false;
+            }
+            p_index = value > 0 ? value - 1 : static_cast<long>(p_count) + value;
+            return p_index >= 0 && static_cast<std::size_t>(p_index) < p_count;
+        }
+
+        struct obj_corner {
+            long position;
+            long texcoord;
+            long normal;
+        };
+
+        // --- glTF ---------------------------------------------------------
+
+        // Just enough JSON for glTF: the whole document as a tree.
+        struct json_value {
+            enum class kind : std::uint8_t {
+                null,
+                boolean,
+                number,
+                string,
+                array,
+                object,
+            };
+
+            kind type = kind::null;
+            bool boolean = false;
+            double number = 0.0;
+            std::string text;
+            std::vector<json_value> items;
+            std::vector<std::pair<std::string, json_value>> members;
+
+            [[nodiscard]] const json_value* find(std::string_view p_key) const {
+                for (const auto& [key, value] : members) {
+                    if (key == p_key) {
+                        return &value;
+                    }
+                }
+                return nullptr;
+            }
+
+            [[nodiscard]] const json_value* at(std::size_t p_index) const {
+                return type == kind::array && p_index < items.size()
+                         ? &items[p_index]
+                         : nullptr;
+            }
+        };
+
+        class json_parser {
+        public:
+            explicit json_parser(std::string_view p_text)
+              : m_text(p_text) {}
+
+            bool parse(json_value& p_value) {
+                return value(p_value, 0) && (skip_space(), m_at == m_text.size());
+            }
+
+        private:
+            static constexpr int k_max_depth = 64;
+
+            void skip_space() {
+                while (m_at < m_text.size() &&
+                       (m_text[m_at] == ' ' || m_text[m_at] == '\t' ||
+                        m_text[m_at] == '\n' || m_text[m_at] == '\r')) {
+                    ++m_at;
+                }
+            }
+
+            bool literal(std::string_view p_word) {
+                if (m_text.substr(m_at, p_word.size()) != p_word) {
+                    return false;
+                }
+                m_at += p_word.size();
+                return true;
+            }
+
+            bool value(json_value& p_value, int p_depth) {
+                if (p_depth > k_max_depth) {
+                    return false;
+                }
+                skip_space();
+                if (m_at >= m_text.size()) {
+                    return false;
+                }
+                switch (m_text[m_at]) {
+                    case '{':
+                        return object(p_value, p_depth);
+                    case '[':
+                        return array(p_value, p_depth);
+                    case '"':
+                        p_value.type = json_value::kind::string;
+                        return string(p_value.text);
+                    case 't':
+                        p_value.type = json_value::kind::boolean;
+                        p_value.boolean = true;
+                        return literal("true");
+                    case 'f':
+                        p_value.type = json_value::kind::boolean;
+                        return literal("false");
+                    case 'n':
+                        return literal("null");
+                    default:
+                        p_value.type = json_value::kind::number;
+                        return number(p_value.number);
+                }
+            }
+
+            bool object(json_value& p_value, int p_depth) {
+                p_value.type = json_value::kind::object;
+                ++m_at;
+                skip_space();
+                if (m_at < m_text.size() && m_text[m_at] == '}') {
+                    ++m_at;
+                    return true;
+                }
+                while (true) {
+                    skip_space();
+                    std::string key;
+                    if (m_at >= m_text.size() || m_text[m_at] != '"' ||
+                        !string(key)) {
+                        return false;
+                    }
+                    skip_space();
+                    if (!literal(":")) {
+                        return false;
+                    }
+                    p_value.members.emplace_back(std::move(key), json_value{});
+                    if (!value(p_value.members.back().second, p_depth + 1)) {
+                        return false;
+                    }
+                    skip_space();
+                    if (literal("}")) {
+                        return true;
+                    }
+                    if (!literal(",")) {
+                        return false;
+                    }
+                }
+            }
+
+            bool array(json_value& p_value, int p_depth) {
+                p_value.type = json_value::kind::array;
+                ++m_at;
+                skip_space();
+                if (literal("]")) {
+                    return true;
+                }
+                while (true) {
+                    p_value.items.emplace_back();
+                    if (!value(p_value.items.back(), p_depth + 1)) {
+                        return false;
+                    }
+                    skip_space();
+                    if (literal("]")) {
+                        return true;
+                    }
+                    if (!literal(",")) {
+                        return false;
+                    }
+                }
+            }
+
+            static void append_utf8(std::string& p_out, std::uint32_t p_code) {
+                if (p_code < 0x80) {
+                    p_out += static_cast<char>(p_code);
+                }
+                else if (p_code < 0x800) {
+                    p_out += static_cast<char>(0xc0 | (p_code >> 6));
+                    p_out += static_cast<char>(0x80 | (p_code & 0x3f));
+                }
+                else if (p_code < 0x10000) {
+                    p_out += static_cast<char>(0xe0 | (p_code >> 12));
+                    p_out += static_cast<char>(0x80 | ((p_code >> 6) & 0x3f));
+                    p_out += static_cast<char>(0x80 | (p_code & 0x3f));
+                }
+                else {
+                    p_out += static_cast<char>(0xf0 | (p_code >> 18));
+                    p_out += static_cast<char>(0x80 | ((p_code >> 12) & 0x3f));
+                    p_out += static_cast<char>(0x80 | ((p_code >> 6) & 0x3f));
+                    p_out += static_cast<char>(0x80 | (p_code & 0x3f));
+                }
+            }
+
+            bool hex4(std::uint32_t& p_code) {
+                if (m_at + 4 > m_text.size()) {
+                    return false;
+                }
+                p_code = 0;
+                for (int i = 0; i < 4; ++i) {
+                    const char c = m_text[m_at++];
+                    p_code <<= 4;
+                    if (c >= '0' && c <= '9') {
+                        p_code |= static_cast<std::uint32_t>(c - '0');
+                    }
+                    else if (c >= 'a' && c <= 'f') {
+                        p_code |= static_cast<std::uint32_t>(c - 'a' + 10);
+                    }
+                    else if (c >= 'A' && c <= 'F') {
+                        p_code |= static_cast<std::uint32_t>(c - 'A' + 10);
+                    }
+                    else {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            bool string(std::string& p_out) {
+                ++m_at;
+                while (m_at < m_text.size()) {
+                    const char c = m_text[m_at++];
+                    if (c == '"') {
+                        return true;
+                    }
+                    if (c != '\\') {
+                        p_out += c;
+                        continue;
+                    }
+                    if (m_at >= m_text.size()) {
+                        return false;
+                    }
+                    const char escape = m_text[m_at++];
+                    switch (escape) {
+                        case '"':
+                        case '\\':
+                        case '/':
+                            p_out += escape;
+                            break;
+                        case 'b':
+                            p_out += '\b';
+                            break;
+                        case 'f':
+                            p_out += '\f';
+                            break;
+                        case 'n':
+                            p_out += '\n';
+                            break;
+                        case 'r':
+                            p_out += '\r';
+                            break;
+                        case 't':
+                            p_out += '\t';
+                            break;
+                        case 'u': {
+                            std::uint32_t code = 0;
+                            if (!hex4(code)) {
+                                return false;
+                            }
+                            if (code >= 0xd800 && code < 0xdc00 &&
+                                literal("\\u")) {
+                                std::uint32_t low = 0;
+                                if (!hex4(low) || low < 0xdc00 || low >= 0xe000) {
+                                    return false;
+                                }
+                                code = 0x10000 + ((code - 0xd800) << 10) +
+                                       (low - 0xdc00);
+                            }
+                            append_utf8(p_out, code);
+                            break;
+                        }
+                        default:
+                            return false;
+                    }
+                }
+                return false;
+            }
+
+            bool number(double& p_out) {
+                const std::size_t start = m_at;
+                while (m_at < m_text.size() &&
+                       std::string_view("+-0123456789.eE").find(
+                         m_text[m_at]) != std::string_view::npos) {
+                    ++m_at;
+                }
+                const std::string token(m_text.substr(start, m_at - start));
+                if (token.empty()) {
+                    return false;
+                }
+                char* end = nullptr;
+                p_out = std::strtod(token.c_str(), &end);
+                return end == token.c_str() + token.size();
+            }
+
+            std::string_view m_text;
+            std::size_t m_at = 0;
+        };
+
+        bool as_index(const json_value* p_value, std::size_t& p_index) {
+            if (p_value == nullptr || p_value->type != json_value::kind::number ||
+                p_value->number < 0.0 || p_value->number > 4294967295.0 ||
+                p_value->number != std::floor(p_value->number)) {
+                return false;
+            }
+            p_index = static_cast<std::size_t>(p_value->number);
+            return true;
+        }
+
+        std::size_t index_or(const json_value& p_object,
+                             std::string_view p_key,
+                             std::size_t p_default) {
+            std::size_t index = p_default;
+            const json_value* value = p_object.find(p_key);
+            return value != nullptr && as_index(value, index) ? index : p_default;
+        }
+
+        std::optional<std::vector<std::byte>> decode_base64(std::string_view p_text) {
+            std::vector<std::byte> out;
+            out.reserve(p_text.size() / 4 * 3);
+            std::uint32_t bits = 0;
+            int count = 0;
+            for (char c : p_text) {
+                int value;
+                if (c >= 'A' && c <= 'Z') {
+                    value = c - 'A';
+                }
+                else if (c >= 'a' && c <= 'z') {
+                    value = c - 'a' + 26;
+                }
+                else if (c >= '0' && c <= '9') {
+                    value = c - '0' + 52;
+                }
+                else if (c == '+') {
+                    value = 62;
+                }
+                else if (c == '/') {
+                    value = 63;
+                }
+                else if (c == '=') {
+                    break;
+                }
+                else {
+                    return std::nullopt;
+                }
+                bits = (bits << 6) | static_cast<std::uint32_t>(value);
+                if (++count == 4) {
+                    out.push_back(static_cast<std::byte>(bits >> 16));
+                    out.push_back(static_cast<std::byte>(bits >> 8));
+                    out.push_back(static_cast<std::byte>(bits));
+                    bits = 0;
+                    count = 0;
+                }
+            }
+            if (count == 2) {
+                out.push_back(static_cast<std::byte>(bits >> 4));
+            }
+            else if (count == 3) {
+                out.push_back(static_cast<std::byte>(bits >> 10));
+                out.push_back(static_cast<std::byte>(bits >> 2));
+            }
+            else if (count == 1) {
+                return std::nullopt;
+            }
+            return out;
+        }
+
+        enum class component : std::uint32_t {
+            i8 = 5120,
+            u8 = 5121,
+            i16 = 5122,
+            u16 = 5123,
+            u32 = 5125,
+            f32 = 5126,
+        };
+
+        std::size_t component_bytes(std::uint32_t p_type) {
+            switch (static_cast<component>(p_type)) {
+                case component::i8:
+                case component::u8:
+                    return 1;
+                case component::i16:
+                case component::u16:
+                    return 2;
+                case component::u32:
+                case component::f32:
+                    return 4;
+            }
+            return 0;
+        }
+
+        std::size_t type_components(std::string_view p_type) {
+            if (p_type == "SCALAR") {
+                return 1;
+            }
+            if (p_type == "VEC2") {
+                return 2;
+            }
+            if (p_type == "VEC3") {
+                return 3;
+            }
+            if (p_type == "VEC4") {
+                return 4;
+            }
+            return 0;
+        }
+
+        //! A resolved accessor: element i starts at data + i * stride.
+        struct accessor_view {
+            const std::byte* data = nullptr;
+            std::size_t count = 0;
+            std::size_t stride = 0;
+            std::uint32_t component_type = 0;
+            std::size_t components = 0;
+            bool normalized = false;
+
+            // Component p_c of element p_i as a float, normalized integers
+            // mapped to [0, 1] or [-1, 1].
+            [[nodiscard]] float read(std::size_t p_i, std::size_t p_c) const {
+                const std::byte* at =
+                  data + p_i * stride + p_c * component_bytes(component_type);
+                switch (static_cast<component>(component_type)) {
+                    case component::f32: {
+                        float value;
+                        std::memcpy(&value, at, sizeof(value));
+                        return value;
+                    }
+                    case component::u8: {
+                        const auto value = static_cast<std::uint8_t>(*at);
+                        return normalized ? value / 255.f : value;
+                    }
+                    case component::i8: {
+                        const auto value = static_cast<std::int8_t>(*at);
+                        return normalized ? std::max(value / 127.f, -1.f)
+                                          : value;
+                    }
+                    case component::u16: {
+                        std::uint16_t value;
+                        std::memcpy(&value, at, sizeof(value));
+                        return normalized ? value / 65535.f : value;
+                    }
+                    case component::i16: {
+                        std::int16_t value;
+                        std::memcpy(&value, at, sizeof(value));
+                        return normalized ? std::max(value / 32767.f, -1.f)
+                                          : value;
+                    }
+                    case component::u32: {
+                        std::uint32_t value;
+                        std::memcpy(&value, at, sizeof(value));
+                        return static_cast<float>(value);
+                    }
+                }
+                return 0.f;
+            }
+
+            [[nodiscard]] std::uint32_t read_index(std::size_t p_i) const {
+                const std::byte* at = data + p_i * stride;
+                switch (static_cast<component>(component_type)) {
+                    case component::u8:
+                        return static_cast<std::uint8_t>(*at);
+                    case component::u16: {
+                        std::uint16_t value;
+                        std::memcpy(&value, at, sizeof(value));
+                        return value;
+                    }
+                    case component::u32: {
+                        std::uint32_t value;
+                        std::memcpy(&value, at, sizeof(value));
+                        return value;
+                    }
+                    default:
+                        // Rejected by the caller, glTF indices are unsigned.
+                        return 0;
+                }
+            }
+        };
+
+        class gltf_document {
+        public:
+            gltf_document(const json_value& p_root,
+                          std::span<const std::byte> p_glb_binary,
+                          const std::filesystem::path& p_base_directory)
+              : m_root(p_root)
+              , m_glb_binary(p_glb_binary)
+              , m_base_directory(p_base_directory) {}
+
+            mesh_import_status load_buffers() {
+                const json_value* buffers = m_root.find("buffers");
+                if (buffers == nullptr) {
+                    return mesh_import_status::ok;
+                }
+                for (std::size_t i = 0; const json_value* buffer = buffers->at(i);
+                     ++i) {
+                    std::size_t length = 0;
+                    if (!as_index(buffer->find("byteLength"), length)) {
+                        return mesh_import_status::malformed;
+                    }
+                    const json_value* uri = buffer->find("uri");
+                    std::vector<std::byte> bytes;
+                    if (uri == nullptr) {
+                        // The GLB binary chunk, which may be padded.
+                        if (i != 0 || m_glb_binary.size() < length) {
+                            return mesh_import_status::malformed;
+                        }
+                        bytes.assign(m_glb_binary.begin(),
+                                     m_glb_binary.begin() +
+                                       static_cast<std::ptrdiff_t>(length));
+                    }
+                    else if (uri->text.starts_with("data:")) {
+                        const std::size_t comma = uri->text.find(";base64,");
+                        if (comma == std::string::npos) {
+                            return mesh_import_status::unsupported;
+                        }
+                        auto decoded = decode_base64(
+                          std::string_view(uri->text).substr(comma + 8));
+                        if (!decoded) {
+                            return mesh_import_status::malformed;
+                        }
+                        bytes = std::move(*decoded);
+                    }
+                    else {
+                        auto file = read_file(m_base_directory / uri->text);
+                        if (!file) {
+                            return mesh_import_status::unreadable;
+                        }
+                        bytes = std::move(*file);
+                    }
+                    if (bytes.size() < length) {
+                        return mesh_import_status::malformed;
+                    }
+                    m_buffers.push_back(std::move(bytes));
+                }
+                return mesh_import_status::ok;
+            }
+
+            mesh_import_status accessor(std::size_t p_index,
+                                        accessor_view& p_view) const {
+                const json_value* accessors = m_root.find("accessors");
+                const json_value* accessor =
+                  accessors != nullptr ? accessors->at(p_index) : nullptr;
+                if (accessor == nullptr) {
+                    return mesh_import_status::malformed;
+                }
+                if (accessor->find("sparse") != nullptr ||
+                    accessor->find("bufferView") == nullptr) {
+                    return mesh_import_status::unsupported;
+                }
+                std::size_t view_index = 0;
+                std::size_t component_type = 0;
+                const json_value* type = accessor->find("type");
+                if (!as_index(accessor->find("bufferView"), view_index) ||
+                    !as_index(accessor->find("count"), p_view.count) ||
+                    !as_index(accessor->find("componentType"), component_type) ||
+                    type == nullptr) {
+                    return mesh_import_status::malformed;
+                }
+                p_view.component_type = static_cast<std::uint32_t>(component_type);
+                p_view.components = type_components(type->text);
+                const json_value* normalized = accessor->find("normalized");
+                p_view.normalized = normalized != nullptr && normalized->boolean;
+                const std::size_t element_bytes =
+                  component_bytes(p_view.component_type) * p_view.components;
+                if (element_bytes == 0) {
+                    return mesh_import_status::malformed;
+                }
+
+                const json_value* views = m_root.find("bufferViews");
+                const json_value* view =
+                  views != nullptr ? views->at(view_index) : nullptr;
+                std::size_t buffer_index = 0;
+                std::size_t view_length = 0;
+                if (view == nullptr ||
+                    !as_index(view->find("buffer"), buffer_index) ||
+                    !as_index(view->find("byteLength"), view_length) ||
+                    buffer_index >= m_buffers.size()) {
+                    return mesh_import_status::malformed;
+                }
+                const std::size_t view_offset = index_or(*view, "byteOffset", 0);
+                const std::size_t offset = index_or(*accessor, "byteOffset", 0);
+                p_view.stride = index_or(*view, "byteStride", element_bytes);
+                const std::vector<std::byte>& buffer = m_buffers[buffer_index];
+                if (view_offset + view_length > buffer.size() ||
+                    p_view.stride < element_bytes ||
+                    (p_view.count > 0 &&
+                     offset + (p_view.count - 1) * p_view.stride + element_bytes >
+                       view_length)) {
+                    return mesh_import_status::malformed;
+                }
+                p_view.data = buffer.data() + view_offset + offset;
+                return mesh_import_status::ok;
+            }
+
+            mesh_import_status append_primitive(const json_value& p_primitive,
+                                                mesh_data& p_mesh) const {
+                if (index_or(p_primitive, "mode", 4) != 4) {
+                    return mesh_import_status::unsupported;
+                }
+                const json_value* attributes = p_primitive.find("attributes");
+                std::size_t position_index = 0;
+                if (attributes == nullptr ||
+                    !as_index(attributes->find("POSITION"), position_index)) {
+                    return mesh_import_status::malformed;
+                }
+                accessor_view positions;
+                if (mesh_import_status status =
+                      accessor(position_index, positions);
+                    status != mesh_import_status::ok) {
+                    return status;
+                }
+                if (positions.components != 3 ||
+                    positions.component_type !=
+                      static_cast<std::uint32_t>(component::f32)) {
+                    return mesh_import_status::malformed;
+                }
+
+                std::optional<accessor_view> normals;
+                if (std::size_t index = 0;
+                    as_index(attributes->find("NORMAL"), index)) {
+                    normals.emplace();
+                    if (mesh_import_status status = accessor(index, *normals);
+                        status != mesh_import_status::ok) {
+                        return status;
+                    }
+                    if (normals->components != 3 ||
+                        normals->count != positions.count) {
+                        return mesh_import_status::malformed;
+                    }
+                }
+                std::optional<accessor_view> texcoords;
+                if (std::size_t index = 0;
+                    as_index(attributes->find("TEXCOORD_0"), index)) {
+                    texcoords.emplace();
+                    if (mesh_import_status status = accessor(index, *texcoords);
+                        status != mesh_import_status::ok) {
+                        return status;
+                    }
+                    if (texcoords->components != 2 ||
+                        texcoords->count != positions.count) {
+                        return mesh_import_status::malformed;
+                    }
+                }
+
+                std::vector<std::uint32_t> indices;
+                if (std::size_t index = 0;
+                    as_index(p_primitive.find("indices"), index)) {
+                    accessor_view view;
+                    if (mesh_import_status status = accessor(index, view);
+                        status != mesh_import_status::ok) {
+                        return status;
+                    }
+                    // glTF only allows unsigned indices, an i8 or i16
+                    // accessor is as malformed as a float one.
+                    if (view.components != 1 ||
+                        (view.component_type !=
+                           static_cast<std::uint32_t>(component::u8) &&
+                         view.component_type !=
+                           static_cast<std::uint32_t>(component::u16) &&
+                         view.component_type !=
+                           static_cast<std::uint32_t>(component::u32))) {
+                        return mesh_import_status::malformed;
+                    }
+                    indices.resize(view.count);
+                    for (std::size_t i = 0; i < view.count; ++i) {
+                        indices[i] = view.read_index(i);
+                        if (indices[i] >= positions.count) {
+                            return mesh_import_status::malformed;
+                        }
+                    }
+                }
+                else {
+                    indices.resize(positions.count);
+                    for (std::size_t i = 0; i < positions.count; ++i) {
+                        indices[i] = static_cast<std::uint32_t>(i);
+                    }
+                }
+                indices.resize(indices.size() - indices.size() % 3);
+
+                auto read_vertex = [&](std::size_t p_i) {
+                    vertex_data vertex{};
+                    vertex.position = { positions.read(p_i, 0),
+                                        positions.read(p_i, 1),
+                                        positions.read(p_i, 2) };
+                    vertex.normal = normals ? float3{ normals->read(p_i, 0),
+                                                      normals->read(p_i, 1),
+                                                      normals->read(p_i, 2) }
+                                            : k_default_normal;
+                    if (texcoords) {
+                        vertex.texcoord = { texcoords->read(p_i, 0),
+                                            texcoords->read(p_i, 1) };
+                    }
+                    return vertex;
+                };
+
+                const auto base = static_cast<std::uint32_t>(p_mesh.vertices.size());
+                if (normals) {
+                    for (std::size_t i = 0; i < positions.count; ++i) {
+                        p_mesh.vertices.push_back(read_vertex(i));
+                    }
+                    for (std::uint32_t index : indices) {
+                        p_mesh.indices.push_back(base + index);
+                    }
+                    return mesh_import_status::ok;
+                }
+                // Flat normals need a vertex per corner.
+                for (std::size_t t = 0; t < indices.size(); t += 3) {
+                    vertex_data corners[3] = { read_vertex(indices[t]),
+                                               read_vertex(indices[t + 1]),
+                                               read_vertex(indices[t + 2]) };
+                    const float3 normal = face_normal(corners[0].position,
+                                                      corners[1].position,
+                                                      corners[2].position);
+                    for (vertex_data& corner : corners) {
+                        corner.normal = normal;
+                        p_mesh.indices.push_back(
+                          static_cast<std::uint32_t>(p_mesh.vertices.size()));
+                        p_mesh.vertices.push_back(corner);
+                    }
+                }
+                return mesh_import_status::ok;
+            }
+
+        private:
+            const json_value& m_root;
+            std::span<const std::byte> m_glb_binary;
+            std::filesystem::path m_base_directory;
+            std::vector<std::vector<std::byte>> m_buffers;
+        };
+
+        std::uint32_t read_u32(std::span<const std::byte> p_bytes,
+                               std::size_t p_offset) {
+            std::uint32_t value;
+            std::memcpy(&value, p_bytes.data() + p_offset, sizeof(value));
+            return value;
+        }
+
+        constexpr std::uint32_t k_glb_magic = 0x46546c67;       // "glTF"
+        constexpr std::uint32_t k_glb_json_chunk = 0x4e4f534a;  // "JSON"
+        constexpr std::uint32_t k_glb_binary_chunk = 0x004e4942; // "BIN\0"
+    }
+
+    mesh_import_status import_obj(std::string_view p_text, mesh_data& p_mesh) {
+        std::vector<float3> positions;
+        std::vector<float2> texcoords;
+        std::vector<float3> normals;
+        std::vector<obj_corner> face;
+        // Faces before a malformed line are dropped again, a failed import
+        // leaves p_mesh as it was.
+        const std::size_t vertex_count = p_mesh.vertices.size();
+        const std::size_t index_count = p_mesh.indices.size();
+        auto fail = [&] {
+            p_mesh.vertices.resize(vertex_count);
+            p_mesh.indices.resize(index_count);
+            return mesh_import_status::malformed;
+        };
+
+        while (!p_text.empty()) {
+            const std::size_t end = p_text.find('\n');
+            std::string_view line = p_text.substr(0, end);
+            p_text = end == std::string_view::npos ? std::string_view()
+                                                   : p_text.substr(end + 1);
+            line = line.substr(0, line.find('#'));
+
+            tokenizer tokens(line);
+            std::string_view keyword;
+            if (!tokens.next(keyword)) {
+                continue;
+            }
+            std::string_view token;
+            if (keyword == "v" || keyword == "vn") {
+                float xyz[3];
+                for (float& value : xyz) {
+                    if (!tokens.next(token) || !parse_float(token, value)) {
+                        return fail();
+                    }
+                }
+                (keyword == "v" ? positions : normals)
+                  .push_back({ xyz[0], xyz[1], xyz[2] });
+            }
+            else if (keyword == "vt") {
+                float uv[2] = { 0.f, 0.f };
+                if (!tokens.next(token) || !parse_float(token, uv[0])) {
+                    return fail();
+                }
+                if (tokens.next(token) && !parse_float(token, uv[1])) {
+                    return fail();
+                }
+                texcoords.push_back({ uv[0], 1.f - uv[1] });
+            }
+            else if (keyword == "f") {
+                face.clear();
+                while (tokens.next(token)) {
+                    // v, v/vt, v//vn or v/vt/vn.
+                    const std::size_t first = token.find('/');
+                    const std::size_t second =
+                      first == std::string_view::npos
+                        ? std::string_view::npos
+                        : token.find('/', first + 1);
+                    obj_corner corner;
+                    const bool ok =
+                      resolve_obj_index(token.substr(0, first),
+                                        positions.size(),
+                                        corner.position) &&
+                      corner.position >= 0 &&
+                      resolve_obj_index(
+                        first == std::string_view::npos
+                          ? std::string_view()
+                          : token.substr(first + 1, second - first - 1),
+                        texcoords.size(),
+                        corner.texcoord) &&
+                      resolve_obj_index(second == std::string_view::npos
+                                          ? std::string_view()
+                                          : token.substr(second + 1),
+                                        normals.size(),
+                                        corner.normal);
+                    if (!ok) {
+                        return fail();
+                    }
+                    face.push_back(corner);
+                }
+                if (face.size() < 3) {
+                    return fail();
+                }
+                for (std::size_t i = 1; i + 1 < face.size(); ++i) {
+                    const obj_corner corners[3] = { face[0], face[i], face[i + 1] };
+                    const float3 flat = face_normal(positions[corners[0].position],
+                                                    positions[corners[1].position],
+                                                    positions[corners[2].position]);
+                    for (const obj_corner& corner : corners) {
+                        vertex_data vertex{};
+                        vertex.position = positions[corner.position];
+                        vertex.normal = corner.normal >= 0
+                                          ? normalized_or_default(
+                                              normals[corner.normal])
+                                          : flat;
+                        if (corner.texcoord >= 0) {
+                            vertex.texcoord = texcoords[corner.texcoord];
+                        }
+                        p_mesh.indices.push_back(
+                          static_cast<std::uint32_t>(p_mesh.vertices.size()));
+                        p_mesh.vertices.push_back(vertex);
+                    }
+                }
+            }
+        }
+        return mesh_import_status::ok;
+    }
+
+    mesh_import_status import_gltf(std::span<const std::byte> p_file,
+                                   const std::filesystem::path& p_base_directory,
+                                   mesh_data& p_mesh) {
+        std::string_view json_text;
+        std::span<const std::byte> binary;
+        if (p_file.size() >= 12 && read_u32(p_file, 0) == k_glb_magic) {
+            // 12-byte header, then length/type prefixed chunks: JSON first,
+            // optionally BIN.
+            if (read_u32(p_file, 4) != 2) {
+                return mesh_import_status::unsupported;
+            }
+            const std::size_t total =
+              std::min<std::size_t>(read_u32(p_file, 8), p_file.size());
+            std::size_t at = 12;
+            while (at + 8 <= total) {
+                const std::size_t length = read_u32(p_file, at);
+                const std::uint32_t type = read_u32(p_file, at + 4);
+                if (at + 8 + length > total) {
+                    return mesh_import_status::malformed;
+                }
+                const std::span<const std::byte> chunk =
+                  p_file.subspan(at + 8, length);
+                if (type == k_glb_json_chunk && json_text.empty()) {
+                    json_text = std::string_view(
+                      reinterpret_cast<const char*>(chunk.data()), chunk.size());
+                }
+                else if (type == k_glb_binary_chunk && binary.empty()) {
+                    binary = chunk;
+                }
+                at += 8 + length;
+            }
+        }
+        else {
+            json_text = std::string_view(
+              reinterpret_cast<const char*>(p_file.data()), p_file.size());
+        }
+
+        json_value root;
+        if (json_text.empty() || !json_parser(json_text).parse(root) ||
+            root.type != json_value::kind::object) {
+            return mesh_import_status::malformed;
+        }
+        gltf_document document(root, binary, p_base_directory);
+        if (mesh_import_status status = document.load_buffers();
+            status != mesh_import_status::ok) {
+            return status;
+        }
+        const json_value* meshes = root.find("meshes");
+        if (meshes == nullptr) {
+            return mesh_import_status::ok;
+        }
+        // Primitives before a failing one are dropped again, a failed
+        // import leaves p_mesh as it was.
+        const std::size_t vertex_count = p_mesh.vertices.size();
+        const std::size_t index_count = p_mesh.indices.size();
+        auto fail = [&](mesh_import_status p_status) {
+            p_mesh.vertices.resize(vertex_count);
+            p_mesh.indices.resize(index_count);
+            return p_status;
+        };
+        for (const json_value& mesh : meshes->items) {
+            const json_value* primitives = mesh.find("primitives");
+            if (primitives == nullptr) {
+                return fail(mesh_import_status::malformed);
+            }
+            for (const json_value& primitive : primitives->items) {
+                if (mesh_import_status status =
+                      document.append_primitive(primitive, p_mesh);
+                    status != mesh_import_status::ok) {
+                    return fail(status);
+                }
+            }
+        }
+        return mesh_import_status::ok;
+    }
+
+    mesh_import_status import_mesh(const std::filesystem::path& p_path,
+                                   mesh_data& p_mesh) {
+        const std::optional<std::vector<std::byte>> file = read_file(p_path);
+        if (!file) {
+            return mesh_import_status::unreadable;
+        }
+        return import_mesh(*file, p_path, p_mesh);
+    }
+
+    mesh_import_status import_mesh(std::span<const std::byte> p_file,
+                                   const std::filesystem::path& p_path,
+                                   mesh_data& p_mesh) {
+        const std::filesystem::path extension = p_path.extension();
+        if (extension == ".obj") {
+            return import_obj(
+              std::string_view(reinterpret_cast<const char*>(p_file.data()),
+                               p_file.size()),
+              p_mesh);
+        }
+        if (extension == ".gltf" || extension == ".glb") {
+            return import_gltf(p_file, p_path.parent_path(), p_mesh);
+        }
+        return mesh_import_status::unsupported;
+    }
+
+    std::optional<std::vector<std::byte>> read_file(
+      const std::filesystem::path& p_path) {
+        std::ifstream file(p_path, std::ios::binary | std::ios::ate);
+        if (!file) {
+            return std::nullopt;
+        }
+        const std::streamoff size = file.tellg();
+        if (size < 0) {
+            return std::nullopt;
+        }
+        std::vector<std::byte> bytes(static_cast<std::size_t>(size));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(bytes.data()),
+                  static_cast<std::streamsize>(bytes.size()));
+        if (!file) {
+            return std::nullopt;
+        }
+        return bytes;
+    }
+}
@@ -0,0 +1,758 @@
+module;
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <vector>
+
+export module lib:mesh_optimizer;
+
+import :math;
+import :shader_types;
+import :mesh_import;
+
+export namespace gpu {
+    //! Post-transform cache behaviour of an index buffer.
+    struct vertex_cache_stats {
+        //! Average cache misses per triangle, 0.5 is ideal for large grids
+        //! and 3 means no reuse at all.
+        float acmr = 0.f;
+        //! Average cache misses per referenced vertex, 1 is ideal.
+        float atvr = 0.f;
+        std::size_t transforms = 0;
+    };
+
+    //! Simulates a FIFO cache of p_cache_size entries over p_indices.
+    [[nodiscard]] vertex_cache_stats analyze_vertex_cache(
+      std::span<const std::uint32_t> p_indices,
+      std::size_t p_vertex_count,
+      std::uint32_t p_cache_size = 16);
+
+    struct overdraw_stats {
+        //! Pixels covered by at least one triangle, summed over all views.
+        std::size_t covered = 0;
+        //! Fragments that passed the depth test and would be shaded.
+        std::size_t shaded = 0;
+
+        [[nodiscard]] float overdraw() const {
+            return covered == 0 ? 0.f : static_cast<float>(shaded) / covered;
+        }
+    };
+
+    /**
+     * @brief Rasterizes the mesh from the six axis directions with back
+     * face culling and a less-than depth test, counting shaded fragments.
+     *
+     * Draw order decides how many fragments an early depth test rejects, so
+     * this is what optimize_overdraw improves. A p_resolution square target
+     * per view is plenty for comparing orders of the same mesh.
+     */
+    [[nodiscard]] overdraw_stats estimate_overdraw(
+      std::span<const std::uint32_t> p_indices,
+      std::span<const shader_types::vertex_data> p_vertices,
+      std::uint32_t p_resolution = 256);
+
+    /**
+     * @brief Rasterizes the mesh once per entry of p_order, placed by that
+     * instance of p_instances and projected by p_view_projection, with the
+     * same culling and depth test into one p_resolution square target.
+     *
+     * Instance order decides how many fragments early depth rejection
+     * saves, which is what sorting visible instances front to back
+     * improves. Triangles with a corner behind the near plane are skipped
+     * rather than clipped.
+     */
+    [[nodiscard]] overdraw_stats estimate_overdraw(
+      std::span<const std::uint32_t> p_indices,
+      std::span<const shader_types::vertex_data> p_vertices,
+      std::span<const shader_types::instance_data> p_instances,
+      std::span<const std::uint32_t> p_order,
+      const math::float4x4& p_view_projection,
+      std::uint32_t p_resolution = 256);
+
+    /**
+     * @brief Merges bitwise identical vertices, -0 and +0 counting as
+     * equal, and drops vertices no index references.
+     *
+     * @return the number of vertices removed.
+     */
+    std::size_t deduplicate_vertices(mesh_data& p_mesh);
+
+    /**
+     * @brief Reorders triangles for the post-transform vertex cache using
+     * Tipsify (Sander, Nehab and Barczak 2007).
+     *
+     * Linear time: it walks fans around the most recently used vertex that
+     * will still be cached when its remaining triangles are emitted, and
+     * falls back to a dead-end stack and then a cursor when none is left.
+     */
+    void optimize_vertex_cache(std::span<std::uint32_t> p_indices,
+                               std::size_t p_vertex_count,
+                               std::uint32_t p_cache_size = 16);
+
+    /**
+     * @brief Reorders clusters of a cache-optimized index buffer so
+     * triangles likely to occlude others are drawn first.
+     *
+     * Clusters end where the cache simulation misses on all three vertices
+     * and wherever the running ACMR is within p_threshold of the cluster's,
+     * so the vertex cache efficiency drops by at most that factor. Clusters
+     * are then sorted outward-facing first by
+     * dot(centroid - mesh centroid, cluster normal).
+     */
+    void optimize_overdraw(std::span<std::uint32_t> p_indices,
+                           std::span<const shader_types::vertex_data> p_vertices,
+                           std::uint32_t p_cache_size = 16,
+                           float p_threshold = 1.05f);
+
+    /**
+     * @brief Renumbers vertices in the order the index buffer first uses
+     * them, so vertex fetch walks memory forwards. Unreferenced vertices
+     * are dropped.
+     */
+    void optimize_vertex_fetch(mesh_data& p_mesh);
+
+    enum class index_format : std::uint8_t {
+        uint16,
+        uint32,
+    };
+
+    /**
+     * @brief 16-bit indices whenever every vertex is addressable with them.
+     *
+     * 0xFFFF is the primitive restart index of MTLIndexTypeUInt16, so the
+     * last 16-bit index is 65534 and 65535 vertices is the limit.
+     */
+    [[nodiscard]] constexpr index_format choose_index_format(
+      std::size_t p_vertex_count) {
+        return p_vertex_count <= 65535 ? index_format::uint16
+                                       : index_format::uint32;
+    }
+
+    [[nodiscard]] constexpr std::size_t index_size(index_format p_format) {
+        return p_format == index_format::uint16 ? 2 : 4;
+    }
+
+    //! Narrows p_indices to p_format, which must be able to hold them all.
+    [[nodiscard]] std::vector<std::byte> encode_indices(
+      std::span<const std::uint32_t> p_indices,
+      index_format p_format);
+
+    struct mesh_optimize_options {
+        std::uint32_t cache_size = 16;
+        //! How much ACMR optimize_overdraw may give up, 1.05 is 5%.
+        float overdraw_threshold = 1.05f;
+        bool overdraw = true;
+    };
+
+    struct mesh_optimize_stats {
+        std::size_t vertices_removed = 0;
+        vertex_cache_stats before;
+        vertex_cache_stats after;
+    };
+
+    /**
+     * @brief Runs the whole pipeline in place: deduplicate, vertex cache,
+     * overdraw, vertex fetch. Stats are measured with p_options.cache_size.
+     */
+    mesh_optimize_stats optimize_mesh(mesh_data& p_mesh,
+                                      const mesh_optimize_options& p_options = {});
+}
+
+namespace gpu {
+    namespace {
+        using math::cross;
+        using math::dot;
+        using math::float3;
+        using shader_types::vertex_data;
+
+        constexpr std::uint32_t k_no_vertex =
+          std::numeric_limits<std::uint32_t>::max();
+
+        /**
+         * FIFO cache with timestamps: a vertex is cached when it missed
+         * within the last cache_size misses. reset() empties it in O(1) by
+         * jumping the clock.
+         */
+        class fifo_cache {
+        public:
+            fifo_cache(std::size_t p_vertex_count, std::uint32_t p_cache_size)
+              : m_stamps(p_vertex_count, 0)
+              , m_size(p_cache_size)
+              , m_time(p_cache_size + 1) {}
+
+            //! @return true on a miss.
+            bool access(std::uint32_t p_vertex) {
+                if (m_time - m_stamps[p_vertex] > m_size) {
+                    m_stamps[p_vertex] = m_time++;
+                    return true;
+                }
+                return false;
+            }
+
+            unsigned access_triangle(const std::uint32_t* p_triangle) {
+                return unsigned{ access(p_triangle[0]) } +
+                       access(p_triangle[1]) + access(p_triangle[2]);
+            }
+
+            void reset() { m_time += m_size + 1; }
+
+        private:
+            std::vector<std::uint64_t> m_stamps;
+            std::uint64_t m_size;
+            std::uint64_t m_time;
+        };
+
+        //! Triangles around each vertex, in CSR form.
+        struct vertex_adjacency {
+            std::vector<std::uint32_t> offsets;
+            std::vector<std::uint32_t> triangles;
+
+            vertex_adjacency(std::span<const std::uint32_t> p_indices,
+                             std::size_t p_vertex_count)
+              : offsets(p_vertex_count + 1, 0)
+              , triangles(p_indices.size()) {
+                for (std::uint32_t index : p_indices) {
+                    ++offsets[index + 1];
+                }
+                for (std::size_t v = 0; v < p_vertex_count; ++v) {
+                    offsets[v + 1] += offsets[v];
+                }
+                std::vector<std::uint32_t> fill(offsets.begin(),
+                                                offsets.end() - 1);
+                for (std::size_t i = 0; i < p_indices.size(); ++i) {
+                    triangles[fill[p_indices[i]]++] =
+                      static_cast<std::uint32_t>(i / 3);
+                }
+            }
+
+            [[nodiscard]] std::span<const std::uint32_t> around(
+              std::uint32_t p_vertex) const {
+                return std::span(triangles)
+                  .subspan(offsets[p_vertex],
+                           offsets[p_vertex + 1] - offsets[p_vertex]);
+            }
+        };
+
+        // Canonical bit patterns of every attribute, padding excluded.
+        struct vertex_key {
+            std::uint32_t bits[8];
+
+            explicit vertex_key(const vertex_data& p_vertex) {
+                const float values[8] = {
+                    p_vertex.position.x, p_vertex.position.y,
+                    p_vertex.position.z, p_vertex.normal.x,
+                    p_vertex.normal.y,   p_vertex.normal.z,
+                    p_vertex.texcoord.x, p_vertex.texcoord.y
+                };
+                for (int i = 0; i < 8; ++i) {
+                    // Adding +0 turns -0 into +0 and leaves the rest alone.
+                    bits[i] = std::bit_cast<std::uint32_t>(values[i] + 0.f);
+                }
+            }
+
+            bool operator==(const vertex_key&) const = default;
+
+            [[nodiscard]] std::uint64_t hash() const {
+                std::uint64_t h = 0x9e3779b97f4a7c15ull;
+                for (std::uint32_t b : bits) {
+                    h = (h ^ b) * 0xff51afd7ed558ccdull;
+                    h ^= h >> 32;
+                }
+                return h;
+            }
+        };
+
+        // Depth-only render target for estimate_overdraw, one view at a
+        // time.
+        class overdraw_rasterizer {
+        public:
+            explicit overdraw_rasterizer(std::uint32_t p_resolution)
+              : m_resolution(p_resolution)
+              , m_depth(std::size_t{ p_resolution } * p_resolution) {}
+
+            void clear() {
+                std::ranges::fill(m_depth,
+                                  std::numeric_limits<float>::infinity());
+            }
+
+            // p_v holds screen x, screen y and depth per corner.
+            void draw(const float (&p_v)[3][3], overdraw_stats& p_stats) {
+                const float area = edge(p_v[0], p_v[1], p_v[2][0], p_v[2][1]);
+                if (!(area > 0.f)) {
+                    return;
+                }
+                const float inverse_area = 1.f / area;
+                const auto clamp_pixel = [&](float p_value) {
+                    return static_cast<int>(std::clamp(
+                      p_value, 0.f, static_cast<float>(m_resolution - 1)));
+                };
+                const int x0 = clamp_pixel(
+                  std::floor(std::min({ p_v[0][0], p_v[1][0], p_v[2][0] })));
+                const int x1 = clamp_pixel(
+                  std::ceil(std::max({ p_v[0][0], p_v[1][0], p_v[2][0] })));
+                const int y0 = clamp_pixel(
+                  std::floor(std::min({ p_v[0][1], p_v[1][1], p_v[2][1] })));
+                const int y1 = clamp_pixel(
+                  std::ceil(std::max({ p_v[0][1], p_v[1][1], p_v[2][1] })));
+                for (int y = y0; y <= y1; ++y) {
+                    for (int x = x0; x <= x1; ++x) {
+                        const float px = static_cast<float>(x) + 0.5f;
+                        const float py = static_cast<float>(y) + 0.5f;
+                        const float w0 = edge(p_v[1], p_v[2], px, py);
+                        const float w1 = edge(p_v[2], p_v[0], px, py);
+                        const float w2 = edge(p_v[0], p_v[1], px, py);
+                        if (w0 < 0.f || w1 < 0.f || w2 < 0.f) {
+                            continue;
+                        }
+                        const float depth =
+                          (w0 * p_v[0][2] + w1 * p_v[1][2] + w2 * p_v[2][2]) *
+                          inverse_area;
+                        float& stored =
+                          m_depth[std::size_t{ static_cast<std::uint32_t>(y) } *
+                                    m_resolution +
+                                  static_cast<std::uint32_t>(x)];
+                        if (depth < stored) {
+                            p_stats.covered += std::isinf(stored) ? 1 : 0;
+                            ++p_stats.shaded;
+                            stored = depth;
+                        }
+                    }
+                }
+            }
+
+        private:
+            static float edge(const float (&p_a)[3],
+                              const float (&p_b)[3],
+                              float p_x,
+                              float p_y) {
+                return (p_b[0] - p_a[0]) * (p_y - p_a[1]) -
+                       (p_b[1] - p_a[1]) * (p_x - p_a[0]);
+            }
+
+            std::uint32_t m_resolution;
+            std::vector<float> m_depth;
+        };
+
+        // Cluster boundaries, as first triangle indices plus the end.
+        std::vector<std::size_t> overdraw_clusters(
+          std::span<const std::uint32_t> p_indices,
+          std::size_t p_vertex_count,
+          std::uint32_t p_cache_size,
+          float p_threshold) {
+            const std::size_t triangle_count = p_indices.size() / 3;
+            fifo_cache cache(p_vertex_count, p_cache_size);
+
+            // Hard boundaries: the cache effectively restarted there, so
+            // moving the cluster costs nothing.
+            std::vector<std::size_t> hard;
+            for (std::size_t t = 0; t < triangle_count; ++t) {
+                if (cache.access_triangle(&p_indices[t * 3]) == 3) {
+                    hard.push_back(t);
+                }
+            }
+            if (hard.empty() || hard.front() != 0) {
+                hard.insert(hard.begin(), 0);
+            }
+            hard.push_back(triangle_count);
+
+            // Soft boundaries: split whenever the part so far is already
+            // close to the whole cluster's efficiency.
+            std::vector<std::size_t> boundaries;
+            for (std::size_t c = 0; c + 1 < hard.size(); ++c) {
+                const std::size_t begin = hard[c];
+                const std::size_t end = hard[c + 1];
+                cache.reset();
+                std::size_t cluster_misses = 0;
+                for (std::size_t t = begin; t < end; ++t) {
+                    cluster_misses += cache.access_triangle(&p_indices[t * 3]);
+                }
+                const float target = static_cast<float>(cluster_misses) /
+                                     static_cast<float>(end - begin) *
+                                     p_threshold;
+
+                cache.reset();
+                boundaries.push_back(begin);
+                std::size_t misses = 0;
+                std::size_t triangles = 0;
+                for (std::size_t t = begin; t < end; ++t) {
+                    misses += cache.access_triangle(&p_indices[t * 3]);
+                    ++triangles;
+                    if (t + 1 < end && static_cast<float>(misses) <=
+                                         target * static_cast<float>(triangles)) {
+                        boundaries.push_back(t + 1);
+                        cache.reset();
+                        misses = 0;
+                        triangles = 0;
+                    }
+                }
+            }
+            boundaries.push_back(triangle_count);
+            return boundaries;
+        }
+    }
+
+    vertex_cache_stats analyze_vertex_cache(
+      std::span<const std::uint32_t> p_indices,
+      std::size_t p_vertex_count,
+      std::uint32_t p_cache_size) {
+        vertex_cache_stats stats;
+        fifo_cache cache(p_vertex_count, p_cache_size);
+        std::vector<bool> used(p_vertex_count, false);
+        std::size_t unique = 0;
+        for (std::uint32_t index : p_indices) {
+            stats.transforms += cache.access(index) ? 1 : 0;
+            if (!used[index]) {
+                used[index] = true;
+                ++unique;
+            }
+        }
+        const std::size_t triangles = p_indices.size() / 3;
+        stats.acmr = triangles == 0 ? 0.f
+                                    : static_cast<float>(stats.transforms) /
+                                        static_cast<float>(triangles);
+        stats.atvr = unique == 0 ? 0.f
+                                 : static_cast<float>(stats.transforms) /
+                                     static_cast<float>(unique);
+        return stats;
+    }
+
+    overdraw_stats estimate_overdraw(
+      std::span<const std::uint32_t> p_indices,
+      std::span<const vertex_data> p_vertices,
+      std::uint32_t p_resolution) {
+        overdraw_stats stats;
+        if (p_vertices.empty() || p_resolution == 0) {
+            return stats;
+        }
+        float3 low = p_vertices[0].position;
+        float3 high = low;
+        for (const vertex_data& vertex : p_vertices) {
+            low = { std::min(low.x, vertex.position.x),
+                    std::min(low.y, vertex.position.y),
+                    std::min(low.z, vertex.position.z) };
+            high = { std::max(high.x, vertex.position.x),
+                     std::max(high.y, vertex.position.y),
+                     std::max(high.z, vertex.position.z) };
+        }
+        const float extent = std::max(
+          { high.x - low.x, high.y - low.y, high.z - low.z, 1e-20f });
+        const float scale = static_cast<float>(p_resolution) / extent;
+
+        // Screen axes u, v and the axis towards the viewer w with
+        // u x v = w, so front faces stay counter-clockwise on screen.
+        struct view {
+            int u;
+            int v;
+            int w;
+            float sign;
+        };
+        constexpr view k_views[] = { { 1, 2, 0, 1.f }, { 2, 1, 0, -1.f },
+                                     { 2, 0, 1, 1.f }, { 0, 2, 1, -1.f },
+                                     { 0, 1, 2, 1.f }, { 1, 0, 2, -1.f } };
+        overdraw_rasterizer target(p_resolution);
+        for (const view& view : k_views) {
+            target.clear();
+            for (std::size_t i = 0; i + 2 < p_indices.size(); i += 3) {
+                float corners[3][3];
+                for (int c = 0; c < 3; ++c) {
+                    const float3 p = p_vertices[p_indices[i + c]].position - low;
+                    const float axes[3] = { p.x, p.y, p.z };
+                    corners[c][0] = axes[view.u] * scale;
+                    corners[c][1] = axes[view.v] * scale;
+                    corners[c][2] = -view.sign * axes[view.w];
+                }
+                target.draw(corners, stats);
+            }
+        }
+        return stats;
+    }
+
+    overdraw_stats estimate_overdraw(
+      std::span<const std::uint32_t> p_indices,
+      std::span<const vertex_data> p_vertices,
+      std::span<const shader_types::instance_data> p_instances,
+      std::span<const std::uint32_t> p_order,
+      const math::float4x4& p_view_projection,
+      std::uint32_t p_resolution) {
+        overdraw_stats stats;
+        if (p_vertices.empty() || p_resolution == 0) {
+            return stats;
+        }
+        const float half = static_cast<float>(p_resolution) * 0.5f;
+        // Screen x, screen y and depth per vertex, NaN behind the camera.
+        std::vector<std::array<float, 3>> screen(p_vertices.size());
+        overdraw_rasterizer target(p_resolution);
+        target.clear();
+        for (std::uint32_t instance : p_order) {
+            const math::float4x4 transform =
+              p_view_projection * p_instances[instance].instanceTransform;
+            for (std::size_t v = 0; v < p_vertices.size(); ++v) {
+                const float3& p = p_vertices[v].position;
+                const math::float4 clip =
+                  transform * math::float4{ p.x, p.y, p.z, 1.f };
+                if (!(clip.z >= 0.f && clip.w > 0.f)) {
+                    screen[v] = {
+                        std::numeric_limits<float>::quiet_NaN(), 0.f, 0.f
+                    };
+                    continue;
+                }
+                const float inverse_w = 1.f / clip.w;
+                screen[v] = { (clip.x * inverse_w + 1.f) * half,
+                              (clip.y * inverse_w + 1.f) * half,
+                              clip.z * inverse_w };
+            }
+            for (std::size_t i = 0; i + 2 < p_indices.size(); i += 3) {
+                float corners[3][3];
+                bool behind = false;
+                for (int c = 0; c < 3; ++c) {
+                    const std::array<float, 3>& s = screen[p_indices[i + c]];
+                    behind = behind || std::isnan(s[0]);
+                    corners[c][0] = s[0];
+                    corners[c][1] = s[1];
+                    corners[c][2] = s[2];
+                }
+                if (!behind) {
+                    target.draw(corners, stats);
+                }
+            }
+        }
+        return stats;
+    }
+
+    std::size_t deduplicate_vertices(mesh_data& p_mesh) {
+        const std::size_t vertex_count = p_mesh.vertices.size();
+        const std::size_t capacity =
+          std::bit_ceil(std::max<std::size_t>(vertex_count * 2, 16));
+        std::vector<std::uint32_t> table(capacity, k_no_vertex);
+        std::vector<std::uint32_t> remap(vertex_count, k_no_vertex);
+        std::vector<vertex_data> unique;
+        unique.reserve(vertex_count);
+
+        for (std::uint32_t& index : p_mesh.indices) {
+            if (remap[index] == k_no_vertex) {
+                const vertex_key key(p_mesh.vertices[index]);
+                std::size_t slot = key.hash() & (capacity - 1);
+                while (table[slot] != k_no_vertex &&
+                       !(vertex_key(unique[table[slot]]) == key)) {
+                    slot = (slot + 1) & (capacity - 1);
+                }
+                if (table[slot] == k_no_vertex) {
+                    table[slot] = static_cast<std::uint32_t>(unique.size());
+                    unique.push_back(p_mesh.vertices[index]);
+                }
+                remap[index] = table[slot];
+            }
+            index = remap[index];
+        }
+        p_mesh.vertices = std::move(unique);
+        return vertex_count - p_mesh.vertices.size();
+    }
+
+    void optimize_vertex_cache(std::span<std::uint32_t> p_indices,
+                               std::size_t p_vertex_count,
+                               std::uint32_t p_cache_size) {
+        const std::size_t triangle_count = p_indices.size() / 3;
+        if (triangle_count == 0) {
+            return;
+        }
+        const vertex_adjacency adjacency(p_indices.first(triangle_count * 3),
+                                         p_vertex_count);
+        std::vector<std::uint32_t> live(p_vertex_count);
+        for (std::size_t v = 0; v < p_vertex_count; ++v) {
+            live[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+        }
+        std::vector<std::uint64_t> cache_time(p_vertex_count, 0);
+        std::vector<bool> emitted(triangle_count, false);
+        std::vector<std::uint32_t> dead_end;
+        std::vector<std::uint32_t> candidates;
+        std::vector<std::uint32_t> output;
+        output.reserve(triangle_count * 3);
+        std::uint64_t time = p_cache_size + 1;
+        std::size_t cursor = 0;
+
+        const auto skip_dead_end = [&]() -> std::uint32_t {
+            while (!dead_end.empty()) {
+                const std::uint32_t v = dead_end.back();
+                dead_end.pop_back();
+                if (live[v] > 0) {
+                    return v;
+                }
+            }
+            while (cursor < p_vertex_count) {
+                if (live[cursor] > 0) {
+                    return static_cast<std::uint32_t>(cursor);
+                }
+                ++cursor;
+            }
+            return k_no_vertex;
+        };
+
+        std::uint32_t fan = skip_dead_end();
+        while (fan != k_no_vertex) {
+            candidates.clear();
+            for (std::uint32_t t : adjacency.around(fan)) {
+                if (emitted[t]) {
+                    continue;
+                }
+                emitted[t] = true;
+                for (int c = 0; c < 3; ++c) {
+                    const std::uint32_t v = p_indices[t * 3 + c];
+                    output.push_back(v);
+                    dead_end.push_back(v);
+                    candidates.push_back(v);
+                    --live[v];
+                    if (time - cache_time[v] > p_cache_size) {
+                        cache_time[v] = time++;
+                    }
+                }
+            }
+
+            // Prefer the oldest candidate that stays cached while its
+            // remaining triangles are emitted, each adding up to two misses.
+            std::uint32_t best = k_no_vertex;
+            std::uint64_t best_priority = 0;
+            for (std::uint32_t v : candidates) {
+                if (live[v] == 0) {
+                    continue;
+                }
+                std::uint64_t priority = 1;
+                if (time - cache_time[v] + 2 * std::uint64_t{ live[v] } <=
+                    p_cache_size) {
+                    priority = time - cache_time[v] + 1;
+                }
+                if (priority > best_priority) {
+                    best = v;
+                    best_priority = priority;
+                }
+            }
+            fan = best != k_no_vertex ? best : skip_dead_end();
+        }
+        std::ranges::copy(output, p_indices.begin());
+    }
+
+    void optimize_overdraw(std::span<std::uint32_t> p_indices,
+                           std::span<const vertex_data> p_vertices,
+                           std::uint32_t p_cache_size,
+                           float p_threshold) {
+        const std::size_t triangle_count = p_indices.size() / 3;
+        if (triangle_count < 2) {
+            return;
+        }
+        const std::vector<std::size_t> boundaries = overdraw_clusters(
+          p_indices, p_vertices.size(), p_cache_size, p_threshold);
+        const std::size_t cluster_count = boundaries.size() - 1;
+
+        // Area-weighted centroids and normals of the mesh and each cluster.
+        std::vector<float3> centroids(cluster_count, float3{});
+        std::vector<float3> normals(cluster_count, float3{});
+        float3 mesh_centroid{};
+        float mesh_area = 0.f;
+        for (std::size_t c = 0; c < cluster_count; ++c) {
+            float cluster_area = 0.f;
+            for (std::size_t t = boundaries[c]; t < boundaries[c + 1]; ++t) {
+                const float3& a = p_vertices[p_indices[t * 3]].position;
+                const float3& b = p_vertices[p_indices[t * 3 + 1]].position;
+                const float3& d = p_vertices[p_indices[t * 3 + 2]].position;
+                const float3 normal = cross(b - a, d - a);
+                const float area = std::sqrt(dot(normal, normal));
+                centroids[c] = centroids[c] + (a + b + d) * (area / 3.f);
+                normals[c] = normals[c] + normal;
+                cluster_area += area;
+            }
+            mesh_centroid = mesh_centroid + centroids[c];
+            mesh_area += cluster_area;
+            if (cluster_area > 0.f) {
+                centroids[c] = centroids[c] * (1.f / cluster_area);
+            }
+        }
+        if (mesh_area > 0.f) {
+            mesh_centroid = mesh_centroid * (1.f / mesh_area);
+        }
+
+        struct sort_entry {
+            float key;
+            std::uint32_t cluster;
+        };
+        std::vector<sort_entry> order(cluster_count);
+        for (std::size_t c = 0; c < cluster_count; ++c) {
+            const float length = std::sqrt(dot(normals[c], normals[c]));
+            const float3 normal =
+              length > 0.f ? normals[c] * (1.f / length) : float3{};
+            order[c] = { dot(centroids[c] - mesh_centroid, normal),
+                         static_cast<std::uint32_t>(c) };
+        }
+        std::ranges::stable_sort(order, [](const sort_entry& p_a,
+                                           const sort_entry& p_b) {
+            return p_a.key > p_b.key;
+        });
+
+        std::vector<std::uint32_t> output;
+        output.reserve(triangle_count * 3);
+        for (const sort_entry& entry : order) {
+            output.insert(output.end(),
+                          p_indices.begin() +
+                            static_cast<std::ptrdiff_t>(
+                              boundaries[entry.cluster] * 3),
+                          p_indices.begin() +
+                            static_cast<std::ptrdiff_t>(
+                              boundaries[entry.cluster + 1] * 3));
+        }
+        std::ranges::copy(output, p_indices.begin());
+    }
+
+    void optimize_vertex_fetch(mesh_data& p_mesh) {
+        std::vector<std::uint32_t> remap(p_mesh.vertices.size(), k_no_vertex);
+        std::vector<vertex_data> ordered;
+        ordered.reserve(p_mesh.vertices.size());
+        for (std::uint32_t& index : p_mesh.indices) {
+            if (remap[index] == k_no_vertex) {
+                remap[index] = static_cast<std::uint32_t>(ordered.size());
+                ordered.push_back(p_mesh.vertices[index]);
+            }
+            index = remap[index];
+        }
+        p_mesh.vertices = std::move(ordered);
+    }
+
+    std::vector<std::byte> encode_indices(
+      std::span<const std::uint32_t> p_indices,
+      index_format p_format) {
+        std::vector<std::byte> bytes(p_indices.size() * index_size(p_format));
+        if (p_format == index_format::uint32) {
+            std::memcpy(bytes.data(), p_indices.data(), bytes.size());
+            return bytes;
+        }
+        for (std::size_t i = 0; i < p_indices.size(); ++i) {
+            const auto index = static_cast<std::uint16_t>(p_indices[i]);
+            std::memcpy(&bytes[i * 2], &index, sizeof(index));
+        }
+        return bytes;
+    }
+
+    mesh_optimize_stats optimize_mesh(mesh_data& p_mesh,
+                                      const mesh_optimize_options& p_options) {
+        mesh_optimize_stats stats;
+        stats.before = analyze_vertex_cache(
+          p_mesh.indices, p_mesh.vertices.size(), p_options.cache_size);
+        stats.vertices_removed = deduplicate_vertices(p_mesh);
+        optimize_vertex_cache(
+          p_mesh.indices, p_mesh.vertices.size(), p_options.cache_size);
+        if (p_options.overdraw) {
+            optimize_overdraw(p_mesh.indices,
+                              p_mesh.vertices,
+                              p_options.cache_size,
+                              p_options.overdraw_threshold);
+        }
+        optimize_vertex_fetch(p_mesh);
+        stats.after = analyze_vertex_cache(
+          p_mesh.indices, p_mesh.vertices.size(), p_options.cache_size);
+        return stats;
+    }
+}
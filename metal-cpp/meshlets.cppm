@@ -0,0 +1,393 @@
+module;
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <vector>
+
+export module lib:meshlets;
+
+import :math;
+import :shader_types;
+import :culling;
+
+export namespace gpu {
+    struct meshlet_limits {
+        //! At most 256, local indices are stored in a byte.
+        std::uint32_t max_vertices = 64;
+        //! 124 leaves a 64-vertex meshlet's primitive block 4-byte aligned.
+        std::uint32_t max_triangles = 124;
+        //! Weight of normal agreement against shared vertices when picking
+        //! the next triangle. 0 packs for vertex reuse alone, higher values
+        //! give tighter cones at the cost of more meshlets.
+        float cone_weight = 0.25f;
+    };
+
+    /**
+     * @brief One cluster: meshlet_data::vertices[vertex_offset...] are its
+     * mesh vertices and meshlet_data::triangles[triangle_offset...] its
+     * triangles, three local vertex indices each.
+     */
+    struct meshlet {
+        std::uint32_t vertex_offset = 0;
+        std::uint32_t triangle_offset = 0;
+        std::uint32_t vertex_count = 0;
+        std::uint32_t triangle_count = 0;
+    };
+
+    struct meshlet_data {
+        std::vector<meshlet> meshlets;
+        std::vector<std::uint32_t> vertices;
+        std::vector<std::uint8_t> triangles;
+        //! Bounds of meshlets[i], in mesh space.
+        std::vector<math::cluster_bounds> bounds;
+    };
+
+    /**
+     * @brief Bounding sphere of the vertices p_indices reference and
+     * normal cone of its triangles, which face outward when wound counter
+     * clockwise. Degenerate triangles do not widen the cone.
+     */
+    [[nodiscard]] math::cluster_bounds compute_cluster_bounds(
+      std::span<const std::uint32_t> p_indices,
+      std::span<const shader_types::vertex_data> p_vertices);
+
+    /**
+     * @brief Splits the triangle list p_indices into meshlets within
+     * p_limits, each with its bounds.
+     *
+     * Meshlets grow greedily from a seed triangle, adding the neighbour
+     * that brings in the fewest new vertices and best matches the normals
+     * so far. When no neighbour fits, growth continues with the next unused
+     * triangle along a Morton curve of triangle centroids, which also picks
+     * the seeds, so flat shaded meshes and disconnected parts still pack
+     * spatially coherent meshlets.
+     */
+    [[nodiscard]] meshlet_data build_meshlets(
+      std::span<const std::uint32_t> p_indices,
+      std::span<const shader_types::vertex_data> p_vertices,
+      const meshlet_limits& p_limits = {});
+}
+
+namespace gpu {
+    namespace {
+        using math::cross;
+        using math::dot;
+        using math::float3;
+
+        constexpr std::uint16_t k_no_local = 0xffff;
+
+        // Triangles around each vertex, compressed rows.
+        struct meshlet_adjacency {
+            std::vector<std::uint32_t> offsets;
+            std::vector<std::uint32_t> triangles;
+
+            meshlet_adjacency(std::span<const std::uint32_t> p_indices,
+                              std::size_t p_vertex_count)
+              : offsets(p_vertex_count + 1, 0)
+              , triangles(p_indices.size()) {
+                for (std::uint32_t index : p_indices) {
+                    ++offsets[index + 1];
+                }
+                std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+                std::vector<std::uint32_t> fill(offsets.begin(),
+                                                offsets.end() - 1);
+                for (std::size_t i = 0; i < p_indices.size(); ++i) {
+                    triangles[fill[p_indices[i]]++] =
+                      static_cast<std::uint32_t>(i / 3);
+                }
+            }
+
+            [[nodiscard]] std::span<const std::uint32_t> around(
+              std::uint32_t p_vertex) const {
+                return std::span(triangles).subspan(
+                  offsets[p_vertex], offsets[p_vertex + 1] - offsets[p_vertex]);
+            }
+        };
+
+        float3 triangle_normal(const float3& p_a,
+                               const float3& p_b,
+                               const float3& p_c) {
+            const float3 n = cross(p_b - p_a, p_c - p_a);
+            const float n_length = math::length(n);
+            return n_length > 0.f ? n * (1.f / n_length) : float3{};
+        }
+
+        // Spreads the low 10 bits of p_v two bits apart.
+        std::uint32_t spread_bits(std::uint32_t p_v) {
+            p_v &= 0x3ff;
+            p_v = (p_v | (p_v << 16)) & 0x030000ff;
+            p_v = (p_v | (p_v << 8)) & 0x0300f00f;
+            p_v = (p_v | (p_v << 4)) & 0x030c30c3;
+            p_v = (p_v | (p_v << 2)) & 0x09249249;
+            return p_v;
+        }
+
+        // Triangles sorted along a Morton curve of their centroids.
+        std::vector<std::uint32_t> morton_order(std::span<const float3> p_centroids) {
+            float3 low = { std::numeric_limits<float>::max(),
+                           std::numeric_limits<float>::max(),
+                           std::numeric_limits<float>::max() };
+            float3 high = -low;
+            for (const float3& c : p_centroids) {
+                low = { std::min(low.x, c.x), std::min(low.y, c.y),
+                        std::min(low.z, c.z) };
+                high = { std::max(high.x, c.x), std::max(high.y, c.y),
+                         std::max(high.z, c.z) };
+            }
+            const float extent =
+              std::max({ high.x - low.x, high.y - low.y, high.z - low.z });
+            const float scale = extent > 0.f ? 1023.f / extent : 0.f;
+
+            std::vector<std::uint64_t> keyed(p_centroids.size());
+            for (std::size_t t = 0; t < p_centroids.size(); ++t) {
+                const float3 q = (p_centroids[t] - low) * scale;
+                const std::uint32_t code =
+                  spread_bits(static_cast<std::uint32_t>(q.x)) |
+                  spread_bits(static_cast<std::uint32_t>(q.y)) << 1 |
+                  spread_bits(static_cast<std::uint32_t>(q.z)) << 2;
+                keyed[t] = std::uint64_t{ code } << 32 | t;
+            }
+            std::ranges::sort(keyed);
+            std::vector<std::uint32_t> order(keyed.size());
+            for (std::size_t t = 0; t < keyed.size(); ++t) {
+                order[t] = static_cast<std::uint32_t>(keyed[t]);
+            }
+            return order;
+        }
+    }
+
+    math::cluster_bounds compute_cluster_bounds(
+      std::span<const std::uint32_t> p_indices,
+      std::span<const shader_types::vertex_data> p_vertices) {
+        math::cluster_bounds bounds;
+        if (p_indices.empty()) {
+            return bounds;
+        }
+        auto position = [&](std::uint32_t p_index) {
+            return p_vertices[p_index].position;
+        };
+
+        // Ritter's sphere: start from the farthest apart pair of the axis
+        // extremes, then grow to take in every point left outside.
+        auto component = [](const float3& p_v, int p_axis) {
+            return p_axis == 0 ? p_v.x : p_axis == 1 ? p_v.y : p_v.z;
+        };
+        std::uint32_t extremes[6];
+        std::ranges::fill(extremes, p_indices[0]);
+        for (std::uint32_t index : p_indices) {
+            const float3 p = position(index);
+            for (int axis = 0; axis < 3; ++axis) {
+                const float value = component(p, axis);
+                if (value < component(position(extremes[axis * 2]), axis)) {
+                    extremes[axis * 2] = index;
+                }
+                if (value > component(position(extremes[axis * 2 + 1]), axis)) {
+                    extremes[axis * 2 + 1] = index;
+                }
+            }
+        }
+        float3 from = position(extremes[0]);
+        float3 to = position(extremes[1]);
+        for (int axis = 1; axis < 3; ++axis) {
+            const float3 a = position(extremes[axis * 2]);
+            const float3 b = position(extremes[axis * 2 + 1]);
+            if (dot(b - a, b - a) > dot(to - from, to - from)) {
+                from = a;
+                to = b;
+            }
+        }
+        float3 center = (from + to) * 0.5f;
+        float radius = math::length(to - from) * 0.5f;
+        for (std::uint32_t index : p_indices) {
+            const float3 offset = position(index) - center;
+            const float distance = math::length(offset);
+            if (distance > radius) {
+                const float grown = (radius + distance) * 0.5f;
+                center = center + offset * ((grown - radius) / distance);
+                radius = grown;
+            }
+        }
+        bounds.center = center;
+        // Covers the rounding of the growth steps above.
+        bounds.radius = radius * (1.f + 1e-5f);
+
+        // The cone is taken around the average normal. Clusters with a
+        // normal 84 degrees or more away from it would get a cone so narrow
+        // it hardly ever culls, so they skip the test.
+        float3 sum{};
+        for (std::size_t i = 0; i + 2 < p_indices.size(); i += 3) {
+            sum = sum + triangle_normal(position(p_indices[i]),
+                                        position(p_indices[i + 1]),
+                                        position(p_indices[i + 2]));
+        }
+        const float sum_length = math::length(sum);
+        if (sum_length <= 0.f) {
+            return bounds;
+        }
+        const float3 axis = sum * (1.f / sum_length);
+        float min_dot = 1.f;
+        for (std::size_t i = 0; i + 2 < p_indices.size(); i += 3) {
+            const float3 n = triangle_normal(position(p_indices[i]),
+                                             position(p_indices[i + 1]),
+                                             position(p_indices[i + 2]));
+            if (dot(n, n) > 0.f) {
+                min_dot = std::min(min_dot, dot(n, axis));
+            }
+        }
+        if (min_dot <= 0.1f) {
+            return bounds;
+        }
+        bounds.cone_axis = axis;
+        // The view directions that see every normal from behind form the
+        // cone around axis whose half angle complements the normals' own.
+        bounds.cone_cutoff = std::sqrt(1.f - min_dot * min_dot);
+        return bounds;
+    }
+
+    meshlet_data build_meshlets(std::span<const std::uint32_t> p_indices,
+                                std::span<const shader_types::vertex_data> p_vertices,
+                                const meshlet_limits& p_limits) {
+        const std::uint32_t max_vertices =
+          std::clamp<std::uint32_t>(p_limits.max_vertices, 3, 256);
+        const std::uint32_t max_triangles =
+          std::max<std::uint32_t>(p_limits.max_triangles, 1);
+        const std::size_t triangle_count = p_indices.size() / 3;
+        const std::span<const std::uint32_t> indices =
+          p_indices.first(triangle_count * 3);
+
+        std::vector<float3> normals(triangle_count);
+        std::vector<float3> centroids(triangle_count);
+        for (std::size_t t = 0; t < triangle_count; ++t) {
+            const float3 a = p_vertices[indices[t * 3]].position;
+            const float3 b = p_vertices[indices[t * 3 + 1]].position;
+            const float3 c = p_vertices[indices[t * 3 + 2]].position;
+            normals[t] = triangle_normal(a, b, c);
+            centroids[t] = (a + b + c) * (1.f / 3.f);
+        }
+        const meshlet_adjacency adjacency(indices, p_vertices.size());
+        const std::vector<std::uint32_t> order = morton_order(centroids);
+
+        meshlet_data result;
+        std::vector<std::uint16_t> local(p_vertices.size(), k_no_local);
+        std::vector<bool> used(triangle_count, false);
+        std::vector<std::uint32_t> candidates;
+        std::vector<std::uint32_t> cluster_indices;
+        std::size_t next_seed = 0;
+        meshlet current;
+        float3 normal_sum{};
+
+        auto new_vertices = [&](std::uint32_t p_triangle) {
+            std::uint32_t count = 0;
+            for (int k = 0; k < 3; ++k) {
+                count += local[indices[p_triangle * 3 + k]] == k_no_local;
+            }
+            return count;
+        };
+        auto flush = [&] {
+            if (current.triangle_count == 0) {
+                return;
+            }
+            cluster_indices.clear();
+            for (std::uint32_t i = 0; i < current.triangle_count * 3; ++i) {
+                cluster_indices.push_back(
+                  result.vertices[current.vertex_offset +
+                                  result.triangles[current.triangle_offset * 3 + i]]);
+            }
+            result.bounds.push_back(
+              compute_cluster_bounds(cluster_indices, p_vertices));
+            for (std::uint32_t i = 0; i < current.vertex_count; ++i) {
+                local[result.vertices[current.vertex_offset + i]] = k_no_local;
+            }
+            result.meshlets.push_back(current);
+            current = { static_cast<std::uint32_t>(result.vertices.size()),
+                        static_cast<std::uint32_t>(result.triangles.size() / 3),
+                        0,
+                        0 };
+            candidates.clear();
+            normal_sum = {};
+        };
+        auto add = [&](std::uint32_t p_triangle) {
+            used[p_triangle] = true;
+            for (int k = 0; k < 3; ++k) {
+                const std::uint32_t vertex = indices[p_triangle * 3 + k];
+                if (local[vertex] == k_no_local) {
+                    local[vertex] = static_cast<std::uint16_t>(current.vertex_count++);
+                    result.vertices.push_back(vertex);
+                    const std::span<const std::uint32_t> around =
+                      adjacency.around(vertex);
+                    candidates.insert(candidates.end(), around.begin(), around.end());
+                }
+                result.triangles.push_back(static_cast<std::uint8_t>(local[vertex]));
+            }
+            ++current.triangle_count;
+            normal_sum = normal_sum + normals[p_triangle];
+        };
+        // Next unused triangle along the curve, or triangle_count.
+        auto seed = [&]() -> std::uint32_t {
+            while (next_seed < order.size() && used[order[next_seed]]) {
+                ++next_seed;
+            }
+            return next_seed < order.size()
+                     ? order[next_seed]
+                     : static_cast<std::uint32_t>(triangle_count);
+        };
+
+        while (true) {
+            if (current.triangle_count == max_triangles) {
+                flush();
+            }
+            if (current.triangle_count == 0) {
+                const std::uint32_t first = seed();
+                if (first == triangle_count) {
+                    break;
+                }
+                add(first);
+                continue;
+            }
+
+            const float normal_length = math::length(normal_sum);
+            const float3 axis = normal_length > 0.f
+                                  ? normal_sum * (1.f / normal_length)
+                                  : float3{};
+            std::uint32_t best = static_cast<std::uint32_t>(triangle_count);
+            float best_score = std::numeric_limits<float>::max();
+            std::size_t live = 0;
+            for (std::uint32_t triangle : candidates) {
+                if (used[triangle]) {
+                    continue;
+                }
+                candidates[live++] = triangle;
+                const std::uint32_t extra = new_vertices(triangle);
+                if (current.vertex_count + extra > max_vertices) {
+                    continue;
+                }
+                const float score =
+                  static_cast<float>(extra) +
+                  p_limits.cone_weight * (1.f - dot(normals[triangle], axis));
+                if (score < best_score) {
+                    best_score = score;
+                    best = triangle;
+                }
+            }
+            candidates.resize(live);
+
+            if (best == triangle_count) {
+                const std::uint32_t next = seed();
+                if (next == triangle_count ||
+                    current.vertex_count + new_vertices(next) > max_vertices) {
+                    flush();
+                    continue;
+                }
+                best = next;
+            }
+            add(best);
+        }
+        flush();
+        return result;
+    }
+}
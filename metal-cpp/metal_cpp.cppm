@@ -5,6 +5,37 @@ module;
 
 export module lib;
 
+export import :math;
+export import :simd;
+export import :transcendental;
+export import :shader_types;
+export import :instance_transforms;
+export import :normal_transforms;
+export import :job_system;
+export import :build_graph;
+export import :frame_allocator;
+export import :dirty_ranges;
+export import :instance_packing;
+export import :instance_store;
+export import :ref;
+export import :autorelease_arena;
+export import :atomic_file;
+export import :pipeline_cache;
+export import :compute_dispatch;
+export import :mandelbrot;
+export import :mandelbrot_cache;
+export import :threadgroup_tuner;
+export import :mip_chain;
+export import :vertex_packing;
+export import :mesh_import;
+export import :mesh_optimizer;
+export import :asset_file;
+export import :mesh_cache;
+export import :culling;
+export import :meshlets;
+export import :bvh;
+export import :depth_sort;
+
 export void print_hello() {
     std::println("hello, library_template");
 }
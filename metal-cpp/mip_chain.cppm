@@ -0,0 +1,699 @@
+module;
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <numbers>
+#include <span>
+#include <vector>
+
+export module lib:mip_chain;
+
+import :simd;
+import :job_system;
+
+export namespace gpu {
+    enum class texel_format : std::uint8_t {
+        //! MTL::PixelFormatRGBA8Unorm, red in the lowest byte.
+        rgba8_unorm,
+        //! MTL::PixelFormatRGBA16Float.
+        rgba16_float,
+    };
+
+    enum class mip_filter : std::uint8_t {
+        //! 2x2 average, what generateMipmaps does.
+        box,
+        /**
+         * Kaiser-windowed sinc (alpha 4) over 6x6 texels. Keeps more detail
+         * than the box and aliases less, at the cost of slight ringing.
+         */
+        kaiser,
+    };
+
+    [[nodiscard]] constexpr std::size_t texel_bytes(texel_format p_format) {
+        return p_format == texel_format::rgba8_unorm ? 4 : 8;
+    }
+
+    //! @return levels down to 1x1, the mipmapLevelCount of a full chain.
+    [[nodiscard]] std::uint32_t mip_level_count(std::uint32_t p_width,
+                                                std::uint32_t p_height);
+
+    struct mip_level {
+        std::uint32_t width = 0;
+        std::uint32_t height = 0;
+        //! Byte offset of the level in the chain's storage.
+        std::size_t offset = 0;
+        //! Rows are tightly packed, the bytesPerRow of replaceRegion.
+        std::size_t row_bytes = 0;
+
+        [[nodiscard]] std::size_t bytes() const { return row_bytes * height; }
+    };
+
+    //! Every level of a texture back to back, level 0 first.
+    struct mip_chain_layout {
+        texel_format format = texel_format::rgba8_unorm;
+        std::vector<mip_level> levels;
+        std::size_t bytes = 0;
+
+        //! p_level_count 0 means the full chain.
+        [[nodiscard]] static mip_chain_layout make(texel_format p_format,
+                                                   std::uint32_t p_width,
+                                                   std::uint32_t p_height,
+                                                   std::uint32_t p_level_count = 0);
+    };
+
+    /**
+     * @brief Builds the next level, max(1, p_width / 2) x
+     * max(1, p_height / 2) texels, from p_source into p_destination.
+     *
+     * Texels past the last full 2x2 footprint of an odd dimension are
+     * dropped, like generateMipmaps, and the filter clamps at the edges.
+     * Rows are spread over p_jobs and processed simd::lanes texels at a
+     * time. The box filter on rgba8_unorm averages bytes in integer
+     * registers, every other case filters in float, separably.
+     */
+    void downsample(jobs::scheduler& p_jobs,
+                    texel_format p_format,
+                    mip_filter p_filter,
+                    std::span<const std::byte> p_source,
+                    std::uint32_t p_width,
+                    std::uint32_t p_height,
+                    std::span<std::byte> p_destination);
+
+    //! One texel at a time, the scalar definition downsample is checked
+    //! against.
+    void downsample_reference(texel_format p_format,
+                              mip_filter p_filter,
+                              std::span<const std::byte> p_source,
+                              std::uint32_t p_width,
+                              std::uint32_t p_height,
+                              std::span<std::byte> p_destination);
+
+    //! Fills levels 1 and up of p_storage from level 0.
+    void build_mip_chain(jobs::scheduler& p_jobs,
+                         const mip_chain_layout& p_layout,
+                         mip_filter p_filter,
+                         std::span<std::byte> p_storage);
+
+    //! IEEE binary16 conversions, rounding to nearest even.
+    [[nodiscard]] std::uint16_t float_to_half(float p_value);
+    [[nodiscard]] float half_to_float(std::uint16_t p_half);
+}
+
+namespace gpu {
+    namespace {
+        using namespace math::simd;
+
+        // Lowest and highest horizontal tap offsets, the planar rows are
+        // padded by these many replicated edge texels.
+        constexpr std::uint32_t k_pad_left = 2;
+        constexpr std::uint32_t k_pad_right = 3;
+        constexpr std::size_t k_max_taps = 6;
+        constexpr double k_kaiser_alpha = 4.0;
+
+        struct filter_taps {
+            //! Offset of the first tap from 2 * destination index.
+            int first;
+            std::size_t count;
+            std::array<float, k_max_taps> weights;
+        };
+
+        double bessel_i0(double p_x) {
+            double sum = 1.0;
+            double term = 1.0;
+            for (int k = 1; k < 32; ++k) {
+                const double half = p_x / (2.0 * k);
+                term *= half * half;
+                sum += term;
+            }
+            return sum;
+        }
+
+        const filter_taps& taps_of(mip_filter p_filter) {
+            static const filter_taps box = { 0, 2, { 0.5f, 0.5f } };
+            static const filter_taps kaiser = [] {
+                filter_taps taps = { -2, k_max_taps, {} };
+                std::array<double, k_max_taps> weights{};
+                double sum = 0.0;
+                for (std::size_t i = 0; i < k_max_taps; ++i) {
+                    // Source texel centre minus destination texel centre,
+                    // in source texels.
+                    const double distance =
+                      static_cast<double>(taps.first) + static_cast<double>(i) -
+                      0.5;
+                    const double x = std::numbers::pi * distance / 2.0;
+                    const double ratio = distance / 3.0;
+                    weights[i] = std::sin(x) / x *
+                                 bessel_i0(k_kaiser_alpha *
+                                           std::sqrt(1.0 - ratio * ratio)) /
+                                 bessel_i0(k_kaiser_alpha);
+                    sum += weights[i];
+                }
+                for (std::size_t i = 0; i < k_max_taps; ++i) {
+                    taps.weights[i] = static_cast<float>(weights[i] / sum);
+                }
+                return taps;
+            }();
+            return p_filter == mip_filter::box ? box : kaiser;
+        }
+
+        std::uint32_t clamp_index(std::int64_t p_index, std::uint32_t p_size) {
+            return static_cast<std::uint32_t>(
+              std::clamp<std::int64_t>(p_index, 0, p_size - 1));
+        }
+
+        std::uint32_t load_u32(const std::byte* p_src) {
+            std::uint32_t value;
+            std::memcpy(&value, p_src, sizeof(value));
+            return value;
+        }
+
+        void store_u32(std::byte* p_dst, std::uint32_t p_value) {
+            std::memcpy(p_dst, &p_value, sizeof(p_value));
+        }
+
+        // Channels of texel p_x as floats, 0-255 for rgba8_unorm.
+        void decode_texel(texel_format p_format,
+                          const std::byte* p_row,
+                          std::uint32_t p_x,
+                          float (&p_channels)[4]) {
+            if (p_format == texel_format::rgba8_unorm) {
+                const std::uint32_t texel = load_u32(p_row + p_x * 4);
+                for (int c = 0; c < 4; ++c) {
+                    p_channels[c] =
+                      static_cast<float>((texel >> (8 * c)) & 0xff);
+                }
+                return;
+            }
+            const std::uint32_t rg = load_u32(p_row + p_x * 8);
+            const std::uint32_t ba = load_u32(p_row + p_x * 8 + 4);
+            p_channels[0] = half_to_float(static_cast<std::uint16_t>(rg));
+            p_channels[1] = half_to_float(static_cast<std::uint16_t>(rg >> 16));
+            p_channels[2] = half_to_float(static_cast<std::uint16_t>(ba));
+            p_channels[3] = half_to_float(static_cast<std::uint16_t>(ba >> 16));
+        }
+
+        void encode_texel(texel_format p_format,
+                          std::byte* p_row,
+                          std::uint32_t p_x,
+                          const float (&p_channels)[4]) {
+            if (p_format == texel_format::rgba8_unorm) {
+                std::uint32_t texel = 0;
+                for (int c = 0; c < 4; ++c) {
+                    const auto value = static_cast<std::uint32_t>(
+                      std::nearbyint(std::clamp(p_channels[c], 0.f, 255.f)));
+                    texel |= value << (8 * c);
+                }
+                store_u32(p_row + p_x * 4, texel);
+                return;
+            }
+            const auto half = [&](int p_channel) {
+                return static_cast<std::uint32_t>(
+                  float_to_half(p_channels[p_channel]));
+            };
+            store_u32(p_row + p_x * 8, half(0) | (half(1) << 16));
+            store_u32(p_row + p_x * 8 + 4, half(2) | (half(3) << 16));
+        }
+
+        // Rounded 2x2 byte average, the same expression the SWAR path
+        // evaluates two channels at a time.
+        std::uint32_t box_rgba8(std::uint32_t p_a,
+                                std::uint32_t p_b,
+                                std::uint32_t p_c,
+                                std::uint32_t p_d) {
+            std::uint32_t result = 0;
+            for (int c = 0; c < 4; ++c) {
+                const int shift = 8 * c;
+                const std::uint32_t sum =
+                  ((p_a >> shift) & 0xff) + ((p_b >> shift) & 0xff) +
+                  ((p_c >> shift) & 0xff) + ((p_d >> shift) & 0xff);
+                result |= ((sum + 2) >> 2) << shift;
+            }
+            return result;
+        }
+
+        vfloat half_to_float(vint p_half) {
+            const vint magnitude = (p_half & vint::splat(0x7fff)) << 13;
+            const vint exponent = magnitude & vint::splat(0x0f800000);
+            const vint normal = magnitude + vint::splat(0x38000000);
+            // Inf and NaN keep an all-ones exponent.
+            const vint special = normal + vint::splat(0x38000000);
+            // Subnormals renormalize through a float subtraction.
+            const vint subnormal = as_int(
+              as_float(normal + vint::splat(1 << 23)) -
+              as_float(vint::splat(113 << 23)));
+            vint bits = select(exponent == vint::splat(0x0f800000), special,
+                               normal);
+            bits = select(exponent == vint::splat(0), subnormal, bits);
+            return as_float(bits | ((p_half & vint::splat(0x8000)) << 16));
+        }
+
+        vint float_to_half(vfloat p_value) {
+            const vint bits = as_int(p_value);
+            const vint sign = bits & vint::splat(static_cast<int32_t>(0x80000000u));
+            const vint magnitude = bits ^ sign;
+
+            const vint overflow = select(magnitude > vint::splat(0x7f800000),
+                                         vint::splat(0x7e00),
+                                         vint::splat(0x7c00));
+            const vint subnormal =
+              as_int(as_float(magnitude) + as_float(vint::splat(0x3f000000))) -
+              vint::splat(0x3f000000);
+            // Round to nearest even: add half an ulp minus one, plus the
+            // lowest kept mantissa bit.
+            const vint odd = (magnitude >> 13) & vint::splat(1);
+            const vint normal =
+              (magnitude + vint::splat(static_cast<int32_t>(0xc8000fffu)) + odd) >>
+              13;
+
+            vint half = select(vint::splat(0x38800000) > magnitude, subnormal,
+                               normal);
+            half = select(magnitude > vint::splat(0x477fffff), overflow, half);
+            return half | (sign >> 16);
+        }
+
+        // Planar float copy of one vertically filtered source row, padded
+        // with replicated edge texels so horizontal taps need no clamping.
+        class filter_rows {
+        public:
+            explicit filter_rows(std::uint32_t p_width)
+              : m_stride(p_width + k_pad_left + k_pad_right + 2 * lanes)
+              , m_planes(4 * m_stride) {}
+
+            [[nodiscard]] float* plane(int p_channel) {
+                return m_planes.data() + p_channel * m_stride;
+            }
+
+            void vertical(texel_format p_format,
+                          const filter_taps& p_taps,
+                          std::span<const std::byte> p_source,
+                          std::uint32_t p_width,
+                          std::uint32_t p_height,
+                          std::uint32_t p_y) {
+                const std::size_t row_bytes = p_width * texel_bytes(p_format);
+                std::array<const std::byte*, k_max_taps> rows{};
+                for (std::size_t k = 0; k < p_taps.count; ++k) {
+                    const std::uint32_t y = clamp_index(
+                      std::int64_t{ 2 } * p_y + p_taps.first +
+                        static_cast<std::int64_t>(k),
+                      p_height);
+                    rows[k] = p_source.data() + y * row_bytes;
+                }
+                float* planes[4] = { plane(0) + k_pad_left,
+                                     plane(1) + k_pad_left,
+                                     plane(2) + k_pad_left,
+                                     plane(3) + k_pad_left };
+
+                std::uint32_t x = 0;
+                for (; x + lanes <= p_width; x += lanes) {
+                    vfloat sums[4];
+                    for (std::size_t k = 0; k < p_taps.count; ++k) {
+                        vfloat channels[4];
+                        decode(p_format, rows[k], x, channels);
+                        const vfloat weight = vfloat::splat(p_taps.weights[k]);
+                        for (int c = 0; c < 4; ++c) {
+                            sums[c] = k == 0 ? weight * channels[c]
+                                             : sums[c] + weight * channels[c];
+                        }
+                    }
+                    for (int c = 0; c < 4; ++c) {
+                        sums[c].store(planes[c] + x);
+                    }
+                }
+                for (; x < p_width; ++x) {
+                    float sums[4] = {};
+                    for (std::size_t k = 0; k < p_taps.count; ++k) {
+                        float channels[4];
+                        decode_texel(p_format, rows[k], x, channels);
+                        for (int c = 0; c < 4; ++c) {
+                            sums[c] = k == 0 ? p_taps.weights[k] * channels[c]
+                                             : sums[c] +
+                                                 p_taps.weights[k] * channels[c];
+                        }
+                    }
+                    for (int c = 0; c < 4; ++c) {
+                        planes[c][x] = sums[c];
+                    }
+                }
+
+                for (int c = 0; c < 4; ++c) {
+                    std::fill(planes[c] - k_pad_left, planes[c], planes[c][0]);
+                    std::fill(planes[c] + p_width,
+                              planes[c] + p_width + k_pad_right + 2 * lanes,
+                              planes[c][p_width - 1]);
+                }
+            }
+
+            void horizontal(texel_format p_format,
+                            const filter_taps& p_taps,
+                            std::uint32_t p_width,
+                            std::byte* p_row) {
+                const float* planes[4] = { plane(0) + k_pad_left,
+                                           plane(1) + k_pad_left,
+                                           plane(2) + k_pad_left,
+                                           plane(3) + k_pad_left };
+                std::uint32_t x = 0;
+                for (; x + lanes <= p_width; x += lanes) {
+                    vfloat sums[4];
+                    // Taps come in pairs: one deinterleave yields the
+                    // samples of tap k in the even and of k + 1 in the
+                    // odd elements.
+                    for (std::size_t k = 0; k < p_taps.count; k += 2) {
+                        const std::ptrdiff_t at =
+                          std::ptrdiff_t{ 2 } * x + p_taps.first +
+                          static_cast<std::ptrdiff_t>(k);
+                        const vfloat w0 = vfloat::splat(p_taps.weights[k]);
+                        const vfloat w1 = vfloat::splat(p_taps.weights[k + 1]);
+                        for (int c = 0; c < 4; ++c) {
+                            vfloat even;
+                            vfloat odd;
+                            deinterleave(vfloat::load(planes[c] + at),
+                                         vfloat::load(planes[c] + at + lanes),
+                                         even,
+                                         odd);
+                            const vfloat pair = w0 * even;
+                            sums[c] = k == 0 ? pair + w1 * odd
+                                             : sums[c] + pair + w1 * odd;
+                        }
+                    }
+                    encode(p_format, p_row, x, sums);
+                }
+                for (; x < p_width; ++x) {
+                    float sums[4] = {};
+                    for (std::size_t k = 0; k < p_taps.count; k += 2) {
+                        const std::ptrdiff_t at =
+                          std::ptrdiff_t{ 2 } * x + p_taps.first +
+                          static_cast<std::ptrdiff_t>(k);
+                        for (int c = 0; c < 4; ++c) {
+                            const float pair = p_taps.weights[k] * planes[c][at];
+                            sums[c] =
+                              k == 0
+                                ? pair + p_taps.weights[k + 1] * planes[c][at + 1]
+                                : sums[c] + pair +
+                                    p_taps.weights[k + 1] * planes[c][at + 1];
+                        }
+                    }
+                    encode_texel(p_format, p_row, x, sums);
+                }
+            }
+
+        private:
+            static void decode(texel_format p_format,
+                               const std::byte* p_row,
+                               std::uint32_t p_x,
+                               vfloat (&p_channels)[4]) {
+                const vint byte = vint::splat(0xff);
+                if (p_format == texel_format::rgba8_unorm) {
+                    const vint texels = vint::load(
+                      reinterpret_cast<const int32_t*>(p_row + p_x * 4));
+                    for (int c = 0; c < 4; ++c) {
+                        p_channels[c] = to_float((texels >> (8 * c)) & byte);
+                    }
+                    return;
+                }
+                const auto* words =
+                  reinterpret_cast<const int32_t*>(p_row + p_x * 8);
+                vint rg;
+                vint ba;
+                deinterleave(
+                  vint::load(words), vint::load(words + lanes), rg, ba);
+                const vint low = vint::splat(0xffff);
+                p_channels[0] = half_to_float(rg & low);
+                p_channels[1] = half_to_float(rg >> 16);
+                p_channels[2] = half_to_float(ba & low);
+                p_channels[3] = half_to_float(ba >> 16);
+            }
+
+            static void encode(texel_format p_format,
+                               std::byte* p_row,
+                               std::uint32_t p_x,
+                               const vfloat (&p_channels)[4]) {
+                if (p_format == texel_format::rgba8_unorm) {
+                    vint texels = vint::splat(0);
+                    for (int c = 0; c < 4; ++c) {
+                        const vfloat clamped = min(
+                          max(p_channels[c], vfloat::splat(0.f)),
+                          vfloat::splat(255.f));
+                        texels = texels | (to_int(clamped) << (8 * c));
+                    }
+                    texels.store(reinterpret_cast<int32_t*>(p_row + p_x * 4));
+                    return;
+                }
+                const vint rg = float_to_half(p_channels[0]) |
+                                (float_to_half(p_channels[1]) << 16);
+                const vint ba = float_to_half(p_channels[2]) |
+                                (float_to_half(p_channels[3]) << 16);
+                vint lo;
+                vint hi;
+                interleave(rg, ba, lo, hi);
+                auto* words = reinterpret_cast<int32_t*>(p_row + p_x * 8);
+                lo.store(words);
+                hi.store(words + lanes);
+            }
+
+            std::size_t m_stride;
+            std::vector<float> m_planes;
+        };
+
+        // Box filter on rgba8_unorm, red/blue and green/alpha bytes summed
+        // in 16-bit halves of each lane.
+        void box_rgba8_row(const std::byte* p_row0,
+                           const std::byte* p_row1,
+                           std::uint32_t p_width,
+                           std::uint32_t p_out_width,
+                           std::byte* p_out) {
+            const vint mask = vint::splat(0x00ff00ff);
+            const vint rounding = vint::splat(0x00020002);
+            const auto* top = reinterpret_cast<const int32_t*>(p_row0);
+            const auto* bottom = reinterpret_cast<const int32_t*>(p_row1);
+            auto* out = reinterpret_cast<int32_t*>(p_out);
+
+            std::uint32_t x = 0;
+            // Every footprint of a vector lies inside the row.
+            for (; 2 * (x + lanes) <= p_width; x += lanes) {
+                vint a;
+                vint b;
+                vint c;
+                vint d;
+                deinterleave(vint::load(top + 2 * x),
+                             vint::load(top + 2 * x + lanes),
+                             a,
+                             b);
+                deinterleave(vint::load(bottom + 2 * x),
+                             vint::load(bottom + 2 * x + lanes),
+                             c,
+                             d);
+                const vint even = (a & mask) + (b & mask) + (c & mask) +
+                                  (d & mask) + rounding;
+                const vint odd = ((a >> 8) & mask) + ((b >> 8) & mask) +
+                                 ((c >> 8) & mask) + ((d >> 8) & mask) +
+                                 rounding;
+                (((even >> 2) & mask) | (((odd >> 2) & mask) << 8))
+                  .store(out + x);
+            }
+            for (; x < p_out_width; ++x) {
+                const std::uint32_t left = std::min(2 * x, p_width - 1);
+                const std::uint32_t right = std::min(2 * x + 1, p_width - 1);
+                store_u32(p_out + x * 4,
+                          box_rgba8(load_u32(p_row0 + left * 4),
+                                    load_u32(p_row0 + right * 4),
+                                    load_u32(p_row1 + left * 4),
+                                    load_u32(p_row1 + right * 4)));
+            }
+        }
+    }
+
+    std::uint32_t mip_level_count(std::uint32_t p_width, std::uint32_t p_height) {
+        return static_cast<std::uint32_t>(
+          std::bit_width(std::max({ p_width, p_height, 1u })));
+    }
+
+    mip_chain_layout mip_chain_layout::make(texel_format p_format,
+                                            std::uint32_t p_width,
+                                            std::uint32_t p_height,
+                                            std::uint32_t p_level_count) {
+        const std::uint32_t full = mip_level_count(p_width, p_height);
+        const std::uint32_t count =
+          p_level_count == 0 ? full : std::min(p_level_count, full);
+        mip_chain_layout layout;
+        layout.format = p_format;
+        std::uint32_t width = std::max(p_width, 1u);
+        std::uint32_t height = std::max(p_height, 1u);
+        for (std::uint32_t level = 0; level < count; ++level) {
+            const mip_level entry = { width,
+                                      height,
+                                      layout.bytes,
+                                      width * texel_bytes(p_format) };
+            layout.levels.push_back(entry);
+            layout.bytes += entry.bytes();
+            width = std::max(width / 2, 1u);
+            height = std::max(height / 2, 1u);
+        }
+        return layout;
+    }
+
+    void downsample(jobs::scheduler& p_jobs,
+                    texel_format p_format,
+                    mip_filter p_filter,
+                    std::span<const std::byte> p_source,
+                    std::uint32_t p_width,
+                    std::uint32_t p_height,
+                    std::span<std::byte> p_destination) {
+        const std::uint32_t out_width = std::max(p_width / 2, 1u);
+        const std::uint32_t out_height = std::max(p_height / 2, 1u);
+        const std::size_t row_bytes = p_width * texel_bytes(p_format);
+        const std::size_t out_row_bytes = out_width * texel_bytes(p_format);
+        const filter_taps& taps = taps_of(p_filter);
+
+        // About 4096 destination texels per job.
+        const std::size_t grain = std::max<std::size_t>(4096 / out_width, 1);
+        p_jobs.parallel_for(
+          out_height, grain, [&](std::size_t p_begin, std::size_t p_end) {
+              if (p_format == texel_format::rgba8_unorm &&
+                  p_filter == mip_filter::box) {
+                  for (std::size_t y = p_begin; y < p_end; ++y) {
+                      const std::size_t top =
+                        std::min<std::size_t>(2 * y, p_height - 1);
+                      const std::size_t bottom =
+                        std::min<std::size_t>(2 * y + 1, p_height - 1);
+                      box_rgba8_row(p_source.data() + top * row_bytes,
+                                    p_source.data() + bottom * row_bytes,
+                                    p_width,
+                                    out_width,
+                                    p_destination.data() + y * out_row_bytes);
+                  }
+                  return;
+              }
+              filter_rows rows(p_width);
+              for (std::size_t y = p_begin; y < p_end; ++y) {
+                  rows.vertical(p_format,
+                                taps,
+                                p_source,
+                                p_width,
+                                p_height,
+                                static_cast<std::uint32_t>(y));
+                  rows.horizontal(p_format,
+                                  taps,
+                                  out_width,
+                                  p_destination.data() + y * out_row_bytes);
+              }
+          });
+    }
+
+    void downsample_reference(texel_format p_format,
+                              mip_filter p_filter,
+                              std::span<const std::byte> p_source,
+                              std::uint32_t p_width,
+                              std::uint32_t p_height,
+                              std::span<std::byte> p_destination) {
+        const std::uint32_t out_width = std::max(p_width / 2, 1u);
+        const std::uint32_t out_height = std::max(p_height / 2, 1u);
+        const std::size_t row_bytes = p_width * texel_bytes(p_format);
+        const std::size_t out_row_bytes = out_width * texel_bytes(p_format);
+        const filter_taps& taps = taps_of(p_filter);
+        auto row = [&](std::int64_t p_y) {
+            return p_source.data() + clamp_index(p_y, p_height) * row_bytes;
+        };
+
+        for (std::uint32_t y = 0; y < out_height; ++y) {
+            std::byte* out = p_destination.data() + y * out_row_bytes;
+            for (std::uint32_t x = 0; x < out_width; ++x) {
+                if (p_format == texel_format::rgba8_unorm &&
+                    p_filter == mip_filter::box) {
+                    const std::uint32_t left = std::min(2 * x, p_width - 1);
+                    const std::uint32_t right = std::min(2 * x + 1, p_width - 1);
+                    const std::byte* top = row(std::int64_t{ 2 } * y);
+                    const std::byte* bottom = row(std::int64_t{ 2 } * y + 1);
+                    store_u32(out + x * 4,
+                              box_rgba8(load_u32(top + left * 4),
+                                        load_u32(top + right * 4),
+                                        load_u32(bottom + left * 4),
+                                        load_u32(bottom + right * 4)));
+                    continue;
+                }
+
+                // Separable: each column of the footprint is filtered
+                // vertically, then the columns horizontally.
+                float sums[4] = {};
+                for (std::size_t t = 0; t < taps.count; ++t) {
+                    const std::uint32_t column = clamp_index(
+                      std::int64_t{ 2 } * x + taps.first +
+                        static_cast<std::int64_t>(t),
+                      p_width);
+                    float column_sums[4] = {};
+                    for (std::size_t k = 0; k < taps.count; ++k) {
+                        float channels[4];
+                        decode_texel(p_format,
+                                     row(std::int64_t{ 2 } * y + taps.first +
+                                         static_cast<std::int64_t>(k)),
+                                     column,
+                                     channels);
+                        for (int c = 0; c < 4; ++c) {
+                            column_sums[c] += taps.weights[k] * channels[c];
+                        }
+                    }
+                    for (int c = 0; c < 4; ++c) {
+                        sums[c] += taps.weights[t] * column_sums[c];
+                    }
+                }
+                encode_texel(p_format, out, x, sums);
+            }
+        }
+    }
+
+    void build_mip_chain(jobs::scheduler& p_jobs,
+                         const mip_chain_layout& p_layout,
+                         mip_filter p_filter,
+                         std::span<std::byte> p_storage) {
+        for (std::size_t level = 1; level < p_layout.levels.size(); ++level) {
+            const mip_level& source = p_layout.levels[level - 1];
+            const mip_level& destination = p_layout.levels[level];
+            downsample(p_jobs,
+                       p_layout.format,
+                       p_filter,
+                       p_storage.subspan(source.offset, source.bytes()),
+                       source.width,
+                       source.height,
+                       p_storage.subspan(destination.offset, destination.bytes()));
+        }
+    }
+
+    std::uint16_t float_to_half(float p_value) {
+        const auto bits = std::bit_cast<std::uint32_t>(p_value);
+        const std::uint32_t sign = bits & 0x80000000u;
+        const std::uint32_t magnitude = bits ^ sign;
+        std::uint32_t half;
+        if (magnitude > 0x477fffffu) {
+            half = magnitude > 0x7f800000u ? 0x7e00u : 0x7c00u;
+        }
+        else if (magnitude < 0x38800000u) {
+            half = std::bit_cast<std::uint32_t>(
+                     std::bit_cast<float>(magnitude) +
+                     std::bit_cast<float>(0x3f000000u)) -
+                   0x3f000000u;
+        }
+        else {
+            half = (magnitude + 0xc8000fffu + ((magnitude >> 13) & 1)) >> 13;
+        }
+        return static_cast<std::uint16_t>(half | (sign >> 16));
+    }
+
+    float half_to_float(std::uint16_t p_half) {
+        const std::uint32_t magnitude = (p_half & 0x7fffu) << 13;
+        const std::uint32_t exponent = magnitude & 0x0f800000u;
+        std::uint32_t bits = magnitude + 0x38000000u;
+        if (exponent == 0x0f800000u) {
+            bits += 0x38000000u;
+        }
+        else if (exponent == 0) {
+            bits = std::bit_cast<std::uint32_t>(
+              std::bit_cast<float>(bits + (1u << 23)) -
+              std::bit_cast<float>(113u << 23));
+        }
+        return std::bit_cast<float>(bits | ((p_half & 0x8000u) << 16));
+    }
+}
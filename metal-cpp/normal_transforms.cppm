@@ -0,0 +1,253 @@
+module;
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <span>
+
+export module lib:normal_transforms;
+
+import :math;
+import :simd;
+import :shader_types;
+
+export namespace math {
+    /**
+     * @brief Inverse transpose of the upper 3x3 of p_transform, what
+     * normals need under non-uniform scale and shear where
+     * discard_translation is only right for rotation and uniform scale.
+     *
+     * Singular matrices have no inverse, they get the cofactor matrix, the
+     * adjugate transposed, which still maps normals of the surviving
+     * directions sensibly.
+     */
+    [[nodiscard]] float3x3 normal_transform(const float4x4& p_transform);
+
+    /**
+     * @brief normal_transform for every element of p_transforms into
+     * p_out, simd::lanes matrices at a time.
+     *
+     * Blocks whose matrices are all rotation times uniform scale, mirrors
+     * included, take a fast path: there the inverse transpose is the
+     * matrix itself divided by the squared scale. Other blocks go through
+     * cofactors and the determinant. Matrices only uniform within the
+     * detection tolerance are off by at most about 1e-5, relative.
+     */
+    void normal_transforms(std::span<const float4x4> p_transforms,
+                           std::span<float3x3> p_out);
+
+    //! Recomputes every instanceNormalTransform from its instanceTransform.
+    void update_normal_transforms(
+      std::span<shader_types::instance_data> p_instances);
+}
+
+namespace math {
+    namespace {
+        using simd::vfloat;
+        using simd::vmask;
+
+        // Matrices with squared column lengths and pairwise dot products
+        // this close, relative to the first column's, count as uniform.
+        constexpr float k_uniform_tolerance = 1e-5f;
+        // Smaller determinants are treated as singular.
+        constexpr float k_singular_determinant = 1e-30f;
+
+        constexpr std::size_t k_float3x3_floats = sizeof(float3x3) / sizeof(float);
+
+        // Matrices are read and written simd::lanes floats at a time, one
+        // register per matrix and group of floats, and a square transpose
+        // turns those into one register per element. Results are the
+        // first 12 floats of a matrix, float3 being padded to four.
+        constexpr std::size_t k_groups = 12 / simd::lanes + (12 % simd::lanes != 0);
+        static_assert(16 % simd::lanes == 0);
+
+        vfloat dot_lanes(const vfloat (&p_a)[3], const vfloat (&p_b)[3]) {
+            return simd::fma(p_a[0], p_b[0],
+                             simd::fma(p_a[1], p_b[1], p_a[2] * p_b[2]));
+        }
+
+        void cross_lanes(const vfloat (&p_a)[3],
+                         const vfloat (&p_b)[3],
+                         vfloat (&p_out)[3]) {
+            p_out[0] = p_a[1] * p_b[2] - p_a[2] * p_b[1];
+            p_out[1] = p_a[2] * p_b[0] - p_a[0] * p_b[2];
+            p_out[2] = p_a[0] * p_b[1] - p_a[1] * p_b[0];
+        }
+
+        // Writes group p_group of one result. With 8 lanes the last group
+        // would run past the result, so it goes through the stack.
+        void store_group(vfloat p_v, std::size_t p_group, float* p_result) {
+            constexpr std::size_t lanes = simd::lanes;
+            if (12 - p_group * lanes >= lanes) {
+                p_v.store(p_result + p_group * lanes);
+            }
+            else {
+                alignas(32) float last[lanes];
+                p_v.store(last);
+                std::memcpy(p_result + p_group * lanes, last,
+                            (12 - p_group * lanes) * sizeof(float));
+            }
+        }
+
+        // Inverse transpose of simd::lanes matrices, p_stride floats apart,
+        // into float3x3s p_out_stride floats apart.
+        void normal_block(const float* p_in,
+                          std::size_t p_stride,
+                          float* p_out,
+                          std::size_t p_out_stride) {
+            constexpr std::size_t lanes = simd::lanes;
+
+            // groups[g][e] holds element g * lanes + e of every matrix.
+            vfloat groups[k_groups][lanes];
+            for (std::size_t g = 0; g < k_groups; ++g) {
+                for (std::size_t j = 0; j < lanes; ++j) {
+                    groups[g][j] = vfloat::load(p_in + j * p_stride + g * lanes);
+                }
+                simd::transpose(groups[g]);
+            }
+            auto element = [&](int p_c, int p_r) -> vfloat& {
+                const std::size_t e = p_c * 4 + p_r;
+                return groups[e / lanes][e % lanes];
+            };
+            // m[c][r] holds element (r, c) of every matrix.
+            vfloat m[3][3];
+            for (int c = 0; c < 3; ++c) {
+                for (int r = 0; r < 3; ++r) {
+                    m[c][r] = element(c, r);
+                }
+            }
+
+            const vfloat scale = dot_lanes(m[0], m[0]);
+            const vfloat tolerance = scale * vfloat::splat(k_uniform_tolerance);
+            const vmask uniform =
+              (simd::abs(dot_lanes(m[1], m[1]) - scale) <= tolerance) &
+              (simd::abs(dot_lanes(m[2], m[2]) - scale) <= tolerance) &
+              (simd::abs(dot_lanes(m[0], m[1])) <= tolerance) &
+              (simd::abs(dot_lanes(m[0], m[2])) <= tolerance) &
+              (simd::abs(dot_lanes(m[1], m[2])) <= tolerance) &
+              (scale > vfloat::splat(0.f));
+            if (simd::all(uniform)) {
+                // Each result is its matrix scaled, straight from the rows
+                // as loaded, without transposing back.
+                alignas(32) float inverse[lanes];
+                (vfloat::splat(1.f) / scale).store(inverse);
+                for (std::size_t j = 0; j < lanes; ++j) {
+                    const vfloat factor = vfloat::splat(inverse[j]);
+                    const float* matrix = p_in + j * p_stride;
+                    for (std::size_t g = 0; g < k_groups; ++g) {
+                        store_group(vfloat::load(matrix + g * lanes) * factor, g,
+                                    p_out + j * p_out_stride);
+                    }
+                }
+                return;
+            }
+
+            vfloat out[3][3];
+            cross_lanes(m[1], m[2], out[0]);
+            cross_lanes(m[2], m[0], out[1]);
+            cross_lanes(m[0], m[1], out[2]);
+            const vfloat determinant = dot_lanes(m[0], out[0]);
+            const vfloat inverse = simd::select(
+              simd::abs(determinant) > vfloat::splat(k_singular_determinant),
+              vfloat::splat(1.f) / determinant,
+              vfloat::splat(1.f));
+            for (int c = 0; c < 3; ++c) {
+                for (int r = 0; r < 3; ++r) {
+                    element(c, r) = out[c][r] * inverse;
+                }
+                element(c, 3) = vfloat::splat(0.f);
+            }
+            for (std::size_t g = 0; g < k_groups; ++g) {
+                simd::transpose(groups[g]);
+                for (std::size_t j = 0; j < lanes; ++j) {
+                    store_group(groups[g][j], g, p_out + j * p_out_stride);
+                }
+            }
+        }
+
+        // A last, partial block: padded with identities, which keep the
+        // uniform path open, and copied out.
+        void normal_tail(const float4x4* p_in,
+                         std::size_t p_stride,
+                         std::size_t p_count,
+                         float3x3* p_out,
+                         std::size_t p_out_stride) {
+            float4x4 padded[simd::lanes];
+            std::fill_n(padded, simd::lanes, make_identity());
+            for (std::size_t j = 0; j < p_count; ++j) {
+                std::memcpy(&padded[j], &p_in->columns[0].x + j * p_stride,
+                            sizeof(float4x4));
+            }
+            float3x3 results[simd::lanes];
+            normal_block(&padded[0].columns[0].x, 16, &results[0].columns[0].x,
+                         k_float3x3_floats);
+            for (std::size_t j = 0; j < p_count; ++j) {
+                std::memcpy(&p_out->columns[0].x + j * p_out_stride, &results[j],
+                            sizeof(float3x3));
+            }
+        }
+
+        // normal_transforms over p_count matrices with any strides.
+        void normal_strided(const float4x4* p_in,
+                            std::size_t p_stride,
+                            std::size_t p_count,
+                            float3x3* p_out,
+                            std::size_t p_out_stride) {
+            const float* in = &p_in->columns[0].x;
+            float* out = &p_out->columns[0].x;
+            if constexpr (simd::lanes == 1) {
+                // Without registers to fill, detecting uniform scale costs
+                // more than it saves.
+                for (std::size_t i = 0; i < p_count; ++i) {
+                    const float3x3 result = normal_transform(
+                      *reinterpret_cast<const float4x4*>(in + i * p_stride));
+                    std::memcpy(out + i * p_out_stride, &result, sizeof(result));
+                }
+                return;
+            }
+            std::size_t i = 0;
+            for (; i + simd::lanes <= p_count; i += simd::lanes) {
+                normal_block(in + i * p_stride, p_stride, out + i * p_out_stride,
+                             p_out_stride);
+            }
+            if (i < p_count) {
+                normal_tail(reinterpret_cast<const float4x4*>(in + i * p_stride),
+                            p_stride, p_count - i,
+                            reinterpret_cast<float3x3*>(out + i * p_out_stride),
+                            p_out_stride);
+            }
+        }
+    }
+
+    float3x3 normal_transform(const float4x4& p_transform) {
+        const float3 c0 = p_transform.columns[0].xyz();
+        const float3 c1 = p_transform.columns[1].xyz();
+        const float3 c2 = p_transform.columns[2].xyz();
+        const float3 x = cross(c1, c2);
+        const float determinant = dot(c0, x);
+        const float inverse = std::abs(determinant) > k_singular_determinant
+                                ? 1.f / determinant
+                                : 1.f;
+        return { { x * inverse, cross(c2, c0) * inverse,
+                   cross(c0, c1) * inverse } };
+    }
+
+    void normal_transforms(std::span<const float4x4> p_transforms,
+                           std::span<float3x3> p_out) {
+        normal_strided(p_transforms.data(), 16, p_transforms.size(),
+                       p_out.data(), k_float3x3_floats);
+    }
+
+    void update_normal_transforms(
+      std::span<shader_types::instance_data> p_instances) {
+        if (p_instances.empty()) {
+            return;
+        }
+        constexpr std::size_t stride =
+          sizeof(shader_types::instance_data) / sizeof(float);
+        normal_strided(&p_instances[0].instanceTransform, stride,
+                       p_instances.size(),
+                       &p_instances[0].instanceNormalTransform, stride);
+    }
+}
@@ -0,0 +1,493 @@
+module;
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+export module lib:pipeline_cache;
+
+import :atomic_file;
+
+export namespace gpu {
+    //! 64-bit identity of a compiled pipeline artifact.
+    struct pipeline_key {
+        std::uint64_t value = 0;
+
+        [[nodiscard]] std::string hex() const {
+            return std::format("{:016x}", value);
+        }
+
+        bool operator==(const pipeline_key&) const = default;
+    };
+
+    /**
+     * @brief FNV-1a accumulator for everything a compiled pipeline depends
+     * on: shader source, compile options and the descriptor state.
+     *
+     * Every add() is length- or type-prefixed, so ("ab", "c") and
+     * ("a", "bc") hash differently.
+     */
+    class pipeline_hasher {
+    public:
+        pipeline_hasher& add(std::span<const std::byte> p_bytes) {
+            add_raw(static_cast<std::uint64_t>(p_bytes.size()));
+            for (std::byte b : p_bytes) {
+                m_state = (m_state ^ static_cast<std::uint8_t>(b)) * k_prime;
+            }
+            return *this;
+        }
+
+        pipeline_hasher& add(std::string_view p_text) {
+            return add(std::as_bytes(std::span(p_text)));
+        }
+
+        template<typename T>
+            requires std::is_integral_v<T> || std::is_enum_v<T>
+        pipeline_hasher& add(T p_value) {
+            add_raw(static_cast<std::uint64_t>(p_value));
+            return *this;
+        }
+
+        [[nodiscard]] pipeline_key finish() const { return { m_state }; }
+
+    private:
+        static constexpr std::uint64_t k_offset = 0xcbf29ce484222325ull;
+        static constexpr std::uint64_t k_prime = 0x100000001b3ull;
+
+        void add_raw(std::uint64_t p_value) {
+            for (int i = 0; i < 8; ++i) {
+                m_state = (m_state ^ ((p_value >> (8 * i)) & 0xff)) * k_prime;
+            }
+        }
+
+        std::uint64_t m_state = k_offset;
+    };
+
+    struct pipeline_cache_options {
+        //! Bump when the artifact format or the compiler changes, every entry
+        //! written under another version is discarded on open.
+        std::uint32_t version = 1;
+        //! Least recently used entries are evicted past this size.
+        std::uintmax_t max_bytes = 64ull << 20;
+    };
+
+    struct pipeline_cache_stats {
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+        std::size_t stores = 0;
+        std::size_t evictions = 0;
+        //! Entries dropped because their payload no longer matched.
+        std::size_t corrupt = 0;
+    };
+
+    /**
+     * @brief Versioned on-disk store of compiled pipeline artifacts.
+     *
+     * Each artifact is one raw file, <key>.bin, so loaders that want a path
+     * (MTL::BinaryArchive, for one) can open it in place through find().
+     * Sizes, checksums and LRU order live in a small text index. Payloads
+     * and the index are both written to a temporary file and renamed into
+     * place, so a crash leaves either the old or the new state and at worst
+     * an orphaned payload, which a later open removes.
+     *
+     * Several processes may share a directory. The index is rewritten
+     * under a file lock and merged with what others stored in the
+     * meantime, and opening only sweeps unindexed files old enough that no
+     * live writer can still own them. Entries another process evicted
+     * show up here as misses.
+     *
+     * The cache is an optimization, so I/O failures only ever turn into
+     * misses.
+     */
+    class pipeline_cache {
+    public:
+        explicit pipeline_cache(std::filesystem::path p_directory,
+                                pipeline_cache_options p_options = {});
+
+        ~pipeline_cache() { flush(); }
+
+        pipeline_cache(const pipeline_cache&) = delete;
+        pipeline_cache& operator=(const pipeline_cache&) = delete;
+
+        //! @return the verified payload for p_key, or nullopt on a miss.
+        [[nodiscard]] std::optional<std::vector<std::byte>> load(
+          const pipeline_key& p_key);
+
+        /**
+         * @brief Path of the payload for p_key, for loaders that read files
+         * themselves. Only the size is checked, not the checksum.
+         */
+        [[nodiscard]] std::optional<std::filesystem::path> find(
+          const pipeline_key& p_key);
+
+        //! Atomically writes p_payload, then evicts down to max_bytes.
+        bool store(const pipeline_key& p_key,
+                   std::span<const std::byte> p_payload);
+
+        void invalidate(const pipeline_key& p_key);
+        void clear();
+
+        /**
+         * @brief Returns the cached payload, or compiles, stores and returns
+         * it. p_compile() must return something convertible to
+         * std::vector<std::byte>.
+         */
+        template<typename Compile>
+        std::vector<std::byte> load_or_compile(const pipeline_key& p_key,
+                                               Compile&& p_compile) {
+            if (auto cached = load(p_key)) {
+                return std::move(*cached);
+            }
+            std::vector<std::byte> compiled = p_compile();
+            store(p_key, compiled);
+            return compiled;
+        }
+
+        //! Writes the index if LRU order changed since the last write.
+        void flush();
+
+        [[nodiscard]] const pipeline_cache_stats& stats() const {
+            return m_stats;
+        }
+        [[nodiscard]] std::uintmax_t size_bytes() const { return m_bytes; }
+        [[nodiscard]] std::size_t entry_count() const {
+            return m_entries.size();
+        }
+        [[nodiscard]] const std::filesystem::path& directory() const {
+            return m_directory;
+        }
+
+    private:
+        struct entry {
+            std::uintmax_t size;
+            std::uint64_t checksum;
+            std::uint64_t last_used;
+        };
+
+        using entry_map = std::unordered_map<std::uint64_t, entry>;
+
+        [[nodiscard]] std::filesystem::path payload_path(
+          std::uint64_t p_key) const;
+        [[nodiscard]] std::optional<entry_map> read_index() const;
+        void merge(const entry_map& p_entries);
+        void write_index();
+        void remove_entry(std::uint64_t p_key);
+        void evict();
+
+        std::filesystem::path m_directory;
+        pipeline_cache_options m_options;
+        entry_map m_entries;
+        std::uintmax_t m_bytes = 0;
+        std::uint64_t m_clock = 0;
+        bool m_index_dirty = false;
+        pipeline_cache_stats m_stats;
+    };
+
+    /**
+     * @brief Compiler stand-in for hosts without Metal.
+     *
+     * Produces a deterministic artifact derived from the source and counts
+     * how often it ran, which is what cache tests assert on.
+     */
+    class fake_shader_compiler {
+    public:
+        std::vector<std::byte> operator()(std::string_view p_source) {
+            ++m_compile_count;
+            const std::uint64_t digest =
+              pipeline_hasher{}.add(p_source).finish().value;
+            std::vector<std::byte> artifact;
+            const std::string_view magic = "FAKEAIR";
+            for (char c : magic) {
+                artifact.push_back(static_cast<std::byte>(c));
+            }
+            for (int i = 0; i < 8; ++i) {
+                artifact.push_back(static_cast<std::byte>(digest >> (8 * i)));
+            }
+            for (char c : p_source) {
+                artifact.push_back(static_cast<std::byte>(c));
+            }
+            return artifact;
+        }
+
+        [[nodiscard]] std::size_t compile_count() const {
+            return m_compile_count;
+        }
+
+    private:
+        std::size_t m_compile_count = 0;
+    };
+}
+
+namespace gpu {
+    namespace {
+        constexpr std::string_view k_index_name = "index";
+        constexpr std::string_view k_index_magic = "pipeline-cache";
+        constexpr std::string_view k_lock_name = "index.lock";
+        // Unindexed files younger than this may belong to a store in
+        // flight in another process.
+        constexpr auto k_orphan_age = std::chrono::minutes(10);
+
+        std::uint64_t checksum(std::span<const std::byte> p_bytes) {
+            return pipeline_hasher{}.add(p_bytes).finish().value;
+        }
+    }
+
+    pipeline_cache::pipeline_cache(std::filesystem::path p_directory,
+                                   pipeline_cache_options p_options)
+      : m_directory(std::move(p_directory))
+      , m_options(p_options) {
+        std::error_code error;
+        std::filesystem::create_directories(m_directory, error);
+        const file_lock lock(m_directory / k_lock_name);
+        if (const std::optional<entry_map> stored = read_index()) {
+            merge(*stored);
+        }
+        else {
+            m_index_dirty = true;
+        }
+
+        // Drop what the index does not vouch for once it is old enough:
+        // payloads from other versions, orphans from an interrupted store
+        // and stale temporaries.
+        const auto now = std::filesystem::file_time_type::clock::now();
+        std::vector<std::filesystem::path> unknown;
+        for (const auto& file :
+             std::filesystem::directory_iterator(m_directory, error)) {
+            const std::filesystem::path& path = file.path();
+            if (path.filename() == k_index_name ||
+                path.filename() == k_lock_name) {
+                continue;
+            }
+            const std::string stem = path.stem().string();
+            std::uint64_t key = 0;
+            const bool known = path.extension() == ".bin" &&
+                               std::from_chars(stem.data(),
+                                               stem.data() + stem.size(),
+                                               key,
+                                               16)
+                                   .ec == std::errc{} &&
+                               m_entries.contains(key);
+            if (known) {
+                continue;
+            }
+            std::error_code age_error;
+            const auto written = file.last_write_time(age_error);
+            if (!age_error && now - written > k_orphan_age) {
+                unknown.push_back(path);
+            }
+        }
+        for (const std::filesystem::path& path : unknown) {
+            std::filesystem::remove(path, error);
+        }
+        evict();
+    }
+
+    std::filesystem::path pipeline_cache::payload_path(
+      std::uint64_t p_key) const {
+        return m_directory / (pipeline_key{ p_key }.hex() + ".bin");
+    }
+
+    std::optional<std::vector<std::byte>> pipeline_cache::load(
+      const pipeline_key& p_key) {
+        auto found = m_entries.find(p_key.value);
+        if (found == m_entries.end()) {
+            ++m_stats.misses;
+            return std::nullopt;
+        }
+
+        std::vector<std::byte> payload(found->second.size);
+        std::ifstream file(payload_path(p_key.value), std::ios::binary);
+        file.read(reinterpret_cast<char*>(payload.data()),
+                  static_cast<std::streamsize>(payload.size()));
+        if (!file || file.peek() != std::ifstream::traits_type::eof() ||
+            checksum(payload) != found->second.checksum) {
+            ++m_stats.corrupt;
+            ++m_stats.misses;
+            remove_entry(p_key.value);
+            return std::nullopt;
+        }
+
+        ++m_stats.hits;
+        found->second.last_used = ++m_clock;
+        m_index_dirty = true;
+        return payload;
+    }
+
+    std::optional<std::filesystem::path> pipeline_cache::find(
+      const pipeline_key& p_key) {
+        auto found = m_entries.find(p_key.value);
+        if (found == m_entries.end()) {
+            ++m_stats.misses;
+            return std::nullopt;
+        }
+
+        std::filesystem::path path = payload_path(p_key.value);
+        std::error_code error;
+        if (std::filesystem::file_size(path, error) != found->second.size ||
+            error) {
+            ++m_stats.corrupt;
+            ++m_stats.misses;
+            remove_entry(p_key.value);
+            return std::nullopt;
+        }
+
+        ++m_stats.hits;
+        found->second.last_used = ++m_clock;
+        m_index_dirty = true;
+        return path;
+    }
+
+    bool pipeline_cache::store(const pipeline_key& p_key,
+                               std::span<const std::byte> p_payload) {
+        if (p_payload.size() > m_options.max_bytes ||
+            !write_file_atomically(payload_path(p_key.value), p_payload)) {
+            return false;
+        }
+
+        auto [it, inserted] = m_entries.try_emplace(p_key.value);
+        if (!inserted) {
+            m_bytes -= it->second.size;
+        }
+        it->second = { p_payload.size(), checksum(p_payload), ++m_clock };
+        m_bytes += p_payload.size();
+        ++m_stats.stores;
+
+        evict();
+        write_index();
+        return true;
+    }
+
+    void pipeline_cache::invalidate(const pipeline_key& p_key) {
+        if (m_entries.contains(p_key.value)) {
+            remove_entry(p_key.value);
+            write_index();
+        }
+    }
+
+    void pipeline_cache::clear() {
+        while (!m_entries.empty()) {
+            remove_entry(m_entries.begin()->first);
+        }
+        write_index();
+    }
+
+    void pipeline_cache::flush() {
+        if (m_index_dirty) {
+            write_index();
+        }
+    }
+
+    void pipeline_cache::remove_entry(std::uint64_t p_key) {
+        auto found = m_entries.find(p_key);
+        m_bytes -= found->second.size;
+        m_entries.erase(found);
+        std::error_code error;
+        std::filesystem::remove(payload_path(p_key), error);
+        m_index_dirty = true;
+    }
+
+    void pipeline_cache::evict() {
+        if (m_bytes <= m_options.max_bytes) {
+            return;
+        }
+
+        std::vector<std::pair<std::uint64_t, std::uint64_t>> by_age;
+        by_age.reserve(m_entries.size());
+        for (const auto& [key, value] : m_entries) {
+            by_age.emplace_back(value.last_used, key);
+        }
+        std::ranges::sort(by_age);
+        for (const auto& [last_used, key] : by_age) {
+            if (m_bytes <= m_options.max_bytes) {
+                break;
+            }
+            remove_entry(key);
+            ++m_stats.evictions;
+        }
+    }
+
+    std::optional<pipeline_cache::entry_map> pipeline_cache::read_index()
+      const {
+        std::ifstream file(m_directory / k_index_name);
+        std::string magic;
+        std::uint32_t version = 0;
+        if (!(file >> magic >> version) || magic != k_index_magic ||
+            version != m_options.version) {
+            // Missing, unreadable or another version: the directory sweep
+            // removes the payloads.
+            return std::nullopt;
+        }
+
+        entry_map entries;
+        std::string key_hex;
+        entry value{};
+        while (file >> key_hex >> value.size >> std::hex >> value.checksum >>
+               std::dec >> value.last_used) {
+            std::uint64_t key = 0;
+            if (std::from_chars(
+                  key_hex.data(), key_hex.data() + key_hex.size(), key, 16)
+                  .ec != std::errc{}) {
+                continue;
+            }
+            std::error_code error;
+            if (std::filesystem::file_size(payload_path(key), error) !=
+                  value.size ||
+                error) {
+                continue;
+            }
+            entries[key] = value;
+        }
+        return entries;
+    }
+
+    void pipeline_cache::merge(const entry_map& p_entries) {
+        for (const auto& [key, value] : p_entries) {
+            auto [it, inserted] = m_entries.try_emplace(key, value);
+            if (inserted) {
+                m_bytes += value.size;
+            }
+            else {
+                it->second.last_used =
+                  std::max(it->second.last_used, value.last_used);
+            }
+            m_clock = std::max(m_clock, value.last_used);
+        }
+    }
+
+    void pipeline_cache::write_index() {
+        // Keep what other processes stored since this one last read the
+        // index. Payloads removed here are gone, so read_index() skips them.
+        const file_lock lock(m_directory / k_lock_name);
+        if (const std::optional<entry_map> stored = read_index()) {
+            merge(*stored);
+            evict();
+        }
+
+        std::string text =
+          std::format("{} {}\n", k_index_magic, m_options.version);
+        for (const auto& [key, value] : m_entries) {
+            text += std::format("{:016x} {} {:x} {}\n",
+                                key,
+                                value.size,
+                                value.checksum,
+                                value.last_used);
+        }
+        if (write_file_atomically(m_directory / k_index_name,
+                                  std::as_bytes(std::span(text)))) {
+            m_index_dirty = false;
+        }
+    }
+}
@@ -0,0 +1,272 @@
+module;
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+export module lib:ref;
+
+export namespace ns {
+    /**
+     * @brief Anything with NS::Object style manual reference counting.
+     *
+     * Every NS/MTL/MTK object satisfies this, ns::mock_object stands in for
+     * them on hosts without Foundation.
+     */
+    template<typename T>
+    concept refcounted = requires(T& p_object) {
+        p_object.retain();
+        p_object.release();
+    };
+
+    /**
+     * @brief Move-only owner of one reference to a refcounted object.
+     *
+     * Objects returned by new*, alloc()->init() and copy() come with a
+     * reference the caller owns, wrap those with adopt(). Objects returned by
+     * anything else are autoreleased or owned by someone else, wrap those
+     * with retain(). Moves transfer the reference without touching the
+     * count, and the handle is exactly one pointer wide.
+     */
+    template<refcounted T>
+    class ref {
+    public:
+        ref() = default;
+        ref(std::nullptr_t) {}
+
+        //! Takes over a reference the caller already owns.
+        [[nodiscard]] static ref adopt(T* p_object) { return ref(p_object); }
+
+        //! Takes a new reference to p_object.
+        [[nodiscard]] static ref retain(T* p_object) {
+            if (p_object != nullptr) {
+                p_object->retain();
+            }
+            return ref(p_object);
+        }
+
+        ref(const ref&) = delete;
+        ref& operator=(const ref&) = delete;
+
+        ref(ref&& p_other) noexcept
+          : m_object(std::exchange(p_other.m_object, nullptr)) {}
+
+        ref& operator=(ref&& p_other) noexcept {
+            if (this != &p_other) {
+                reset(std::exchange(p_other.m_object, nullptr));
+            }
+            return *this;
+        }
+
+        ~ref() { reset(); }
+
+        //! Releases the current reference and adopts p_object.
+        void reset(T* p_object = nullptr) {
+            if (T* old = std::exchange(m_object, p_object)) {
+                old->release();
+            }
+        }
+
+        //! Gives up ownership without releasing, the caller now owns it.
+        [[nodiscard]] T* detach() { return std::exchange(m_object, nullptr); }
+
+        friend void swap(ref& p_a, ref& p_b) noexcept {
+            std::swap(p_a.m_object, p_b.m_object);
+        }
+
+        [[nodiscard]] T* get() const { return m_object; }
+        T* operator->() const { return m_object; }
+        T& operator*() const { return *m_object; }
+        explicit operator bool() const { return m_object != nullptr; }
+
+    private:
+        explicit ref(T* p_object)
+          : m_object(p_object) {}
+
+        T* m_object = nullptr;
+    };
+
+    /**
+     * @brief Copyable ref, every copy owns its own reference.
+     *
+     * Copies retain and destruction releases, moves leave the count alone.
+     * A ref can be moved into a shared_ref without any count traffic.
+     */
+    template<refcounted T>
+    class shared_ref {
+    public:
+        shared_ref() = default;
+        shared_ref(std::nullptr_t) {}
+
+        shared_ref(ref<T>&& p_owner) noexcept
+          : m_object(p_owner.detach()) {}
+
+        [[nodiscard]] static shared_ref adopt(T* p_object) {
+            return shared_ref(ref<T>::adopt(p_object));
+        }
+
+        [[nodiscard]] static shared_ref retain(T* p_object) {
+            return shared_ref(ref<T>::retain(p_object));
+        }
+
+        shared_ref(const shared_ref& p_other)
+          : m_object(p_other.m_object) {
+            if (m_object != nullptr) {
+                m_object->retain();
+            }
+        }
+
+        shared_ref& operator=(const shared_ref& p_other) {
+            // Retain first so self-assignment cannot drop the last reference.
+            if (p_other.m_object != nullptr) {
+                p_other.m_object->retain();
+            }
+            reset(p_other.m_object);
+            return *this;
+        }
+
+        shared_ref(shared_ref&& p_other) noexcept
+          : m_object(std::exchange(p_other.m_object, nullptr)) {}
+
+        shared_ref& operator=(shared_ref&& p_other) noexcept {
+            if (this != &p_other) {
+                reset(std::exchange(p_other.m_object, nullptr));
+            }
+            return *this;
+        }
+
+        ~shared_ref() { reset(); }
+
+        void reset(T* p_object = nullptr) {
+            if (T* old = std::exchange(m_object, p_object)) {
+                old->release();
+            }
+        }
+
+        friend void swap(shared_ref& p_a, shared_ref& p_b) noexcept {
+            std::swap(p_a.m_object, p_b.m_object);
+        }
+
+        [[nodiscard]] T* get() const { return m_object; }
+        T* operator->() const { return m_object; }
+        T& operator*() const { return *m_object; }
+        explicit operator bool() const { return m_object != nullptr; }
+
+    private:
+        T* m_object = nullptr;
+    };
+
+    //! Shorthand for ref<T>::adopt, the usual way to wrap new*/alloc results.
+    template<refcounted T>
+    [[nodiscard]] ref<T> adopt(T* p_object) {
+        return ref<T>::adopt(p_object);
+    }
+
+    //! Shorthand for ref<T>::retain.
+    template<refcounted T>
+    [[nodiscard]] ref<T> retain(T* p_object) {
+        return ref<T>::retain(p_object);
+    }
+
+    class mock_autorelease_pool;
+
+    /**
+     * @brief Refcounted object that only records its count.
+     *
+     * Starts at one reference, like an object fresh out of new* or
+     * alloc()->init(). Nothing is freed when the count reaches zero,
+     * destroyed() reports it instead so tests can keep the object on the
+     * stack and assert on it afterwards.
+     */
+    class mock_object {
+    public:
+        mock_object* retain() {
+            ++m_count;
+            ++m_retains;
+            return this;
+        }
+
+        void release() {
+            --m_count;
+            ++m_releases;
+        }
+
+        //! Hands one reference to the innermost mock_autorelease_pool.
+        mock_object* autorelease();
+
+        [[nodiscard]] int retain_count() const { return m_count; }
+        [[nodiscard]] int retains() const { return m_retains; }
+        [[nodiscard]] int releases() const { return m_releases; }
+        [[nodiscard]] bool destroyed() const { return m_count == 0; }
+
+    private:
+        int m_count = 1;
+        int m_retains = 0;
+        int m_releases = 0;
+    };
+
+    /**
+     * @brief Stand-in for NS::AutoreleasePool with the same alloc()->init()
+     * / release() shape.
+     *
+     * Pools nest per thread like the real ones. release() pops the pool and
+     * releases every object autoreleased into it; objects autoreleased with
+     * no pool open are counted as leaked.
+     */
+    class mock_autorelease_pool {
+    public:
+        static mock_autorelease_pool* alloc() {
+            return new mock_autorelease_pool();
+        }
+
+        mock_autorelease_pool* init() {
+            m_parent = std::exchange(s_current, this);
+            return this;
+        }
+
+        void release() {
+            for (mock_object* object : m_objects) {
+                object->release();
+            }
+            s_current = m_parent;
+            delete this;
+        }
+
+        void add_object(mock_object* p_object) { m_objects.push_back(p_object); }
+
+        [[nodiscard]] std::size_t object_count() const {
+            return m_objects.size();
+        }
+
+        [[nodiscard]] static mock_autorelease_pool* current() {
+            return s_current;
+        }
+
+        //! Objects autoreleased on this thread while no pool was open.
+        [[nodiscard]] static std::size_t leaked() { return s_leaked; }
+
+    private:
+        friend class mock_object;
+
+        mock_autorelease_pool() = default;
+
+        std::vector<mock_object*> m_objects;
+        mock_autorelease_pool* m_parent = nullptr;
+
+        static inline thread_local mock_autorelease_pool* s_current = nullptr;
+        static inline thread_local std::size_t s_leaked = 0;
+    };
+
+    inline mock_object* mock_object::autorelease() {
+        if (mock_autorelease_pool* pool = mock_autorelease_pool::s_current) {
+            pool->add_object(this);
+        }
+        else {
+            ++mock_autorelease_pool::s_leaked;
+        }
+        return this;
+    }
+
+    static_assert(sizeof(ref<mock_object>) == sizeof(mock_object*));
+    static_assert(sizeof(shared_ref<mock_object>) == sizeof(mock_object*));
+}
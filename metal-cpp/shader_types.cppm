@@ -0,0 +1,99 @@
+module;
+
+#include <cstddef>
+#include <cstdint>
+
+export module lib:shader_types;
+
+import :math;
+
+/**
+ * @brief CPU mirrors of the structs declared in the renderer's MSL source.
+ *
+ * Field names intentionally match the shader side. The static_asserts pin the
+ * sizes and offsets the GPU reads, so a layout change here fails to compile
+ * instead of silently corrupting the instance stream.
+ */
+export namespace shader_types {
+    struct vertex_data {
+        math::float3 position;
+        math::float3 normal;
+        math::float2 texcoord;
+    };
+
+    /**
+     * vertex_data quantized to 16 bytes, a third of the float layout.
+     * Written by gpu::pack_vertices, vertex_quantization maps it back.
+     */
+    struct packed_vertex_data {
+        //! unorm16 steps above positionOffset.
+        std::uint16_t position[3];
+        //! Unit normal folded onto the octahedron, snorm16.
+        std::int16_t normal[2];
+        //! unorm16 steps above texcoordOffset.
+        std::uint16_t texcoord[2];
+        std::uint16_t padding;
+    };
+
+    //! Per-mesh decode constants of packed_vertex_data:
+    //! value = offset + scale * stored integer.
+    struct vertex_quantization {
+        math::float3 positionOffset;
+        math::float3 positionScale;
+        math::float2 texcoordOffset;
+        math::float2 texcoordScale;
+    };
+
+    //! Per-instance data that changes as instances move.
+    struct instance_data {
+        math::float4x4 instanceTransform;
+        math::float3x3 instanceNormalTransform;
+    };
+
+    //! Per-instance data that is uploaded once, bound as its own stream.
+    struct instance_static_data {
+        math::float4 instanceColor;
+    };
+
+    /**
+     * instance_data in 48 bytes: the rows of instanceTransform's affine
+     * part, world = dot(instanceRows[i], float4(p, 1)). The normal
+     * transform is derived from them in the shader.
+     * Written by gpu::pack_instances.
+     */
+    struct compact_instance_data {
+        math::float4 instanceRows[3];
+    };
+
+    //! instance_static_data with the color as RGBA8 unorm, red in the low
+    //! byte, which MSL's unpack_unorm4x8_to_float reads back.
+    struct compact_instance_static_data {
+        std::uint32_t instanceColor;
+    };
+
+    struct camera_data {
+        math::float4x4 perspectiveTransform;
+        math::float4x4 worldTransform;
+        math::float3x3 worldNormalTransform;
+    };
+
+    static_assert(sizeof(vertex_data) == 48);
+    static_assert(offsetof(vertex_data, normal) == 16);
+    static_assert(offsetof(vertex_data, texcoord) == 32);
+
+    static_assert(sizeof(packed_vertex_data) == 16);
+    static_assert(offsetof(packed_vertex_data, normal) == 6);
+    static_assert(offsetof(packed_vertex_data, texcoord) == 10);
+
+    static_assert(sizeof(vertex_quantization) == 48);
+    static_assert(offsetof(vertex_quantization, texcoordOffset) == 32);
+
+    static_assert(sizeof(instance_data) == 112);
+    static_assert(offsetof(instance_data, instanceNormalTransform) == 64);
+    static_assert(sizeof(instance_static_data) == 16);
+    static_assert(sizeof(compact_instance_data) == 48);
+    static_assert(sizeof(compact_instance_static_data) == 4);
+
+    static_assert(sizeof(camera_data) == 176);
+    static_assert(offsetof(camera_data, worldNormalTransform) == 128);
+}
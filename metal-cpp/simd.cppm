@@ -0,0 +1,510 @@
+module;
+
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <bit>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+export module lib:simd;
+
+/**
+ * @brief Thin, width-agnostic wrappers over the native float/int registers.
+ *
+ * Batched kernels are written once against vfloat/vint/vmask and process
+ * math::simd::lanes elements per step: 8 with AVX2, 4 with SSE or NEON and 1
+ * in the scalar fallback. Everything is inline so the wrappers compile down
+ * to the raw intrinsics.
+ */
+export namespace math::simd {
+#if defined(__AVX2__) && defined(__FMA__)
+    inline constexpr std::size_t lanes = 8;
+    //! Whether fma rounds once, it is a multiply and an add otherwise.
+    inline constexpr bool fused_fma = true;
+
+    struct vmask {
+        __m256 v;
+    };
+
+    struct vint {
+        __m256i v;
+
+        static vint splat(int32_t p_x) { return { _mm256_set1_epi32(p_x) }; }
+        static vint load(const int32_t* p_src) {
+            return { _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p_src)) };
+        }
+        void store(int32_t* p_dst) const {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(p_dst), v);
+        }
+    };
+
+    struct vfloat {
+        __m256 v;
+
+        static vfloat splat(float p_x) { return { _mm256_set1_ps(p_x) }; }
+        static vfloat load(const float* p_src) { return { _mm256_loadu_ps(p_src) }; }
+        static vfloat iota() {
+            return { _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f) };
+        }
+        void store(float* p_dst) const { _mm256_storeu_ps(p_dst, v); }
+    };
+
+    inline vfloat operator+(vfloat p_a, vfloat p_b) { return { _mm256_add_ps(p_a.v, p_b.v) }; }
+    inline vfloat operator-(vfloat p_a, vfloat p_b) { return { _mm256_sub_ps(p_a.v, p_b.v) }; }
+    inline vfloat operator*(vfloat p_a, vfloat p_b) { return { _mm256_mul_ps(p_a.v, p_b.v) }; }
+    inline vfloat operator/(vfloat p_a, vfloat p_b) { return { _mm256_div_ps(p_a.v, p_b.v) }; }
+    inline vfloat operator-(vfloat p_a) {
+        return { _mm256_xor_ps(p_a.v, _mm256_set1_ps(-0.f)) };
+    }
+    //! @return p_a * p_b + p_c
+    inline vfloat fma(vfloat p_a, vfloat p_b, vfloat p_c) {
+        return { _mm256_fmadd_ps(p_a.v, p_b.v, p_c.v) };
+    }
+    inline vfloat min(vfloat p_a, vfloat p_b) { return { _mm256_min_ps(p_a.v, p_b.v) }; }
+    inline vfloat max(vfloat p_a, vfloat p_b) { return { _mm256_max_ps(p_a.v, p_b.v) }; }
+    inline vfloat abs(vfloat p_a) {
+        return { _mm256_andnot_ps(_mm256_set1_ps(-0.f), p_a.v) };
+    }
+    inline vfloat sqrt(vfloat p_a) { return { _mm256_sqrt_ps(p_a.v) }; }
+    inline vfloat round(vfloat p_a) {
+        return { _mm256_round_ps(p_a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC) };
+    }
+    inline vfloat floor(vfloat p_a) { return { _mm256_floor_ps(p_a.v) }; }
+
+    inline vmask operator<(vfloat p_a, vfloat p_b) { return { _mm256_cmp_ps(p_a.v, p_b.v, _CMP_LT_OQ) }; }
+    inline vmask operator<=(vfloat p_a, vfloat p_b) { return { _mm256_cmp_ps(p_a.v, p_b.v, _CMP_LE_OQ) }; }
+    inline vmask operator>(vfloat p_a, vfloat p_b) { return { _mm256_cmp_ps(p_a.v, p_b.v, _CMP_GT_OQ) }; }
+    inline vmask operator>=(vfloat p_a, vfloat p_b) { return { _mm256_cmp_ps(p_a.v, p_b.v, _CMP_GE_OQ) }; }
+    inline vmask operator==(vfloat p_a, vfloat p_b) { return { _mm256_cmp_ps(p_a.v, p_b.v, _CMP_EQ_OQ) }; }
+
+    inline vmask operator&(vmask p_a, vmask p_b) { return { _mm256_and_ps(p_a.v, p_b.v) }; }
+    inline vmask operator|(vmask p_a, vmask p_b) { return { _mm256_or_ps(p_a.v, p_b.v) }; }
+    inline vmask operator~(vmask p_a) {
+        return { _mm256_xor_ps(p_a.v, _mm256_castsi256_ps(_mm256_set1_epi32(-1))) };
+    }
+    //! @return one bit per lane, lane 0 in bit 0.
+    inline uint32_t bits(vmask p_m) { return static_cast<uint32_t>(_mm256_movemask_ps(p_m.v)); }
+    inline bool any(vmask p_m) { return _mm256_movemask_ps(p_m.v) != 0; }
+    inline bool all(vmask p_m) { return _mm256_movemask_ps(p_m.v) == 0xff; }
+    inline vfloat select(vmask p_m, vfloat p_a, vfloat p_b) {
+        return { _mm256_blendv_ps(p_b.v, p_a.v, p_m.v) };
+    }
+    inline vint select(vmask p_m, vint p_a, vint p_b) {
+        return { _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(p_b.v),
+                                                      _mm256_castsi256_ps(p_a.v),
+                                                      p_m.v)) };
+    }
+
+    inline vint operator+(vint p_a, vint p_b) { return { _mm256_add_epi32(p_a.v, p_b.v) }; }
+    inline vint operator-(vint p_a, vint p_b) { return { _mm256_sub_epi32(p_a.v, p_b.v) }; }
+    inline vint operator&(vint p_a, vint p_b) { return { _mm256_and_si256(p_a.v, p_b.v) }; }
+    inline vint operator|(vint p_a, vint p_b) { return { _mm256_or_si256(p_a.v, p_b.v) }; }
+    inline vint operator^(vint p_a, vint p_b) { return { _mm256_xor_si256(p_a.v, p_b.v) }; }
+    inline vint operator<<(vint p_a, int p_n) { return { _mm256_slli_epi32(p_a.v, p_n) }; }
+    //! Logical shift, zero-filled.
+    inline vint operator>>(vint p_a, int p_n) { return { _mm256_srli_epi32(p_a.v, p_n) }; }
+    inline vmask operator==(vint p_a, vint p_b) {
+        return { _mm256_castsi256_ps(_mm256_cmpeq_epi32(p_a.v, p_b.v)) };
+    }
+    inline vmask operator>(vint p_a, vint p_b) {
+        return { _mm256_castsi256_ps(_mm256_cmpgt_epi32(p_a.v, p_b.v)) };
+    }
+
+    //! Round-to-nearest conversion.
+    inline vint to_int(vfloat p_a) { return { _mm256_cvtps_epi32(p_a.v) }; }
+    inline vfloat to_float(vint p_a) { return { _mm256_cvtepi32_ps(p_a.v) }; }
+    inline vint as_int(vfloat p_a) { return { _mm256_castps_si256(p_a.v) }; }
+    inline vfloat as_float(vint p_a) { return { _mm256_castsi256_ps(p_a.v) }; }
+
+    //! Splits the 2 * lanes elements p_a, p_b into the even-indexed and
+    //! odd-indexed ones, each in order.
+    inline void deinterleave(vint p_a, vint p_b, vint& p_even, vint& p_odd) {
+        const __m256 a = _mm256_castsi256_ps(p_a.v);
+        const __m256 b = _mm256_castsi256_ps(p_b.v);
+        // Within each 128-bit half: a0 a2 b0 b2, then fix the half order.
+        const __m256 even = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m256 odd = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        p_even = { _mm256_permute4x64_epi64(_mm256_castps_si256(even),
+                                            _MM_SHUFFLE(3, 1, 2, 0)) };
+        p_odd = { _mm256_permute4x64_epi64(_mm256_castps_si256(odd),
+                                           _MM_SHUFFLE(3, 1, 2, 0)) };
+    }
+    //! Inverse of deinterleave: p_lo, p_hi receive p_even[0], p_odd[0],
+    //! p_even[1], p_odd[1], ...
+    inline void interleave(vint p_even, vint p_odd, vint& p_lo, vint& p_hi) {
+        // Within each 128-bit half: e0 o0 e1 o1 and e2 o2 e3 o3.
+        const __m256i low = _mm256_unpacklo_epi32(p_even.v, p_odd.v);
+        const __m256i high = _mm256_unpackhi_epi32(p_even.v, p_odd.v);
+        p_lo = { _mm256_permute2x128_si256(low, high, 0x20) };
+        p_hi = { _mm256_permute2x128_si256(low, high, 0x31) };
+    }
+    //! Transposes p_rows as a lanes x lanes matrix: lane j of register i
+    //! and lane i of register j swap.
+    inline void transpose(vfloat (&p_rows)[lanes]) {
+        // 4x4 transposes within each 128-bit half, then swap the halves.
+        __m256 t[8];
+        for (int k = 0; k < 4; ++k) {
+            t[2 * k] = _mm256_unpacklo_ps(p_rows[2 * k].v, p_rows[2 * k + 1].v);
+            t[2 * k + 1] = _mm256_unpackhi_ps(p_rows[2 * k].v, p_rows[2 * k + 1].v);
+        }
+        __m256 q[8];
+        for (int k = 0; k < 2; ++k) {
+            const __m256* u = t + 4 * k;
+            q[4 * k] = _mm256_shuffle_ps(u[0], u[2], _MM_SHUFFLE(1, 0, 1, 0));
+            q[4 * k + 1] = _mm256_shuffle_ps(u[0], u[2], _MM_SHUFFLE(3, 2, 3, 2));
+            q[4 * k + 2] = _mm256_shuffle_ps(u[1], u[3], _MM_SHUFFLE(1, 0, 1, 0));
+            q[4 * k + 3] = _mm256_shuffle_ps(u[1], u[3], _MM_SHUFFLE(3, 2, 3, 2));
+        }
+        for (int k = 0; k < 4; ++k) {
+            p_rows[k] = { _mm256_permute2f128_ps(q[k], q[4 + k], 0x20) };
+            p_rows[4 + k] = { _mm256_permute2f128_ps(q[k], q[4 + k], 0x31) };
+        }
+    }
+
+#elif defined(__SSE2__) || defined(_M_X64)
+    inline constexpr std::size_t lanes = 4;
+    inline constexpr bool fused_fma = false;
+
+    struct vmask {
+        __m128 v;
+    };
+
+    struct vint {
+        __m128i v;
+
+        static vint splat(int32_t p_x) { return { _mm_set1_epi32(p_x) }; }
+        static vint load(const int32_t* p_src) {
+            return { _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_src)) };
+        }
+        void store(int32_t* p_dst) const {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(p_dst), v);
+        }
+    };
+
+    struct vfloat {
+        __m128 v;
+
+        static vfloat splat(float p_x) { return { _mm_set1_ps(p_x) }; }
+        static vfloat load(const float* p_src) { return { _mm_loadu_ps(p_src) }; }
+        static vfloat iota() { return { _mm_setr_ps(0.f, 1.f, 2.f, 3.f) }; }
+        void store(float* p_dst) const { _mm_storeu_ps(p_dst, v); }
+    };
+
+    inline vfloat operator+(vfloat p_a, vfloat p_b) { return { _mm_add_ps(p_a.v, p_b.v) }; }
+    inline vfloat operator-(vfloat p_a, vfloat p_b) { return { _mm_sub_ps(p_a.v, p_b.v) }; }
+    inline vfloat operator*(vfloat p_a, vfloat p_b) { return { _mm_mul_ps(p_a.v, p_b.v) }; }
+    inline vfloat operator/(vfloat p_a, vfloat p_b) { return { _mm_div_ps(p_a.v, p_b.v) }; }
+    inline vfloat operator-(vfloat p_a) { return { _mm_xor_ps(p_a.v, _mm_set1_ps(-0.f)) }; }
+    //! @return p_a * p_b + p_c
+    inline vfloat fma(vfloat p_a, vfloat p_b, vfloat p_c) {
+        return { _mm_add_ps(_mm_mul_ps(p_a.v, p_b.v), p_c.v) };
+    }
+    inline vfloat min(vfloat p_a, vfloat p_b) { return { _mm_min_ps(p_a.v, p_b.v) }; }
+    inline vfloat max(vfloat p_a, vfloat p_b) { return { _mm_max_ps(p_a.v, p_b.v) }; }
+    inline vfloat abs(vfloat p_a) { return { _mm_andnot_ps(_mm_set1_ps(-0.f), p_a.v) }; }
+    inline vfloat sqrt(vfloat p_a) { return { _mm_sqrt_ps(p_a.v) }; }
+
+    inline vmask operator<(vfloat p_a, vfloat p_b) { return { _mm_cmplt_ps(p_a.v, p_b.v) }; }
+    inline vmask operator<=(vfloat p_a, vfloat p_b) { return { _mm_cmple_ps(p_a.v, p_b.v) }; }
+    inline vmask operator>(vfloat p_a, vfloat p_b) { return { _mm_cmpgt_ps(p_a.v, p_b.v) }; }
+    inline vmask operator>=(vfloat p_a, vfloat p_b) { return { _mm_cmpge_ps(p_a.v, p_b.v) }; }
+    inline vmask operator==(vfloat p_a, vfloat p_b) { return { _mm_cmpeq_ps(p_a.v, p_b.v) }; }
+
+    inline vmask operator&(vmask p_a, vmask p_b) { return { _mm_and_ps(p_a.v, p_b.v) }; }
+    inline vmask operator|(vmask p_a, vmask p_b) { return { _mm_or_ps(p_a.v, p_b.v) }; }
+    inline vmask operator~(vmask p_a) {
+        return { _mm_xor_ps(p_a.v, _mm_castsi128_ps(_mm_set1_epi32(-1))) };
+    }
+    //! @return one bit per lane, lane 0 in bit 0.
+    inline uint32_t bits(vmask p_m) { return static_cast<uint32_t>(_mm_movemask_ps(p_m.v)); }
+    inline bool any(vmask p_m) { return _mm_movemask_ps(p_m.v) != 0; }
+    inline bool all(vmask p_m) { return _mm_movemask_ps(p_m.v) == 0xf; }
+    inline vfloat select(vmask p_m, vfloat p_a, vfloat p_b) {
+        return { _mm_or_ps(_mm_and_ps(p_m.v, p_a.v), _mm_andnot_ps(p_m.v, p_b.v)) };
+    }
+    inline vint select(vmask p_m, vint p_a, vint p_b) {
+        const __m128i m = _mm_castps_si128(p_m.v);
+        return { _mm_or_si128(_mm_and_si128(m, p_a.v), _mm_andnot_si128(m, p_b.v)) };
+    }
+
+    inline vint operator+(vint p_a, vint p_b) { return { _mm_add_epi32(p_a.v, p_b.v) }; }
+    inline vint operator-(vint p_a, vint p_b) { return { _mm_sub_epi32(p_a.v, p_b.v) }; }
+    inline vint operator&(vint p_a, vint p_b) { return { _mm_and_si128(p_a.v, p_b.v) }; }
+    inline vint operator|(vint p_a, vint p_b) { return { _mm_or_si128(p_a.v, p_b.v) }; }
+    inline vint operator^(vint p_a, vint p_b) { return { _mm_xor_si128(p_a.v, p_b.v) }; }
+    inline vint operator<<(vint p_a, int p_n) { return { _mm_slli_epi32(p_a.v, p_n) }; }
+    //! Logical shift, zero-filled.
+    inline vint operator>>(vint p_a, int p_n) { return { _mm_srli_epi32(p_a.v, p_n) }; }
+    inline vmask operator==(vint p_a, vint p_b) {
+        return { _mm_castsi128_ps(_mm_cmpeq_epi32(p_a.v, p_b.v)) };
+    }
+    inline vmask operator>(vint p_a, vint p_b) {
+        return { _mm_castsi128_ps(_mm_cmpgt_epi32(p_a.v, p_b.v)) };
+    }
+
+    //! Round-to-nearest conversion.
+    inline vint to_int(vfloat p_a) { return { _mm_cvtps_epi32(p_a.v) }; }
+    inline vfloat to_float(vint p_a) { return { _mm_cvtepi32_ps(p_a.v) }; }
+    inline vint as_int(vfloat p_a) { return { _mm_castps_si128(p_a.v) }; }
+    inline vfloat as_float(vint p_a) { return { _mm_castsi128_ps(p_a.v) }; }
+
+    //! Splits the 2 * lanes elements p_a, p_b into the even-indexed and
+    //! odd-indexed ones, each in order.
+    inline void deinterleave(vint p_a, vint p_b, vint& p_even, vint& p_odd) {
+        const __m128 a = _mm_castsi128_ps(p_a.v);
+        const __m128 b = _mm_castsi128_ps(p_b.v);
+        p_even = { _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0))) };
+        p_odd = { _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))) };
+    }
+    //! Inverse of deinterleave: p_lo, p_hi receive p_even[0], p_odd[0],
+    //! p_even[1], p_odd[1], ...
+    inline void interleave(vint p_even, vint p_odd, vint& p_lo, vint& p_hi) {
+        p_lo = { _mm_unpacklo_epi32(p_even.v, p_odd.v) };
+        p_hi = { _mm_unpackhi_epi32(p_even.v, p_odd.v) };
+    }
+    //! Transposes p_rows as a lanes x lanes matrix: lane j of register i
+    //! and lane i of register j swap.
+    inline void transpose(vfloat (&p_rows)[lanes]) {
+        _MM_TRANSPOSE4_PS(p_rows[0].v, p_rows[1].v, p_rows[2].v, p_rows[3].v);
+    }
+
+    // SSE2 has no roundps, so go through the integer conversion. Only exact
+    // for |x| < 2^31, which covers every caller.
+    inline vfloat round(vfloat p_a) { return to_float(to_int(p_a)); }
+    inline vfloat floor(vfloat p_a) {
+        const vfloat r = round(p_a);
+        return select(p_a < r, r - vfloat::splat(1.f), r);
+    }
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    inline constexpr std::size_t lanes = 4;
+    inline constexpr bool fused_fma = true;
+
+    struct vmask {
+        uint32x4_t v;
+    };
+
+    struct vint {
+        int32x4_t v;
+
+        static vint splat(int32_t p_x) { return { vdupq_n_s32(p_x) }; }
+        static vint load(const int32_t* p_src) { return { vld1q_s32(p_src) }; }
+        void store(int32_t* p_dst) const { vst1q_s32(p_dst, v); }
+    };
+
+    struct vfloat {
+        float32x4_t v;
+
+        static vfloat splat(float p_x) { return { vdupq_n_f32(p_x) }; }
+        static vfloat load(const float* p_src) { return { vld1q_f32(p_src) }; }
+        static vfloat iota() {
+            constexpr float values[4] = { 0.f, 1.f, 2.f, 3.f };
+            return { vld1q_f32(values) };
+        }
+        void store(float* p_dst) const { vst1q_f32(p_dst, v); }
+    };
+
+    inline vfloat operator+(vfloat p_a, vfloat p_b) { return { vaddq_f32(p_a.v, p_b.v) }; }
+    inline vfloat operator-(vfloat p_a, vfloat p_b) { return { vsubq_f32(p_a.v, p_b.v) }; }
+    inline vfloat operator*(vfloat p_a, vfloat p_b) { return { vmulq_f32(p_a.v, p_b.v) }; }
+    inline vfloat operator/(vfloat p_a, vfloat p_b) { return { vdivq_f32(p_a.v, p_b.v) }; }
+    inline vfloat operator-(vfloat p_a) { return { vnegq_f32(p_a.v) }; }
+    //! @return p_a * p_b + p_c
+    inline vfloat fma(vfloat p_a, vfloat p_b, vfloat p_c) {
+        return { vfmaq_f32(p_c.v, p_a.v, p_b.v) };
+    }
+    inline vfloat min(vfloat p_a, vfloat p_b) { return { vminq_f32(p_a.v, p_b.v) }; }
+    inline vfloat max(vfloat p_a, vfloat p_b) { return { vmaxq_f32(p_a.v, p_b.v) }; }
+    inline vfloat abs(vfloat p_a) { return { vabsq_f32(p_a.v) }; }
+    inline vfloat sqrt(vfloat p_a) { return { vsqrtq_f32(p_a.v) }; }
+    inline vfloat round(vfloat p_a) { return { vrndnq_f32(p_a.v) }; }
+    inline vfloat floor(vfloat p_a) { return { vrndmq_f32(p_a.v) }; }
+
+    inline vmask operator<(vfloat p_a, vfloat p_b) { return { vcltq_f32(p_a.v, p_b.v) }; }
+    inline vmask operator<=(vfloat p_a, vfloat p_b) { return { vcleq_f32(p_a.v, p_b.v) }; }
+    inline vmask operator>(vfloat p_a, vfloat p_b) { return { vcgtq_f32(p_a.v, p_b.v) }; }
+    inline vmask operator>=(vfloat p_a, vfloat p_b) { return { vcgeq_f32(p_a.v, p_b.v) }; }
+    inline vmask operator==(vfloat p_a, vfloat p_b) { return { vceqq_f32(p_a.v, p_b.v) }; }
+
+    inline vmask operator&(vmask p_a, vmask p_b) { return { vandq_u32(p_a.v, p_b.v) }; }
+    inline vmask operator|(vmask p_a, vmask p_b) { return { vorrq_u32(p_a.v, p_b.v) }; }
+    inline vmask operator~(vmask p_a) { return { vmvnq_u32(p_a.v) }; }
+    //! @return one bit per lane, lane 0 in bit 0.
+    inline uint32_t bits(vmask p_m) {
+        constexpr uint32_t weights[4] = { 1, 2, 4, 8 };
+        return vaddvq_u32(vandq_u32(p_m.v, vld1q_u32(weights)));
+    }
+    inline bool any(vmask p_m) { return vmaxvq_u32(p_m.v) != 0; }
+    inline bool all(vmask p_m) { return vminvq_u32(p_m.v) != 0; }
+    inline vfloat select(vmask p_m, vfloat p_a, vfloat p_b) {
+        return { vbslq_f32(p_m.v, p_a.v, p_b.v) };
+    }
+    inline vint select(vmask p_m, vint p_a, vint p_b) {
+        return { vbslq_s32(p_m.v, p_a.v, p_b.v) };
+    }
+
+    inline vint operator+(vint p_a, vint p_b) { return { vaddq_s32(p_a.v, p_b.v) }; }
+    inline vint operator-(vint p_a, vint p_b) { return { vsubq_s32(p_a.v, p_b.v) }; }
+    inline vint operator&(vint p_a, vint p_b) { return { vandq_s32(p_a.v, p_b.v) }; }
+    inline vint operator|(vint p_a, vint p_b) { return { vorrq_s32(p_a.v, p_b.v) }; }
+    inline vint operator^(vint p_a, vint p_b) { return { veorq_s32(p_a.v, p_b.v) }; }
+    inline vint operator<<(vint p_a, int p_n) { return { vshlq_s32(p_a.v, vdupq_n_s32(p_n)) }; }
+    //! Logical shift, zero-filled.
+    inline vint operator>>(vint p_a, int p_n) {
+        return { vreinterpretq_s32_u32(
+          vshlq_u32(vreinterpretq_u32_s32(p_a.v), vdupq_n_s32(-p_n))) };
+    }
+    inline vmask operator==(vint p_a, vint p_b) { return { vceqq_s32(p_a.v, p_b.v) }; }
+    inline vmask operator>(vint p_a, vint p_b) { return { vcgtq_s32(p_a.v, p_b.v) }; }
+
+    //! Round-to-nearest conversion.
+    inline vint to_int(vfloat p_a) { return { vcvtnq_s32_f32(p_a.v) }; }
+    inline vfloat to_float(vint p_a) { return { vcvtq_f32_s32(p_a.v) }; }
+    inline vint as_int(vfloat p_a) { return { vreinterpretq_s32_f32(p_a.v) }; }
+    inline vfloat as_float(vint p_a) { return { vreinterpretq_f32_s32(p_a.v) }; }
+
+    //! Splits the 2 * lanes elements p_a, p_b into the even-indexed and
+    //! odd-indexed ones, each in order.
+    inline void deinterleave(vint p_a, vint p_b, vint& p_even, vint& p_odd) {
+        p_even = { vuzp1q_s32(p_a.v, p_b.v) };
+        p_odd = { vuzp2q_s32(p_a.v, p_b.v) };
+    }
+    //! Inverse of deinterleave: p_lo, p_hi receive p_even[0], p_odd[0],
+    //! p_even[1], p_odd[1], ...
+    inline void interleave(vint p_even, vint p_odd, vint& p_lo, vint& p_hi) {
+        p_lo = { vzip1q_s32(p_even.v, p_odd.v) };
+        p_hi = { vzip2q_s32(p_even.v, p_odd.v) };
+    }
+    //! Transposes p_rows as a lanes x lanes matrix: lane j of register i
+    //! and lane i of register j swap.
+    inline void transpose(vfloat (&p_rows)[lanes]) {
+        const float32x4x2_t a = vtrnq_f32(p_rows[0].v, p_rows[1].v);
+        const float32x4x2_t b = vtrnq_f32(p_rows[2].v, p_rows[3].v);
+        p_rows[0] = { vcombine_f32(vget_low_f32(a.val[0]), vget_low_f32(b.val[0])) };
+        p_rows[1] = { vcombine_f32(vget_low_f32(a.val[1]), vget_low_f32(b.val[1])) };
+        p_rows[2] = { vcombine_f32(vget_high_f32(a.val[0]), vget_high_f32(b.val[0])) };
+        p_rows[3] = { vcombine_f32(vget_high_f32(a.val[1]), vget_high_f32(b.val[1])) };
+    }
+
+#else
+    inline constexpr std::size_t lanes = 1;
+    inline constexpr bool fused_fma = false;
+
+    struct vmask {
+        bool v;
+    };
+
+    struct vint {
+        int32_t v;
+
+        static vint splat(int32_t p_x) { return { p_x }; }
+        static vint load(const int32_t* p_src) { return { *p_src }; }
+        void store(int32_t* p_dst) const { *p_dst = v; }
+    };
+
+    struct vfloat {
+        float v;
+
+        static vfloat splat(float p_x) { return { p_x }; }
+        static vfloat load(const float* p_src) { return { *p_src }; }
+        static vfloat iota() { return { 0.f }; }
+        void store(float* p_dst) const { *p_dst = v; }
+    };
+
+    inline vfloat operator+(vfloat p_a, vfloat p_b) { return { p_a.v + p_b.v }; }
+    inline vfloat operator-(vfloat p_a, vfloat p_b) { return { p_a.v - p_b.v }; }
+    inline vfloat operator*(vfloat p_a, vfloat p_b) { return { p_a.v * p_b.v }; }
+    inline vfloat operator/(vfloat p_a, vfloat p_b) { return { p_a.v / p_b.v }; }
+    inline vfloat operator-(vfloat p_a) { return { -p_a.v }; }
+    //! @return p_a * p_b + p_c
+    inline vfloat fma(vfloat p_a, vfloat p_b, vfloat p_c) {
+        return { p_a.v * p_b.v + p_c.v };
+    }
+    inline vfloat min(vfloat p_a, vfloat p_b) { return { p_a.v < p_b.v ? p_a.v : p_b.v }; }
+    inline vfloat max(vfloat p_a, vfloat p_b) { return { p_a.v > p_b.v ? p_a.v : p_b.v }; }
+    inline vfloat abs(vfloat p_a) { return { std::fabs(p_a.v) }; }
+    inline vfloat sqrt(vfloat p_a) { return { std::sqrt(p_a.v) }; }
+    inline vfloat round(vfloat p_a) { return { std::nearbyint(p_a.v) }; }
+    inline vfloat floor(vfloat p_a) { return { std::floor(p_a.v) }; }
+
+    inline vmask operator<(vfloat p_a, vfloat p_b) { return { p_a.v < p_b.v }; }
+    inline vmask operator<=(vfloat p_a, vfloat p_b) { return { p_a.v <= p_b.v }; }
+    inline vmask operator>(vfloat p_a, vfloat p_b) { return { p_a.v > p_b.v }; }
+    inline vmask operator>=(vfloat p_a, vfloat p_b) { return { p_a.v >= p_b.v }; }
+    inline vmask operator==(vfloat p_a, vfloat p_b) { return { p_a.v == p_b.v }; }
+
+    inline vmask operator&(vmask p_a, vmask p_b) { return { p_a.v && p_b.v }; }
+    inline vmask operator|(vmask p_a, vmask p_b) { return { p_a.v || p_b.v }; }
+    inline vmask operator~(vmask p_a) { return { !p_a.v }; }
+    //! @return one bit per lane, lane 0 in bit 0.
+    inline uint32_t bits(vmask p_m) { return p_m.v ? 1u : 0u; }
+    inline bool any(vmask p_m) { return p_m.v; }
+    inline bool all(vmask p_m) { return p_m.v; }
+    inline vfloat select(vmask p_m, vfloat p_a, vfloat p_b) { return p_m.v ? p_a : p_b; }
+    inline vint select(vmask p_m, vint p_a, vint p_b) { return p_m.v ? p_a : p_b; }
+
+    //! Wraps around like the vector instructions.
+    inline vint operator+(vint p_a, vint p_b) {
+        return { static_cast<int32_t>(static_cast<uint32_t>(p_a.v) +
+                                      static_cast<uint32_t>(p_b.v)) };
+    }
+    inline vint operator-(vint p_a, vint p_b) {
+        return { static_cast<int32_t>(static_cast<uint32_t>(p_a.v) -
+                                      static_cast<uint32_t>(p_b.v)) };
+    }
+    inline vint operator&(vint p_a, vint p_b) { return { p_a.v & p_b.v }; }
+    inline vint operator|(vint p_a, vint p_b) { return { p_a.v | p_b.v }; }
+    inline vint operator^(vint p_a, vint p_b) { return { p_a.v ^ p_b.v }; }
+    inline vint operator<<(vint p_a, int p_n) {
+        return { static_cast<int32_t>(static_cast<uint32_t>(p_a.v) << p_n) };
+    }
+    //! Logical shift, zero-filled.
+    inline vint operator>>(vint p_a, int p_n) {
+        return { static_cast<int32_t>(static_cast<uint32_t>(p_a.v) >> p_n) };
+    }
+    inline vmask operator==(vint p_a, vint p_b) { return { p_a.v == p_b.v }; }
+    inline vmask operator>(vint p_a, vint p_b) { return { p_a.v > p_b.v }; }
+
+    //! Round-to-nearest conversion.
+    inline vint to_int(vfloat p_a) {
+        return { static_cast<int32_t>(std::nearbyint(p_a.v)) };
+    }
+    inline vfloat to_float(vint p_a) { return { static_cast<float>(p_a.v) }; }
+    inline vint as_int(vfloat p_a) { return { std::bit_cast<int32_t>(p_a.v) }; }
+    inline vfloat as_float(vint p_a) { return { std::bit_cast<float>(p_a.v) }; }
+
+    //! Splits the 2 * lanes elements p_a, p_b into the even-indexed and
+    //! odd-indexed ones, each in order.
+    inline void deinterleave(vint p_a, vint p_b, vint& p_even, vint& p_odd) {
+        p_even = p_a;
+        p_odd = p_b;
+    }
+    //! Inverse of deinterleave: p_lo, p_hi receive p_even[0], p_odd[0],
+    //! p_even[1], p_odd[1], ...
+    inline void interleave(vint p_even, vint p_odd, vint& p_lo, vint& p_hi) {
+        p_lo = p_even;
+        p_hi = p_odd;
+    }
+    //! Transposes p_rows as a lanes x lanes matrix: lane j of register i
+    //! and lane i of register j swap.
+    inline void transpose(vfloat (&)[lanes]) {}
+#endif
+
+    inline vfloat& operator+=(vfloat& p_a, vfloat p_b) { return p_a = p_a + p_b; }
+    inline vfloat& operator-=(vfloat& p_a, vfloat p_b) { return p_a = p_a - p_b; }
+    inline vfloat& operator*=(vfloat& p_a, vfloat p_b) { return p_a = p_a * p_b; }
+    inline vint& operator+=(vint& p_a, vint p_b) { return p_a = p_a + p_b; }
+
+    inline void deinterleave(vfloat p_a, vfloat p_b, vfloat& p_even, vfloat& p_odd) {
+        vint even;
+        vint odd;
+        deinterleave(as_int(p_a), as_int(p_b), even, odd);
+        p_even = as_float(even);
+        p_odd = as_float(odd);
+    }
+}
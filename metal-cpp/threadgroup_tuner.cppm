@@ -0,0 +1,280 @@
+module;
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+export module lib:threadgroup_tuner;
+
+import :atomic_file;
+import :pipeline_cache;
+import :compute_dispatch;
+
+export namespace compute {
+    //! What a tuned threadgroup shape is valid for.
+    struct tuning_key {
+        //! Hash of the kernel source and pipeline state, as used for the
+        //! pipeline cache.
+        gpu::pipeline_key kernel;
+        //! Hash of the device name, shapes do not carry across GPUs.
+        std::uint64_t device = 0;
+        uint3 grid;
+
+        //! @return a key for p_device_name, e.g. MTL::Device::name().
+        [[nodiscard]] static tuning_key make(gpu::pipeline_key p_kernel,
+                                             std::string_view p_device_name,
+                                             uint3 p_grid) {
+            return { p_kernel,
+                     gpu::pipeline_hasher{}.add(p_device_name).finish().value,
+                     p_grid };
+        }
+
+        bool operator==(const tuning_key&) const = default;
+    };
+
+    struct tuning_result {
+        uint3 threadgroup;
+        //! Best time measured for it, in nanoseconds.
+        double ns = 0.0;
+    };
+
+    struct threadgroup_tuner_options {
+        //! Bump when the measurement changes, older tables are discarded.
+        std::uint32_t version = 1;
+        //! Timed runs per candidate after one warm-up, the minimum counts.
+        std::size_t samples = 5;
+    };
+
+    struct threadgroup_tuner_stats {
+        std::size_t hits = 0;
+        std::size_t tunings = 0;
+        //! Calls made to the measure callback, warm-ups included.
+        std::size_t measurements = 0;
+    };
+
+    /**
+     * @brief 2D threadgroup shapes worth trying for p_grid.
+     *
+     * Power-of-two widths and heights whose product is a multiple of
+     * p_execution_width (the SIMD-group size, threadExecutionWidth() on
+     * Metal) and at most p_max_total_threads, trimmed to the grid so no
+     * candidate is mostly idle. The 1D (p_max_total_threads, 1, 1) shape
+     * is always included as the baseline.
+     */
+    std::vector<uint3> candidate_threadgroups(uint3 p_grid,
+                                              std::uint32_t p_max_total_threads,
+                                              std::uint32_t p_execution_width);
+
+    /**
+     * @brief Picks the fastest threadgroup shape per kernel, device and grid
+     * and remembers it in a small text table on disk.
+     *
+     * Timing is left to the caller, so the same tuner works with GPU
+     * timestamps on Metal and with wall-clock time around
+     * compute::dispatcher on the CPU. Like the pipeline cache the table is
+     * written to a temporary file and renamed into place, and I/O failures
+     * only cost a re-tune.
+     */
+    class threadgroup_tuner {
+    public:
+        explicit threadgroup_tuner(std::filesystem::path p_table,
+                                   threadgroup_tuner_options p_options = {});
+
+        threadgroup_tuner(const threadgroup_tuner&) = delete;
+        threadgroup_tuner& operator=(const threadgroup_tuner&) = delete;
+
+        [[nodiscard]] std::optional<tuning_result> find(
+          const tuning_key& p_key) const;
+
+        /**
+         * @brief Returns the stored shape for p_key, or times every
+         * candidate and stores the fastest.
+         *
+         * p_measure(uint3 threadgroup) runs one dispatch with that shape
+         * and returns its duration in nanoseconds.
+         *
+         * @return std::nullopt when nothing is stored and p_candidates is
+         * empty.
+         */
+        template<typename Measure>
+        std::optional<tuning_result> tune(const tuning_key& p_key,
+                                          std::span<const uint3> p_candidates,
+                                          Measure&& p_measure) {
+            if (std::optional<tuning_result> stored = find(p_key)) {
+                ++m_stats.hits;
+                return stored;
+            }
+            if (p_candidates.empty()) {
+                return std::nullopt;
+            }
+
+            tuning_result best = { p_candidates.front(),
+                                   std::numeric_limits<double>::infinity() };
+            for (const uint3& candidate : p_candidates) {
+                p_measure(candidate);
+                ++m_stats.measurements;
+                for (std::size_t i = 0; i < m_options.samples; ++i) {
+                    const double ns = p_measure(candidate);
+                    ++m_stats.measurements;
+                    if (ns < best.ns) {
+                        best = { candidate, ns };
+                    }
+                }
+            }
+            ++m_stats.tunings;
+            store(p_key, best);
+            return best;
+        }
+
+        void store(const tuning_key& p_key, const tuning_result& p_result);
+        void invalidate(const tuning_key& p_key);
+
+        [[nodiscard]] const threadgroup_tuner_stats& stats() const {
+            return m_stats;
+        }
+        [[nodiscard]] std::size_t entry_count() const {
+            return m_entries.size();
+        }
+
+    private:
+        [[nodiscard]] static std::string format_key(const tuning_key& p_key);
+        void read_table();
+        void write_table();
+
+        std::filesystem::path m_table;
+        threadgroup_tuner_options m_options;
+        std::unordered_map<std::string, tuning_result> m_entries;
+        threadgroup_tuner_stats m_stats;
+    };
+}
+
+namespace compute {
+    namespace {
+        constexpr std::string_view k_table_magic = "threadgroup-tuner";
+    }
+
+    std::vector<uint3> candidate_threadgroups(uint3 p_grid,
+                                              std::uint32_t p_max_total_threads,
+                                              std::uint32_t p_execution_width) {
+        const std::uint32_t max_width = std::bit_ceil(std::max(p_grid.x, 1u));
+        const std::uint32_t max_height = std::bit_ceil(std::max(p_grid.y, 1u));
+        // Small grids cannot fill a SIMD group, accept what fits.
+        const std::uint32_t min_threads = static_cast<std::uint32_t>(
+          std::min<std::size_t>(std::max(p_execution_width, 1u),
+                                std::bit_ceil(p_grid.volume())));
+
+        std::vector<uint3> candidates = { { p_max_total_threads, 1, 1 } };
+        for (std::uint32_t width = 1;
+             width <= std::min(max_width, p_max_total_threads);
+             width *= 2) {
+            for (std::uint32_t height = 1;
+                 height <= max_height && width * height <= p_max_total_threads;
+                 height *= 2) {
+                const uint3 shape = { width, height, 1 };
+                if (width * height % min_threads == 0 &&
+                    shape != candidates.front()) {
+                    candidates.push_back(shape);
+                }
+            }
+        }
+        return candidates;
+    }
+
+    threadgroup_tuner::threadgroup_tuner(std::filesystem::path p_table,
+                                         threadgroup_tuner_options p_options)
+      : m_table(std::move(p_table))
+      , m_options(p_options) {
+        read_table();
+    }
+
+    std::optional<tuning_result> threadgroup_tuner::find(
+      const tuning_key& p_key) const {
+        auto found = m_entries.find(format_key(p_key));
+        if (found == m_entries.end()) {
+            return std::nullopt;
+        }
+        return found->second;
+    }
+
+    void threadgroup_tuner::store(const tuning_key& p_key,
+                                  const tuning_result& p_result) {
+        m_entries[format_key(p_key)] = p_result;
+        write_table();
+    }
+
+    void threadgroup_tuner::invalidate(const tuning_key& p_key) {
+        if (m_entries.erase(format_key(p_key)) != 0) {
+            write_table();
+        }
+    }
+
+    std::string threadgroup_tuner::format_key(const tuning_key& p_key) {
+        return std::format("{} {:016x} {} {} {}",
+                           p_key.kernel.hex(),
+                           p_key.device,
+                           p_key.grid.x,
+                           p_key.grid.y,
+                           p_key.grid.z);
+    }
+
+    void threadgroup_tuner::read_table() {
+        std::ifstream file(m_table);
+        std::string magic;
+        std::uint32_t version = 0;
+        if (!(file >> magic >> version) || magic != k_table_magic ||
+            version != m_options.version) {
+            return;
+        }
+
+        std::string kernel;
+        std::string device;
+        uint3 grid;
+        tuning_result result;
+        while (file >> kernel >> device >> grid.x >> grid.y >> grid.z >>
+               result.threadgroup.x >> result.threadgroup.y >>
+               result.threadgroup.z >> result.ns) {
+            tuning_key key;
+            const bool parsed =
+              std::from_chars(kernel.data(),
+                              kernel.data() + kernel.size(),
+                              key.kernel.value,
+                              16)
+                  .ec == std::errc{} &&
+              std::from_chars(
+                device.data(), device.data() + device.size(), key.device, 16)
+                  .ec == std::errc{};
+            if (!parsed || result.threadgroup.volume() == 0) {
+                continue;
+            }
+            key.grid = grid;
+            m_entries[format_key(key)] = result;
+        }
+    }
+
+    void threadgroup_tuner::write_table() {
+        std::string text =
+          std::format("{} {}\n", k_table_magic, m_options.version);
+        for (const auto& [key, result] : m_entries) {
+            text += std::format("{} {} {} {} {:.0f}\n",
+                                key,
+                                result.threadgroup.x,
+                                result.threadgroup.y,
+                                result.threadgroup.z,
+                                result.ns);
+        }
+        gpu::write_file_atomically(m_table, std::as_bytes(std::span(text)));
+    }
+}
@@ -0,0 +1,485 @@
+module;
+
+#include <cstdint>
+#include <limits>
+
+export module lib:transcendental;
+
+import :simd;
+
+/**
+ * @brief Vectorized transcendental functions over math::simd lanes.
+ *
+ * Every function comes in two precisions. The accurate one has a
+ * documented bound in ulp of the correctly rounded result, checked by
+ * benchmarks/transcendental.cpp on every float of the stated domain for
+ * sin, cos, exp and atan, and on sampled and special arguments for atan2
+ * and pow. The fast one trades digits for shorter polynomials and a
+ * cheaper range reduction, for animation and other values nobody compares
+ * against libm.
+ *
+ * sincos reduces the argument into [-pi/4, pi/4] against pi/2 split into
+ * five parts, keeping the reduced argument as an unevaluated float pair,
+ * and evaluates minimax polynomials on the reduced range. exp and pow
+ * scale a polynomial on [-ln2/2, ln2/2] by a power of two, pow carrying
+ * log2(x) and y * log2(x) as float pairs so the error does not grow with
+ * the exponent. atan2 folds its arguments onto [0, tan(pi/8)] and adds the
+ * octant back in two parts.
+ *
+ * The constant splits are exact without a fused multiply-add, and exact
+ * products fall back to Dekker's splitting, so the SSE2 backend, where
+ * simd::fma is a separate multiply and add, meets the same bounds.
+ */
+export namespace math::simd {
+    enum class precision : std::uint8_t {
+        //! Bounded ulp error, see each function.
+        accurate,
+        //! Relative error around 1e-5, see each function.
+        fast,
+    };
+}
+
+namespace math::simd::detail {
+    constexpr float k_infinity = std::numeric_limits<float>::infinity();
+
+    inline vfloat copy_sign(vfloat p_magnitude, vfloat p_sign) {
+        return as_float(as_int(abs(p_magnitude)) |
+                        (as_int(p_sign) & vint::splat(INT32_MIN)));
+    }
+
+    inline vmask sign_bit(vfloat p_x) {
+        return (as_int(p_x) >> 31) == vint::splat(1);
+    }
+
+    inline vmask is_nan(vfloat p_x) { return ~(p_x == p_x); }
+
+    //! p_hi + p_lo == p_a * p_b exactly: the fused multiply-add's residual,
+    //! or Dekker's splitting where simd::fma is a multiply and an add.
+    inline void two_product(vfloat p_a, vfloat p_b, vfloat& p_hi, vfloat& p_lo) {
+        p_hi = p_a * p_b;
+        if constexpr (fused_fma) {
+            p_lo = fma(p_a, p_b, -p_hi);
+        }
+        else {
+            const vfloat split = vfloat::splat(4097.f);
+            const vfloat a_scaled = p_a * split;
+            const vfloat a_hi = a_scaled - (a_scaled - p_a);
+            const vfloat a_lo = p_a - a_hi;
+            const vfloat b_scaled = p_b * split;
+            const vfloat b_hi = b_scaled - (b_scaled - p_b);
+            const vfloat b_lo = p_b - b_hi;
+            p_lo = ((a_hi * b_hi - p_hi) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo;
+        }
+    }
+
+    //! p_hi + p_lo == p_a + p_b exactly, for any magnitudes.
+    inline void two_sum(vfloat p_a, vfloat p_b, vfloat& p_hi, vfloat& p_lo) {
+        p_hi = p_a + p_b;
+        const vfloat b_part = p_hi - p_a;
+        p_lo = (p_a - (p_hi - b_part)) + (p_b - b_part);
+    }
+
+    //! p_x * 2^p_n for integral p_n in [-160, 130], in two steps so that
+    //! neither power of two leaves the normal range and results that
+    //! underflow round once.
+    inline vfloat scale_by_power_of_two(vfloat p_x, vfloat p_n) {
+        const vfloat first = floor(p_n * vfloat::splat(0.5f));
+        const vfloat second = p_n - first;
+        auto power = [](vfloat p_e) {
+            return as_float((to_int(p_e) + vint::splat(127)) << 23);
+        };
+        return p_x * power(first) * power(second);
+    }
+
+    //! e^p_r for |p_r| <= ln2 / 2, within 1 ulp.
+    inline vfloat exp_reduced(vfloat p_r) {
+        vfloat p = fma(p_r, vfloat::splat(1.9875691500e-4f), vfloat::splat(1.3981999507e-3f));
+        p = fma(p, p_r, vfloat::splat(8.3334519073e-3f));
+        p = fma(p, p_r, vfloat::splat(4.1665795894e-2f));
+        p = fma(p, p_r, vfloat::splat(1.6666665459e-1f));
+        p = fma(p, p_r, vfloat::splat(5.0000001201e-1f));
+        // 1 + p_r is kept as a pair, leaving one rounding at the end.
+        const vfloat one = vfloat::splat(1.f);
+        const vfloat hi = one + p_r;
+        const vfloat lo = (one - hi) + p_r;
+        return hi + fma(p, p_r * p_r, lo);
+    }
+
+    //! 2^p_f for |p_f| <= 1/2, relative error 2.7e-6.
+    inline vfloat exp2_reduced_fast(vfloat p_f) {
+        vfloat p = fma(p_f, vfloat::splat(9.570101276e-3f), vfloat::splat(5.591785908e-2f));
+        p = fma(p, p_f, vfloat::splat(2.402474433e-1f));
+        p = fma(p, p_f, vfloat::splat(6.931217909e-1f));
+        return fma(p, p_f, vfloat::splat(9.999992847e-1f));
+    }
+
+    //! Splits positive, finite p_x into p_x = p_m * 2^p_e with p_m in
+    //! [sqrt(1/2), sqrt(2)). Subnormals are normalized first.
+    inline void decompose(vfloat p_x, vfloat& p_m, vfloat& p_e) {
+        const vmask subnormal = p_x < vfloat::splat(std::numeric_limits<float>::min());
+        const vfloat x = select(subnormal, p_x * vfloat::splat(8388608.f), p_x);
+        const vint bits = as_int(x);
+        vfloat e = to_float((bits >> 23) - vint::splat(127));
+        e = select(subnormal, e - vfloat::splat(23.f), e);
+        vfloat m = as_float((bits & vint::splat(0x007fffff)) | vint::splat(0x3f800000));
+        const vmask high = m > vfloat::splat(1.41421356f);
+        p_m = select(high, m * vfloat::splat(0.5f), m);
+        p_e = select(high, e + vfloat::splat(1.f), e);
+    }
+
+    //! log2 of positive, finite p_x as p_hi + p_lo, |p_lo| about half an
+    //! ulp of p_hi or less, good to about 2^-34 relative.
+    inline void log2_extended(vfloat p_x, vfloat& p_hi, vfloat& p_lo) {
+        vfloat m;
+        vfloat e;
+        decompose(p_x, m, e);
+        // ln(m) = 2 atanh(s) = 2s + s^3 R(s^2) for s = (m - 1) / (m + 1),
+        // |s| <= 0.172. s is carried as a pair, the series only needs to be
+        // good relative to its own small size.
+        const vfloat one = vfloat::splat(1.f);
+        const vfloat numerator = m - one;
+        vfloat denominator;
+        vfloat denominator_lo;
+        two_sum(m, one, denominator, denominator_lo);
+        const vfloat reciprocal = one / denominator;
+        const vfloat quotient = numerator * reciprocal;
+        vfloat product;
+        vfloat product_lo;
+        two_product(quotient, denominator, product, product_lo);
+        const vfloat quotient_lo =
+          (((numerator - product) - product_lo) - quotient * denominator_lo) * reciprocal;
+
+        // The leading 2s^3 / 3 of the series is kept as a pair as well,
+        // the rest is below 2^-13 of the result.
+        vfloat square;
+        vfloat square_lo;
+        two_product(quotient, quotient, square, square_lo);
+        vfloat cube;
+        vfloat cube_lo;
+        two_product(square, quotient, cube, cube_lo);
+        cube_lo = fma(square_lo, quotient,
+                      fma(square * quotient_lo, vfloat::splat(3.f), cube_lo));
+        vfloat third;
+        vfloat third_lo;
+        two_product(cube, vfloat::splat(2.f / 3.f), third, third_lo);
+        third_lo = fma(cube, vfloat::splat(-1.9868215e-8f),
+                       fma(cube_lo, vfloat::splat(2.f / 3.f), third_lo));
+        vfloat r = fma(square, vfloat::splat(2.f / 13.f), vfloat::splat(2.f / 11.f));
+        r = fma(r, square, vfloat::splat(2.f / 9.f));
+        r = fma(r, square, vfloat::splat(2.f / 7.f));
+        r = fma(r, square, vfloat::splat(2.f / 5.f));
+
+        // 2s dominates the other terms, so its sum with them rounds with
+        // an exact error.
+        const vfloat twice = quotient + quotient;
+        const vfloat ln_sum = twice + third;
+        const vfloat ln_sum_lo = (twice - ln_sum) + third;
+        // s^5 R, with 2 s^4 for the low part of s, and 2 s_lo.
+        const vfloat ln_small =
+          fma(cube * square, r,
+              fma(square * square + vfloat::splat(1.f), quotient_lo + quotient_lo, third_lo));
+        const vfloat ln_hi = ln_sum + (ln_sum_lo + ln_small);
+        const vfloat ln_lo = (ln_sum_lo + ln_small) - (ln_hi - ln_sum);
+
+        // Times 1 / ln2 as a float pair, then plus the exponent.
+        const vfloat inverse_ln2_hi = vfloat::splat(1.44269502162933349609375f);
+        const vfloat inverse_ln2_lo = vfloat::splat(1.925963033500011e-8f);
+        two_product(ln_hi, inverse_ln2_hi, product, product_lo);
+        product_lo = product_lo + fma(ln_hi, inverse_ln2_lo, ln_lo * inverse_ln2_hi);
+        vfloat sum;
+        vfloat sum_lo;
+        two_sum(e, product, sum, sum_lo);
+        sum_lo = sum_lo + product_lo;
+        p_hi = sum + sum_lo;
+        p_lo = sum_lo - (p_hi - sum);
+    }
+
+    //! log2 of positive, finite p_x, absolute error 1.5e-5.
+    inline vfloat log2_fast(vfloat p_x) {
+        vfloat m;
+        vfloat e;
+        decompose(p_x, m, e);
+        const vfloat f = m - vfloat::splat(1.f);
+        vfloat p = fma(f, vfloat::splat(2.526600957e-1f), vfloat::splat(-3.945753574e-1f));
+        p = fma(p, f, vfloat::splat(4.866861701e-1f));
+        p = fma(p, f, vfloat::splat(-7.202417850e-1f));
+        p = fma(p, f, vfloat::splat(1.442577958f));
+        return fma(p, f, e);
+    }
+}
+
+export namespace math::simd {
+    /**
+     * @brief Sine and cosine of p_x.
+     *
+     * accurate: within 1 ulp for |p_x| <= 8192, 0.85 measured, including
+     * the arguments closest to multiples of pi/2. Larger arguments lose
+     * accuracy with the reduction.
+     *
+     * fast: absolute error within 1.1e-5 for |p_x| <= 256.
+     */
+    template<precision P = precision::accurate>
+    inline void sincos(vfloat p_x, vfloat& p_sin, vfloat& p_cos) {
+        const vfloat quadrant = round(p_x * vfloat::splat(0.63661977236758134f));
+        const vint q = to_int(quadrant);
+
+        vfloat s;
+        vfloat c;
+        if constexpr (P == precision::accurate) {
+            // pi/2 in five parts, the first four 11 bits wide so that their
+            // products with quadrants below 2^13 are exact. The first two
+            // subtractions are exact as well, the next two keep their
+            // rounding errors, and r_hi + r_lo is the reduced argument to
+            // about 2^-65 absolute, which the arguments closest to a
+            // multiple of pi/2 need.
+            vfloat r = fma(quadrant, vfloat::splat(-1.5703125f), p_x);
+            r = fma(quadrant, vfloat::splat(-4.837512969970703125e-4f), r);
+            vfloat r_hi;
+            vfloat error;
+            detail::two_sum(r, quadrant * vfloat::splat(-7.549533620476723e-8f), r, error);
+            vfloat r_lo = error;
+            detail::two_sum(r, quadrant * vfloat::splat(-2.5632829192545614e-12f), r, error);
+            r_lo = fma(quadrant, vfloat::splat(-6.123234262925839e-17f), r_lo + error);
+            r_hi = r + r_lo;
+            r_lo = r_lo - (r_hi - r);
+
+            const vfloat r2 = r_hi * r_hi;
+
+            // sin(r_hi + r_lo) = sin(r_hi) + r_lo cos(r_hi), to well under
+            // an ulp.
+            s = fma(r2, vfloat::splat(-1.9515295891e-4f), vfloat::splat(8.3321608736e-3f));
+            s = fma(r2, s, vfloat::splat(-1.6666654611e-1f));
+            s = r_hi + fma(r2 * r_hi, s, fma(r_lo * r2, vfloat::splat(-0.5f), r_lo));
+
+            // cos = 1 - r2 / 2 + r2^2 Q. The rounding error of the first
+            // subtraction is recovered exactly and added back with the
+            // small terms.
+            c = fma(r2, vfloat::splat(2.443315711809948e-5f), vfloat::splat(-1.388731625493765e-3f));
+            c = fma(r2, c, vfloat::splat(4.166664568298827e-2f));
+            const vfloat half = r2 * vfloat::splat(0.5f);
+            const vfloat w = vfloat::splat(1.f) - half;
+            c = w + (((vfloat::splat(1.f) - w) - half) + fma(r2 * r2, c, -(r_hi * r_lo)));
+        }
+        else {
+            vfloat r = fma(quadrant, vfloat::splat(-1.5703125f), p_x);
+            r = fma(quadrant, vfloat::splat(-4.837512969970703125e-4f), r);
+            r = fma(quadrant, vfloat::splat(-7.54978995489188216e-8f), r);
+            const vfloat r2 = r * r;
+
+            s = fma(r2, vfloat::splat(8.150069974e-3f), vfloat::splat(-1.666238308e-1f));
+            s = fma(r2, s, vfloat::splat(9.999985099e-1f)) * r;
+
+            c = fma(r2, vfloat::splat(4.039862379e-2f), vfloat::splat(-4.997082055e-1f));
+            c = fma(r2, c, vfloat::splat(9.999900460e-1f));
+        }
+
+        // Odd quadrants swap sin and cos, quadrants 2,3 negate sin and
+        // quadrants 1,2 negate cos.
+        const vmask swap = (q & vint::splat(1)) == vint::splat(1);
+        const vint sin_sign = (q & vint::splat(2)) << 30;
+        const vint cos_sign = ((q + vint::splat(1)) & vint::splat(2)) << 30;
+
+        p_sin = as_float(as_int(select(swap, c, s)) ^ sin_sign);
+        p_cos = as_float(as_int(select(swap, s, c)) ^ cos_sign);
+    }
+
+    template<precision P = precision::accurate>
+    inline vfloat sin(vfloat p_x) {
+        vfloat s;
+        vfloat c;
+        sincos<P>(p_x, s, c);
+        return s;
+    }
+
+    template<precision P = precision::accurate>
+    inline vfloat cos(vfloat p_x) {
+        vfloat s;
+        vfloat c;
+        sincos<P>(p_x, s, c);
+        return c;
+    }
+
+    /**
+     * @brief Angle of the point (p_x, p_y) in [-pi, pi], with C's signed
+     * zero and infinity conventions.
+     *
+     * accurate: within 2 ulp for all inputs, 1.6 measured.
+     *
+     * fast: relative error within 2e-5.
+     */
+    template<precision P = precision::accurate>
+    inline vfloat atan2(vfloat p_y, vfloat p_x) {
+        const vfloat ax = abs(p_x);
+        const vfloat ay = abs(p_y);
+        vfloat hi = max(ax, ay);
+        vfloat lo = min(ax, ay);
+        // Two infinities make a diagonal, two zeros an axis.
+        const vmask both_infinite = lo == vfloat::splat(detail::k_infinity);
+        hi = select(both_infinite | (hi == vfloat::splat(0.f)), vfloat::splat(1.f), hi);
+        lo = select(both_infinite, vfloat::splat(1.f), lo);
+
+        // lo + hi below must not overflow.
+        const vmask huge = hi > vfloat::splat(0x1p126f);
+        hi = select(huge, hi * vfloat::splat(0.25f), hi);
+        lo = select(huge, lo * vfloat::splat(0.25f), lo);
+
+        // atan(lo / hi) is in [0, pi/4]. Above tan(pi/8) it is pi/4 plus
+        // atan((lo - hi) / (lo + hi)), taken as u + tail with tail small.
+        const vmask upper = lo > hi * vfloat::splat(0.41421356f);
+        const vfloat numerator = select(upper, lo - hi, lo);
+        const vfloat denominator = select(upper, lo + hi, hi);
+        const vfloat u = numerator / denominator;
+        const vfloat z = u * u;
+        vfloat head;
+        vfloat tail;
+        if constexpr (P == precision::accurate) {
+            // Both sums can round, their exact errors correct u to first
+            // order, worth most of an ulp next to pi/4.
+            const vfloat zero = vfloat::splat(0.f);
+            const vfloat numerator_error =
+              select(upper, lo - (numerator + hi), zero);
+            const vfloat denominator_error =
+              select(upper, lo - (denominator - hi), zero);
+            const vfloat u_lo = (numerator_error - u * denominator_error) / denominator;
+
+            vfloat p = fma(z, vfloat::splat(8.05374449538e-2f), vfloat::splat(-1.38776856032e-1f));
+            p = fma(p, z, vfloat::splat(1.99777106478e-1f));
+            p = fma(p, z, vfloat::splat(-3.33329491539e-1f));
+            head = u;
+            tail = fma(p * z, u, u_lo - u_lo * z);
+        }
+        else {
+            vfloat p = fma(z, vfloat::splat(1.682313681e-1f), vfloat::splat(-3.313911259e-1f));
+            p = fma(p, z, vfloat::splat(9.999819994e-1f));
+            head = p * u;
+            tail = vfloat::splat(0.f);
+        }
+
+        // The result is octant * pi/4 + sign * (head + tail). The octant
+        // offset is added in two parts, the high one exact for octants up
+        // to 4.
+        const vfloat one = vfloat::splat(1.f);
+        vfloat octant = select(upper, one, vfloat::splat(0.f));
+        vfloat sign = one;
+        const vmask steep = ay > ax;
+        octant = select(steep, vfloat::splat(2.f) - octant, octant);
+        sign = select(steep, -sign, sign);
+        const vmask left = detail::sign_bit(p_x);
+        octant = select(left, vfloat::splat(4.f) - octant, octant);
+        sign = select(left, -sign, sign);
+        // The offset is at least as large as head unless it is zero, so the
+        // rounding error of their sum is exact.
+        const vfloat offset = octant * vfloat::splat(0.78515625f);
+        const vfloat signed_head = sign * head;
+        const vfloat sum = offset + signed_head;
+        const vfloat error = (offset - sum) + signed_head;
+        const vfloat angle =
+          sum + fma(octant, vfloat::splat(2.4191339e-4f), fma(sign, tail, error));
+        return select(detail::is_nan(p_x) | detail::is_nan(p_y), p_x + p_y,
+                      detail::copy_sign(angle, p_y));
+    }
+
+    /**
+     * @brief e^p_x. Overflows to infinity above 88.72 and underflows
+     * through subnormals to zero below -103.97.
+     *
+     * accurate: within 1 ulp for every float, 0.8 measured, subnormal
+     * results in units of the subnormal spacing.
+     *
+     * fast: relative error within 1e-5 for normal results.
+     */
+    template<precision P = precision::accurate>
+    inline vfloat exp(vfloat p_x) {
+        const vfloat x = min(max(p_x, vfloat::splat(-104.f)), vfloat::splat(89.f));
+        vfloat result;
+        if constexpr (P == precision::accurate) {
+            const vfloat n = round(x * vfloat::splat(1.44269504088896341f));
+            vfloat r = fma(n, vfloat::splat(-0.693359375f), x);
+            r = fma(n, vfloat::splat(2.12194440e-4f), r);
+            result = detail::scale_by_power_of_two(detail::exp_reduced(r), n);
+        }
+        else {
+            const vfloat t = x * vfloat::splat(1.44269504088896341f);
+            const vfloat n = round(t);
+            result = detail::scale_by_power_of_two(detail::exp2_reduced_fast(t - n), n);
+        }
+        return select(detail::is_nan(p_x), p_x, result);
+    }
+
+    /**
+     * @brief p_x raised to p_y, with C's conventions for zeros, infinities,
+     * NaNs and negative bases with integral exponents.
+     *
+     * accurate: within 2 ulp, 0.9 measured. log2(p_x) and
+     * p_y * log2(p_x) are carried as float pairs, so large exponents do
+     * not magnify the error.
+     *
+     * fast: relative error within 1.1e-5 * (1 + |p_y|) for normal results.
+     */
+    template<precision P = precision::accurate>
+    inline vfloat pow(vfloat p_x, vfloat p_y) {
+        const vfloat ax = abs(p_x);
+        const vfloat ay = abs(p_y);
+        const vfloat zero = vfloat::splat(0.f);
+        const vfloat one = vfloat::splat(1.f);
+        const vfloat infinity = vfloat::splat(detail::k_infinity);
+        // Keep the core finite, special bases are patched in below.
+        const vfloat base = select((ax == zero) | (ax == infinity), one, ax);
+        // Infinite exponents as finite ones large enough to saturate any
+        // base other than one.
+        const vfloat y = min(max(p_y, vfloat::splat(-0x1p40f)), vfloat::splat(0x1p40f));
+
+        vfloat z;
+        vfloat z_lo;
+        if constexpr (P == precision::accurate) {
+            vfloat log_hi;
+            vfloat log_lo;
+            detail::log2_extended(base, log_hi, log_lo);
+            detail::two_product(y, log_hi, z, z_lo);
+            z_lo = fma(y, log_lo, z_lo);
+        }
+        else {
+            z = y * detail::log2_fast(base);
+            z_lo = zero;
+        }
+        // Far outside [-150, 128] the result is 0 or infinity either way,
+        // and the low part no longer matters.
+        const vfloat clamped = min(max(z, vfloat::splat(-160.f)), vfloat::splat(130.f));
+        z_lo = select(clamped == z, z_lo, zero);
+        z = clamped;
+        const vfloat n = round(z);
+        const vfloat f = (z - n) + z_lo;
+        vfloat result;
+        if constexpr (P == precision::accurate) {
+            result = detail::exp_reduced(f * vfloat::splat(0.693147180559945309f));
+        }
+        else {
+            result = detail::exp2_reduced_fast(f);
+        }
+        result = detail::scale_by_power_of_two(result, n);
+
+        // Zero and infinite bases: 0^y and inf^-y are 0, the rest infinity.
+        const vmask to_zero = ((ax == zero) & (p_y > zero)) |
+                              ((ax == infinity) & (p_y < zero));
+        result = select((ax == zero) | (ax == infinity),
+                        select(to_zero, zero, infinity), result);
+        // |x| == 1 stays 1 even for infinite y.
+        result = select(ax == one, one, result);
+
+        // Negative bases need an integral exponent, odd ones keep the sign.
+        // Every float of magnitude 2^24 or more is an even integer.
+        const vmask large = ay >= vfloat::splat(16777216.f);
+        const vfloat small_y = select(large, zero, p_y);
+        const vmask integral = large | (floor(small_y) == small_y);
+        const vmask odd = (to_int(small_y) & vint::splat(1)) == vint::splat(1);
+        const vmask negative = detail::sign_bit(p_x);
+        result = select(negative & odd & integral, -result, result);
+        result = select(negative & ~integral & ~(ax == zero) & ~(ax == infinity),
+                        vfloat::splat(std::numeric_limits<float>::quiet_NaN()),
+                        result);
+
+        result = select(detail::is_nan(p_x) | detail::is_nan(p_y),
+                        p_x + p_y, result);
+        return select((p_y == zero) | (p_x == one), one, result);
+    }
+}
@@ -0,0 +1,441 @@
+module;
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+
+export module lib:vertex_packing;
+
+import :math;
+import :simd;
+import :shader_types;
+
+export namespace gpu {
+    /**
+     * @brief Decode constants covering the bounds of p_vertices, so the
+     * 16-bit steps span exactly the mesh. Flat axes get a zero scale and
+     * decode to the offset.
+     */
+    [[nodiscard]] shader_types::vertex_quantization make_vertex_quantization(
+      std::span<const shader_types::vertex_data> p_vertices);
+
+    /**
+     * @brief Quantizes p_vertices into p_out, simd::lanes vertices at a
+     * time. Matches pack_vertex bit for bit.
+     *
+     * Positions and texcoords round to the nearest step, at most half a
+     * step off, values outside the quantization's bounds clamp to them.
+     * Normals are expected to be unit length.
+     */
+    void pack_vertices(const shader_types::vertex_quantization& p_quantization,
+                       std::span<const shader_types::vertex_data> p_vertices,
+                       std::span<shader_types::packed_vertex_data> p_out);
+
+    //! Inverse of pack_vertices, what the vertex shader computes.
+    void unpack_vertices(
+      const shader_types::vertex_quantization& p_quantization,
+      std::span<const shader_types::packed_vertex_data> p_packed,
+      std::span<shader_types::vertex_data> p_out);
+
+    //! One vertex at a time, the scalar definition of pack_vertices.
+    [[nodiscard]] shader_types::packed_vertex_data pack_vertex(
+      const shader_types::vertex_quantization& p_quantization,
+      const shader_types::vertex_data& p_vertex);
+
+    [[nodiscard]] shader_types::vertex_data unpack_vertex(
+      const shader_types::vertex_quantization& p_quantization,
+      const shader_types::packed_vertex_data& p_packed);
+}
+
+namespace gpu {
+    namespace {
+        using math::simd::vfloat;
+        using math::simd::vint;
+        using shader_types::packed_vertex_data;
+        using shader_types::vertex_data;
+        using shader_types::vertex_quantization;
+
+        constexpr float k_unorm16_max = 65535.f;
+        constexpr float k_snorm16_max = 32767.f;
+
+        // Position x/y/z, normal x/y/z, texcoord u/v.
+        constexpr std::size_t k_attributes = 8;
+
+        //! Reciprocal scales, zero for flat axes so they quantize to 0.
+        struct encode_scales {
+            float position[3];
+            float texcoord[2];
+        };
+
+        float inverse(float p_scale) {
+            return p_scale > 0.f ? 1.f / p_scale : 0.f;
+        }
+
+        encode_scales make_encode_scales(const vertex_quantization& p_q) {
+            return { { inverse(p_q.positionScale.x),
+                       inverse(p_q.positionScale.y),
+                       inverse(p_q.positionScale.z) },
+                     { inverse(p_q.texcoordScale.x),
+                       inverse(p_q.texcoordScale.y) } };
+        }
+
+        // Every helper below exists as a scalar and a vector overload with
+        // the same operations in the same order, the results agree exactly.
+
+        float quantize_unorm16(float p_value, float p_offset, float p_inverse) {
+            const float steps = (p_value - p_offset) * p_inverse;
+            return std::nearbyint(std::clamp(steps, 0.f, k_unorm16_max));
+        }
+
+        vint quantize_unorm16(vfloat p_value, float p_offset, float p_inverse) {
+            const vfloat steps =
+              (p_value - vfloat::splat(p_offset)) * vfloat::splat(p_inverse);
+            return math::simd::to_int(
+              math::simd::min(math::simd::max(steps, vfloat::splat(0.f)),
+                              vfloat::splat(k_unorm16_max)));
+        }
+
+        float sign_not_zero(float p_value) {
+            return p_value >= 0.f ? 1.f : -1.f;
+        }
+
+        vfloat sign_not_zero(vfloat p_value) {
+            return math::simd::select(p_value >= vfloat::splat(0.f),
+                                      vfloat::splat(1.f),
+                                      vfloat::splat(-1.f));
+        }
+
+        // Projects the normal onto the octahedron |x| + |y| + |z| = 1 and
+        // folds the lower half over the diagonals.
+        void octahedral_encode(float p_x,
+                               float p_y,
+                               float p_z,
+                               float& p_u,
+                               float& p_v) {
+            const float l1 = std::max(std::abs(p_x) + std::abs(p_y) + std::abs(p_z),
+                                      std::numeric_limits<float>::min());
+            const float u = p_x / l1;
+            const float v = p_y / l1;
+            if (p_z < 0.f) {
+                p_u = (1.f - std::abs(v)) * sign_not_zero(u);
+                p_v = (1.f - std::abs(u)) * sign_not_zero(v);
+            }
+            else {
+                p_u = u;
+                p_v = v;
+            }
+        }
+
+        void octahedral_encode(vfloat p_x,
+                               vfloat p_y,
+                               vfloat p_z,
+                               vfloat& p_u,
+                               vfloat& p_v) {
+            using namespace math::simd;
+            const vfloat one = vfloat::splat(1.f);
+            const vfloat l1 =
+              max(abs(p_x) + abs(p_y) + abs(p_z),
+                  vfloat::splat(std::numeric_limits<float>::min()));
+            const vfloat u = p_x / l1;
+            const vfloat v = p_y / l1;
+            const auto lower = p_z < vfloat::splat(0.f);
+            p_u = select(lower, (one - abs(v)) * sign_not_zero(u), u);
+            p_v = select(lower, (one - abs(u)) * sign_not_zero(v), v);
+        }
+
+        float quantize_snorm16(float p_value) {
+            return std::nearbyint(std::clamp(p_value, -1.f, 1.f) *
+                                  k_snorm16_max);
+        }
+
+        vint quantize_snorm16(vfloat p_value) {
+            using namespace math::simd;
+            return to_int(
+              min(max(p_value, vfloat::splat(-1.f)), vfloat::splat(1.f)) *
+              vfloat::splat(k_snorm16_max));
+        }
+
+        void octahedral_decode(float p_u,
+                               float p_v,
+                               float& p_x,
+                               float& p_y,
+                               float& p_z) {
+            float x = std::max(p_u / k_snorm16_max, -1.f);
+            float y = std::max(p_v / k_snorm16_max, -1.f);
+            const float z = 1.f - std::abs(x) - std::abs(y);
+            const float fold = std::max(-z, 0.f);
+            x += x >= 0.f ? -fold : fold;
+            y += y >= 0.f ? -fold : fold;
+            const float length = std::sqrt(x * x + y * y + z * z);
+            p_x = x / length;
+            p_y = y / length;
+            p_z = z / length;
+        }
+
+        void octahedral_decode(vfloat p_u,
+                               vfloat p_v,
+                               vfloat& p_x,
+                               vfloat& p_y,
+                               vfloat& p_z) {
+            using namespace math::simd;
+            const vfloat zero = vfloat::splat(0.f);
+            const vfloat minus_one = vfloat::splat(-1.f);
+            vfloat x = max(p_u / vfloat::splat(k_snorm16_max), minus_one);
+            vfloat y = max(p_v / vfloat::splat(k_snorm16_max), minus_one);
+            const vfloat z = vfloat::splat(1.f) - abs(x) - abs(y);
+            const vfloat fold = max(-z, zero);
+            x = x + select(x >= zero, -fold, fold);
+            y = y + select(y >= zero, -fold, fold);
+            const vfloat length = sqrt(x * x + y * y + z * z);
+            p_x = x / length;
+            p_y = y / length;
+            p_z = z / length;
+        }
+
+        // Packs up to simd::lanes vertices starting at p_in.
+        void pack_lanes(const vertex_quantization& p_q,
+                        const encode_scales& p_scales,
+                        const vertex_data* p_in,
+                        std::size_t p_count,
+                        packed_vertex_data* p_out) {
+            // Unused lanes quantize harmless zeros.
+            float gathered[k_attributes][math::simd::lanes] = {};
+            for (std::size_t j = 0; j < p_count; ++j) {
+                const vertex_data& vertex = p_in[j];
+                gathered[0][j] = vertex.position.x;
+                gathered[1][j] = vertex.position.y;
+                gathered[2][j] = vertex.position.z;
+                gathered[3][j] = vertex.normal.x;
+                gathered[4][j] = vertex.normal.y;
+                gathered[5][j] = vertex.normal.z;
+                gathered[6][j] = vertex.texcoord.x;
+                gathered[7][j] = vertex.texcoord.y;
+            }
+
+            const float position_offset[3] = { p_q.positionOffset.x,
+                                               p_q.positionOffset.y,
+                                               p_q.positionOffset.z };
+            const float texcoord_offset[2] = { p_q.texcoordOffset.x,
+                                               p_q.texcoordOffset.y };
+            std::int32_t quantized[7][math::simd::lanes];
+            for (int c = 0; c < 3; ++c) {
+                quantize_unorm16(vfloat::load(gathered[c]),
+                                 position_offset[c],
+                                 p_scales.position[c])
+                  .store(quantized[c]);
+            }
+            vfloat u;
+            vfloat v;
+            octahedral_encode(vfloat::load(gathered[3]),
+                              vfloat::load(gathered[4]),
+                              vfloat::load(gathered[5]),
+                              u,
+                              v);
+            quantize_snorm16(u).store(quantized[3]);
+            quantize_snorm16(v).store(quantized[4]);
+            for (int c = 0; c < 2; ++c) {
+                quantize_unorm16(vfloat::load(gathered[6 + c]),
+                                 texcoord_offset[c],
+                                 p_scales.texcoord[c])
+                  .store(quantized[5 + c]);
+            }
+
+            for (std::size_t j = 0; j < p_count; ++j) {
+                packed_vertex_data& packed = p_out[j];
+                for (int c = 0; c < 3; ++c) {
+                    packed.position[c] =
+                      static_cast<std::uint16_t>(quantized[c][j]);
+                }
+                packed.normal[0] = static_cast<std::int16_t>(quantized[3][j]);
+                packed.normal[1] = static_cast<std::int16_t>(quantized[4][j]);
+                packed.texcoord[0] = static_cast<std::uint16_t>(quantized[5][j]);
+                packed.texcoord[1] = static_cast<std::uint16_t>(quantized[6][j]);
+                packed.padding = 0;
+            }
+        }
+
+        void unpack_lanes(const vertex_quantization& p_q,
+                          const packed_vertex_data* p_in,
+                          std::size_t p_count,
+                          vertex_data* p_out) {
+            std::int32_t gathered[7][math::simd::lanes] = {};
+            for (std::size_t j = 0; j < p_count; ++j) {
+                const packed_vertex_data& packed = p_in[j];
+                for (int c = 0; c < 3; ++c) {
+                    gathered[c][j] = packed.position[c];
+                }
+                gathered[3][j] = packed.normal[0];
+                gathered[4][j] = packed.normal[1];
+                gathered[5][j] = packed.texcoord[0];
+                gathered[6][j] = packed.texcoord[1];
+            }
+
+            const float offsets[7] = {
+                p_q.positionOffset.x, p_q.positionOffset.y,
+                p_q.positionOffset.z, 0.f,
+                0.f,                  p_q.texcoordOffset.x,
+                p_q.texcoordOffset.y
+            };
+            const float scales[7] = {
+                p_q.positionScale.x, p_q.positionScale.y,
+                p_q.positionScale.z, 0.f,
+                0.f,                 p_q.texcoordScale.x,
+                p_q.texcoordScale.y
+            };
+            float decoded[8][math::simd::lanes];
+            for (int c : { 0, 1, 2, 5, 6 }) {
+                const vfloat steps =
+                  math::simd::to_float(vint::load(gathered[c]));
+                (vfloat::splat(offsets[c]) + vfloat::splat(scales[c]) * steps)
+                  .store(decoded[c < 3 ? c : c + 1]);
+            }
+            vfloat x;
+            vfloat y;
+            vfloat z;
+            octahedral_decode(math::simd::to_float(vint::load(gathered[3])),
+                              math::simd::to_float(vint::load(gathered[4])),
+                              x,
+                              y,
+                              z);
+            x.store(decoded[3]);
+            y.store(decoded[4]);
+            z.store(decoded[5]);
+
+            for (std::size_t j = 0; j < p_count; ++j) {
+                p_out[j] = { .position = { decoded[0][j],
+                                           decoded[1][j],
+                                           decoded[2][j] },
+                             .normal = { decoded[3][j],
+                                         decoded[4][j],
+                                         decoded[5][j] },
+                             .texcoord = { decoded[6][j], decoded[7][j] } };
+            }
+        }
+    }
+
+    vertex_quantization make_vertex_quantization(
+      std::span<const vertex_data> p_vertices) {
+        constexpr float k_max = std::numeric_limits<float>::max();
+        float low[5] = { k_max, k_max, k_max, k_max, k_max };
+        float high[5] = { -k_max, -k_max, -k_max, -k_max, -k_max };
+        for (const vertex_data& vertex : p_vertices) {
+            const float values[5] = { vertex.position.x,
+                                      vertex.position.y,
+                                      vertex.position.z,
+                                      vertex.texcoord.x,
+                                      vertex.texcoord.y };
+            for (int c = 0; c < 5; ++c) {
+                low[c] = std::min(low[c], values[c]);
+                high[c] = std::max(high[c], values[c]);
+            }
+        }
+        if (p_vertices.empty()) {
+            std::fill(std::begin(low), std::end(low), 0.f);
+            std::fill(std::begin(high), std::end(high), 0.f);
+        }
+        float scale[5];
+        for (int c = 0; c < 5; ++c) {
+            scale[c] = (high[c] - low[c]) / k_unorm16_max;
+        }
+        return { .positionOffset = { low[0], low[1], low[2] },
+                 .positionScale = { scale[0], scale[1], scale[2] },
+                 .texcoordOffset = { low[3], low[4] },
+                 .texcoordScale = { scale[3], scale[4] } };
+    }
+
+    void pack_vertices(const vertex_quantization& p_quantization,
+                       std::span<const vertex_data> p_vertices,
+                       std::span<packed_vertex_data> p_out) {
+        const encode_scales scales = make_encode_scales(p_quantization);
+        const std::size_t count = p_vertices.size();
+        for (std::size_t i = 0; i < count; i += math::simd::lanes) {
+            pack_lanes(p_quantization,
+                       scales,
+                       p_vertices.data() + i,
+                       std::min(math::simd::lanes, count - i),
+                       p_out.data() + i);
+        }
+    }
+
+    void unpack_vertices(const vertex_quantization& p_quantization,
+                         std::span<const packed_vertex_data> p_packed,
+                         std::span<vertex_data> p_out) {
+        const std::size_t count = p_packed.size();
+        for (std::size_t i = 0; i < count; i += math::simd::lanes) {
+            unpack_lanes(p_quantization,
+                         p_packed.data() + i,
+                         std::min(math::simd::lanes, count - i),
+                         p_out.data() + i);
+        }
+    }
+
+    packed_vertex_data pack_vertex(const vertex_quantization& p_quantization,
+                                   const vertex_data& p_vertex) {
+        const encode_scales scales = make_encode_scales(p_quantization);
+        const auto unorm16 = [](float p_value, float p_offset, float p_inverse) {
+            return static_cast<std::uint16_t>(
+              quantize_unorm16(p_value, p_offset, p_inverse));
+        };
+        float u;
+        float v;
+        octahedral_encode(
+          p_vertex.normal.x, p_vertex.normal.y, p_vertex.normal.z, u, v);
+
+        packed_vertex_data packed;
+        packed.position[0] = unorm16(p_vertex.position.x,
+                                     p_quantization.positionOffset.x,
+                                     scales.position[0]);
+        packed.position[1] = unorm16(p_vertex.position.y,
+                                     p_quantization.positionOffset.y,
+                                     scales.position[1]);
+        packed.position[2] = unorm16(p_vertex.position.z,
+                                     p_quantization.positionOffset.z,
+                                     scales.position[2]);
+        packed.normal[0] = static_cast<std::int16_t>(quantize_snorm16(u));
+        packed.normal[1] = static_cast<std::int16_t>(quantize_snorm16(v));
+        packed.texcoord[0] = unorm16(p_vertex.texcoord.x,
+                                     p_quantization.texcoordOffset.x,
+                                     scales.texcoord[0]);
+        packed.texcoord[1] = unorm16(p_vertex.texcoord.y,
+                                     p_quantization.texcoordOffset.y,
+                                     scales.texcoord[1]);
+        packed.padding = 0;
+        return packed;
+    }
+
+    vertex_data unpack_vertex(const vertex_quantization& p_quantization,
+                              const packed_vertex_data& p_packed) {
+        const auto decode = [](std::uint16_t p_steps,
+                               float p_offset,
+                               float p_scale) {
+            return p_offset + p_scale * static_cast<float>(p_steps);
+        };
+        vertex_data vertex;
+        vertex.position = {
+            decode(p_packed.position[0],
+                   p_quantization.positionOffset.x,
+                   p_quantization.positionScale.x),
+            decode(p_packed.position[1],
+                   p_quantization.positionOffset.y,
+                   p_quantization.positionScale.y),
+            decode(p_packed.position[2],
+                   p_quantization.positionOffset.z,
+                   p_quantization.positionScale.z)
+        };
+        octahedral_decode(static_cast<float>(p_packed.normal[0]),
+                          static_cast<float>(p_packed.normal[1]),
+                          vertex.normal.x,
+                          vertex.normal.y,
+                          vertex.normal.z);
+        vertex.texcoord = { decode(p_packed.texcoord[0],
+                                   p_quantization.texcoordOffset.x,
+                                   p_quantization.texcoordScale.x),
+                            decode(p_packed.texcoord[1],
+                                   p_quantization.texcoordOffset.y,
+                                   p_quantization.texcoordScale.y) };
+        return vertex;
+    }
+}
@@ -7,9 +7,23 @@
 #include <Metal/Metal.hpp>
 #include <Foundation/Foundation.hpp>
 #include <MetalKit/MetalKit.hpp>
+#include <charconv>
 #include <cstddef>
-
-#include <simd/simd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+import lib;
 
 static constexpr size_t k_instance_rows = 10;
 static constexpr size_t k_instance_columns = 10;
@@ -17,122 +31,88 @@ static constexpr size_t k_instance_depth = 10;
 static constexpr size_t k_num_instances =
   (k_instance_rows * k_instance_columns * k_instance_depth);
 static constexpr size_t k_max_frames_in_flight = 3;
-static constexpr uint32_t k_texture_width = 128;
-static constexpr uint32_t k_texture_height = 128;
-
-// namespace math {
-//     constexpr simd::float3 add(const simd::float3& a, const simd::float3& b);
-//     constexpr simd_float4x4 make_identity();
-//     simd::float4x4 make_perspective();
-//     simd::float4x4 make_x_rotate(float angle_radians);
-//     simd::float4x4 make_y_rotate(float angle_radians);
-//     simd::float4x4 make_z_rotate(float angle_radians);
-//     simd::float4x4 make_translate(const simd::float3& v);
-//     simd::float4x4 make_scale(const simd::float3& v);
-//     simd::float3x3 discard_translation(const simd::float4x4& m);
-// }
-
-namespace math {
-    struct perspective_params {
-        float fov_radians;
-        float aspect;
-        float znear;
-        float zfar;
-    };
-
-    constexpr simd::float3 add(const simd::float3& a, const simd::float3& b) {
-        return { a.x + b.x, a.y + b.y, a.z + b.z };
-    }
-
-    constexpr simd_float4x4 make_identity() {
-        using simd::float4;
-        return (simd_float4x4){ (float4){ 1.f, 0.f, 0.f, 0.f },
-                                (float4){ 0.f, 1.f, 0.f, 0.f },
-                                (float4){ 0.f, 0.f, 1.f, 0.f },
-                                (float4){ 0.f, 0.f, 0.f, 1.f } };
-    }
-
-    simd::float4x4 make_perspective(perspective_params params) {
-        using simd::float4;
-        float ys = 1.f / tanf(params.fov_radians * 0.5f);
-        float xs = ys / params.aspect;
-        float zs = params.zfar / (params.znear - params.zfar);
-        return simd_matrix_from_rows((float4){ xs, 0.0f, 0.0f, 0.0f },
-                                     (float4){ 0.0f, ys, 0.0f, 0.0f },
-                                     (float4){ 0.0f, 0.0f, zs, params.znear * zs },
-                                     (float4){ 0, 0, -1, 0 });
-    }
-
-    simd::float4x4 make_x_rotate(float angle_radians) {
-        using simd::float4;
-        const float a = angle_radians;
-        return simd_matrix_from_rows((float4){ 1.0f, 0.0f, 0.0f, 0.0f },
-                                     (float4){ 0.0f, cosf(a), sinf(a), 0.0f },
-                                     (float4){ 0.0f, -sinf(a), cosf(a), 0.0f },
-                                     (float4){ 0.0f, 0.0f, 0.0f, 1.0f });
-    }
-
-    simd::float4x4 make_y_rotate(float angle_radians) {
-        using simd::float4;
-        const float a = angle_radians;
-        return simd_matrix_from_rows((float4){ cosf(a), 0.0f, sinf(a), 0.0f },
-                                     (float4){ 0.0f, 1.0f, 0.0f, 0.0f },
-                                     (float4){ -sinf(a), 0.0f, cosf(a), 0.0f },
-                                     (float4){ 0.0f, 0.0f, 0.0f, 1.0f });
-    }
-
-    simd::float4x4 make_z_rotate(float angle_radians) {
-        using simd::float4;
-        const float a = angle_radians;
-        return simd_matrix_from_rows((float4){ cosf(a), sinf(a), 0.0f, 0.0f },
-                                     (float4){ -sinf(a), cosf(a), 0.0f, 0.0f },
-                                     (float4){ 0.0f, 0.0f, 1.0f, 0.0f },
-                                     (float4){ 0.0f, 0.0f, 0.0f, 1.0f });
-    }
+// Instances in one depth layer of the grid.
+static constexpr size_t k_instances_per_layer =
+  k_instance_rows * k_instance_columns;
+static constexpr size_t k_instance_region_size =
+  (k_num_instances * sizeof(shader_types::compact_instance_data) +
+   gpu::cpu_buffer::alignment - 1) &
+  ~(gpu::cpu_buffer::alignment - 1);
+static constexpr uint32_t k_default_texture_size = 128;
+// MTLDevice limit for 2D textures on every Apple GPU family.
+static constexpr uint32_t k_max_texture_size = 16384;
+// Command buffer, compute and blit encoders, pass descriptor, render encoder
+// and drawable, everything draw() gets back autoreleased.
+static constexpr size_t k_autoreleased_per_frame = 6;
+
+// Unit cube drawn for every instance, texture V pointing up as OBJ expects.
+static constexpr std::string_view k_cube_obj = R"(
+v -0.5 -0.5  0.5
+v  0.5 -0.5  0.5
+v  0.5  0.5  0.5
+v -0.5  0.5  0.5
+v  0.5 -0.5 -0.5
+v -0.5 -0.5 -0.5
+v -0.5  0.5 -0.5
+v  0.5  0.5 -0.5
+vt 0 0
+vt 1 0
+vt 1 1
+vt 0 1
+vn  0  0  1
+vn  1  0  0
+vn  0  0 -1
+vn -1  0  0
+vn  0  1  0
+vn  0 -1  0
+# front, right, back, left, top, bottom
+f 1/1/1 2/2/1 3/3/1 4/4/1
+f 2/1/2 5/2/2 8/3/2 3/4/2
+f 5/1/3 6/2/3 7/3/3 8/4/3
+f 6/1/4 1/2/4 4/3/4 7/4/4
+f 4/1/5 3/2/5 8/3/5 7/4/5
+f 6/1/6 5/2/6 2/3/6 1/4/6
+)";
+
+struct texture_size {
+    uint32_t width;
+    uint32_t height;
+};
 
-    simd::float4x4 make_translate(const simd::float3& v) {
-        using simd::float4;
-        const float4 col0 = { 1.0f, 0.0f, 0.0f, 0.0f };
-        const float4 col1 = { 0.0f, 1.0f, 0.0f, 0.0f };
-        const float4 col2 = { 0.0f, 0.0f, 1.0f, 0.0f };
-        const float4 col3 = { v.x, v.y, v.z, 1.0f };
-        return simd_matrix(col0, col1, col2, col3);
+// METAL_CPP_TEXTURE_SIZE sets the Mandelbrot texture size, either "512" or
+// "1024x256". Anything else keeps the default.
+static texture_size
+mandelbrot_texture_size() {
+    const texture_size fallback = { k_default_texture_size,
+                                    k_default_texture_size };
+    const char* p_value = std::getenv("METAL_CPP_TEXTURE_SIZE");
+    if (p_value == nullptr) {
+        return fallback;
     }
-
-    simd::float4x4 make_scale(const simd::float3& v) {
-        using simd::float4;
-        return simd_matrix((float4){ v.x, 0, 0, 0 },
-                           (float4){ 0, v.y, 0, 0 },
-                           (float4){ 0, 0, v.z, 0 },
-                           (float4){ 0, 0, 0, 1.0 });
+    auto parse = [](std::string_view p_text, uint32_t& p_size) {
+        const char* p_end = p_text.data() + p_text.size();
+        const auto [p_last, error] =
+          std::from_chars(p_text.data(), p_end, p_size);
+        return error == std::errc{} && p_last == p_end && p_size >= 1 &&
+               p_size <= k_max_texture_size;
+    };
+    const std::string_view text = p_value;
+    const size_t separator = text.find('x');
+    texture_size size{};
+    if (separator == std::string_view::npos) {
+        if (!parse(text, size.width)) {
+            return fallback;
+        }
+        size.height = size.width;
     }
-
-    simd::float3x3 discard_translation(const simd::float4x4& m) {
-        return simd_matrix(
-          m.columns[0].xyz, m.columns[1].xyz, m.columns[2].xyz);
+    else if (!parse(text.substr(0, separator), size.width) ||
+             !parse(text.substr(separator + 1), size.height)) {
+        return fallback;
     }
-
+    return size;
 }
 
-namespace shader_types {
-    struct vertex_data {
-        simd::float3 position;
-        simd::float3 normal;
-        simd::float2 texcoord;
-    };
-
-    struct instance_data {
-        simd::float4x4 instanceTransform;
-        simd::float3x3 instanceNormalTransform;
-        simd::float4 instanceColor;
-    };
-
-    struct camera_data {
-        simd::float4x4 perspectiveTransform;
-        simd::float4x4 worldTransform;
-        simd::float3x3 worldNormalTransform;
-    };
-}
+using autorelease_arena = ns::frame_arena<NS::AutoreleasePool>;
 
 class renderer {
 public:
@@ -149,34 +129,39 @@ public:
     // const int k_max_frames_in_flight = 3;
 
     renderer(MTL::Device* p_device)
-    : m_p_device(p_device->retain()) {
-        m_p_command_queue = m_p_device->newCommandQueue();
-        build_shaders();
-        build_compute_pipeline();
-        build_depth_stencil_states();
-        build_textures();
-        build_buffers();
-
+    : m_p_device(ns::retain(p_device)) {
+        m_p_command_queue = ns::adopt(m_p_device->newCommandQueue());
         m_semaphore = dispatch_semaphore_create(k_max_frames_in_flight);
-    }
 
-    ~renderer() {
-        m_p_texture_animation_buffer->release();
-        m_p_texture->release();
-        m_p_shader_library->release();
-        m_p_depth_stencil_state->release();
-        m_p_vertex_data_buffer->release();
-        for (uint64_t i = 0; i < k_max_frames_in_flight; ++i) {
-            m_p_instance_data_buffer[i]->release();
-        }
-        for (uint64_t i = 0; i < k_max_frames_in_flight; ++i) {
-            m_p_camera_data_buffer[i]->release();
-        }
-        m_p_index_buffer->release();
-        m_p_compute_pso->release();
-        m_p_pso->release();
-        m_p_command_queue->release();
-        m_p_device->release();
+        // Independent builds run concurrently on m_jobs, draw() starts
+        // rendering once the ones it reads are done. A stage fails by
+        // throwing. Worker threads have no autorelease pool of their own,
+        // so every stage opens one.
+        auto stage = [this](void (renderer::*p_build)()) {
+            return [this, p_build] {
+                auto p_pool = ns::adopt(NS::AutoreleasePool::alloc()->init());
+                (this->*p_build)();
+            };
+        };
+        const jobs::stage_id shaders =
+        m_build.add("shaders", stage(&renderer::build_shaders));
+        const jobs::stage_id compute_pipeline =
+        m_build.add("compute_pipeline", stage(&renderer::build_compute_pipeline));
+        const jobs::stage_id depth_stencil =
+        m_build.add("depth_stencil", stage(&renderer::build_depth_stencil_states));
+        const jobs::stage_id textures =
+        m_build.add("textures", stage(&renderer::build_textures));
+        const jobs::stage_id buffers =
+        m_build.add("buffers", stage(&renderer::build_buffers));
+        const jobs::stage_id instances =
+        m_build.add("instances", stage(&renderer::build_instances), { buffers });
+        m_draw_stages = { shaders,  compute_pipeline, depth_stencil,
+                          textures, buffers,          instances };
+        m_tuning_stage =
+        m_build.add("threadgroup_tuning",
+                    stage(&renderer::tune_mandelbrot_threadgroup),
+                    { compute_pipeline, textures, buffers });
+        m_build.run(m_jobs);
     }
 
     void
@@ -195,18 +180,33 @@ public:
                 float2 texcoord;
             };
 
-            struct VertexData
+            struct PackedVertexData
             {
-                float3 position;
-                float3 normal;
-                float2 texcoord;
+                packed_ushort3 position;
+                packed_short2 normal;
+                packed_ushort2 texcoord;
+                ushort padding;
+            };
+
+            struct VertexQuantization
+            {
+                float3 positionOffset;
+                float3 positionScale;
+                float2 texcoordOffset;
+                float2 texcoordScale;
             };
 
+            // Rows of the instance's affine transform, see
+            // shader_types::compact_instance_data.
             struct InstanceData
             {
-                float4x4 instanceTransform;
-                float3x3 instanceNormalTransform;
-                float4 instanceColor;
+                float4 instanceRows[3];
+            };
+
+            // RGBA8 unorm, red in the low byte.
+            struct InstanceStaticData
+            {
+                uint instanceColor;
             };
 
             struct CameraData
@@ -216,33 +216,69 @@ public:
                 float3x3 worldNormalTransform;
             };
 
-            v2f vertex vertexMain( device const VertexData* vertexData [[buffer(0)]],
+            // Inverse of gpu::pack_vertices' octahedral normal encoding.
+            float3 unpackNormal( short2 encoded )
+            {
+                float2 f = max( float2( encoded ) / 32767.0, -1.0 );
+                float3 n = float3( f, 1.0 - abs( f.x ) - abs( f.y ) );
+                float fold = max( -n.z, 0.0 );
+                n.xy += select( float2( fold ), float2( -fold ), n.xy >= 0.0 );
+                return normalize( n );
+            }
+
+            // The cofactor matrix, the inverse transpose up to a positive
+            // scale, so normals stay right under non-uniform scale. Matches
+            // gpu::instance_normal_transform.
+            float3x3 instanceNormalTransform( float3 c0, float3 c1, float3 c2 )
+            {
+                float3 x = cross( c1, c2 );
+                float s = dot( c0, x ) < 0.0 ? -1.0 : 1.0;
+                return float3x3( x * s, cross( c2, c0 ) * s, cross( c0, c1 ) * s );
+            }
+
+            v2f vertex vertexMain( device const PackedVertexData* vertexData [[buffer(0)]],
                                 device const InstanceData* instanceData [[buffer(1)]],
                                 device const CameraData& cameraData [[buffer(2)]],
+                                device const InstanceStaticData* instanceStaticData [[buffer(3)]],
+                                constant VertexQuantization& quantization [[buffer(4)]],
+                                device const uint* visibleInstances [[buffer(5)]],
                                 uint vertexId [[vertex_id]],
                                 uint instanceId [[instance_id]] )
             {
                 v2f o;
-
-                const device VertexData& vd = vertexData[ vertexId ];
-                float4 pos = float4( vd.position, 1.0 );
-                pos = instanceData[ instanceId ].instanceTransform * pos;
+                // Only instances that survived CPU culling are drawn.
+                const uint instance = visibleInstances[ instanceId ];
+
+                const device PackedVertexData& vd = vertexData[ vertexId ];
+                float3 position = quantization.positionOffset +
+                                  quantization.positionScale * float3( ushort3( vd.position ) );
+                const device InstanceData& inst = instanceData[ instance ];
+                float4 pos = float4( position, 1.0 );
+                pos = float4( dot( inst.instanceRows[0], pos ),
+                              dot( inst.instanceRows[1], pos ),
+                              dot( inst.instanceRows[2], pos ),
+                              1.0 );
                 pos = cameraData.perspectiveTransform * cameraData.worldTransform * pos;
                 o.position = pos;
 
-                float3 normal = instanceData[ instanceId ].instanceNormalTransform * vd.normal;
+                float3x3 normalTransform = instanceNormalTransform(
+                    float3( inst.instanceRows[0].x, inst.instanceRows[1].x, inst.instanceRows[2].x ),
+                    float3( inst.instanceRows[0].y, inst.instanceRows[1].y, inst.instanceRows[2].y ),
+                    float3( inst.instanceRows[0].z, inst.instanceRows[1].z, inst.instanceRows[2].z ) );
+                float3 normal = normalTransform * unpackNormal( short2( vd.normal ) );
                 normal = cameraData.worldNormalTransform * normal;
                 o.normal = normal;
 
-                o.texcoord = vd.texcoord.xy;
+                o.texcoord = quantization.texcoordOffset +
+                             quantization.texcoordScale * float2( ushort2( vd.texcoord ) );
 
-                o.color = half3( instanceData[ instanceId ].instanceColor.rgb );
+                o.color = half3( unpack_unorm4x8_to_float( instanceStaticData[ instance ].instanceColor ).rgb );
                 return o;
             }
 
             half4 fragment fragmentMain( v2f in [[stage_in]], texture2d< half, access::sample > tex [[texture(0)]] )
             {
-                constexpr sampler s( address::repeat, filter::linear );
+                constexpr sampler s( address::repeat, filter::linear, mip_filter::linear );
                 half3 texel = tex.sample( s, in.texcoord ).rgb;
 
                 // assume light coming from (front-top-right)
@@ -257,37 +293,52 @@ public:
         )";
 
         NS::Error* p_error = nullptr;
-        MTL::Library* p_library = m_p_device->newLibrary(
-        NS::String::string(shader_src, UTF8StringEncoding), nullptr, &p_error);
+        auto p_library = ns::adopt(m_p_device->newLibrary(
+        NS::String::string(shader_src, UTF8StringEncoding), nullptr, &p_error));
         if (!p_library) {
-            __builtin_printf("%s", p_error->localizedDescription()->utf8String());
-            assert(false);
+            throw std::runtime_error(p_error->localizedDescription()->utf8String());
         }
 
-        MTL::Function* p_vertex_fn = p_library->newFunction(
-        NS::String::string("vertexMain", UTF8StringEncoding));
-        MTL::Function* p_frag_fn = p_library->newFunction(
-        NS::String::string("fragmentMain", UTF8StringEncoding));
+        auto p_vertex_fn = ns::adopt(p_library->newFunction(
+        NS::String::string("vertexMain", UTF8StringEncoding)));
+        auto p_frag_fn = ns::adopt(p_library->newFunction(
+        NS::String::string("fragmentMain", UTF8StringEncoding)));
 
-        MTL::RenderPipelineDescriptor* p_desc =
-        MTL::RenderPipelineDescriptor::alloc()->init();
-        p_desc->setVertexFunction(p_vertex_fn);
-        p_desc->setFragmentFunction(p_frag_fn);
+        auto p_desc = ns::adopt(MTL::RenderPipelineDescriptor::alloc()->init());
+        p_desc->setVertexFunction(p_vertex_fn.get());
+        p_desc->setFragmentFunction(p_frag_fn.get());
         p_desc->colorAttachments()->object(0)->setPixelFormat(
         MTL::PixelFormat::PixelFormatBGRA8Unorm_sRGB);
         p_desc->setDepthAttachmentPixelFormat(
         MTL::PixelFormat::PixelFormatDepth16Unorm);
 
-        m_p_pso = m_p_device->newRenderPipelineState(p_desc, &p_error);
+        const gpu::pipeline_key key =
+        gpu::pipeline_hasher{}
+          .add(std::string_view(shader_src))
+          .add(std::string_view("vertexMain"))
+          .add(std::string_view("fragmentMain"))
+          .add(MTL::PixelFormat::PixelFormatBGRA8Unorm_sRGB)
+          .add(MTL::PixelFormat::PixelFormatDepth16Unorm)
+          .finish();
+        bool cached = false;
+        auto p_archive = open_pipeline_archive(key, cached);
+        if (p_archive && !cached) {
+            p_archive->addRenderPipelineFunctions(p_desc.get(), &p_error);
+        }
+        if (p_archive) {
+            p_desc->setBinaryArchives(NS::Array::array(p_archive.get()));
+        }
+
+        m_p_pso = ns::adopt(
+        m_p_device->newRenderPipelineState(p_desc.get(), &p_error));
         if (!m_p_pso) {
-            __builtin_printf("%s", p_error->localizedDescription()->utf8String());
-            assert(false);
+            throw std::runtime_error(p_error->localizedDescription()->utf8String());
+        }
+        if (p_archive && !cached) {
+            store_pipeline_archive(key, p_archive.get());
         }
 
-        p_vertex_fn->release();
-        p_frag_fn->release();
-        p_desc->release();
-        m_p_shader_library = p_library;
+        m_p_shader_library = std::move(p_library);
     }
 
     void
@@ -325,12 +376,39 @@ public:
                 uint iteration = 0;
                 uint max_iteration = 1000;
                 float xtmp = 0.0;
-                while(x * x + y * y <= 4 && iteration < max_iteration)
+
+                // Main cardioid and period-2 bulb never escape
+                float xq = x0 - 0.25;
+                float q = xq * xq + y0 * y0;
+                float xb = x0 + 1.0;
+                bool interior = q * (q + xq) <= 0.25 * y0 * y0 ||
+                                xb * xb + y0 * y0 <= 0.0625;
+
+                // Periodicity: an orbit back at a saved point cycles forever,
+                // the point is saved at power-of-two iteration counts
+                float saved_x = 0.0;
+                float saved_y = 0.0;
+                uint next_save = 1;
+                while(!interior && x * x + y * y <= 4 && iteration < max_iteration)
                 {
                     xtmp = x * x - y * y + x0;
                     y = 2 * x * y + y0;
                     x = xtmp;
                     iteration += 1;
+                    if (x == saved_x && y == saved_y)
+                    {
+                        interior = true;
+                    }
+                    if (iteration == next_save)
+                    {
+                        saved_x = x;
+                        saved_y = y;
+                        next_save *= 2;
+                    }
+                }
+                if (interior)
+                {
+                    iteration = max_iteration;
                 }
 
                 // Convert iteration result to colors
@@ -339,191 +417,424 @@ public:
             })";
         NS::Error* p_error = nullptr;
 
-        MTL::Library* p_compute_library = m_p_device->newLibrary(
-        NS::String::string(kernel_src, NS::UTF8StringEncoding), nullptr, &p_error);
+        auto p_compute_library = ns::adopt(m_p_device->newLibrary(
+        NS::String::string(kernel_src, NS::UTF8StringEncoding), nullptr, &p_error));
         if (!p_compute_library) {
-            __builtin_printf("%s", p_error->localizedDescription()->utf8String());
-            assert(false);
+            throw std::runtime_error(p_error->localizedDescription()->utf8String());
         }
 
-        MTL::Function* p_mandelbrot_fn = p_compute_library->newFunction(
-        NS::String::string("mandelbrot_set", NS::UTF8StringEncoding));
-        m_p_compute_pso = m_p_device->newComputePipelineState(p_mandelbrot_fn, &p_error);
+        auto p_mandelbrot_fn = ns::adopt(p_compute_library->newFunction(
+        NS::String::string("mandelbrot_set", NS::UTF8StringEncoding)));
+        auto p_desc = ns::adopt(MTL::ComputePipelineDescriptor::alloc()->init());
+        p_desc->setComputeFunction(p_mandelbrot_fn.get());
+
+        const gpu::pipeline_key key = gpu::pipeline_hasher{}
+                                        .add(std::string_view(kernel_src))
+                                        .add(std::string_view("mandelbrot_set"))
+                                        .finish();
+        m_compute_pipeline_key = key;
+        bool cached = false;
+        auto p_archive = open_pipeline_archive(key, cached);
+        if (p_archive && !cached) {
+            p_archive->addComputePipelineFunctions(p_desc.get(), &p_error);
+        }
+        if (p_archive) {
+            p_desc->setBinaryArchives(NS::Array::array(p_archive.get()));
+        }
+
+        m_p_compute_pso = ns::adopt(m_p_device->newComputePipelineState(
+        p_desc.get(), MTL::PipelineOptionNone, nullptr, &p_error));
         if (!m_p_compute_pso) {
-            __builtin_printf("%s", p_error->localizedDescription()->utf8String());
-            assert(false);
+            throw std::runtime_error(p_error->localizedDescription()->utf8String());
+        }
+        m_mandelbrot_threadgroup =
+        MTL::Size(m_p_compute_pso->maxTotalThreadsPerThreadgroup(), 1, 1);
+        if (p_archive && !cached) {
+            store_pipeline_archive(key, p_archive.get());
+        }
+    }
+
+    /**
+     * Opens the binary archive cached under p_key, or an empty one to be
+     * filled and handed to store_pipeline_archive() when p_cached is false.
+     * Pipelines created with a cached archive skip the GPU compile.
+     */
+    ns::ref<MTL::BinaryArchive>
+    open_pipeline_archive(const gpu::pipeline_key& p_key, bool& p_cached) {
+        // Pipelines build concurrently and the cache is single-threaded.
+        std::lock_guard lock(m_pipeline_cache_mutex);
+        auto p_desc = ns::adopt(MTL::BinaryArchiveDescriptor::alloc()->init());
+        const std::optional<std::filesystem::path> path =
+        m_pipeline_cache.find(p_key);
+        if (path) {
+            p_desc->setUrl(NS::URL::fileURLWithPath(
+            NS::String::string(path->c_str(), NS::UTF8StringEncoding)));
         }
 
-        p_mandelbrot_fn->release();
-        p_compute_library->release();
+        NS::Error* p_error = nullptr;
+        auto p_archive =
+        ns::adopt(m_p_device->newBinaryArchive(p_desc.get(), &p_error));
+        p_cached = path && p_archive;
+        if (path && !p_archive) {
+            // Written by another OS or driver version, start over.
+            m_pipeline_cache.invalidate(p_key);
+            p_desc->setUrl(nullptr);
+            p_archive =
+            ns::adopt(m_p_device->newBinaryArchive(p_desc.get(), &p_error));
+        }
+        return p_archive;
+    }
+
+    void
+    store_pipeline_archive(const gpu::pipeline_key& p_key,
+                           MTL::BinaryArchive* p_archive) {
+        // Metal only serializes to a URL, so go through a scratch file and
+        // let the cache do the atomic write.
+        std::lock_guard lock(m_pipeline_cache_mutex);
+        const std::filesystem::path scratch =
+        m_pipeline_cache.directory() / (p_key.hex() + ".archive");
+        NS::Error* p_error = nullptr;
+        if (p_archive->serializeToURL(
+              NS::URL::fileURLWithPath(
+              NS::String::string(scratch.c_str(), NS::UTF8StringEncoding)),
+              &p_error)) {
+            std::ifstream file(scratch, std::ios::binary);
+            const std::vector<char> bytes{ std::istreambuf_iterator<char>(file),
+                                           std::istreambuf_iterator<char>() };
+            m_pipeline_cache.store(p_key, std::as_bytes(std::span(bytes)));
+        }
+        std::error_code error;
+        std::filesystem::remove(scratch, error);
     }
 
     void
     build_depth_stencil_states() {
-        MTL::DepthStencilDescriptor* p_ds_desc =
-        MTL::DepthStencilDescriptor::alloc()->init();
+        auto p_ds_desc = ns::adopt(MTL::DepthStencilDescriptor::alloc()->init());
         p_ds_desc->setDepthCompareFunction(MTL::CompareFunction::CompareFunctionLess);
         p_ds_desc->setDepthWriteEnabled(true);
 
-        m_p_depth_stencil_state = m_p_device->newDepthStencilState(p_ds_desc);
-
-        p_ds_desc->release();
+        m_p_depth_stencil_state =
+        ns::adopt(m_p_device->newDepthStencilState(p_ds_desc.get()));
+        if (!m_p_depth_stencil_state) {
+            throw std::runtime_error("could not create the depth stencil state");
+        }
     }
 
     void
     build_textures() {
-        MTL::TextureDescriptor* p_texture_desc =
-        MTL::TextureDescriptor::alloc()->init();
-        p_texture_desc->setWidth(k_texture_width);
-        p_texture_desc->setHeight(k_texture_height);
+        auto p_texture_desc = ns::adopt(MTL::TextureDescriptor::alloc()->init());
+        p_texture_desc->setWidth(m_texture_size.width);
+        p_texture_desc->setHeight(m_texture_size.height);
+        p_texture_desc->setMipmapLevelCount(m_texture_layout.levels.size());
         p_texture_desc->setPixelFormat(MTL::PixelFormatRGBA8Unorm);
         p_texture_desc->setTextureType(MTL::TextureType2D);
         p_texture_desc->setStorageMode(MTL::StorageModeManaged);
         p_texture_desc->setUsage(MTL::ResourceUsageSample | MTL::ResourceUsageRead |
                             MTL::ResourceUsageWrite);
 
-        MTL::Texture* p_texture = m_p_device->newTexture(p_texture_desc);
-        m_p_texture = p_texture;
+        m_p_texture = ns::adopt(m_p_device->newTexture(p_texture_desc.get()));
+        if (!m_p_texture) {
+            throw std::runtime_error("could not create the Mandelbrot texture");
+        }
+    }
+
+    // METAL_CPP_MESH replaces the cube with an .obj, .gltf or .glb file,
+    // drawn at its own scale. Optimized meshes are cached next to the
+    // pipelines as asset files, keyed on the file's path, size and mtime,
+    // and later runs upload straight from the mapped cache.
+    [[nodiscard]] gpu::mesh_load_result
+    load_instance_mesh() const {
+        if (const char* p_path = std::getenv("METAL_CPP_MESH")) {
+            gpu::mesh_load_result loaded = gpu::load_mesh(
+              p_path,
+              std::filesystem::temp_directory_path() / "metal-cpp-sandbox" / "meshes");
+            if (loaded.status == gpu::mesh_import_status::ok &&
+                loaded.view().index_count > 0) {
+                return loaded;
+            }
+        }
 
-        p_texture_desc->release();
+        gpu::mesh_data cube;
+        const gpu::mesh_import_status status = gpu::import_obj(k_cube_obj, cube);
+        assert(status == gpu::mesh_import_status::ok);
+        (void)status;
+        gpu::mesh_load_result result;
+        result.stats = gpu::optimize_mesh(cube);
+        result.mesh = gpu::pack_mesh(cube);
+        return result;
     }
 
     void
     build_buffers() {
-        using simd::float2;
-        using simd::float3;
-
-        const float s = 0.5f;
-
-        shader_types::vertex_data verts[] = {
-            //                                         Texture
-            //   Positions           Normals         Coordinates
-            { .position = { -s, -s, +s }, .normal = { 0.f, 0.f, 1.f }, .texcoord = { 0.f, 1.f } },
-            { .position = { +s, -s, +s }, .normal = { 0.f, 0.f, 1.f }, .texcoord = { 1.f, 1.f } },
-            { .position = { +s, +s, +s }, .normal = { 0.f, 0.f, 1.f }, .texcoord = { 1.f, 0.f } },
-            { .position = { -s, +s, +s }, .normal = { 0.f, 0.f, 1.f }, .texcoord = { 0.f, 0.f } },
-
-            { .position = { +s, -s, +s }, .normal = { 1.f, 0.f, 0.f }, .texcoord = { 0.f, 1.f } },
-            { .position = { +s, -s, -s }, .normal = { 1.f, 0.f, 0.f }, .texcoord = { 1.f, 1.f } },
-            { .position = { +s, +s, -s }, .normal = { 1.f, 0.f, 0.f }, .texcoord = { 1.f, 0.f } },
-            { .position = { +s, +s, +s }, .normal = { 1.f, 0.f, 0.f }, .texcoord = { 0.f, 0.f } },
-
-            { .position = { +s, -s, -s }, .normal = { 0.f, 0.f, -1.f }, .texcoord = { 0.f, 1.f } },
-            { .position = { -s, -s, -s }, .normal = { 0.f, 0.f, -1.f }, .texcoord = { 1.f, 1.f } },
-            { .position = { -s, +s, -s }, .normal = { 0.f, 0.f, -1.f }, .texcoord = { 1.f, 0.f } },
-            { .position = { +s, +s, -s }, .normal = { 0.f, 0.f, -1.f }, .texcoord = { 0.f, 0.f } },
-
-            { .position = { -s, -s, -s }, .normal = { -1.f, 0.f, 0.f }, .texcoord = { 0.f, 1.f } },
-            { .position = { -s, -s, +s }, .normal = { -1.f, 0.f, 0.f }, .texcoord = { 1.f, 1.f } },
-            { .position = { -s, +s, +s }, .normal = { -1.f, 0.f, 0.f }, .texcoord = { 1.f, 0.f } },
-            { .position = { -s, +s, -s }, .normal = { -1.f, 0.f, 0.f }, .texcoord = { 0.f, 0.f } },
-
-            { .position = { -s, +s, +s }, .normal = { 0.f, 1.f, 0.f }, .texcoord = { 0.f, 1.f } },
-            { .position = { +s, +s, +s }, .normal = { 0.f, 1.f, 0.f }, .texcoord = { 1.f, 1.f } },
-            { .position = { +s, +s, -s }, .normal = { 0.f, 1.f, 0.f }, .texcoord = { 1.f, 0.f } },
-            { .position = { -s, +s, -s }, .normal = { 0.f, 1.f, 0.f }, .texcoord = { 0.f, 0.f } },
-
-            { .position = { -s, -s, -s }, .normal = { 0.f, -1.f, 0.f }, .texcoord = { 0.f, 1.f } },
-            { .position = { +s, -s, -s }, .normal = { 0.f, -1.f, 0.f }, .texcoord = { 1.f, 1.f } },
-            { .position = { +s, -s, +s }, .normal = { 0.f, -1.f, 0.f }, .texcoord = { 1.f, 0.f } },
-            { .position = { -s, -s, +s }, .normal = { 0.f, -1.f, 0.f }, .texcoord = { 0.f, 0.f } }
-        };
-
-        uint16_t indices[] = {
-            0,  1,  2,  2,  3,  0,  /* front */
-            4,  5,  6,  6,  7,  4,  /* right */
-            8,  9,  10, 10, 11, 8,  /* back */
-            12, 13, 14, 14, 15, 12, /* left */
-            16, 17, 18, 18, 19, 16, /* top */
-            20, 21, 22, 22, 23, 20, /* bottom */
-        };
-
-        const size_t vertex_data_size = sizeof(verts);
-        const size_t index_data_size = sizeof(indices);
-
-        MTL::Buffer* p_vertex_buffer =
-        m_p_device->newBuffer(vertex_data_size, MTL::ResourceStorageModeManaged);
-        MTL::Buffer* p_index_buffer =
-        m_p_device->newBuffer(index_data_size, MTL::ResourceStorageModeManaged);
+        // Keeps a cached mesh mapped until the buffers own their copies.
+        const gpu::mesh_load_result loaded = load_instance_mesh();
+        const gpu::mesh_view mesh = loaded.view();
+        m_vertex_quantization = mesh.quantization;
+        m_index_count = mesh.index_count;
+        m_index_type = mesh.format == gpu::index_format::uint16
+                         ? MTL::IndexType::IndexTypeUInt16
+                         : MTL::IndexType::IndexTypeUInt32;
+
+        // Instances are culled by the sphere around the quantization box,
+        // which is known without decoding a cached mesh. They get no cone:
+        // a closed mesh faces every direction, cones pay off per meshlet.
+        const math::float3 extent = { mesh.quantization.positionScale.x * 65535.f,
+                                      mesh.quantization.positionScale.y * 65535.f,
+                                      mesh.quantization.positionScale.z * 65535.f };
+        m_instance_mesh_bounds = { .center = mesh.quantization.positionOffset +
+                                             extent * 0.5f,
+                                   .radius = math::length(extent) * 0.5f };
+
+        // The GPU reads 16-byte quantized vertices, a third of vertex_data,
+        // and decodes them with m_vertex_quantization. newBuffer copies
+        // once, straight out of the mapping when the mesh came from cache.
+        m_p_vertex_data_buffer = ns::adopt(m_p_device->newBuffer(
+          mesh.vertices.data(),
+          mesh.vertices.size_bytes(),
+          MTL::ResourceStorageModeManaged));
+        m_p_index_buffer = ns::adopt(m_p_device->newBuffer(
+          mesh.indices.data(), mesh.indices.size(), MTL::ResourceStorageModeManaged));
+
+        // One ring for the transient per-frame uploads, each frame only
+        // needs room for its camera and visible-instance list plus
+        // alignment padding.
+        const size_t frame_data_size =
+        sizeof(shader_types::camera_data) + k_num_instances * sizeof(uint32_t) +
+        2 * gpu::cpu_buffer::alignment;
+        m_p_frame_data_buffer = ns::adopt(m_p_device->newBuffer(
+        k_max_frames_in_flight * frame_data_size, MTL::ResourceStorageModeManaged));
+        m_frame_allocator.emplace(m_p_frame_data_buffer.get(), k_max_frames_in_flight);
+
+        // Instance transforms persist across frames, one region per frame in
+        // flight. m_instance_store only rewrites what changed in each when
+        // instances move independently.
+        m_p_instance_buffer = ns::adopt(m_p_device->newBuffer(
+        k_max_frames_in_flight * k_instance_region_size,
+        MTL::ResourceStorageModeManaged));
+        m_p_instance_static_buffer = ns::adopt(m_p_device->newBuffer(
+        k_num_instances * sizeof(shader_types::compact_instance_static_data),
+        MTL::ResourceStorageModeManaged));
+
+        m_p_texture_animation_buffer = ns::adopt(
+        m_p_device->newBuffer(sizeof(uint), MTL::ResourceStorageModeManaged));
+        if (!m_p_vertex_data_buffer || !m_p_index_buffer ||
+            !m_p_frame_data_buffer || !m_p_instance_buffer ||
+            !m_p_instance_static_buffer || !m_p_texture_animation_buffer) {
+            throw std::runtime_error("could not allocate the mesh and frame buffers");
+        }
+    }
 
-        m_p_vertex_data_buffer = p_vertex_buffer;
-        m_p_index_buffer = p_index_buffer;
+    void
+    build_instances() {
+        const float scl = 0.2f;
+        const math::float3 object_position = { 0.f, 0.f, -10.f };
+        std::vector<math::float4> colors(k_num_instances);
 
-        memcpy(m_p_vertex_data_buffer->contents(), verts, vertex_data_size);
-        memcpy(m_p_index_buffer->contents(), indices, index_data_size);
+        for (size_t i = 0; i < k_num_instances; ++i) {
+            const size_t ix = i % k_instance_rows;
+            const size_t iy = (i / k_instance_rows) % k_instance_columns;
+            const size_t iz = i / (k_instance_rows * k_instance_columns);
 
-        m_p_vertex_data_buffer->didModifyRange(
-        NS::Range::Make(0, m_p_vertex_data_buffer->length()));
-        m_p_index_buffer->didModifyRange(NS::Range::Make(0, m_p_index_buffer->length()));
+            float x = ((float)ix - (float)k_instance_rows / 2.f) * (2.f * scl) + scl;
+            float y =
+            ((float)iy - (float)k_instance_columns / 2.f) * (2.f * scl) + scl;
+            float z = ((float)iz - (float)k_instance_depth / 2.f) * (2.f * scl);
 
-        const size_t instance_data_size =
-        k_max_frames_in_flight * k_num_instances * sizeof(shader_types::instance_data);
-        for (size_t i = 0; i < k_max_frames_in_flight; ++i) {
-            m_p_instance_data_buffer[i] = m_p_device->newBuffer(
-            instance_data_size, MTL::ResourceStorageModeManaged);
-        }
+            m_instance_position_x.push_back(object_position.x + x);
+            m_instance_position_y.push_back(object_position.y + y);
+            m_instance_position_z.push_back(object_position.z + z);
+            m_instance_rotation_y.push_back(cosf((float)iy));
+            m_instance_rotation_z.push_back(sinf((float)ix));
+            m_instance_scale.push_back(scl);
 
-        const size_t camera_data_size =
-        k_max_frames_in_flight * sizeof(shader_types::camera_data);
-        for (size_t i = 0; i < k_max_frames_in_flight; ++i) {
-            m_p_camera_data_buffer[i] =
-            m_p_device->newBuffer(camera_data_size, MTL::ResourceStorageModeManaged);
+            float i_div_num_instances = static_cast<float>(i) / (float)k_num_instances;
+            float r = i_div_num_instances;
+            float g = 1.0f - r;
+            float b = sinf(M_PI * 2.0f * i_div_num_instances);
+            colors[i] = { r, g, b, 1.0f };
         }
-
-        m_p_texture_animation_buffer =
-        m_p_device->newBuffer(sizeof(uint), MTL::ResourceStorageModeManaged);
+        // RGBA8, a quarter of the float colors.
+        gpu::pack_colors(
+        colors,
+        { static_cast<uint32_t*>(m_p_instance_static_buffer->contents()),
+          k_num_instances });
+        m_p_instance_static_buffer->didModifyRange(
+        NS::Range::Make(0, m_p_instance_static_buffer->length()));
+
+        m_instances = { .position_x = m_instance_position_x,
+                        .position_y = m_instance_position_y,
+                        .position_z = m_instance_position_z,
+                        .rotation_y = m_instance_rotation_y,
+                        .rotation_z = m_instance_rotation_z,
+                        .scale = m_instance_scale };
     }
 
     void
-    generate_mandelbrot_texture(MTL::CommandBuffer* p_command_buffer) {
+    generate_mandelbrot_texture(MTL::CommandBuffer* p_command_buffer,
+                                autorelease_arena::scope& p_pass) {
         assert(p_command_buffer);
 
+        const uint frame = (m_animation_index++) % 5000;
+        if (m_cpu_compute) {
+            // Same grid and frame as the kernel dispatch below, reused from
+            // the frame cache or computed on m_jobs. The smaller levels are
+            // filtered on m_jobs too, then the whole chain is uploaded into
+            // the managed texture.
+            m_mandelbrot_frames.render(m_jobs, frame, m_cpu_texture_pixels);
+            const std::span<std::byte> chain =
+              std::as_writable_bytes(std::span(m_cpu_texture_pixels));
+            gpu::build_mip_chain(
+              m_jobs, m_texture_layout, gpu::mip_filter::kaiser, chain);
+            for (size_t level = 0; level < m_texture_layout.levels.size();
+                 ++level) {
+                const gpu::mip_level& mip = m_texture_layout.levels[level];
+                m_p_texture->replaceRegion(
+                  MTL::Region(0, 0, 0, mip.width, mip.height, 1),
+                  level,
+                  chain.data() + mip.offset,
+                  mip.row_bytes);
+            }
+            return;
+        }
+
         uint* ptr = reinterpret_cast<uint*>(m_p_texture_animation_buffer->contents());
-        *ptr = (m_animation_index++) % 5000;
+        *ptr = frame;
         m_p_texture_animation_buffer->didModifyRange(NS::Range::Make(0, sizeof(uint)));
 
-        MTL::ComputeCommandEncoder* p_compute_encoder =
-        p_command_buffer->computeCommandEncoder();
+        encode_mandelbrot(p_pass.track(p_command_buffer->computeCommandEncoder()),
+                          m_mandelbrot_threadgroup);
 
-        p_compute_encoder->setComputePipelineState(m_p_compute_pso);
-        p_compute_encoder->setTexture(m_p_texture, 0);
-        p_compute_encoder->setBuffer(m_p_texture_animation_buffer, 0, 0);
-
-        MTL::Size grid_size = MTL::Size(k_texture_width, k_texture_height, 1);
+        MTL::BlitCommandEncoder* p_blit_encoder =
+          p_pass.track(p_command_buffer->blitCommandEncoder());
+        p_blit_encoder->generateMipmaps(m_p_texture.get());
+        p_blit_encoder->endEncoding();
+    }
 
-        NS::UInteger thread_group_size =
-        m_p_compute_pso->maxTotalThreadsPerThreadgroup();
-        MTL::Size threadgroup_size(thread_group_size, 1, 1);
+    void
+    encode_mandelbrot(MTL::ComputeCommandEncoder* p_compute_encoder,
+                      MTL::Size p_threadgroup_size) {
+        p_compute_encoder->setComputePipelineState(m_p_compute_pso.get());
+        p_compute_encoder->setTexture(m_p_texture.get(), 0);
+        p_compute_encoder->setBuffer(m_p_texture_animation_buffer.get(), 0, 0);
 
-        p_compute_encoder->dispatchThreads(grid_size, threadgroup_size);
+        MTL::Size grid_size =
+          MTL::Size(m_texture_size.width, m_texture_size.height, 1);
+        p_compute_encoder->dispatchThreads(grid_size, p_threadgroup_size);
 
         p_compute_encoder->endEncoding();
     }
 
+    /**
+     * Picks the Mandelbrot threadgroup shape by timing the candidates on the
+     * GPU, once per kernel, device and grid. Later runs read the choice
+     * back from the tuning table. Frames render with the default shape
+     * meanwhile, draw() switches once this stage is done.
+     */
     void
-    draw(MTK::View* p_view) {
-        using simd::float3;
-        using simd::float4;
-        using simd::float4x4;
+    tune_mandelbrot_threadgroup() {
+        const compute::uint3 grid = { m_texture_size.width,
+                                      m_texture_size.height,
+                                      1 };
+        const compute::tuning_key key = compute::tuning_key::make(
+          m_compute_pipeline_key, m_p_device->name()->utf8String(), grid);
+        const std::vector<compute::uint3> candidates =
+          compute::candidate_threadgroups(
+            grid,
+            static_cast<uint32_t>(m_p_compute_pso->maxTotalThreadsPerThreadgroup()),
+            static_cast<uint32_t>(m_p_compute_pso->threadExecutionWidth()));
+
+        auto measure = [this](compute::uint3 p_shape) {
+            MTL::CommandBuffer* p_cmd = m_p_command_queue->commandBuffer();
+            encode_mandelbrot(p_cmd->computeCommandEncoder(),
+                              MTL::Size(p_shape.x, p_shape.y, p_shape.z));
+            p_cmd->commit();
+            p_cmd->waitUntilCompleted();
+            return (p_cmd->GPUEndTime() - p_cmd->GPUStartTime()) * 1e9;
+        };
+        if (const std::optional<compute::tuning_result> tuned =
+              m_threadgroup_tuner.tune(key, candidates, measure)) {
+            m_tuned_mandelbrot_threadgroup = MTL::Size(
+              tuned->threadgroup.x, tuned->threadgroup.y, tuned->threadgroup.z);
+        }
+    }
 
-        NS::AutoreleasePool* p_pool = NS::AutoreleasePool::alloc()->init();
+    void
+    draw(MTK::View* p_view) {
+        using math::float3;
+        using math::float4;
+        using math::float4x4;
+
+        if (!m_resources_ready) {
+            // Keep the view's previous contents until the stages draw()
+            // reads are built. A failed one leaves null objects behind.
+            for (jobs::stage_id stage : m_draw_stages) {
+                if (!m_build.ready(stage)) {
+                    return;
+                }
+            }
+            for (jobs::stage_id stage : m_draw_stages) {
+                try {
+                    m_build.future(stage).get();
+                }
+                catch (const std::exception& p_error) {
+                    std::fprintf(stderr, "startup build failed: %s\n", p_error.what());
+                    std::exit(EXIT_FAILURE);
+                }
+            }
+            m_resources_ready = true;
+        }
+        if (!m_threadgroup_tuned && m_build.ready(m_tuning_stage)) {
+            // Tuning is optional, a failed stage keeps the default shape.
+            m_threadgroup_tuned = true;
+            if (m_tuned_mandelbrot_threadgroup) {
+                m_mandelbrot_threadgroup = *m_tuned_mandelbrot_threadgroup;
+            }
+        }
+        if (m_print_stage_timings && m_build.finished()) {
+            m_print_stage_timings = false;
+            for (const jobs::stage_timing& timing : m_build.timings()) {
+                __builtin_printf("%-18s queued %7.2f ms, ran %7.2f ms\n",
+                                 timing.name.c_str(),
+                                 timing.queued_ns() * 1e-6,
+                                 timing.run_ns() * 1e-6);
+            }
+        }
 
-        m_frame = (m_frame + 1) % k_max_frames_in_flight;
-        MTL::Buffer* p_instance_data_buffer = m_p_instance_data_buffer[m_frame];
+        auto frame = m_autorelease_arena.frame();
 
-        MTL::CommandBuffer* p_cmd = m_p_command_queue->commandBuffer();
+        MTL::CommandBuffer* p_cmd =
+        frame.track(m_p_command_queue->commandBuffer());
         dispatch_semaphore_wait(m_semaphore, DISPATCH_TIME_FOREVER);
+
+        // The semaphore already bounds the frames in flight, so the ring
+        // only refuses when it is undersized. Skip the frame rather than
+        // write over slices the GPU is still reading.
+        if (!m_frame_allocator->begin_frame()) {
+            dispatch_semaphore_signal(m_semaphore);
+            return;
+        }
+        auto camera_slice =
+        m_frame_allocator->allocate(sizeof(shader_types::camera_data));
+        auto visible_slice =
+        m_frame_allocator->allocate(k_num_instances * sizeof(uint32_t));
+        const uint64_t frame_fence = m_frame_allocator->end_frame();
+        const size_t instance_region = frame_fence % k_max_frames_in_flight;
+        const size_t instance_offset = instance_region * k_instance_region_size;
+
         renderer* p_renderer = this;
         p_cmd->addCompletedHandler(^void(MTL::CommandBuffer* p_cmd) {
+        p_renderer->m_frame_allocator->complete_frame(frame_fence);
         dispatch_semaphore_signal(p_renderer->m_semaphore);
         });
 
-        m_angle += 0.002f;
+        if (!camera_slice || !visible_slice) {
+            // Fences complete in order, so this frame's still has to pass
+            // through the queue: commit the empty command buffer.
+            p_cmd->commit();
+            return;
+        }
 
-        const float scl = 0.2f;
-        shader_types::instance_data* p_instance_data =
-        reinterpret_cast<shader_types::instance_data*>(
-            p_instance_data_buffer->contents());
+        m_angle += 0.002f;
 
         float3 object_position = { 0.f, 0.f, -10.f };
 
@@ -534,113 +845,232 @@ public:
         { -object_position.x, -object_position.y, -object_position.z });
         float4x4 full_object_rot = rt * rr1 * rr0 * rt_inv;
 
-        size_t ix = 0;
-        size_t iy = 0;
-        size_t iz = 0;
-        for (size_t i = 0; i < k_num_instances; ++i) {
-            if (ix == k_instance_rows) {
-                ix = 0;
-                iy += 1;
-            }
-            if (iy == k_instance_rows) {
-                iy = 0;
-                iz += 1;
+        m_instances.angle_scale = m_angle;
+        auto* p_region = reinterpret_cast<shader_types::compact_instance_data*>(
+        static_cast<std::byte*>(m_p_instance_buffer->contents()) +
+        instance_offset);
+        std::span<const shader_types::instance_data> instances;
+        if (!m_partial_animation) {
+            // Every instance spins with m_angle. At full churn the store's
+            // change tracking and extra copy only cost time, so compose
+            // straight into this frame's region, keeping the full matrices
+            // for culling.
+            m_jobs.parallel_for(
+            k_num_instances,
+            gpu::instance_store::chunk_size,
+            [&](size_t p_begin, size_t p_end) {
+                const std::span<shader_types::instance_data> composed =
+                std::span(m_instance_transforms).subspan(p_begin, p_end - p_begin);
+                math::compose_instance_transforms(
+                full_object_rot, m_instances, composed, p_begin);
+                gpu::pack_instances(composed,
+                                    { p_region + p_begin, p_end - p_begin });
+            });
+            m_instance_dirty.mark(
+            instance_offset,
+            k_num_instances * sizeof(shader_types::compact_instance_data));
+            instances = m_instance_transforms;
+        }
+        else {
+            // Only one depth layer catches up with m_angle per frame, the
+            // rest keep the pose they were last composed with. update()
+            // recomputes just that layer and each region only receives the
+            // instances its frame has not seen, packed into the 48-byte
+            // rows the shader reads.
+            const size_t layer = frame_fence % k_instance_depth;
+            for (size_t i = 0; i < k_instances_per_layer; ++i) {
+                m_instance_store.touch(layer * k_instances_per_layer + i);
             }
-
-            float4x4 scale = math::make_scale((float3){ scl, scl, scl });
-            float4x4 zrot = math::make_z_rotate(m_angle * sinf((float)ix));
-            float4x4 yrot = math::make_y_rotate(m_angle * cosf((float)iy));
-
-            float x = ((float)ix - (float)k_instance_rows / 2.f) * (2.f * scl) + scl;
-            float y =
-            ((float)iy - (float)k_instance_columns / 2.f) * (2.f * scl) + scl;
-            float z = ((float)iz - (float)k_instance_depth / 2.f) * (2.f * scl);
-            float4x4 translate =
-            math::make_translate(math::add(object_position, { x, y, z }));
-
-            p_instance_data[i].instanceTransform =
-            full_object_rot * translate * yrot * zrot * scale;
-            p_instance_data[i].instanceNormalTransform =
-            math::discard_translation(p_instance_data[i].instanceTransform);
-
-            float i_div_num_instances = static_cast<float>(i) / (float)k_num_instances;
-            float r = i_div_num_instances;
-            float g = 1.0f - r;
-            float b = sinf(M_PI * 2.0f * i_div_num_instances);
-            p_instance_data[i].instanceColor = (float4){ r, g, b, 1.0f };
-
-            ix += 1;
+            m_instance_store.update(full_object_rot, m_instances, &m_jobs);
+            m_instance_store.sync(
+            instance_region,
+            { p_region, k_num_instances },
+            [&](size_t p_first, size_t p_count) {
+                m_instance_dirty.mark(
+                instance_offset + p_first * sizeof(shader_types::compact_instance_data),
+                p_count * sizeof(shader_types::compact_instance_data));
+            });
+            instances = m_instance_store.instances();
         }
-        p_instance_data_buffer->didModifyRange(
-        NS::Range::Make(0, p_instance_data_buffer->length()));
+        m_instance_dirty.flush([this](size_t p_offset, size_t p_size) {
+            m_p_instance_buffer->didModifyRange(
+            NS::Range::Make(p_offset, p_size));
+        });
 
         // Update camera state:
 
-        MTL::Buffer* p_camera_data_buffer = m_p_camera_data_buffer[m_frame];
         shader_types::camera_data* p_camera_data =
-        reinterpret_cast<shader_types::camera_data*>(
-            p_camera_data_buffer->contents());
+        camera_slice->as<shader_types::camera_data>();
         p_camera_data->perspectiveTransform =
         math::make_perspective({ .fov_radians = 45.f * M_PI / 180.f, .aspect = 1.f, .znear = 0.03f, .zfar = 500.0f });
         p_camera_data->worldTransform = math::make_identity();
         p_camera_data->worldNormalTransform =
         math::discard_translation(p_camera_data->worldTransform);
-        p_camera_data_buffer->didModifyRange(
-        NS::Range::Make(0, sizeof(shader_types::camera_data)));
+        m_frame_data_dirty.mark(camera_slice->offset, camera_slice->size);
+
+        // Cull instances against the camera, the GPU only reads the
+        // compacted list of survivors. The world transform is the identity,
+        // so the camera sits at the origin.
+        math::transform_bounds(m_instance_mesh_bounds,
+                               instances,
+                               m_instance_bounds);
+        const math::frustum view_frustum = math::make_frustum(
+        p_camera_data->perspectiveTransform * p_camera_data->worldTransform);
+        const size_t visible_count = math::cull_bounds(
+        view_frustum,
+        { 0.f, 0.f, 0.f },
+        m_instance_bounds.view(),
+        { visible_slice->as<uint32_t>(), k_num_instances });
+        // Nearest first, so the depth test rejects the fragments of cubes
+        // hidden behind them before they are shaded. The grid turns slowly,
+        // so last frame's order usually only needs fixing up.
+        m_depth_sorter.sort(view_frustum,
+                            m_instance_bounds.view(),
+                            { visible_slice->as<uint32_t>(), visible_count },
+                            &m_jobs);
+        m_frame_data_dirty.mark(visible_slice->offset,
+                                visible_count * sizeof(uint32_t));
+
+        // Normally a single didModifyRange covering only what was written.
+        m_frame_data_dirty.flush([this](size_t p_offset, size_t p_size) {
+            m_p_frame_data_buffer->didModifyRange(
+            NS::Range::Make(p_offset, p_size));
+        });
 
         // Update texture:
 
-        generate_mandelbrot_texture(p_cmd);
+        {
+            auto compute_pass = m_autorelease_arena.sub_pass();
+            generate_mandelbrot_texture(p_cmd, compute_pass);
+        }
 
         // Begin render pass:
 
-        MTL::RenderPassDescriptor* p_rpd = p_view->currentRenderPassDescriptor();
-        MTL::RenderCommandEncoder* p_enc = p_cmd->renderCommandEncoder(p_rpd);
+        auto render_pass = m_autorelease_arena.sub_pass();
+        MTL::RenderPassDescriptor* p_rpd =
+        render_pass.track(p_view->currentRenderPassDescriptor());
+        MTL::RenderCommandEncoder* p_enc =
+        render_pass.track(p_cmd->renderCommandEncoder(p_rpd));
 
-        p_enc->setRenderPipelineState(m_p_pso);
-        p_enc->setDepthStencilState(m_p_depth_stencil_state);
+        p_enc->setRenderPipelineState(m_p_pso.get());
+        p_enc->setDepthStencilState(m_p_depth_stencil_state.get());
 
-        p_enc->setVertexBuffer(m_p_vertex_data_buffer, /* offset */ 0, /* index */ 0);
-        p_enc->setVertexBuffer(p_instance_data_buffer, /* offset */ 0, /* index */ 1);
-        p_enc->setVertexBuffer(p_camera_data_buffer, /* offset */ 0, /* index */ 2);
+        p_enc->setVertexBuffer(m_p_vertex_data_buffer.get(), /* offset */ 0, /* index */ 0);
+        p_enc->setVertexBuffer(m_p_instance_buffer.get(), instance_offset, /* index */ 1);
+        p_enc->setVertexBuffer(m_p_frame_data_buffer.get(), camera_slice->offset, /* index */ 2);
+        p_enc->setVertexBuffer(m_p_instance_static_buffer.get(), /* offset */ 0, /* index */ 3);
+        p_enc->setVertexBytes(&m_vertex_quantization, sizeof(m_vertex_quantization), /* index */ 4);
+        p_enc->setVertexBuffer(m_p_frame_data_buffer.get(), visible_slice->offset, /* index */ 5);
 
-        p_enc->setFragmentTexture(m_p_texture, /* index */ 0);
+        p_enc->setFragmentTexture(m_p_texture.get(), /* index */ 0);
 
         p_enc->setCullMode(MTL::CullModeBack);
         p_enc->setFrontFacingWinding(MTL::Winding::WindingCounterClockwise);
 
-        p_enc->drawIndexedPrimitives(MTL::PrimitiveType::PrimitiveTypeTriangle,
-                                    static_cast<NS::UInteger>(6 * 6),
-                                    MTL::IndexType::IndexTypeUInt16,
-                                    m_p_index_buffer,
-                                    0,
-                                    k_num_instances);
+        if (visible_count > 0) {
+            p_enc->drawIndexedPrimitives(MTL::PrimitiveType::PrimitiveTypeTriangle,
+                                        static_cast<NS::UInteger>(m_index_count),
+                                        m_index_type,
+                                        m_p_index_buffer.get(),
+                                        0,
+                                        visible_count);
+        }
 
         p_enc->endEncoding();
-        p_cmd->presentDrawable(p_view->currentDrawable());
+        p_cmd->presentDrawable(render_pass.track(p_view->currentDrawable()));
         p_cmd->commit();
+    }
 
-        p_pool->release();
+    //! Autoreleased-object counts of the frames drawn so far.
+    [[nodiscard]] const ns::frame_arena_metrics&
+    autorelease_metrics() const {
+        return m_autorelease_arena.metrics();
     }
 
 
 private:
-    MTL::Device* m_p_device;
-    MTL::CommandQueue* m_p_command_queue;
-    MTL::Library* m_p_shader_library;
-    MTL::RenderPipelineState* m_p_pso;
-    MTL::ComputePipelineState* m_p_compute_pso;
-    MTL::DepthStencilState* m_p_depth_stencil_state;
-    MTL::Texture* m_p_texture;
-    MTL::Buffer* m_p_vertex_data_buffer;
-    MTL::Buffer* m_p_instance_data_buffer[k_max_frames_in_flight];
-    MTL::Buffer* m_p_camera_data_buffer[k_max_frames_in_flight];
-    MTL::Buffer* m_p_index_buffer;
-    MTL::Buffer* m_p_texture_animation_buffer;
+    ns::ref<MTL::Device> m_p_device;
+    std::mutex m_pipeline_cache_mutex;
+    gpu::pipeline_cache m_pipeline_cache{
+        std::filesystem::temp_directory_path() / "metal-cpp-sandbox" / "pipelines"
+    };
+    gpu::pipeline_key m_compute_pipeline_key;
+    compute::threadgroup_tuner m_threadgroup_tuner{
+        std::filesystem::temp_directory_path() / "metal-cpp-sandbox" / "threadgroups"
+    };
+    // Until tuned, the 1D shape of maxTotalThreadsPerThreadgroup threads.
+    MTL::Size m_mandelbrot_threadgroup = MTL::Size(1024, 1, 1);
+    // Written by the tuning stage, picked up by draw() once it is done.
+    std::optional<MTL::Size> m_tuned_mandelbrot_threadgroup;
+    ns::ref<MTL::CommandQueue> m_p_command_queue;
+    ns::ref<MTL::Library> m_p_shader_library;
+    ns::ref<MTL::RenderPipelineState> m_p_pso;
+    ns::ref<MTL::ComputePipelineState> m_p_compute_pso;
+    ns::ref<MTL::DepthStencilState> m_p_depth_stencil_state;
+    ns::ref<MTL::Texture> m_p_texture;
+    ns::ref<MTL::Buffer> m_p_vertex_data_buffer;
+    ns::ref<MTL::Buffer> m_p_frame_data_buffer;
+    std::optional<gpu::frame_ring_allocator<MTL::Buffer>> m_frame_allocator;
+    gpu::dirty_range_tracker m_frame_data_dirty{ { .merge_gap = gpu::cpu_buffer::alignment } };
+    ns::ref<MTL::Buffer> m_p_instance_buffer;
+    ns::ref<MTL::Buffer> m_p_instance_static_buffer;
+    gpu::instance_store m_instance_store{ k_num_instances, k_max_frames_in_flight };
+    std::vector<shader_types::instance_data> m_instance_transforms =
+    std::vector<shader_types::instance_data>(k_num_instances);
+    gpu::dirty_range_tracker m_instance_dirty{ { .merge_gap = gpu::cpu_buffer::alignment } };
+    ns::ref<MTL::Buffer> m_p_index_buffer;
+    uint32_t m_index_count{};
+    MTL::IndexType m_index_type = MTL::IndexType::IndexTypeUInt16;
+    shader_types::vertex_quantization m_vertex_quantization{};
+    math::cluster_bounds m_instance_mesh_bounds{};
+    math::bounds_storage m_instance_bounds;
+    math::depth_sorter m_depth_sorter;
+    ns::ref<MTL::Buffer> m_p_texture_animation_buffer;
+    std::vector<float> m_instance_position_x;
+    std::vector<float> m_instance_position_y;
+    std::vector<float> m_instance_position_z;
+    std::vector<float> m_instance_rotation_y;
+    std::vector<float> m_instance_rotation_z;
+    std::vector<float> m_instance_scale;
+    math::instance_transform_soa m_instances;
+    jobs::scheduler m_jobs;
+    autorelease_arena m_autorelease_arena{ { .object_budget = k_autoreleased_per_frame } };
     float m_angle{};
-    uint64_t m_frame{};
     dispatch_semaphore_t m_semaphore;
     uint m_animation_index{};
+    texture_size m_texture_size = mandelbrot_texture_size();
+    gpu::mip_chain_layout m_texture_layout = gpu::mip_chain_layout::make(
+      gpu::texel_format::rgba8_unorm, m_texture_size.width, m_texture_size.height);
+    // Runs the Mandelbrot kernel on the CPU backend instead of the GPU.
+    bool m_cpu_compute = std::getenv("METAL_CPP_CPU_COMPUTE") != nullptr;
+    // METAL_CPP_PARTIAL_ANIMATION animates one layer of the grid per frame
+    // through m_instance_store instead of composing every instance into
+    // the upload region, to show the cost of a scene with low churn.
+    bool m_partial_animation =
+      std::getenv("METAL_CPP_PARTIAL_ANIMATION") != nullptr;
+    // Every mip level, level 0 first, one RGBA8 texel per element.
+    std::vector<uint32_t> m_cpu_texture_pixels =
+      std::vector<uint32_t>(m_texture_layout.bytes / sizeof(uint32_t));
+    // Frames are reprojected from the nearest cached zoom, half a pixel off
+    // at most, and recomputed only when nothing close enough is cached.
+    compute::mandelbrot_frame_cache m_mandelbrot_frames{
+        m_texture_size.width,
+        m_texture_size.height,
+        { .max_bytes = 16u << 20, .max_error = 0.5f },
+        { .boundary_tracing = true },
+        { .interior_checks = true, .periodicity = true }
+    };
+    // Every startup stage except the threadgroup tuning.
+    std::vector<jobs::stage_id> m_draw_stages;
+    jobs::stage_id m_tuning_stage{};
+    bool m_threadgroup_tuned = false;
+    bool m_resources_ready = false;
+    // METAL_CPP_STAGE_TIMINGS prints each startup stage's queue and run
+    // time once every stage has finished.
+    bool m_print_stage_timings = std::getenv("METAL_CPP_STAGE_TIMINGS") != nullptr;
+    // Last, so it is destroyed first and waits for stages still touching
+    // the members above.
+    jobs::build_graph m_build;
 };
 
 class my_mtk_view_delegate : public MTK::ViewDelegate {
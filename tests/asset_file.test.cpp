@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+import lib;
+
+namespace {
+    std::vector<std::byte> pattern(std::size_t p_size, std::uint32_t p_seed) {
+        std::vector<std::byte> bytes(p_size);
+        for (std::size_t i = 0; i < p_size; ++i) {
+            p_seed = p_seed * 1664525u + 1013904223u;
+            bytes[i] = static_cast<std::byte>(p_seed >> 24);
+        }
+        return bytes;
+    }
+
+    void patch_byte(const std::filesystem::path& p_path,
+                    std::size_t p_offset,
+                    std::byte p_value) {
+        std::fstream file(p_path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(static_cast<std::streamoff>(p_offset));
+        file.put(static_cast<char>(p_value));
+    }
+}
+
+int
+main() {
+    using namespace boost::ut;
+    const std::filesystem::path directory =
+      std::filesystem::temp_directory_path() / "metal-cpp-asset-file-test";
+    std::filesystem::remove_all(directory);
+    const std::filesystem::path path = directory / "sections.asset";
+
+    const std::uint32_t k_first = gpu::asset_tag("ONE ");
+    const std::uint32_t k_second = gpu::asset_tag("TWO ");
+    const std::uint32_t k_empty = gpu::asset_tag("NONE");
+    // One payload just past a page, so the padding path runs.
+    const std::vector<std::byte> first =
+      pattern(gpu::k_asset_page_alignment + 3, 1);
+    const std::vector<std::byte> second = pattern(1000, 2);
+
+    "writer writes"_test = [&] {
+        gpu::asset_writer writer;
+        writer.add(k_first, first);
+        writer.add(k_empty, {});
+        writer.add(k_second, second);
+        expect(writer.write(path));
+    };
+
+    "sections round trip, page aligned"_test = [&] {
+        gpu::asset_reader reader;
+        expect(reader.open(path) == gpu::asset_status::ok);
+        expect(reader.section_count() == 3);
+        expect(std::ranges::equal(reader.find(k_first), first));
+        expect(std::ranges::equal(reader.find(k_second), second));
+        expect(reader.contains(k_empty) && reader.find(k_empty).empty());
+        expect(!reader.contains(gpu::asset_tag("MISS")));
+        for (std::uint32_t tag : { k_first, k_second }) {
+            expect((reader.find(tag).data() - reader.file().data()) %
+                     gpu::k_asset_page_alignment ==
+                   0);
+        }
+        expect(reader.file().size() ==
+               4 * std::size_t{ gpu::k_asset_page_alignment });
+    };
+
+    // The spans belong to the mapping, not to the reader object.
+    "spans survive a move"_test = [&] {
+        gpu::asset_reader reader;
+        expect(reader.open(path) == gpu::asset_status::ok);
+        const std::byte* before = reader.find(k_second).data();
+        gpu::asset_reader moved = std::move(reader);
+        expect(moved.find(k_second).data() == before);
+        expect(std::ranges::equal(moved.find(k_second), second));
+    };
+
+    "damaged files are rejected"_test = [&] {
+        const std::filesystem::path damaged = directory / "damaged.asset";
+        gpu::asset_reader reader;
+
+        std::filesystem::copy_file(path, damaged);
+        patch_byte(damaged, gpu::k_asset_page_alignment + 10,
+                   std::byte{ 0x55 });
+        expect(reader.open(damaged) == gpu::asset_status::corrupt);
+        expect(reader.open(damaged, gpu::asset_verify::layout) ==
+               gpu::asset_status::ok);
+
+        std::filesystem::copy_file(
+          path, damaged, std::filesystem::copy_options::overwrite_existing);
+        patch_byte(damaged, 64 + 16, std::byte{ 0x7f });
+        expect(reader.open(damaged, gpu::asset_verify::layout) ==
+               gpu::asset_status::corrupt);
+
+        std::filesystem::copy_file(
+          path, damaged, std::filesystem::copy_options::overwrite_existing);
+        std::filesystem::resize_file(
+          damaged, std::filesystem::file_size(damaged) - 1);
+        expect(reader.open(damaged) == gpu::asset_status::truncated);
+
+        std::filesystem::copy_file(
+          path, damaged, std::filesystem::copy_options::overwrite_existing);
+        patch_byte(damaged, 8, std::byte{ 9 });
+        expect(reader.open(damaged) == gpu::asset_status::version_mismatch);
+
+        patch_byte(damaged, 0, std::byte{ 'X' });
+        expect(reader.open(damaged) == gpu::asset_status::not_an_asset);
+        expect(reader.open(directory / "missing.asset") ==
+               gpu::asset_status::unreadable);
+        expect(reader.file().empty() && reader.section_count() == 0);
+    };
+
+    "checksum sees lengths and bit flips"_test = [&] {
+        const std::vector<std::byte> zeros(64);
+        expect(gpu::asset_checksum(std::span(zeros).first(7)) !=
+               gpu::asset_checksum(std::span(zeros).first(8)));
+        expect(gpu::asset_checksum(first) ==
+               gpu::asset_checksum(pattern(first.size(), 1)));
+        // Every single-bit flip of a short buffer changes the sum.
+        std::vector<std::byte> bytes = pattern(45, 3);
+        const std::uint64_t sum = gpu::asset_checksum(bytes);
+        bool changed = true;
+        for (std::size_t bit = 0; bit < bytes.size() * 8; ++bit) {
+            bytes[bit / 8] ^= std::byte{ 1 } << (bit % 8);
+            changed &= gpu::asset_checksum(bytes) != sum;
+            bytes[bit / 8] ^= std::byte{ 1 } << (bit % 8);
+        }
+        expect(changed);
+    };
+
+    "mapped mesh matches packed"_test = [&] {
+        gpu::mesh_data quad;
+        expect(gpu::import_obj(
+                 std::string_view("v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+                                  "f 1 2 3 4\n"),
+                 quad) == gpu::mesh_import_status::ok);
+        gpu::optimize_mesh(quad);
+        const gpu::packed_mesh packed = gpu::pack_mesh(quad);
+        const std::filesystem::path mesh_path = directory / "quad.mesh";
+        expect(gpu::save_mesh_cache(mesh_path, packed.view(), 7));
+        const std::optional<gpu::mapped_mesh> mapped =
+          gpu::map_mesh_cache(mesh_path, 7);
+        expect(mapped.has_value());
+        expect(mapped->view.index_count == packed.index_count &&
+               std::ranges::equal(mapped->view.indices, packed.indices));
+        expect(std::memcmp(mapped->view.vertices.data(),
+                           packed.vertices.data(),
+                           packed.vertices.size() *
+                             sizeof(shader_types::packed_vertex_data)) == 0);
+        expect(!gpu::map_mesh_cache(mesh_path, 8).has_value());
+    };
+
+    std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,85 @@
+#include <cstddef>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+import lib;
+
+namespace {
+    constexpr std::size_t k_frames = 100;
+    constexpr std::size_t k_sub_passes = 4;
+    constexpr std::size_t k_objects_per_pass = 6;
+    constexpr std::size_t k_budget = k_sub_passes * k_objects_per_pass;
+
+    using arena = ns::frame_arena<ns::mock_autorelease_pool>;
+
+    struct run_result {
+        ns::frame_arena_metrics metrics;
+        std::size_t undrained = 0;
+    };
+
+    // Runs k_frames frames, p_extra_every adds one stray object to every
+    // n-th frame.
+    run_result simulate(ns::frame_arena_options p_options,
+                        std::size_t p_extra_every) {
+        run_result result;
+        std::vector<ns::mock_object> objects(k_budget + 1);
+
+        arena frames(p_options);
+        for (std::size_t frame = 0; frame < k_frames; ++frame) {
+            objects.assign(objects.size(), ns::mock_object{});
+            std::size_t used = 0;
+            {
+                auto frame_scope = frames.frame();
+                for (std::size_t pass = 0; pass < k_sub_passes; ++pass) {
+                    auto sub_pass = frames.sub_pass();
+                    std::size_t count = k_objects_per_pass;
+                    if (p_extra_every != 0 && frame % p_extra_every == 0 &&
+                        pass == 0) {
+                        ++count;
+                    }
+                    for (std::size_t i = 0; i < count; ++i) {
+                        sub_pass.autorelease(&objects[used++]);
+                    }
+                }
+            }
+            for (std::size_t i = 0; i < used; ++i) {
+                result.undrained += objects[i].destroyed() ? 0 : 1;
+            }
+        }
+        result.metrics = frames.metrics();
+        return result;
+    }
+}
+
+int
+main() {
+    using namespace boost::ut;
+
+    "batched frames drain every object"_test = [] {
+        const run_result result = simulate({ .object_budget = k_budget }, 0);
+        expect(result.undrained == 0);
+        expect(result.metrics.over_budget_frames == 0);
+        expect(result.metrics.peak_frame_objects == k_budget);
+        expect(result.metrics.last_frame_pools == 1);
+    };
+
+    "pool per sub-pass drains every object"_test = [] {
+        const run_result result = simulate(
+          { .object_budget = k_budget, .pool_per_sub_pass = true }, 0);
+        expect(result.undrained == 0);
+        expect(result.metrics.over_budget_frames == 0);
+        // The frame pool plus one per sub-pass.
+        expect(result.metrics.last_frame_pools == k_sub_passes + 1);
+    };
+
+    "stray objects are caught by the budget"_test = [] {
+        const run_result result = simulate({ .object_budget = k_budget }, 10);
+        expect(result.undrained == 0);
+        expect(result.metrics.over_budget_frames == k_frames / 10);
+    };
+
+    "nothing leaks outside a pool"_test = [] {
+        expect(ns::mock_autorelease_pool::leaked() == 0);
+    };
+}
@@ -0,0 +1,78 @@
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+import lib;
+
+int
+main() {
+    using namespace boost::ut;
+
+    "dependents start after their dependencies end"_test = [] {
+        jobs::scheduler workers(4);
+        jobs::build_graph graph;
+        std::atomic<int> finished = 0;
+        std::vector<int> seen(8, -1);
+        std::vector<jobs::stage_id> roots;
+        for (int i = 0; i < 4; ++i) {
+            roots.push_back(graph.add("root", [&] { ++finished; }));
+        }
+        for (int i = 0; i < 4; ++i) {
+            graph.add("dependent",
+                      [&, i] { seen[i] = finished.load(); },
+                      { roots[0], roots[1], roots[2], roots[3] });
+        }
+        graph.run(workers);
+        graph.wait();
+        const std::vector<jobs::stage_timing> timings = graph.timings();
+        for (int i = 0; i < 4; ++i) {
+            expect(seen[i] == 4);
+            for (int root = 0; root < 4; ++root) {
+                expect(timings[4 + i].start_ns >= timings[root].end_ns);
+            }
+        }
+    };
+
+    // Diamond with a failing stage: the failure reaches every dependent
+    // and skips their work, the independent branch still runs.
+    "failure propagates to dependents"_test = [] {
+        jobs::scheduler workers(4);
+        jobs::build_graph diamond;
+        std::atomic<int> ran = 0;
+        const auto root = diamond.add("root", [&] { ++ran; });
+        const auto left = diamond.add(
+          "left", [] { throw std::runtime_error("left failed"); }, { root });
+        const auto right = diamond.add("right", [&] { ++ran; }, { root });
+        const auto join =
+          diamond.add("join", [&] { ++ran; }, { left, right });
+        const auto side = diamond.add("side", [&] { ++ran; });
+        diamond.run(workers);
+        diamond.wait();
+
+        bool join_failed = false;
+        try {
+            diamond.future(join).get();
+        }
+        catch (const std::runtime_error&) {
+            join_failed = true;
+        }
+        expect(join_failed);
+        // The failed branch is skipped, everything else ran.
+        expect(ran == 3 && diamond.ready(side) && diamond.finished());
+    };
+
+    // Without workers the graph runs inline inside run().
+    "inline scheduler runs in order"_test = [] {
+        jobs::scheduler inline_jobs(0);
+        jobs::build_graph chain;
+        std::vector<int> order;
+        const auto a = chain.add("a", [&] { order.push_back(0); });
+        const auto b = chain.add("b", [&] { order.push_back(1); }, { a });
+        chain.add("c", [&] { order.push_back(2); }, { b });
+        chain.run(inline_jobs);
+        expect(chain.finished());
+        expect(order == std::vector<int>{ 0, 1, 2 });
+    };
+}
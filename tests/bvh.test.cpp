@@ -0,0 +1,324 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <numbers>
+#include <optional>
+#include <random>
+#include <span>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+import lib;
+
+namespace {
+    constexpr float k_miss = std::numeric_limits<float>::infinity();
+
+    // Side of the cube instances are scattered over, keeping the density
+    // the same at every count.
+    float scene_side(std::size_t p_count) {
+        return 4.f * std::cbrt(static_cast<float>(p_count));
+    }
+
+    // Unit cubes rotated, scaled and scattered around the origin.
+    std::vector<shader_types::instance_data> random_instances(std::size_t p_count,
+                                                              std::uint32_t p_seed) {
+        std::mt19937 rng(p_seed);
+        const float half = scene_side(p_count) * 0.5f;
+        std::uniform_real_distribution<float> position(-half, half);
+        std::uniform_real_distribution<float> angle(-3.f, 3.f);
+        std::uniform_real_distribution<float> scale(0.3f, 1.5f);
+        std::vector<shader_types::instance_data> instances(p_count);
+        for (shader_types::instance_data& instance : instances) {
+            instance.instanceTransform =
+              math::make_translate({ position(rng), position(rng), position(rng) }) *
+              math::make_y_rotate(angle(rng)) * math::make_x_rotate(angle(rng)) *
+              math::make_scale({ scale(rng), scale(rng), scale(rng) });
+        }
+        return instances;
+    }
+
+    std::vector<math::aabb> instance_bounds(
+      std::span<const shader_types::instance_data> p_instances) {
+        const math::aabb cube = { { -1.f, -1.f, -1.f }, { 1.f, 1.f, 1.f } };
+        std::vector<math::aabb> bounds;
+        for (const shader_types::instance_data& instance : p_instances) {
+            bounds.push_back(math::transform_aabb(cube, instance.instanceTransform));
+        }
+        return bounds;
+    }
+
+    math::frustum camera_frustum(std::size_t p_count, float p_yaw) {
+        return math::make_frustum(
+          math::make_perspective({ .fov_radians = std::numbers::pi_v<float> / 3.f,
+                                   .aspect = 16.f / 9.f,
+                                   .znear = 0.1f,
+                                   .zfar = scene_side(p_count) * 0.5f }) *
+          math::make_y_rotate(p_yaw));
+    }
+
+    // Keeps every box in.
+    math::frustum everything() {
+        math::frustum all;
+        std::ranges::fill(all.planes, math::float4{ 0.f, 0.f, 0.f, 1.f });
+        return all;
+    }
+
+    std::size_t brute_force_query(const math::frustum& p_frustum,
+                                  std::span<const math::aabb> p_bounds,
+                                  std::span<std::uint32_t> p_visible) {
+        std::size_t written = 0;
+        for (std::size_t i = 0; i < p_bounds.size(); ++i) {
+            if (math::intersects(p_frustum, p_bounds[i])) {
+                p_visible[written++] = static_cast<std::uint32_t>(i);
+            }
+        }
+        return written;
+    }
+
+    // Smallest distance, in double, of a box's outermost corner to the
+    // planes. Boxes this close to zero may land on either side.
+    bool on_boundary(const math::frustum& p_frustum, const math::aabb& p_box) {
+        double margin = 1e30;
+        for (const math::float4& plane : p_frustum.planes) {
+            const double x = plane.x >= 0.f ? p_box.max.x : p_box.min.x;
+            const double y = plane.y >= 0.f ? p_box.max.y : p_box.min.y;
+            const double z = plane.z >= 0.f ? p_box.max.z : p_box.min.z;
+            margin = std::min(margin, plane.x * x + plane.y * y + plane.z * z + plane.w);
+        }
+        return std::abs(margin) < 1e-3;
+    }
+
+    // The query agrees with the brute force loop, each instance at most
+    // once, boxes touching a plane aside.
+    bool matches_brute_force(const math::bvh& p_tree, const math::frustum& p_frustum) {
+        const std::span<const math::aabb> bounds = p_tree.bounds();
+        std::vector<std::uint32_t> expected(bounds.size());
+        std::vector<std::uint32_t> got(bounds.size());
+        expected.resize(brute_force_query(p_frustum, bounds, expected));
+        got.resize(p_tree.query(p_frustum, got));
+        std::ranges::sort(got);
+        if (std::ranges::adjacent_find(got) != got.end()) {
+            return false;
+        }
+        std::vector<std::uint32_t> differ;
+        std::ranges::set_symmetric_difference(expected, got, std::back_inserter(differ));
+        return std::ranges::all_of(
+          differ, [&](std::uint32_t p_i) { return on_boundary(p_frustum, bounds[p_i]); });
+    }
+
+    math::ray random_ray(std::mt19937& p_rng, std::size_t p_count) {
+        const float half = scene_side(p_count) * 0.5f;
+        std::uniform_real_distribution<float> position(-half, half);
+        std::normal_distribution<float> direction;
+        return { .origin = { position(p_rng), position(p_rng), position(p_rng) },
+                 .direction = math::normalize(
+                   { direction(p_rng), direction(p_rng), direction(p_rng) }) };
+    }
+
+    // Entry distance into a box in double, infinity on a miss.
+    double box_entry(const math::ray& p_ray, const math::aabb& p_box) {
+        double enter = 0.0;
+        double leave = p_ray.max_distance;
+        const float* origin = &p_ray.origin.x;
+        const float* direction = &p_ray.direction.x;
+        const float* lo = &p_box.min.x;
+        const float* hi = &p_box.max.x;
+        for (int a = 0; a < 3; ++a) {
+            if (direction[a] == 0.f) {
+                if (origin[a] < lo[a] || origin[a] > hi[a]) {
+                    return k_miss;
+                }
+                continue;
+            }
+            const double t0 = (lo[a] - static_cast<double>(origin[a])) / direction[a];
+            const double t1 = (hi[a] - static_cast<double>(origin[a])) / direction[a];
+            enter = std::max(enter, std::min(t0, t1));
+            leave = std::min(leave, std::max(t0, t1));
+        }
+        return enter <= leave ? enter : k_miss;
+    }
+
+    // A sphere inside every box, so the exact test decides hits.
+    float sphere_hit(const math::aabb& p_box, const math::ray& p_ray) {
+        const math::float3 center = (p_box.min + p_box.max) * 0.5f;
+        const math::float3 extent = p_box.max - p_box.min;
+        const float radius = 0.5f * std::min({ extent.x, extent.y, extent.z });
+        const math::float3 offset = p_ray.origin - center;
+        const float b = math::dot(offset, p_ray.direction);
+        const float c = math::dot(offset, offset) - radius * radius;
+        const float discriminant = b * b - c;
+        if (discriminant < 0.f) {
+            return k_miss;
+        }
+        const float t = -b - std::sqrt(discriminant);
+        return t >= 0.f && t <= p_ray.max_distance ? t : k_miss;
+    }
+
+    struct brute_force_hit {
+        std::uint32_t index = 0;
+        double distance = k_miss;
+    };
+
+    brute_force_hit brute_force_box_ray(const math::ray& p_ray,
+                                        std::span<const math::aabb> p_bounds) {
+        brute_force_hit best;
+        for (std::size_t i = 0; i < p_bounds.size(); ++i) {
+            const double distance = box_entry(p_ray, p_bounds[i]);
+            if (distance < best.distance) {
+                best = { static_cast<std::uint32_t>(i), distance };
+            }
+        }
+        return best;
+    }
+
+    brute_force_hit brute_force_sphere_ray(const math::ray& p_ray,
+                                           std::span<const math::aabb> p_bounds) {
+        brute_force_hit best;
+        for (std::size_t i = 0; i < p_bounds.size(); ++i) {
+            const float distance = sphere_hit(p_bounds[i], p_ray);
+            if (distance < best.distance) {
+                best = { static_cast<std::uint32_t>(i), distance };
+            }
+        }
+        return best;
+    }
+
+    // Box hits agree on the distance, to rounding, and the sphere hits
+    // exactly since both sides run the same test.
+    bool rays_match(const math::bvh& p_tree, std::size_t p_rays, std::uint32_t p_seed) {
+        std::mt19937 rng(p_seed);
+        const std::span<const math::aabb> bounds = p_tree.bounds();
+        bool ok = true;
+        for (std::size_t r = 0; r < p_rays; ++r) {
+            math::ray ray = random_ray(rng, bounds.size());
+            if (r % 4 == 3) {
+                ray.max_distance = 2.f;
+            }
+            const brute_force_hit box = brute_force_box_ray(ray, bounds);
+            const std::optional<math::ray_hit> hit = p_tree.raycast(ray);
+            ok &= hit.has_value() == (box.distance != k_miss);
+            if (hit && box.distance != k_miss) {
+                ok &= std::abs(hit->distance - box.distance) <= 1e-4 * (1.0 + box.distance);
+            }
+
+            const brute_force_hit sphere = brute_force_sphere_ray(ray, bounds);
+            const std::optional<math::ray_hit> exact = p_tree.raycast(
+              ray, [&](std::uint32_t p_index, const math::ray& p_ray) {
+                  return sphere_hit(bounds[p_index], p_ray);
+              });
+            ok &= exact.has_value() == (sphere.distance != k_miss);
+            if (exact && sphere.distance != k_miss) {
+                ok &= exact->index == sphere.index && exact->distance == sphere.distance;
+            }
+        }
+        return ok;
+    }
+
+    // Moves p_count random instances by up to p_step along each axis.
+    void move_some(std::vector<math::aabb>& p_bounds,
+                   std::size_t p_count,
+                   float p_step,
+                   std::mt19937& p_rng,
+                   math::bvh& p_tree) {
+        std::uniform_int_distribution<std::size_t> pick(0, p_bounds.size() - 1);
+        std::uniform_real_distribution<float> step(-p_step, p_step);
+        for (std::size_t i = 0; i < p_count; ++i) {
+            const std::size_t index = pick(p_rng);
+            const math::float3 offset = { step(p_rng), step(p_rng), step(p_rng) };
+            p_bounds[index] = { p_bounds[index].min + offset, p_bounds[index].max + offset };
+            p_tree.set_bounds(index, p_bounds[index]);
+        }
+    }
+}
+
+int
+main() {
+    using namespace boost::ut;
+    jobs::scheduler parallel(3);
+
+    "empty and small trees"_test = [&] {
+        math::bvh tree;
+        tree.build({});
+        std::vector<std::uint32_t> visible(1);
+        tree.refit();
+        bool ok = tree.query(everything(), visible) == 0 && !tree.raycast({}) &&
+                  tree.node_count() == 0 && tree.sah_cost() == 0.f;
+        // Small trees, a lone leaf included, against the brute force loop.
+        const std::vector<math::aabb> bounds =
+          instance_bounds(random_instances(300, 1));
+        for (std::size_t count = 1; count <= 40; ++count) {
+            tree.build(std::span(bounds).first(count));
+            ok &= matches_brute_force(tree, everything()) &&
+                  matches_brute_force(tree, camera_frustum(count, 0.3f)) &&
+                  rays_match(tree, 8, 2);
+        }
+        expect(ok);
+    };
+
+    "coincident instances"_test = [] {
+        // Every centroid in the same spot leaves nothing for SAH to split.
+        std::vector<math::aabb> same(1000, { { -1.f, -1.f, -1.f }, { 1.f, 1.f, 1.f } });
+        for (std::size_t i = 0; i < same.size(); i += 2) {
+            same[i] = { { -2.f, -2.f, -2.f }, { 2.f, 2.f, 2.f } };
+        }
+        math::bvh tree;
+        tree.build(same);
+        std::vector<std::uint32_t> visible(same.size());
+        expect(tree.query(everything(), visible) == same.size());
+        expect(matches_brute_force(tree, everything()));
+        expect(rays_match(tree, 16, 3));
+    };
+
+    const std::vector<math::aabb> scene =
+      instance_bounds(random_instances(20'000, 4));
+    math::bvh tree;
+    tree.build(scene);
+    "frustum queries match brute force"_test = [&] {
+        for (float yaw = 0.f; yaw < 6.2f; yaw += 0.7f) {
+            expect(matches_brute_force(tree, camera_frustum(scene.size(), yaw)));
+        }
+        expect(matches_brute_force(tree, everything()));
+    };
+    "ray casts match brute force"_test = [&] { expect(rays_match(tree, 200, 5)); };
+
+    "parallel build matches the serial one"_test = [&] {
+        math::bvh threaded;
+        threaded.build(scene, &parallel);
+        const float serial_cost = tree.sah_cost();
+        expect(threaded.node_count() == tree.node_count());
+        expect(std::abs(threaded.sah_cost() - serial_cost) <=
+               1e-4f * serial_cost);
+        expect(matches_brute_force(threaded,
+                                   camera_frustum(scene.size(), 1.f)));
+        expect(rays_match(threaded, 50, 6));
+    };
+
+    "refit keeps queries exact"_test = [&] {
+        // A few instances at a time, then everything at once.
+        std::vector<math::aabb> moved = scene;
+        math::bvh refitted;
+        refitted.build(moved);
+        std::mt19937 rng(7);
+        bool ok = true;
+        for (int frame = 0; frame < 8; ++frame) {
+            move_some(moved, moved.size() / 100, 2.f, rng, refitted);
+            refitted.refit(frame % 2 ? &parallel : nullptr);
+            ok &= matches_brute_force(refitted, camera_frustum(moved.size(), frame * 0.8f)) &&
+                  rays_match(refitted, 20, 8 + frame);
+        }
+        std::uniform_real_distribution<float> step(-4.f, 4.f);
+        for (math::aabb& box : moved) {
+            const math::float3 offset = { step(rng), step(rng), step(rng) };
+            box = { box.min + offset, box.max + offset };
+        }
+        ok &= refitted.update(moved) && !refitted.update(std::span(moved).first(10));
+        refitted.refit(&parallel);
+        ok &= matches_brute_force(refitted, camera_frustum(moved.size(), 2.f)) &&
+              matches_brute_force(refitted, everything()) && rays_match(refitted, 50, 20);
+        expect(ok);
+    };
+}
@@ -0,0 +1,129 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+import lib;
+
+namespace {
+    using compute::kernel_thread;
+    using compute::thread_context;
+    using compute::uint3;
+
+    // Tree reduction through threadgroup memory, one partial sum per group.
+    struct group_sum {
+        const float* in;
+        float* out;
+        std::size_t count;
+
+        kernel_thread operator()(const thread_context& p_thread) const {
+            const std::span<float> shared = p_thread.threadgroup_memory<float>(0);
+            const std::uint32_t local = p_thread.thread_index_in_threadgroup;
+            const std::uint32_t global = p_thread.thread_position_in_grid.x;
+            shared[local] = global < count ? in[global] : 0.f;
+            co_await p_thread.barrier();
+
+            for (std::uint32_t stride = p_thread.threads_per_threadgroup.x / 2;
+                 stride > 0; stride /= 2) {
+                if (local < stride) {
+                    shared[local] += shared[local + stride];
+                }
+                co_await p_thread.barrier();
+            }
+            if (local == 0) {
+                out[p_thread.threadgroup_position_in_grid.x] = shared[0];
+            }
+        }
+    };
+}
+
+int
+main() {
+    using namespace boost::ut;
+    jobs::scheduler workers;
+    compute::dispatcher encoder(workers);
+
+    "mandelbrot kernel matches reference"_test = [&] {
+        constexpr std::uint32_t width = 128;
+        constexpr std::uint32_t height = 128;
+        const uint3 threadgroup = {
+            compute::dispatcher::max_total_threads_per_threadgroup, 1, 1
+        };
+        std::vector<std::uint32_t> texture(width * height);
+        std::vector<std::uint32_t> reference(width * height);
+        const std::uint32_t frame = 42;
+        compute::dispatch_mandelbrot_reference(width, height, frame, reference);
+        expect(encoder.dispatch_threads(
+                 { width, height, 1 }, threadgroup,
+                 compute::mandelbrot_kernel{ texture, frame }) ==
+               compute::dispatch_status::ok);
+        expect(texture == reference);
+    };
+
+    // Non-uniform 3D grid: every thread runs once and the attributes agree.
+    "3D non-uniform grid covered exactly once"_test = [&] {
+        const uint3 grid = { 37, 19, 5 };
+        const uint3 group = { 8, 4, 2 };
+        std::vector<std::atomic<int>> visits(grid.volume());
+        std::atomic<bool> consistent = true;
+        encoder.dispatch_threads(grid, group, [&](const thread_context& p_t) {
+            const uint3 g = p_t.threadgroup_position_in_grid;
+            const uint3 l = p_t.thread_position_in_threadgroup;
+            const uint3 p = p_t.thread_position_in_grid;
+            const uint3 s = p_t.threads_per_threadgroup;
+            consistent = consistent && p.x == g.x * group.x + l.x &&
+                         p.y == g.y * group.y + l.y &&
+                         p.z == g.z * group.z + l.z && l.x < s.x &&
+                         l.y < s.y && l.z < s.z &&
+                         p_t.thread_index_in_threadgroup ==
+                           (l.z * s.y + l.y) * s.x + l.x &&
+                         p_t.threadgroups_per_grid == uint3{ 5, 5, 3 };
+            ++visits[(std::size_t{ p.z } * grid.y + p.y) * grid.x + p.x];
+        });
+        for (const std::atomic<int>& count : visits) {
+            expect(count == 1);
+        }
+        expect(consistent.load());
+    };
+
+    "threadgroup reduction matches"_test = [&] {
+        constexpr std::size_t count = 1 << 16;
+        constexpr std::uint32_t group_size = 256;
+        std::vector<float> values(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            values[i] = static_cast<float>(i % 7);
+        }
+        std::vector<float> partials(count / group_size);
+        encoder.set_threadgroup_memory_length(group_size * sizeof(float), 0);
+        expect(encoder.dispatch_threads(
+                 { count, 1, 1 }, { group_size, 1, 1 },
+                 group_sum{ values.data(), partials.data(), count }) ==
+               compute::dispatch_status::ok);
+        for (std::size_t group = 0; group < partials.size(); ++group) {
+            const float expected =
+              std::accumulate(values.begin() + group * group_size,
+                              values.begin() + (group + 1) * group_size, 0.f);
+            expect(partials[group] == expected);
+        }
+    };
+
+    "divergent barrier reported"_test = [&] {
+        expect(encoder.dispatch_threads(
+                 { 64, 1, 1 }, { 32, 1, 1 },
+                 [](const thread_context& p_t) -> kernel_thread {
+                     if (p_t.thread_index_in_threadgroup % 2 == 0) {
+                         co_await p_t.barrier();
+                     }
+                 }) == compute::dispatch_status::barrier_divergence);
+    };
+
+    "oversized threadgroup rejected"_test = [&] {
+        expect(encoder.dispatch_threads({ 64, 1, 1 }, { 2048, 1, 1 },
+                                        [](const thread_context&) {}) ==
+               compute::dispatch_status::invalid_threadgroup_size);
+    };
+}
@@ -0,0 +1,345 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+#include <random>
+#include <span>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+import lib;
+
+namespace {
+    constexpr int k_rings = 128;
+    constexpr int k_sides = 64;
+    constexpr std::size_t k_sphere_count = std::size_t{ 1 } << 16;
+
+    gpu::mesh_data make_torus() {
+        gpu::mesh_data mesh;
+        for (int r = 0; r < k_rings; ++r) {
+            for (int s = 0; s < k_sides; ++s) {
+                const float u = 2.f * std::numbers::pi_v<float> * r / k_rings;
+                const float v = 2.f * std::numbers::pi_v<float> * s / k_sides;
+                mesh.vertices.push_back(
+                  { .position = { std::cos(u) * (1.f + 0.35f * std::cos(v)),
+                                  std::sin(u) * (1.f + 0.35f * std::cos(v)),
+                                  0.35f * std::sin(v) },
+                    .normal = { std::cos(u) * std::cos(v),
+                                std::sin(u) * std::cos(v),
+                                std::sin(v) },
+                    .texcoord = { 0.f, 0.f } });
+            }
+        }
+        auto index = [](int p_ring, int p_side) {
+            return static_cast<std::uint32_t>((p_ring % k_rings) * k_sides +
+                                              p_side % k_sides);
+        };
+        for (int r = 0; r < k_rings; ++r) {
+            for (int s = 0; s < k_sides; ++s) {
+                const std::uint32_t a = index(r, s);
+                const std::uint32_t b = index(r + 1, s);
+                const std::uint32_t c = index(r + 1, s + 1);
+                const std::uint32_t d = index(r, s + 1);
+                mesh.indices.insert(mesh.indices.end(), { a, b, c, a, c, d });
+            }
+        }
+        gpu::optimize_vertex_cache(mesh.indices, mesh.vertices.size());
+        return mesh;
+    }
+
+    math::float3 face_normal(const math::float3& p_a,
+                             const math::float3& p_b,
+                             const math::float3& p_c) {
+        return math::cross(p_b - p_a, p_c - p_a);
+    }
+
+    // Keeps every element in, so only the cone test decides.
+    math::frustum everything() {
+        math::frustum all;
+        std::ranges::fill(all.planes, math::float4{ 0.f, 0.f, 0.f, 1.f });
+        return all;
+    }
+
+    math::float4x4 camera_view_projection() {
+        return math::make_perspective({ .fov_radians = std::numbers::pi_v<float> / 3.f,
+                                        .aspect = 16.f / 9.f,
+                                        .znear = 0.1f,
+                                        .zfar = 100.f }) *
+               math::make_y_rotate(0.4f);
+    }
+
+    // Smallest signed margin of one element against every test, in
+    // double. Negative means culled.
+    double reference_margin(const math::frustum& p_frustum,
+                            const math::float3& p_camera,
+                            const math::bounds_soa& p_bounds,
+                            std::size_t p_i) {
+        const double x = p_bounds.center_x[p_i];
+        const double y = p_bounds.center_y[p_i];
+        const double z = p_bounds.center_z[p_i];
+        const double r = p_bounds.radius[p_i];
+        double margin = 1e30;
+        for (const math::float4& plane : p_frustum.planes) {
+            margin = std::min(margin,
+                              plane.x * x + plane.y * y + plane.z * z + plane.w + r);
+        }
+        if (!p_bounds.cone_cutoff.empty()) {
+            const double dx = x - p_camera.x;
+            const double dy = y - p_camera.y;
+            const double dz = z - p_camera.z;
+            const double along = p_bounds.cone_axis_x[p_i] * dx +
+                                 p_bounds.cone_axis_y[p_i] * dy +
+                                 p_bounds.cone_axis_z[p_i] * dz;
+            margin = std::min(margin, p_bounds.cone_cutoff[p_i] *
+                                          std::sqrt(dx * dx + dy * dy + dz * dz) +
+                                        r - along);
+        }
+        return margin;
+    }
+
+    // Spheres scattered around the camera, with cones of random width.
+    math::bounds_storage random_bounds(std::size_t p_count, std::uint32_t p_seed) {
+        std::mt19937 rng(p_seed);
+        std::uniform_real_distribution<float> position(-40.f, 40.f);
+        std::uniform_real_distribution<float> radius(0.05f, 2.f);
+        std::normal_distribution<float> direction;
+        std::uniform_real_distribution<float> cutoff(0.f, 1.f);
+        math::bounds_storage bounds;
+        for (std::size_t i = 0; i < p_count; ++i) {
+            bounds.center_x.push_back(position(rng));
+            bounds.center_y.push_back(position(rng));
+            bounds.center_z.push_back(position(rng));
+            bounds.radius.push_back(radius(rng));
+            const math::float3 axis = math::normalize(
+              { direction(rng), direction(rng), direction(rng) });
+            bounds.cone_axis_x.push_back(axis.x);
+            bounds.cone_axis_y.push_back(axis.y);
+            bounds.cone_axis_z.push_back(axis.z);
+            bounds.cone_cutoff.push_back(cutoff(rng));
+        }
+        return bounds;
+    }
+
+    math::bounds_soa without_cones(math::bounds_soa p_bounds) {
+        p_bounds.cone_axis_x = {};
+        p_bounds.cone_axis_y = {};
+        p_bounds.cone_axis_z = {};
+        p_bounds.cone_cutoff = {};
+        return p_bounds;
+    }
+
+    math::bounds_soa first(math::bounds_soa p_bounds, std::size_t p_count) {
+        for (std::span<const float>* stream :
+             { &p_bounds.center_x, &p_bounds.center_y, &p_bounds.center_z,
+               &p_bounds.radius, &p_bounds.cone_axis_x, &p_bounds.cone_axis_y,
+               &p_bounds.cone_axis_z, &p_bounds.cone_cutoff }) {
+            if (!stream->empty()) {
+                *stream = stream->first(p_count);
+            }
+        }
+        return p_bounds;
+    }
+
+    // Elements whose margin is not within rounding of zero must agree.
+    bool matches_reference(const math::frustum& p_frustum,
+                           const math::float3& p_camera,
+                           const math::bounds_soa& p_bounds,
+                           std::uint32_t p_first) {
+        const std::size_t count = p_bounds.radius.size();
+        std::vector<std::uint32_t> visible(count);
+        visible.resize(
+          math::cull_bounds(p_frustum, p_camera, p_bounds, visible, p_first));
+        if (!std::ranges::is_sorted(visible) ||
+            std::ranges::adjacent_find(visible) != visible.end()) {
+            return false;
+        }
+        std::size_t at = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            const bool listed = at < visible.size() && visible[at] == p_first + i;
+            at += listed;
+            const double margin = reference_margin(p_frustum, p_camera, p_bounds, i);
+            if (std::abs(margin) > 1e-3 && listed != (margin >= 0.)) {
+                return false;
+            }
+        }
+        return at == visible.size();
+    }
+}
+
+int
+main() {
+    using namespace boost::ut;
+    const gpu::mesh_data torus = make_torus();
+    const std::size_t triangle_count = torus.indices.size() / 3;
+    const gpu::meshlet_data meshlets =
+      gpu::build_meshlets(torus.indices, torus.vertices);
+
+    "meshlets keep limits and every triangle"_test = [&] {
+        bool ok = meshlets.bounds.size() == meshlets.meshlets.size();
+        std::vector<std::array<std::uint32_t, 3>> rebuilt;
+        for (const gpu::meshlet& m : meshlets.meshlets) {
+            ok &= m.vertex_count <= 64 && m.triangle_count <= 124 &&
+                  m.triangle_count > 0;
+            for (std::uint32_t t = 0; t < m.triangle_count; ++t) {
+                std::array<std::uint32_t, 3> triangle{};
+                for (std::uint32_t k = 0; k < 3; ++k) {
+                    const std::uint8_t local =
+                      meshlets.triangles[(m.triangle_offset + t) * 3 + k];
+                    ok &= local < m.vertex_count;
+                    triangle[k] = meshlets.vertices[m.vertex_offset + local];
+                }
+                rebuilt.push_back(triangle);
+            }
+        }
+        std::vector<std::array<std::uint32_t, 3>> original;
+        for (std::size_t t = 0; t < triangle_count; ++t) {
+            original.push_back({ torus.indices[t * 3], torus.indices[t * 3 + 1],
+                                 torus.indices[t * 3 + 2] });
+        }
+        std::ranges::sort(rebuilt);
+        std::ranges::sort(original);
+        expect(ok && rebuilt == original);
+    };
+
+    "meshlet spheres hold their vertices"_test = [&] {
+        bool ok = true;
+        for (std::size_t i = 0; i < meshlets.meshlets.size(); ++i) {
+            const gpu::meshlet& m = meshlets.meshlets[i];
+            const math::cluster_bounds& b = meshlets.bounds[i];
+            for (std::uint32_t v = 0; v < m.vertex_count; ++v) {
+                const math::float3 p =
+                  torus.vertices[meshlets.vertices[m.vertex_offset + v]].position;
+                ok &= math::length(p - b.center) <= b.radius * 1.0001f + 1e-6f;
+            }
+        }
+        expect(ok);
+    };
+
+    // Every meshlet the cone test drops must be back facing in full.
+    "cone test only drops back-facing meshlets"_test = [&] {
+        math::bounds_storage bounds;
+        math::split_bounds(meshlets.bounds, bounds);
+        std::size_t cone_culled = 0;
+        std::mt19937 rng(20);
+        std::normal_distribution<float> direction;
+        std::uniform_real_distribution<float> distance(1.5f, 6.f);
+        std::vector<std::uint32_t> visible(bounds.size());
+        bool ok = true;
+        for (int view = 0; view < 256; ++view) {
+            const math::float3 camera =
+              math::normalize({ direction(rng), direction(rng), direction(rng) }) *
+              distance(rng);
+            const std::size_t count =
+              math::cull_bounds(everything(), camera, bounds.view(), visible);
+            std::size_t at = 0;
+            for (std::uint32_t i = 0; i < bounds.size(); ++i) {
+                if (at < count && visible[at] == i) {
+                    ++at;
+                    continue;
+                }
+                const gpu::meshlet& m = meshlets.meshlets[i];
+                for (std::uint32_t t = 0; t < m.triangle_count; ++t) {
+                    math::float3 p[3];
+                    for (std::uint32_t k = 0; k < 3; ++k) {
+                        p[k] = torus.vertices[meshlets.vertices[
+                          m.vertex_offset +
+                          meshlets.triangles[(m.triangle_offset + t) * 3 + k]]]
+                                 .position;
+                    }
+                    ok &= math::dot(p[0] - camera, face_normal(p[0], p[1], p[2])) >=
+                          -1e-6f;
+                }
+            }
+            cone_culled += bounds.size() - count;
+        }
+        expect(ok && cone_culled > 0);
+    };
+
+    "frustum planes agree with clip space"_test = [] {
+        // Points well clear of the clip volume's faces, in world space.
+        const math::float4x4 view_projection = camera_view_projection();
+        const math::frustum frustum = math::make_frustum(view_projection);
+        std::mt19937 rng(21);
+        std::uniform_real_distribution<float> position(-60.f, 60.f);
+        bool ok = true;
+        int inside_count = 0;
+        for (int i = 0; i < 100000; ++i) {
+            const math::float4 p = { position(rng), position(rng), position(rng), 1.f };
+            const math::float4 clip = view_projection * p;
+            const float slack = 1e-3f * std::abs(clip.w);
+            const float gaps[] = { clip.w + clip.x, clip.w - clip.x,
+                                   clip.w + clip.y, clip.w - clip.y,
+                                   clip.z,          clip.w - clip.z };
+            if (std::ranges::any_of(gaps, [&](float g) { return std::abs(g) < slack; })) {
+                continue;
+            }
+            const bool clip_inside =
+              std::ranges::all_of(gaps, [](float g) { return g > 0.f; });
+            bool planes_inside = true;
+            for (const math::float4& plane : frustum.planes) {
+                planes_inside &= math::dot(plane, p) >= 0.f;
+            }
+            ok &= clip_inside == planes_inside;
+            inside_count += clip_inside;
+        }
+        expect(ok && inside_count > 0);
+    };
+
+    const math::bounds_storage spheres = random_bounds(k_sphere_count, 22);
+    const math::frustum frustum = math::make_frustum(camera_view_projection());
+    const math::float3 camera = { 0.f, 0.f, 0.f };
+    "simd culling matches the reference"_test = [&] {
+        bool ok = matches_reference(frustum, camera, spheres.view(), 0) &&
+                  matches_reference(frustum, camera, without_cones(spheres.view()), 0);
+        for (std::size_t count = 0; count <= 2 * 8 + 1; ++count) {
+            ok &= matches_reference(frustum, camera, first(spheres.view(), count), 7) &&
+                  matches_reference(
+                    frustum, camera, without_cones(first(spheres.view(), count)), 7);
+        }
+        expect(ok);
+    };
+
+    "instance bounds follow their transforms"_test = [&] {
+        // A mesh cone placed at a rotated, translated and scaled instance.
+        const math::cluster_bounds local = meshlets.bounds.front();
+        std::vector<shader_types::instance_data> instances(3);
+        instances[0].instanceTransform =
+          math::make_translate({ 1.f, 2.f, 3.f }) * math::make_y_rotate(0.7f) *
+          math::make_scale({ 2.f, 2.f, 2.f });
+        instances[1].instanceTransform = math::make_x_rotate(-1.1f);
+        instances[2].instanceTransform = math::make_scale({ 1.f, 3.f, 1.f });
+        math::bounds_storage placed;
+        math::transform_bounds(local, instances, placed);
+
+        bool ok = placed.size() == 3 && placed.cone_cutoff.size() == 3 &&
+                  placed.cone_cutoff[2] == 1.f;
+        const gpu::meshlet& m = meshlets.meshlets.front();
+        for (std::size_t i = 0; i < 2; ++i) {
+            const math::float4x4& transform = instances[i].instanceTransform;
+            const math::float3 center = { placed.center_x[i], placed.center_y[i],
+                                          placed.center_z[i] };
+            for (std::uint32_t v = 0; v < m.vertex_count; ++v) {
+                const math::float3 p =
+                  torus.vertices[meshlets.vertices[m.vertex_offset + v]].position;
+                const math::float3 world =
+                  (transform * math::float4{ p.x, p.y, p.z, 1.f }).xyz();
+                ok &= math::length(world - center) <= placed.radius[i] * 1.0001f;
+            }
+            const math::float3 axis = (transform * math::float4{ local.cone_axis.x,
+                                                                 local.cone_axis.y,
+                                                                 local.cone_axis.z,
+                                                                 0.f })
+                                        .xyz();
+            ok &= math::dot(math::normalize(axis),
+                            { placed.cone_axis_x[i], placed.cone_axis_y[i],
+                              placed.cone_axis_z[i] }) > 0.9999f &&
+                  placed.cone_cutoff[i] == local.cone_cutoff;
+        }
+        math::transform_bounds({ .radius = 1.f }, instances, placed);
+        ok &= placed.cone_cutoff.empty() && placed.size() == 3;
+        expect(ok);
+    };
+}
@@ -0,0 +1,245 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <numbers>
+#include <numeric>
+#include <random>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+import lib;
+
+namespace {
+    // What radix_sort has to match.
+    bool matches_stable_sort(std::span<const std::uint32_t> p_keys,
+                             jobs::scheduler* p_jobs) {
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> expected;
+        for (std::size_t i = 0; i < p_keys.size(); ++i) {
+            expected.emplace_back(p_keys[i], static_cast<std::uint32_t>(i));
+        }
+        std::ranges::stable_sort(expected, {}, [](const auto& p_entry) {
+            return p_entry.first;
+        });
+
+        std::vector<std::uint32_t> keys(p_keys.begin(), p_keys.end());
+        std::vector<std::uint32_t> values(keys.size());
+        std::iota(values.begin(), values.end(), 0u);
+        std::vector<std::uint32_t> key_scratch(keys.size());
+        std::vector<std::uint32_t> value_scratch(keys.size());
+        math::radix_sort(keys, values, key_scratch, value_scratch, p_jobs);
+        for (std::size_t i = 0; i < keys.size(); ++i) {
+            if (keys[i] != expected[i].first || values[i] != expected[i].second) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Side of the cube instances are scattered over, keeping the density
+    // the same at every count.
+    float scene_side(std::size_t p_count) {
+        return 4.f * std::cbrt(static_cast<float>(p_count));
+    }
+
+    math::bounds_storage random_bounds(std::size_t p_count, std::uint32_t p_seed) {
+        std::mt19937 rng(p_seed);
+        const float half = scene_side(p_count) * 0.5f;
+        std::uniform_real_distribution<float> position(-half, half);
+        std::uniform_real_distribution<float> radius(0.5f, 2.f);
+        math::bounds_storage bounds;
+        for (std::size_t i = 0; i < p_count; ++i) {
+            bounds.center_x.push_back(position(rng));
+            bounds.center_y.push_back(position(rng));
+            bounds.center_z.push_back(position(rng));
+            bounds.radius.push_back(radius(rng));
+        }
+        return bounds;
+    }
+
+    math::float4x4 camera(std::size_t p_count, float p_yaw) {
+        return math::make_perspective({ .fov_radians = std::numbers::pi_v<float> / 3.f,
+                                        .aspect = 16.f / 9.f,
+                                        .znear = 0.1f,
+                                        .zfar = scene_side(p_count) * 0.5f }) *
+               math::make_y_rotate(p_yaw);
+    }
+
+    std::vector<std::uint32_t> cull(const math::frustum& p_frustum,
+                                    const math::bounds_storage& p_bounds) {
+        std::vector<std::uint32_t> visible(p_bounds.size());
+        visible.resize(math::cull_bounds(p_frustum, {}, p_bounds.view(), visible));
+        return visible;
+    }
+
+    float view_depth(const math::frustum& p_frustum,
+                     const math::bounds_storage& p_bounds,
+                     std::uint32_t p_index) {
+        const math::float4& plane = p_frustum.planes[4];
+        return plane.x * p_bounds.center_x[p_index] +
+               plane.y * p_bounds.center_y[p_index] +
+               plane.z * p_bounds.center_z[p_index] + plane.w;
+    }
+
+    // p_sorted holds exactly p_visible's indices, nearest first.
+    bool front_to_back(const math::frustum& p_frustum,
+                       const math::bounds_storage& p_bounds,
+                       std::span<const std::uint32_t> p_visible,
+                       std::span<const std::uint32_t> p_sorted) {
+        for (std::size_t i = 1; i < p_sorted.size(); ++i) {
+            if (view_depth(p_frustum, p_bounds, p_sorted[i - 1]) >
+                view_depth(p_frustum, p_bounds, p_sorted[i])) {
+                return false;
+            }
+        }
+        std::vector<std::uint32_t> a(p_visible.begin(), p_visible.end());
+        std::vector<std::uint32_t> b(p_sorted.begin(), p_sorted.end());
+        std::ranges::sort(a);
+        std::ranges::sort(b);
+        return a == b;
+    }
+}
+
+int
+main() {
+    using namespace boost::ut;
+    jobs::scheduler parallel(3);
+
+    "sortable keys keep float order"_test = [] {
+        const float values[] = { -std::numeric_limits<float>::infinity(),
+                                 -1e30f, -2.f, -1e-40f, -0.f, 0.f, 1e-40f,
+                                 0.5f, 1.f, 3e38f,
+                                 std::numeric_limits<float>::infinity() };
+        bool ok = true;
+        for (std::size_t i = 1; i < std::size(values); ++i) {
+            ok &= math::sortable_key(values[i - 1]) < math::sortable_key(values[i]);
+        }
+        expect(ok);
+    };
+
+    "radix sort matches std::stable_sort"_test = [] {
+        std::mt19937 rng(1);
+        bool ok = matches_stable_sort({}, nullptr);
+        for (std::size_t count : { 1, 2, 3, 17, 255, 1000, 40'000 }) {
+            std::vector<std::uint32_t> keys(count);
+            // Full range, few distinct keys and only the middle bytes set,
+            // which skips passes.
+            for (std::uint32_t mask : { 0xffffffffu, 0x7u, 0x00ffff00u }) {
+                for (std::uint32_t& key : keys) {
+                    key = rng() & mask;
+                }
+                ok &= matches_stable_sort(keys, nullptr);
+            }
+        }
+        expect(ok);
+    };
+
+    "parallel radix sort matches std::stable_sort"_test = [&] {
+        std::mt19937 rng(1);
+        std::vector<std::uint32_t> keys(600'000);
+        for (std::uint32_t& key : keys) {
+            key = rng() & 0xf0ff0fffu;
+        }
+        expect(matches_stable_sort(keys, &parallel));
+        expect(matches_stable_sort(std::span(keys).first(70'000), &parallel));
+    };
+
+    // Turning reorders a dense scene too much for the fix-up, moving
+    // forward and sideways only changes which instances are visible.
+    "sorted front to back while the camera moves"_test = [&] {
+        const math::bounds_storage bounds = random_bounds(100'000, 2);
+        math::depth_sorter sorter;
+        bool ok = true;
+        bool reused = true;
+        for (int frame = 0; frame < 80; ++frame) {
+            const bool turn = frame < 40;
+            const float step = static_cast<float>(frame % 40);
+            if (frame == 40) {
+                // A camera cut, which also ends the turn's back-off.
+                sorter.reset();
+            }
+            const math::frustum frustum = math::make_frustum(
+              camera(bounds.size(), turn ? step * 0.01f : 0.f) *
+              math::make_translate({ turn ? 0.f : step * 0.3f, 0.f, turn ? 0.f : step * 0.2f }));
+            const std::vector<std::uint32_t> visible = cull(frustum, bounds);
+            std::vector<std::uint32_t> sorted = visible;
+            sorter.sort(frustum, bounds.view(), sorted, frame % 2 ? &parallel : nullptr);
+            ok &= front_to_back(frustum, bounds, visible, sorted);
+            reused &= turn || step == 0.f || !sorter.full_sort();
+        }
+        expect(ok);
+        expect(reused);
+
+        // Turning around leaves little to reuse.
+        const math::frustum behind = math::make_frustum(camera(bounds.size(), 3.f));
+        const std::vector<std::uint32_t> visible = cull(behind, bounds);
+        std::vector<std::uint32_t> sorted = visible;
+        sorter.sort(behind, bounds.view(), sorted, &parallel);
+        expect(sorter.full_sort());
+        expect(front_to_back(behind, bounds, visible, sorted));
+    };
+
+    "equal depths keep their order across frames"_test = [] {
+        // Pairs of instances at the same depth must keep last frame's
+        // order even when the visible list arrives in another order.
+        math::bounds_storage bounds;
+        for (int i = 0; i < 64; ++i) {
+            bounds.center_x.push_back(i % 2 ? 1.f : -1.f);
+            bounds.center_y.push_back(0.f);
+            bounds.center_z.push_back(-2.f - static_cast<float>(i / 2));
+            bounds.radius.push_back(0.5f);
+        }
+        const math::frustum frustum = math::make_frustum(camera(1000, 0.f));
+        std::vector<std::uint32_t> first(bounds.size());
+        std::iota(first.begin(), first.end(), 0u);
+        math::depth_sorter sorter;
+        sorter.sort(frustum, bounds.view(), first);
+        std::vector<std::uint32_t> second(first.rbegin(), first.rend());
+        sorter.sort(frustum, bounds.view(), second);
+        std::vector<std::uint32_t> third(bounds.size());
+        std::iota(third.begin(), third.end(), 0u);
+        std::ranges::reverse(third);
+        sorter.reset();
+        sorter.sort(frustum, bounds.view(), third);
+        bool ok = first == second && front_to_back(frustum, bounds, first, first);
+        for (std::size_t i = 0; i < first.size(); i += 2) {
+            ok &= first[i] + 1 == first[i + 1] && third[i] == first[i + 1];
+        }
+        expect(ok);
+    };
+
+    "full sort fallback keeps last frame's order"_test = [] {
+        // Too many newcomers for the incremental path, the radix sort
+        // still has to leave the retained pairs in last frame's order.
+        math::bounds_storage bounds;
+        for (int i = 0; i < 160; ++i) {
+            const bool pair = i < 64;
+            bounds.center_x.push_back(pair && i % 2 ? 1.f : -1.f);
+            bounds.center_y.push_back(pair ? 0.f : 1.f);
+            bounds.center_z.push_back(pair ? -2.f - static_cast<float>(i / 2)
+                                           : -2.5f - static_cast<float>(i - 64));
+            bounds.radius.push_back(0.5f);
+        }
+        const math::frustum frustum = math::make_frustum(camera(1000, 0.f));
+        std::vector<std::uint32_t> first(64);
+        std::iota(first.begin(), first.end(), 0u);
+        math::depth_sorter sorter;
+        sorter.sort(frustum, bounds.view(), first);
+        std::vector<std::uint32_t> second(bounds.size());
+        std::iota(second.begin(), second.end(), 0u);
+        std::ranges::reverse(second);
+        sorter.sort(frustum, bounds.view(), second);
+        expect(sorter.full_sort());
+        expect(front_to_back(frustum, bounds, second, second));
+
+        std::vector<std::uint32_t> pairs;
+        std::ranges::copy_if(second, std::back_inserter(pairs),
+                             [](std::uint32_t p_index) { return p_index < 64; });
+        expect(pairs == first);
+    };
+}
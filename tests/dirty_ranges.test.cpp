@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+import lib;
+
+namespace {
+    /**
+     * Random, overlapping and out-of-order marks: the tracker never holds
+     * more than max_ranges ranges, and the flushed ranges are sorted,
+     * disjoint, inside the buffer and cover every marked byte. With
+     * p_exact nothing unmarked is flushed either.
+     */
+    bool covers_marks(gpu::dirty_range_options p_options,
+                      std::size_t p_length,
+                      bool p_exact,
+                      std::mt19937& p_rng) {
+        std::uniform_int_distribution<std::size_t> offset(0, p_length - 1);
+        std::uniform_int_distribution<std::size_t> size(0, 300);
+        gpu::dirty_range_tracker tracker(p_options);
+        const std::size_t limit = std::max<std::size_t>(p_options.max_ranges, 1);
+        bool ok = true;
+        for (int round = 0; round < 20; ++round) {
+            std::vector<bool> marked(p_length, false);
+            const std::size_t marks = 1 + p_rng() % 400;
+            for (std::size_t m = 0; m < marks; ++m) {
+                const std::size_t begin = offset(p_rng);
+                const std::size_t end = std::min(begin + size(p_rng), p_length);
+                tracker.mark(begin, end - begin);
+                std::fill(marked.begin() + begin, marked.begin() + end, true);
+                ok &= tracker.ranges().size() <= limit;
+            }
+
+            std::vector<bool> flushed(p_length, false);
+            std::size_t previous_end = 0;
+            std::size_t bytes = 0;
+            const std::size_t reported =
+              tracker.flush([&](std::size_t p_offset, std::size_t p_size) {
+                  ok &= p_size > 0 && p_offset >= previous_end &&
+                        p_offset + p_size <= p_length;
+                  previous_end = p_offset + p_size;
+                  bytes += p_size;
+                  std::fill(flushed.begin() + p_offset,
+                            flushed.begin() + std::min(p_offset + p_size, p_length),
+                            true);
+              });
+            ok &= reported == bytes && tracker.empty();
+            for (std::size_t i = 0; i < p_length; ++i) {
+                ok &= !marked[i] || flushed[i];
+                ok &= !p_exact || marked[i] == flushed[i];
+            }
+        }
+        return ok;
+    }
+}
+
+int
+main() {
+    using namespace boost::ut;
+    constexpr std::size_t length = 20'000;
+    std::mt19937 rng(7);
+
+    "exact ranges flush only what was marked"_test = [&] {
+        expect(covers_marks({ .max_ranges = length }, length, true, rng));
+    };
+
+    "marks covered within max_ranges"_test = [&] {
+        for (std::size_t max_ranges : { 0, 1, 2, 3, 8, 64 }) {
+            expect(covers_marks({ .max_ranges = max_ranges }, length, false, rng));
+            expect(covers_marks({ .merge_gap = 100, .max_ranges = max_ranges },
+                                length, false, rng));
+            expect(covers_marks({ .page_size = 4096,
+                                  .buffer_length = length,
+                                  .max_ranges = max_ranges },
+                                length, false, rng));
+        }
+    };
+}
@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+import lib;
+
+namespace {
+    using ring_allocator = gpu::frame_ring_allocator<gpu::cpu_buffer>;
+}
+
+int
+main() {
+    using namespace boost::ut;
+
+    "begin_frame refuses with all frames in flight"_test = [] {
+        gpu::cpu_buffer buffer(4096);
+        ring_allocator ring(&buffer, 2);
+        expect(ring.begin_frame());
+        const std::uint64_t first = ring.end_frame();
+        expect(ring.begin_frame());
+        ring.end_frame();
+        expect(!ring.begin_frame() && !ring.begin_frame());
+        ring.complete_frame(first);
+        expect(ring.begin_frame());
+        const std::uint64_t third = ring.end_frame();
+        expect(!ring.begin_frame());
+        // Completing a fence completes every frame before it.
+        ring.complete_frame(third);
+        expect(ring.begin_frame());
+        ring.end_frame();
+        expect(ring.begin_frame());
+    };
+
+    "slices wrap to the start of the ring"_test = [] {
+        gpu::cpu_buffer buffer(1024);
+        ring_allocator ring(&buffer, 3);
+        expect(ring.begin_frame());
+        const auto a = ring.allocate(300);
+        const std::uint64_t fence_a = ring.end_frame();
+        expect(ring.begin_frame());
+        const auto b = ring.allocate(300);
+        ring.end_frame();
+        expect(a.has_value() && a->offset == 0);
+        expect(b.has_value() && b->offset == 512);
+
+        // Past the end, and the start still belongs to frame a.
+        expect(ring.begin_frame());
+        expect(!ring.allocate(300).has_value());
+        ring.end_frame();
+        ring.complete_frame(fence_a);
+        expect(ring.begin_frame());
+        const auto wrapped = ring.allocate(300);
+        expect(wrapped.has_value() && wrapped->offset == 0 &&
+               wrapped->data == buffer.contents());
+        expect(!ring.allocate(300).has_value());
+        expect(!ring.allocate(2048).has_value());
+        ring.end_frame();
+    };
+
+    // Random slice sizes and GPU latency: every slice is aligned, inside
+    // the buffer and clear of the slices of frames still in flight, and
+    // bytes come back once their fence completes, old fences included.
+    "completed frames are reused, live ones kept"_test = [] {
+        struct slice {
+            std::uint64_t fence;
+            std::size_t offset;
+            std::size_t size;
+        };
+        gpu::cpu_buffer buffer(8192);
+        ring_allocator ring(&buffer, 3);
+        std::mt19937 rng(5);
+        std::uniform_int_distribution<std::size_t> size(16, 2500);
+        std::deque<std::uint64_t> gpu_queue;
+        std::vector<slice> live;
+        bool ok = true;
+        std::size_t wraps = 0;
+        std::size_t allocated = 0;
+        std::size_t last_offset = 0;
+        auto complete = [&](std::uint64_t p_fence) {
+            ring.complete_frame(p_fence);
+            // A stale fence must not undo the newer one.
+            ring.complete_frame(p_fence / 2);
+            std::erase_if(live, [&](const slice& p_slice) {
+                return p_slice.fence <= p_fence;
+            });
+        };
+        for (std::uint64_t frame = 0; frame < 5000; ++frame) {
+            while (!gpu_queue.empty() && rng() % 2 == 0) {
+                complete(gpu_queue.front());
+                gpu_queue.pop_front();
+            }
+            while (!ring.begin_frame()) {
+                ok &= gpu_queue.size() == 3;
+                complete(gpu_queue.front());
+                gpu_queue.pop_front();
+            }
+            ok &= gpu_queue.size() < 3;
+            for (std::size_t i = rng() % 4; i > 0; --i) {
+                const auto allocation = ring.allocate(size(rng));
+                if (!allocation) {
+                    continue;
+                }
+                ++allocated;
+                wraps += allocation->offset < last_offset ? 1 : 0;
+                last_offset = allocation->offset;
+                const std::size_t end = allocation->offset + allocation->size;
+                ok &= allocation->offset % gpu::cpu_buffer::alignment == 0 &&
+                      end <= buffer.length();
+                for (const slice& other : live) {
+                    ok &= end <= other.offset ||
+                          other.offset + other.size <= allocation->offset;
+                }
+                live.push_back({ frame, allocation->offset, allocation->size });
+            }
+            ok &= ring.end_frame() == frame;
+            gpu_queue.push_back(frame);
+        }
+        while (!gpu_queue.empty()) {
+            complete(gpu_queue.front());
+            gpu_queue.pop_front();
+        }
+        expect(ok);
+        expect(ring.begin_frame() && ring.bytes_in_flight() == 0);
+        expect(wraps > 100 && allocated > 5000);
+    };
+}
@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <span>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+import lib;
+
+namespace {
+    struct instance_streams {
+        std::vector<float> position_x;
+        std::vector<float> position_y;
+        std::vector<float> position_z;
+        std::vector<float> rotation_y;
+        std::vector<float> rotation_z;
+        std::vector<float> scale;
+
+        explicit instance_streams(std::size_t p_count) {
+            std::mt19937 rng(21);
+            std::uniform_real_distribution<float> position(-50.f, 50.f);
+            std::uniform_real_distribution<float> angle(-3.f, 3.f);
+            std::uniform_real_distribution<float> size(0.1f, 2.f);
+            for (std::size_t i = 0; i < p_count; ++i) {
+                position_x.push_back(position(rng));
+                position_y.push_back(position(rng));
+                position_z.push_back(position(rng));
+                rotation_y.push_back(angle(rng));
+                rotation_z.push_back(angle(rng));
+                scale.push_back(size(rng));
+            }
+        }
+
+        [[nodiscard]] math::instance_transform_soa view() const {
+            return { .position_x = position_x,
+                     .position_y = position_y,
+                     .position_z = position_z,
+                     .rotation_y = rotation_y,
+                     .rotation_z = rotation_z,
+                     .scale = scale };
+        }
+    };
+
+    math::float3 mul(const math::float3x3& p_m, const math::float3& p_v) {
+        return p_m.columns[0] * p_v.x + p_m.columns[1] * p_v.y +
+               p_m.columns[2] * p_v.z;
+    }
+
+    // Inverse transpose of the upper 3x3 by Gauss-Jordan in double, an
+    // independent route to what the cofactors give.
+    math::float3x3 inverse_transpose(const math::float4x4& p_m) {
+        double a[3][6] = {};
+        for (int r = 0; r < 3; ++r) {
+            const math::float4* c = p_m.columns;
+            const float row[3] = { r == 0 ? c[0].x : r == 1 ? c[0].y : c[0].z,
+                                   r == 0 ? c[1].x : r == 1 ? c[1].y : c[1].z,
+                                   r == 0 ? c[2].x : r == 1 ? c[2].y : c[2].z };
+            for (int k = 0; k < 3; ++k) {
+                a[r][k] = row[k];
+            }
+            a[r][3 + r] = 1.0;
+        }
+        for (int p = 0; p < 3; ++p) {
+            int pivot = p;
+            for (int r = p + 1; r < 3; ++r) {
+                if (std::abs(a[r][p]) > std::abs(a[pivot][p])) {
+                    pivot = r;
+                }
+            }
+            std::swap(a[p], a[pivot]);
+            const double scale = 1.0 / a[p][p];
+            for (double& v : a[p]) {
+                v *= scale;
+            }
+            for (int r = 0; r < 3; ++r) {
+                if (r != p) {
+                    const double f = a[r][p];
+                    for (int k = 0; k < 6; ++k) {
+                        a[r][k] -= f * a[p][k];
+                    }
+                }
+            }
+        }
+        // Column c of the transpose is row c of the inverse.
+        math::float3x3 result;
+        for (int c = 0; c < 3; ++c) {
+            result.columns[c] = { static_cast<float>(a[c][3]),
+                                  static_cast<float>(a[c][4]),
+                                  static_cast<float>(a[c][5]) };
+        }
+        return result;
+    }
+
+    bool same_bits(const void* p_a, const void* p_b, std::size_t p_bytes) {
+        return std::memcmp(p_a, p_b, p_bytes) == 0;
+    }
+}
+
+int
+main() {
+    using namespace boost::ut;
+    std::mt19937 rng(22);
+
+    // Composed transforms, then shears, mirrors and uneven scales that
+    // the full layout's normal transform gets wrong.
+    const instance_streams streams(1000);
+    std::vector<shader_types::instance_data> instances(1000);
+    math::compose_instance_transforms(math::make_identity(), streams.view(),
+                                      instances);
+    std::uniform_real_distribution<float> value(-2.f, 2.f);
+    for (std::size_t i = 0; i < 300; ++i) {
+        math::float4x4& m = instances[i].instanceTransform;
+        for (math::float4& column : m.columns) {
+            column = { value(rng), value(rng), value(rng), 0.f };
+        }
+        m.columns[3].w = 1.f;
+    }
+
+    "pack_instances matches pack_instance"_test = [&] {
+        for (std::size_t count : { std::size_t{ 0 }, std::size_t{ 1 },
+                                   std::size_t{ 7 }, std::size_t{ 1000 } }) {
+            std::vector<shader_types::compact_instance_data> packed(count);
+            gpu::pack_instances(std::span(instances).first(count), packed);
+            for (std::size_t i = 0; i < count; ++i) {
+                const shader_types::compact_instance_data one =
+                  gpu::pack_instance(instances[i]);
+                expect(same_bits(&one, &packed[i], sizeof(one)));
+                const math::float4x4 back =
+                  gpu::unpack_instance_transform(packed[i]);
+                expect(same_bits(&back, &instances[i].instanceTransform,
+                                 sizeof(back)));
+            }
+        }
+    };
+
+    "derived normals match the inverse transpose"_test = [&] {
+        // Transformed normals must stay perpendicular to transformed
+        // tangents and point the way the true inverse transpose does.
+        std::normal_distribution<float> direction;
+        bool perpendicular = true;
+        bool uniform_matches = true;
+        float worst = 0.f;
+        for (std::size_t i = 0; i < instances.size(); ++i) {
+            const math::float4x4& m = instances[i].instanceTransform;
+            const math::float3x3 normal_transform =
+              gpu::instance_normal_transform(gpu::pack_instance(instances[i]));
+            const math::float3x3 reference = inverse_transpose(m);
+            for (int trial = 0; trial < 8; ++trial) {
+                const math::float3 n = math::normalize(
+                  { direction(rng), direction(rng), direction(rng) });
+                const math::float3 t = math::normalize(
+                  math::cross(n, { direction(rng), direction(rng), direction(rng) }));
+                const math::float3 packed_n =
+                  math::normalize(mul(normal_transform, n));
+                const math::float3 reference_n = math::normalize(mul(reference, n));
+                const math::float3 world_t = math::normalize(
+                  mul(math::discard_translation(m), t));
+                perpendicular &= std::abs(math::dot(packed_n, world_t)) < 1e-4f;
+                worst = std::max(worst, math::length(packed_n - reference_n));
+                if (i >= 300) {
+                    // Composed instances scale uniformly, the old 3x3 is
+                    // right for them.
+                    const math::float3 full_n = math::normalize(
+                      mul(instances[i].instanceNormalTransform, n));
+                    uniform_matches &= math::length(packed_n - full_n) < 1e-5f;
+                }
+            }
+        }
+        expect(perpendicular && worst < 1e-4f);
+        expect(uniform_matches);
+    };
+
+    "colors pack to rgba8 and back"_test = [&] {
+        std::uniform_real_distribution<float> channel(-0.2f, 1.2f);
+        std::vector<math::float4> colors(1003);
+        for (math::float4& color : colors) {
+            color = { channel(rng), channel(rng), channel(rng), channel(rng) };
+        }
+        colors[0] = { 0.f, 1.f, 0.5f, 1.f / 255.f };
+        bool ok = true;
+        for (std::size_t count : { std::size_t{ 0 }, std::size_t{ 3 },
+                                   std::size_t{ 1003 } }) {
+            std::vector<std::uint32_t> packed(count);
+            gpu::pack_colors(std::span(colors).first(count), packed);
+            for (std::size_t i = 0; i < count; ++i) {
+                ok &= packed[i] == gpu::pack_color(colors[i]);
+                const math::float4 back = gpu::unpack_color(packed[i]);
+                const float in[] = { colors[i].x, colors[i].y, colors[i].z,
+                                     colors[i].w };
+                const float out[] = { back.x, back.y, back.z, back.w };
+                for (int c = 0; c < 4; ++c) {
+                    ok &= std::abs(std::clamp(in[c], 0.f, 1.f) - out[c]) <=
+                          0.5f / 255.f + 1e-6f;
+                }
+            }
+        }
+        ok &= gpu::pack_color(colors[0]) == 0x01'80'ff'00u;
+        expect(ok);
+    };
+}
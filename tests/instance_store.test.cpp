@@ -0,0 +1,122 @@
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <random>
+#include <span>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+import lib;
+
+namespace {
+    constexpr std::size_t k_instances = 20'000;
+    constexpr std::size_t k_frames_in_flight = 3;
+
+    struct instance_streams {
+        std::vector<float> position_x;
+        std::vector<float> position_y;
+        std::vector<float> position_z;
+        std::vector<float> rotation_y;
+        std::vector<float> rotation_z;
+        std::vector<float> scale;
+
+        instance_streams()
+          : position_x(k_instances)
+          , position_y(k_instances)
+          , position_z(k_instances)
+          , rotation_y(k_instances)
+          , rotation_z(k_instances)
+          , scale(k_instances, 0.2f) {
+            for (std::size_t i = 0; i < k_instances; ++i) {
+                const float f = static_cast<float>(i);
+                position_x[i] = std::fmod(f, 100.f);
+                position_y[i] = std::fmod(f * 0.37f, 100.f);
+                position_z[i] = -f * 0.01f;
+                rotation_y[i] = std::cos(f);
+                rotation_z[i] = std::sin(f);
+            }
+        }
+
+        [[nodiscard]] math::instance_transform_soa view() const {
+            return { .position_x = position_x,
+                     .position_y = position_y,
+                     .position_z = position_z,
+                     .rotation_y = rotation_y,
+                     .rotation_z = rotation_z,
+                     .scale = scale };
+        }
+    };
+
+    bool same_bytes(std::span<const std::byte> p_a, std::span<const std::byte> p_b) {
+        return p_a.size() == p_b.size() &&
+               std::memcmp(p_a.data(), p_b.data(), p_a.size()) == 0;
+    }
+
+    /**
+     * Moves a random subset of instances per frame, every one of them on
+     * some frames, and compares the store and the regions it syncs with a
+     * full recompute. Regions are visited out of order and the compact one
+     * only every fourth frame, so destinations that skipped frames have to
+     * catch up.
+     */
+    bool matches_full_recompute(instance_streams& p_streams,
+                                jobs::scheduler* p_jobs) {
+        const math::float4x4 parent =
+          math::make_translate({ 1.f, -2.f, 3.f }) * math::make_y_rotate(0.3f);
+        constexpr std::size_t compact_destination = k_frames_in_flight;
+        gpu::instance_store store(k_instances, k_frames_in_flight + 1);
+        std::vector<shader_types::instance_data> regions(k_frames_in_flight *
+                                                         k_instances);
+        std::vector<shader_types::compact_instance_data> compact(k_instances);
+        std::vector<shader_types::instance_data> expected(k_instances);
+        std::vector<shader_types::compact_instance_data> expected_compact(k_instances);
+        auto ignore = [](std::size_t, std::size_t) {};
+        std::mt19937 rng(11);
+        std::uniform_int_distribution<std::size_t> index(0, k_instances - 1);
+        bool ok = true;
+        for (std::size_t frame = 0; frame < 12; ++frame) {
+            const std::size_t moves = frame % 5 == 4 ? k_instances : rng() % 600;
+            for (std::size_t m = 0; m < moves; ++m) {
+                const std::size_t i = moves == k_instances ? m : index(rng);
+                p_streams.position_x[i] += 0.5f;
+                p_streams.rotation_y[i] += 0.1f;
+                store.touch(i);
+            }
+            store.update(parent, p_streams.view(), p_jobs);
+            math::compose_instance_transforms(parent, p_streams.view(), expected);
+            ok &= same_bytes(std::as_bytes(store.instances()),
+                             std::as_bytes(std::span(expected)));
+
+            const std::size_t destination = (frame * 2 + frame / 3) % k_frames_in_flight;
+            const std::span region(regions.data() + destination * k_instances,
+                                   k_instances);
+            store.sync(destination, region, ignore);
+            ok &= same_bytes(std::as_bytes(region), std::as_bytes(std::span(expected)));
+
+            if (frame % 4 == 3) {
+                store.sync(compact_destination, std::span(compact), ignore);
+                gpu::pack_instances(expected, expected_compact);
+                ok &= same_bytes(std::as_bytes(std::span(compact)),
+                                 std::as_bytes(std::span(expected_compact)));
+            }
+        }
+        return ok;
+    }
+}
+
+int
+main() {
+    using namespace boost::ut;
+
+    "store matches a full recompute"_test = [] {
+        instance_streams moving;
+        expect(matches_full_recompute(moving, nullptr));
+    };
+
+    "store matches a full recompute on workers"_test = [] {
+        jobs::scheduler parallel(3);
+        instance_streams moving;
+        expect(matches_full_recompute(moving, &parallel));
+    };
+}
@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+import lib;
+
+namespace {
+    // The sandbox texture.
+    constexpr std::uint32_t k_width = 128;
+    constexpr std::uint32_t k_height = 128;
+    constexpr std::size_t k_pixels = std::size_t{ k_width } * k_height;
+    // A stretch of the sandbox's 5000 frame cycle, played forth and back.
+    constexpr std::uint32_t k_frames = 400;
+
+    constexpr compute::mandelbrot_options k_shading = { .boundary_tracing =
+                                                          true };
+    constexpr compute::mandelbrot_params k_params = { .interior_checks = true,
+                                                      .periodicity = true };
+
+    std::size_t mismatches(const std::vector<std::uint32_t>& p_a,
+                           const std::vector<std::uint32_t>& p_b) {
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < p_a.size(); ++i) {
+            count += p_a[i] != p_b[i];
+        }
+        return count;
+    }
+
+    //! @return the mean share of pixels that differ from a full recompute.
+    double play(jobs::scheduler& p_jobs,
+                compute::mandelbrot_frame_cache& p_cache,
+                std::size_t p_max_bytes) {
+        std::vector<std::uint32_t> frame(k_pixels);
+        std::vector<std::uint32_t> truth(k_pixels);
+        double mismatch = 0.0;
+        for (std::uint32_t i = 0; i < 2 * k_frames; ++i) {
+            const std::uint32_t index = i < k_frames ? i : 2 * k_frames - 1 - i;
+            p_cache.render(p_jobs, index, frame);
+            compute::dispatch_mandelbrot(p_jobs, k_width, k_height, index,
+                                         truth, k_shading, k_params);
+            mismatch += static_cast<double>(mismatches(frame, truth)) /
+                        static_cast<double>(k_pixels);
+            if (p_cache.memory_bytes() > p_max_bytes) {
+                return 1.0;
+            }
+        }
+        return mismatch / (2 * k_frames);
+    }
+}
+
+int
+main() {
+    using namespace boost::ut;
+    jobs::scheduler workers;
+
+    "scattered pixels match full dispatch"_test = [&] {
+        std::vector<std::uint32_t> full(k_pixels);
+        std::vector<std::uint32_t> scattered(k_pixels, 0);
+        std::vector<std::uint32_t> indices(k_pixels);
+        std::iota(indices.begin(), indices.end(), 0u);
+        std::shuffle(indices.begin(), indices.end(), std::mt19937(7));
+        compute::dispatch_mandelbrot(workers, k_width, k_height, 100, full, {},
+                                     k_params);
+        compute::dispatch_mandelbrot_pixels(workers, k_width, k_height, 100,
+                                            indices, scattered, {}, k_params);
+        expect(scattered == full);
+    };
+
+    "exact cache reproduces every frame within budget"_test = [&] {
+        const std::size_t budget = 32 * k_pixels * sizeof(std::uint32_t);
+        compute::mandelbrot_frame_cache cache(
+          k_width, k_height, { .max_bytes = budget }, k_shading, k_params);
+        expect(play(workers, cache, budget) == 0.0);
+        expect(cache.stats().hits > 0);
+    };
+
+    // Reused samples sit up to max_error pixels off, which only changes
+    // pixels along the set's boundary.
+    "lossy cache stays close within budget"_test = [&] {
+        const std::size_t budget = 32 * k_pixels * sizeof(std::uint32_t);
+        compute::mandelbrot_frame_cache cache(
+          k_width,
+          k_height,
+          { .max_bytes = budget, .max_error = 0.5f },
+          k_shading,
+          k_params);
+        cache.prefill(workers);
+        expect(play(workers, cache, budget) < 0.2);
+        expect(cache.stats().reprojections > 0);
+    };
+}
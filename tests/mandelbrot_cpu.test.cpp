@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+import lib;
+
+namespace {
+    constexpr std::uint32_t k_width = 256;
+    constexpr std::uint32_t k_height = 256;
+    constexpr std::size_t k_pixels = std::size_t{ k_width } * k_height;
+
+    // Largest per-channel difference the GPU path can show. The kernel
+    // writes half colour values into a unorm8 texture, which costs up to
+    // one step over rounding the float straight to unorm8.
+    constexpr int k_channel_tolerance = 1;
+
+    // Pixels whose channels differ by more than k_channel_tolerance.
+    std::size_t pixels_over_tolerance(const std::vector<std::uint32_t>& p_a,
+                                      const std::vector<std::uint32_t>& p_b) {
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < p_a.size(); ++i) {
+            int worst = 0;
+            for (int shift = 0; shift < 32; shift += 8) {
+                const int a = static_cast<int>((p_a[i] >> shift) & 0xff);
+                const int b = static_cast<int>((p_b[i] >> shift) & 0xff);
+                worst = std::max(worst, std::abs(a - b));
+            }
+            count += worst > k_channel_tolerance;
+        }
+        return count;
+    }
+}
+
+int
+main() {
+    using namespace boost::ut;
+    jobs::scheduler serial(0);
+    jobs::scheduler workers;
+
+    // Iteration near the set boundary is chaotic: once the compiler fuses
+    // a multiply-add differently (Metal's fast math does, and so may the
+    // host compiler for the scalar port) the escape count of boundary
+    // pixels changes. Without contraction both backends are bit-identical,
+    // with it under 1% of the pixels may differ.
+    "simd matches the reference across the zoom"_test = [&] {
+        std::vector<std::uint32_t> reference(k_pixels);
+        std::vector<std::uint32_t> image(k_pixels);
+        for (std::uint32_t frame : { 0u, 100u, 314u }) {
+            compute::dispatch_mandelbrot_reference(k_width, k_height, frame,
+                                                   reference);
+            compute::dispatch_mandelbrot(workers, k_width, k_height, frame,
+                                         image);
+            expect(pixels_over_tolerance(reference, image) * 100 < k_pixels);
+        }
+    };
+
+    "register counts and tilings agree"_test = [&] {
+        std::vector<std::uint32_t> one_register(k_pixels);
+        std::vector<std::uint32_t> image(k_pixels);
+        compute::dispatch_mandelbrot(serial, k_width, k_height, 100,
+                                     one_register, { .registers = 1 });
+        compute::dispatch_mandelbrot(workers, k_width, k_height, 100, image,
+                                     { .registers = 2 });
+        expect(image == one_register);
+        compute::dispatch_mandelbrot(
+          workers, k_width, k_height, 100, image,
+          { .tile_width = k_width, .tile_height = 64 });
+        expect(image == one_register);
+    };
+
+    // Widths that are not a multiple of the step exercise the tail lanes.
+    "tail lanes stay inside the image"_test = [&] {
+        constexpr std::uint32_t odd_width = 67;
+        constexpr std::uint32_t odd_height = 13;
+        std::vector<std::uint32_t> reference(odd_width * odd_height);
+        std::vector<std::uint32_t> image(odd_width * odd_height + 1,
+                                         0xdeadbeef);
+        compute::dispatch_mandelbrot_reference(odd_width, odd_height, 0,
+                                               reference);
+        compute::dispatch_mandelbrot(workers, odd_width, odd_height, 0, image);
+        expect(image.back() == 0xdeadbeef);
+        image.pop_back();
+        expect(pixels_over_tolerance(reference, image) * 100 <
+               reference.size());
+    };
+}
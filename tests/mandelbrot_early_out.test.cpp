@@ -0,0 +1,96 @@
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+import lib;
+
+namespace {
+    constexpr std::uint32_t k_width = 256;
+    constexpr std::uint32_t k_height = 256;
+    constexpr std::size_t k_pixels = std::size_t{ k_width } * k_height;
+
+    // Frame 0 is the wide view with the most interior, 314 the deepest zoom.
+    constexpr std::uint32_t k_frames[] = { 0, 100, 314 };
+
+    constexpr compute::mandelbrot_params k_checked = { .interior_checks = true,
+                                                       .periodicity = true };
+
+    std::size_t mismatches(const std::vector<std::uint32_t>& p_a,
+                           const std::vector<std::uint32_t>& p_b) {
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < p_a.size(); ++i) {
+            count += p_a[i] != p_b[i];
+        }
+        return count;
+    }
+}
+
+int
+main() {
+    using namespace boost::ut;
+    jobs::scheduler workers;
+    std::vector<std::uint32_t> plain(k_pixels);
+    std::vector<std::uint32_t> image(k_pixels);
+    std::vector<std::uint32_t> reference(k_pixels);
+
+    // Interior rejection only skips pixels that would reach max_iterations
+    // anyway, so it is exact.
+    "cardioid/bulb rejection is exact"_test = [&] {
+        for (std::uint32_t frame : k_frames) {
+            compute::dispatch_mandelbrot(workers, k_width, k_height, frame,
+                                         plain);
+            compute::dispatch_mandelbrot(workers, k_width, k_height, frame,
+                                         image, {}, { .interior_checks = true });
+            expect(image == plain);
+        }
+    };
+
+    // A detected cycle is exact in float arithmetic too, the scalar
+    // reference applies the same checks and must agree with the SIMD path
+    // as closely as the plain kernels do.
+    "periodicity matches reference and stays close to plain"_test = [&] {
+        for (std::uint32_t frame : k_frames) {
+            compute::dispatch_mandelbrot(workers, k_width, k_height, frame,
+                                         plain);
+            compute::dispatch_mandelbrot_reference(k_width, k_height, frame,
+                                                   reference, k_checked);
+            compute::dispatch_mandelbrot(workers, k_width, k_height, frame,
+                                         image, {}, k_checked);
+            expect(mismatches(reference, image) * 100 < k_pixels);
+            expect(mismatches(plain, image) * 100 < k_pixels);
+        }
+    };
+
+    // Tracing assumes the set has no islands inside a tile border, the
+    // filaments it misses are thinner than a pixel.
+    "boundary tracing close to plain"_test = [&] {
+        for (std::uint32_t frame : k_frames) {
+            compute::dispatch_mandelbrot(workers, k_width, k_height, frame,
+                                         plain);
+            compute::dispatch_mandelbrot(workers, k_width, k_height, frame,
+                                         image, { .boundary_tracing = true });
+            expect(mismatches(plain, image) * 100 < k_pixels);
+        }
+    };
+
+    // Odd sizes: partial trace tiles and tail lanes on both axes.
+    "157x93 traced, guard intact"_test = [&] {
+        constexpr std::uint32_t odd_width = 157;
+        constexpr std::uint32_t odd_height = 93;
+        std::vector<std::uint32_t> odd_plain(odd_width * odd_height);
+        std::vector<std::uint32_t> odd_image(odd_width * odd_height + 1,
+                                             0xdeadbeef);
+        compute::dispatch_mandelbrot(workers, odd_width, odd_height, 0,
+                                     odd_plain);
+        compute::dispatch_mandelbrot(workers, odd_width, odd_height, 0,
+                                     odd_image,
+                                     { .boundary_tracing = true,
+                                       .trace_tile = 32 },
+                                     k_checked);
+        expect(odd_image.back() == 0xdeadbeef);
+        odd_image.pop_back();
+        expect(mismatches(odd_plain, odd_image) * 100 < odd_plain.size());
+    };
+}
@@ -0,0 +1,441 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <numbers>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+import lib;
+
+namespace {
+    // A torus has no poles or seams to special-case and hides part of
+    // itself from every axis, which gives the overdraw order something to
+    // do.
+    constexpr int k_rings = 192;
+    constexpr int k_sides = 96;
+
+    shader_types::vertex_data torus_vertex(int p_ring, int p_side) {
+        const float u = 2.f * std::numbers::pi_v<float> * p_ring / k_rings;
+        const float v = 2.f * std::numbers::pi_v<float> * p_side / k_sides;
+        const math::float3 normal = { std::cos(u) * std::cos(v),
+                                      std::sin(u) * std::cos(v),
+                                      std::sin(v) };
+        return { .position = { std::cos(u) * (1.f + 0.35f * std::cos(v)),
+                               std::sin(u) * (1.f + 0.35f * std::cos(v)),
+                               0.35f * std::sin(v) },
+                 .normal = normal,
+                 .texcoord = { static_cast<float>(p_ring) / k_rings,
+                               static_cast<float>(p_side) / k_sides } };
+    }
+
+    int torus_index(int p_ring, int p_side) {
+        return (p_ring % k_rings) * k_sides + p_side % k_sides;
+    }
+
+    // Shared v/vt/vn, one quad per face, faces in random order so the
+    // input starts out cache-hostile.
+    std::string make_torus_obj() {
+        std::string text = "# torus\no torus\n";
+        for (int r = 0; r < k_rings; ++r) {
+            for (int s = 0; s < k_sides; ++s) {
+                const shader_types::vertex_data vertex = torus_vertex(r, s);
+                text += std::format("v {} {} {}\nvn {} {} {}\nvt {} {}\n",
+                                    vertex.position.x, vertex.position.y,
+                                    vertex.position.z, vertex.normal.x,
+                                    vertex.normal.y, vertex.normal.z,
+                                    vertex.texcoord.x, 1.f - vertex.texcoord.y);
+            }
+        }
+        std::vector<std::array<int, 4>> quads;
+        for (int r = 0; r < k_rings; ++r) {
+            for (int s = 0; s < k_sides; ++s) {
+                quads.push_back({ torus_index(r, s) + 1,
+                                  torus_index(r + 1, s) + 1,
+                                  torus_index(r + 1, s + 1) + 1,
+                                  torus_index(r, s + 1) + 1 });
+            }
+        }
+        std::ranges::shuffle(quads, std::mt19937(18));
+        for (const auto& quad : quads) {
+            text += "f";
+            for (int index : quad) {
+                text += std::format(" {}/{}/{}", index, index, index);
+            }
+            text += '\n';
+        }
+        return text;
+    }
+
+    void append_bytes(std::vector<std::byte>& p_out, const void* p_data,
+                      std::size_t p_size) {
+        const auto* bytes = static_cast<const std::byte*>(p_data);
+        p_out.insert(p_out.end(), bytes, bytes + p_size);
+    }
+
+    // The same mesh as a .glb: interleaved position/normal, a separate
+    // texcoord view and 32-bit indices, padded as the spec requires.
+    std::vector<std::byte> make_glb(const gpu::mesh_data& p_mesh) {
+        std::vector<std::byte> binary;
+        for (const shader_types::vertex_data& vertex : p_mesh.vertices) {
+            const float values[6] = { vertex.position.x, vertex.position.y,
+                                      vertex.position.z, vertex.normal.x,
+                                      vertex.normal.y,   vertex.normal.z };
+            append_bytes(binary, values, sizeof(values));
+        }
+        const std::size_t texcoord_offset = binary.size();
+        for (const shader_types::vertex_data& vertex : p_mesh.vertices) {
+            const float values[2] = { vertex.texcoord.x, vertex.texcoord.y };
+            append_bytes(binary, values, sizeof(values));
+        }
+        const std::size_t index_offset = binary.size();
+        append_bytes(binary, p_mesh.indices.data(),
+                     p_mesh.indices.size() * sizeof(std::uint32_t));
+
+        const std::string count = std::to_string(p_mesh.vertices.size());
+        std::string json =
+          R"({"asset":{"version":"2.0"},"buffers":[{"byteLength":)" +
+          std::to_string(binary.size()) + R"(}],"bufferViews":[)" +
+          R"({"buffer":0,"byteOffset":0,"byteStride":24,"byteLength":)" +
+          std::to_string(texcoord_offset) + "}," +
+          R"({"buffer":0,"byteOffset":)" + std::to_string(texcoord_offset) +
+          R"(,"byteLength":)" + std::to_string(index_offset - texcoord_offset) +
+          "}," + R"({"buffer":0,"byteOffset":)" + std::to_string(index_offset) +
+          R"(,"byteLength":)" + std::to_string(binary.size() - index_offset) +
+          R"(}],"accessors":[)" +
+          R"({"bufferView":0,"componentType":5126,"type":"VEC3","count":)" +
+          count + "}," +
+          R"({"bufferView":0,"byteOffset":12,"componentType":5126,)" +
+          R"("type":"VEC3","count":)" + count + "}," +
+          R"({"bufferView":1,"componentType":5126,"type":"VEC2","count":)" +
+          count + "}," +
+          R"({"bufferView":2,"componentType":5125,"type":"SCALAR","count":)" +
+          std::to_string(p_mesh.indices.size()) + "}]," +
+          R"("meshes":[{"name":"torus é","primitives":[{"attributes":)" +
+          R"({"POSITION":0,"NORMAL":1,"TEXCOORD_0":2},"indices":3}]}]})";
+        while (json.size() % 4 != 0) {
+            json += ' ';
+        }
+        while (binary.size() % 4 != 0) {
+            binary.push_back(std::byte{ 0 });
+        }
+
+        std::vector<std::byte> glb;
+        const std::uint32_t header[3] = {
+            0x46546c67, 2,
+            static_cast<std::uint32_t>(12 + 8 + json.size() + 8 + binary.size())
+        };
+        append_bytes(glb, header, sizeof(header));
+        const std::uint32_t json_chunk[2] = {
+            static_cast<std::uint32_t>(json.size()), 0x4e4f534a
+        };
+        append_bytes(glb, json_chunk, sizeof(json_chunk));
+        append_bytes(glb, json.data(), json.size());
+        const std::uint32_t binary_chunk[2] = {
+            static_cast<std::uint32_t>(binary.size()), 0x004e4942
+        };
+        append_bytes(glb, binary_chunk, sizeof(binary_chunk));
+        append_bytes(glb, binary.data(), binary.size());
+        return glb;
+    }
+
+    // Each triangle as its corner positions, rotated so the smallest
+    // corner leads without changing the winding, then sorted. Equal lists
+    // mean the same triangles facing the same way.
+    std::vector<std::array<float, 9>> triangle_set(const gpu::mesh_data& p_mesh) {
+        std::vector<std::array<float, 9>> triangles;
+        for (std::size_t i = 0; i < p_mesh.indices.size(); i += 3) {
+            std::array<std::array<float, 3>, 3> corners;
+            for (int c = 0; c < 3; ++c) {
+                const math::float3& p =
+                  p_mesh.vertices[p_mesh.indices[i + c]].position;
+                corners[c] = { p.x, p.y, p.z };
+            }
+            const auto first = std::ranges::min_element(corners);
+            std::ranges::rotate(corners, first);
+            std::array<float, 9> flat;
+            for (int c = 0; c < 3; ++c) {
+                std::ranges::copy(corners[c], flat.begin() + c * 3);
+            }
+            triangles.push_back(flat);
+        }
+        std::ranges::sort(triangles);
+        return triangles;
+    }
+
+    bool same_vertices(const gpu::mesh_data& p_a, const gpu::mesh_data& p_b) {
+        if (p_a.vertices.size() != p_b.vertices.size() ||
+            p_a.indices != p_b.indices) {
+            return false;
+        }
+        for (std::size_t i = 0; i < p_a.vertices.size(); ++i) {
+            const shader_types::vertex_data& a = p_a.vertices[i];
+            const shader_types::vertex_data& b = p_b.vertices[i];
+            if (a.position.x != b.position.x || a.position.y != b.position.y ||
+                a.position.z != b.position.z || a.normal.x != b.normal.x ||
+                a.normal.y != b.normal.y || a.normal.z != b.normal.z ||
+                a.texcoord.x != b.texcoord.x || a.texcoord.y != b.texcoord.y) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool small_obj_cases() {
+        // Negative indices, a quad without normals or texcoords, a comment
+        // and a trailing line without a newline.
+        gpu::mesh_data quad;
+        bool ok = gpu::import_obj("v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0 # top\n"
+                                  "f -4 -3 -2 -1",
+                                  quad) == gpu::mesh_import_status::ok;
+        ok &= quad.indices.size() == 6 && quad.vertices.size() == 6;
+        for (const shader_types::vertex_data& vertex : quad.vertices) {
+            ok &= vertex.normal.z == 1.f && vertex.texcoord.x == 0.f;
+        }
+        ok &= gpu::deduplicate_vertices(quad) == 2 && quad.vertices.size() == 4;
+
+        gpu::mesh_data bad;
+        ok &= gpu::import_obj("v 0 0 0\nv 1 0 0\nf 1 2 3\n", bad) ==
+              gpu::mesh_import_status::malformed;
+        ok &= gpu::import_obj("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1//4 2 3\n", bad) ==
+              gpu::mesh_import_status::malformed;
+        ok &= gpu::import_obj("v 0 zero 0\n", bad) ==
+              gpu::mesh_import_status::malformed;
+        ok &= bad.vertices.empty() && bad.indices.empty();
+        // A bad face after a good one leaves the mesh as it was.
+        ok &= gpu::import_obj("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\nf 1 2 4\n",
+                              quad) == gpu::mesh_import_status::malformed;
+        ok &= quad.indices.size() == 6 && quad.vertices.size() == 4;
+        return ok;
+    }
+
+    bool small_gltf_cases() {
+        // One triangle in a base64 data URI, no normals, 16-bit indices
+        // padded to four bytes.
+        std::vector<std::byte> binary;
+        const float positions[9] = { 0, 0, 0, 0, 1, 0, 0, 0, 1 };
+        const std::uint16_t indices[4] = { 0, 1, 2, 0 };
+        append_bytes(binary, positions, sizeof(positions));
+        append_bytes(binary, indices, sizeof(indices));
+        constexpr char alphabet[] =
+          "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::string base64;
+        for (std::size_t i = 0; i < binary.size(); i += 3) {
+            std::uint32_t bits = 0;
+            const std::size_t n = std::min<std::size_t>(3, binary.size() - i);
+            for (std::size_t j = 0; j < 3; ++j) {
+                bits = (bits << 8) |
+                       (j < n ? static_cast<std::uint32_t>(binary[i + j]) : 0);
+            }
+            for (std::size_t j = 0; j < 4; ++j) {
+                base64 += j <= n ? alphabet[(bits >> (18 - 6 * j)) & 63] : '=';
+            }
+        }
+        const auto document = [&](const char* p_mode,
+                                  const char* p_index_type = "5123") {
+            return std::string(
+                     R"({"buffers":[{"byteLength":44,"uri":)"
+                     R"("data:application/octet-stream;base64,)") +
+                   base64 +
+                   R"("}],"bufferViews":[{"buffer":0,"byteLength":36},)"
+                   R"({"buffer":0,"byteOffset":36,"byteLength":6}],)"
+                   R"("accessors":[{"bufferView":0,"componentType":5126,)"
+                   R"("type":"VEC3","count":3},{"bufferView":1,)"
+                   R"("componentType":)" +
+                   p_index_type + R"(,"type":"SCALAR","count":3}],)"
+                   R"("meshes":[{"primitives":[{"attributes":{"POSITION":0},)"
+                   R"("indices":1,"mode":)" +
+                   p_mode + "}]}]}";
+        };
+        const std::string triangles = document("4");
+        gpu::mesh_data mesh;
+        bool ok = gpu::import_gltf(std::as_bytes(std::span(triangles)), {},
+                                   mesh) == gpu::mesh_import_status::ok;
+        ok &= mesh.indices.size() == 3 && mesh.vertices.size() == 3 &&
+              mesh.vertices[1].position.y == 1.f &&
+              mesh.vertices[0].normal.x == 1.f;
+
+        const std::string lines = document("1");
+        ok &= gpu::import_gltf(std::as_bytes(std::span(lines)), {}, mesh) ==
+              gpu::mesh_import_status::unsupported;
+        // Signed indices are not valid glTF.
+        for (const char* type : { "5120", "5122" }) {
+            const std::string signed_indices = document("4", type);
+            ok &= gpu::import_gltf(std::as_bytes(std::span(signed_indices)), {},
+                                   mesh) == gpu::mesh_import_status::malformed;
+        }
+        const std::string truncated = triangles.substr(0, triangles.size() - 2);
+        ok &= gpu::import_gltf(std::as_bytes(std::span(truncated)), {}, mesh) ==
+              gpu::mesh_import_status::malformed;
+        ok &= mesh.indices.size() == 3 && mesh.vertices.size() == 3;
+
+        // A good primitive, then one with an out-of-range index accessor.
+        std::string second_bad = triangles;
+        const std::size_t end = second_bad.rfind("}]}]}");
+        second_bad.insert(end + 1,
+                          R"(,{"attributes":{"POSITION":0},"indices":7})");
+        ok &= gpu::import_gltf(std::as_bytes(std::span(second_bad)), {},
+                               mesh) == gpu::mesh_import_status::malformed;
+        ok &= mesh.indices.size() == 3 && mesh.vertices.size() == 3;
+        return ok;
+    }
+
+    bool first_use_order(const gpu::mesh_data& p_mesh) {
+        std::uint32_t next = 0;
+        for (std::uint32_t index : p_mesh.indices) {
+            if (index > next) {
+                return false;
+            }
+            next += index == next ? 1 : 0;
+        }
+        return next == p_mesh.vertices.size();
+    }
+}
+
+int
+main() {
+    using namespace boost::ut;
+    const std::string obj = make_torus_obj();
+    constexpr std::size_t k_vertices = std::size_t{ k_rings } * k_sides;
+    constexpr std::size_t k_triangles = k_vertices * 2;
+
+    "small obj files"_test = [] { expect(small_obj_cases()); };
+    "small gltf files"_test = [] { expect(small_gltf_cases()); };
+
+    gpu::mesh_data imported;
+    "torus obj imports"_test = [&] {
+        expect(gpu::import_obj(obj, imported) == gpu::mesh_import_status::ok);
+        expect(imported.indices.size() == k_triangles * 3 &&
+               imported.vertices.size() == k_triangles * 3);
+    };
+
+    gpu::mesh_data deduplicated = imported;
+    "dedup restores shared vertices"_test = [&] {
+        expect(gpu::deduplicate_vertices(deduplicated) ==
+               k_triangles * 3 - k_vertices);
+        expect(deduplicated.vertices.size() == k_vertices);
+        expect(triangle_set(deduplicated) == triangle_set(imported));
+    };
+
+    "glb matches obj"_test = [&] {
+        const std::vector<std::byte> glb = make_glb(deduplicated);
+        gpu::mesh_data from_glb;
+        expect(gpu::import_gltf(glb, {}, from_glb) ==
+               gpu::mesh_import_status::ok);
+        expect(same_vertices(from_glb, deduplicated));
+    };
+
+    const gpu::mesh_optimize_options options;
+    gpu::mesh_data optimized = imported;
+    gpu::optimize_mesh(optimized, options);
+    "optimizing keeps every triangle in first-use order"_test = [&] {
+        gpu::mesh_data cache_only = deduplicated;
+        gpu::optimize_vertex_cache(cache_only.indices,
+                                   cache_only.vertices.size());
+        gpu::optimize_vertex_fetch(cache_only);
+        expect(triangle_set(optimized) == triangle_set(imported));
+        expect(triangle_set(cache_only) == triangle_set(imported));
+        expect(first_use_order(optimized) && first_use_order(cache_only));
+    };
+
+    // 0xFFFF is the primitive restart index, so 16-bit indices stop one
+    // short of it.
+    "index format choice"_test = [] {
+        const std::vector<std::uint32_t> indices = { 0, 1, 65534, 7 };
+        const std::vector<std::byte> narrow =
+          gpu::encode_indices(indices, gpu::index_format::uint16);
+        std::uint16_t last = 0;
+        std::memcpy(&last, &narrow[4], sizeof(last));
+        expect(gpu::choose_index_format(65535) == gpu::index_format::uint16);
+        expect(gpu::choose_index_format(65536) == gpu::index_format::uint32);
+        expect(narrow.size() == 8 && last == 65534);
+        expect(gpu::encode_indices(indices, gpu::index_format::uint32)
+                 .size() == 16);
+    };
+
+    const std::filesystem::path directory =
+      std::filesystem::temp_directory_path() / "metal-cpp-mesh-pipeline-test";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    const std::filesystem::path source = directory / "torus.obj";
+    const std::filesystem::path cache = directory / "cache";
+    std::ofstream(source, std::ios::binary) << obj;
+    const gpu::packed_mesh expected = gpu::pack_mesh(optimized);
+
+    "load_mesh builds, then hits the cache"_test = [&] {
+        const gpu::mesh_load_result cold =
+          gpu::load_mesh(source, cache, options);
+        const gpu::mesh_load_result warm =
+          gpu::load_mesh(source, cache, options);
+        const gpu::mesh_view hit = warm.view();
+        expect(cold.status == gpu::mesh_import_status::ok &&
+               !cold.from_cache && warm.from_cache);
+        expect(hit.index_count == k_triangles * 3 &&
+               hit.format == gpu::index_format::uint16);
+        expect(std::ranges::equal(hit.indices, expected.indices));
+        expect(hit.vertices.size() == expected.vertices.size() &&
+               std::memcmp(hit.vertices.data(), expected.vertices.data(),
+                           expected.vertices.size() *
+                             sizeof(shader_types::packed_vertex_data)) == 0);
+        expect(hit.quantization.positionScale.x ==
+               expected.quantization.positionScale.x);
+    };
+
+    "cache rejects stale and truncated files"_test = [&] {
+        const std::filesystem::path file = directory / "torus.mesh";
+        expect(gpu::save_mesh_cache(file, expected.view(), 42));
+        expect(gpu::load_mesh_cache(file, 42).has_value() &&
+               !gpu::load_mesh_cache(file, 43).has_value());
+        std::filesystem::resize_file(file,
+                                     std::filesystem::file_size(file) - 2);
+        expect(!gpu::load_mesh_cache(file, 42).has_value());
+        gpu::mesh_optimize_options other = options;
+        other.overdraw = false;
+        expect(!gpu::load_mesh(source, cache, other).from_cache);
+        // Saving the source moves its timestamp.
+        std::filesystem::last_write_time(
+          source,
+          std::filesystem::last_write_time(source) + std::chrono::seconds(1));
+        expect(!gpu::load_mesh(source, cache, options).from_cache);
+        expect(gpu::load_mesh(source, cache, options).from_cache);
+    };
+
+    "rebuilds replace their entry, the cache stays within budget"_test = [&] {
+        const auto count_entries = [&] {
+            std::size_t entries = 0;
+            for (const auto& file :
+                 std::filesystem::directory_iterator(cache)) {
+                entries += file.path().extension() == ".mesh" ? 1 : 0;
+            }
+            return entries;
+        };
+        // One entry for each option set loaded so far.
+        expect(count_entries() == 2);
+        std::filesystem::last_write_time(
+          source,
+          std::filesystem::last_write_time(source) + std::chrono::seconds(1));
+        expect(!gpu::load_mesh(source, cache, options).from_cache);
+        expect(count_entries() == 2);
+
+        // Only room for the entry just written.
+        gpu::mesh_optimize_options third = options;
+        third.cache_size = options.cache_size + 8;
+        expect(!gpu::load_mesh(source, cache, third, { .max_bytes = 1 })
+                  .from_cache);
+        expect(count_entries() == 1);
+        expect(gpu::load_mesh(source, cache, third).from_cache);
+        expect(!gpu::load_mesh(source, cache, options).from_cache);
+    };
+
+    std::filesystem::remove_all(directory);
+}
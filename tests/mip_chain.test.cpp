@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <span>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+import lib;
+
+namespace {
+    struct case_config {
+        const char* name;
+        gpu::texel_format format;
+        gpu::mip_filter filter;
+        //! Largest per-channel difference from the reference, in bytes for
+        //! rgba8_unorm and in half ulps for rgba16_float.
+        int tolerance;
+    };
+
+    // The byte-averaging box path is exact. Float paths only differ from
+    // the reference where the vector code rounds an intermediate
+    // differently, which moves a result by at most one step.
+    constexpr case_config k_cases[] = {
+        { "rgba8 box", gpu::texel_format::rgba8_unorm, gpu::mip_filter::box,
+          0 },
+        { "rgba8 kaiser", gpu::texel_format::rgba8_unorm,
+          gpu::mip_filter::kaiser, 1 },
+        { "rgba16f box", gpu::texel_format::rgba16_float,
+          gpu::mip_filter::box, 1 },
+        { "rgba16f kaiser", gpu::texel_format::rgba16_float,
+          gpu::mip_filter::kaiser, 1 },
+    };
+
+    // A smooth gradient plus noise, so both the filter weights and the
+    // rounding get exercised.
+    std::vector<std::byte> make_image(gpu::texel_format p_format,
+                                      std::uint32_t p_width,
+                                      std::uint32_t p_height) {
+        std::vector<std::byte> image(std::size_t{ p_width } * p_height *
+                                     gpu::texel_bytes(p_format));
+        std::mt19937 random(p_width * 31 + p_height);
+        std::uniform_real_distribution<float> noise(-0.1f, 0.1f);
+        for (std::uint32_t y = 0; y < p_height; ++y) {
+            for (std::uint32_t x = 0; x < p_width; ++x) {
+                const std::size_t texel = std::size_t{ y } * p_width + x;
+                const float u = static_cast<float>(x) / p_width;
+                const float v = static_cast<float>(y) / p_height;
+                const float channels[4] = { u, v, 0.5f + 0.5f * std::sin(8 * u),
+                                            1.f - u * v };
+                for (int c = 0; c < 4; ++c) {
+                    const float value =
+                      std::clamp(channels[c] + noise(random), 0.f, 1.f);
+                    if (p_format == gpu::texel_format::rgba8_unorm) {
+                        image[texel * 4 + c] =
+                          static_cast<std::byte>(std::lround(value * 255.f));
+                    }
+                    else {
+                        const std::uint16_t half = gpu::float_to_half(value);
+                        std::memcpy(&image[texel * 8 + c * 2], &half, 2);
+                    }
+                }
+            }
+        }
+        return image;
+    }
+
+    int max_difference(gpu::texel_format p_format,
+                       std::span<const std::byte> p_a,
+                       std::span<const std::byte> p_b) {
+        int worst = 0;
+        if (p_format == gpu::texel_format::rgba8_unorm) {
+            for (std::size_t i = 0; i < p_a.size(); ++i) {
+                worst = std::max(worst,
+                                 std::abs(static_cast<int>(p_a[i]) -
+                                          static_cast<int>(p_b[i])));
+            }
+            return worst;
+        }
+        // Non-negative halves order like their bit patterns.
+        for (std::size_t i = 0; i < p_a.size(); i += 2) {
+            std::uint16_t a;
+            std::uint16_t b;
+            std::memcpy(&a, &p_a[i], 2);
+            std::memcpy(&b, &p_b[i], 2);
+            worst = std::max(worst, std::abs(int{ a } - int{ b }));
+        }
+        return worst;
+    }
+
+    bool half_round_trips() {
+        // Every half survives the trip through float, NaNs stay NaNs.
+        for (std::uint32_t bits = 0; bits <= 0xffff; ++bits) {
+            const auto half = static_cast<std::uint16_t>(bits);
+            const float value = gpu::half_to_float(half);
+            if (std::isnan(value)) {
+                if ((gpu::float_to_half(value) & 0x7c00) != 0x7c00) {
+                    return false;
+                }
+            }
+            else if (gpu::float_to_half(value) != half) {
+                return false;
+            }
+        }
+        // Halfway cases round to even, overflow goes to infinity.
+        return gpu::float_to_half(1.f + 1.f / 2048.f) == 0x3c00 &&
+               gpu::float_to_half(1.f + 3.f / 2048.f) == 0x3c02 &&
+               gpu::float_to_half(65520.f) == 0x7c00 &&
+               gpu::float_to_half(-65504.f) == 0xfbff &&
+               gpu::float_to_half(std::ldexp(1.f, -25)) == 0x0000 &&
+               gpu::float_to_half(std::ldexp(1.5f, -25)) == 0x0001;
+    }
+}
+
+int
+main() {
+    using namespace boost::ut;
+    jobs::scheduler workers;
+
+    "half conversions round trip"_test = [] { expect(half_round_trips()); };
+
+    "300x17 layout"_test = [] {
+        const gpu::mip_chain_layout layout = gpu::mip_chain_layout::make(
+          gpu::texel_format::rgba8_unorm, 300, 17);
+        bool ok = layout.levels.size() == 9 &&
+                  gpu::mip_level_count(1, 1) == 1 &&
+                  gpu::mip_level_count(1024, 1024) == 11;
+        std::size_t offset = 0;
+        for (const gpu::mip_level& level : layout.levels) {
+            ok &= level.offset == offset;
+            offset += level.bytes();
+        }
+        ok &= offset == layout.bytes && layout.levels[4].width == 18 &&
+              layout.levels[4].height == 1 && layout.levels.back().width == 1;
+        expect(ok);
+    };
+
+    // Odd, non-power-of-two and degenerate sizes cover the vector tails and
+    // the edge clamping.
+    "downsample matches reference"_test = [&] {
+        constexpr std::uint32_t sizes[][2] = { { 256, 256 }, { 300, 17 },
+                                               { 157, 93 },  { 1, 64 },
+                                               { 37, 1 },    { 3, 3 } };
+        for (const case_config& c : k_cases) {
+            for (const auto& size : sizes) {
+                const std::vector<std::byte> image =
+                  make_image(c.format, size[0], size[1]);
+                const std::size_t out_bytes =
+                  std::size_t{ std::max(size[0] / 2, 1u) } *
+                  std::max(size[1] / 2, 1u) * gpu::texel_bytes(c.format);
+                std::vector<std::byte> expected(out_bytes);
+                // One extra texel catches writes past the level.
+                std::vector<std::byte> actual(out_bytes + 8,
+                                              std::byte{ 0x5a });
+                gpu::downsample_reference(
+                  c.format, c.filter, image, size[0], size[1], expected);
+                gpu::downsample(workers, c.format, c.filter, image, size[0],
+                                size[1], actual);
+                expect(std::ranges::all_of(
+                  std::span(actual).subspan(out_bytes),
+                  [](std::byte p_b) { return p_b == std::byte{ 0x5a }; }));
+                expect(max_difference(c.format, expected,
+                                      std::span(actual).first(out_bytes)) <=
+                       c.tolerance);
+            }
+        }
+    };
+
+    // A flat image stays flat through the whole chain, so the weights sum
+    // to one and edges do not darken.
+    "flat chain stays flat"_test = [&] {
+        for (const case_config& c : k_cases) {
+            const gpu::mip_chain_layout layout =
+              gpu::mip_chain_layout::make(c.format, 200, 120);
+            std::vector<std::byte> storage(layout.bytes);
+            const std::size_t stride = gpu::texel_bytes(c.format);
+            std::vector<std::byte> texel(stride);
+            if (c.format == gpu::texel_format::rgba8_unorm) {
+                texel = { std::byte{ 10 }, std::byte{ 128 }, std::byte{ 200 },
+                          std::byte{ 255 } };
+            }
+            else {
+                const std::uint16_t halves[4] = { gpu::float_to_half(0.1f),
+                                                  gpu::float_to_half(0.5f),
+                                                  gpu::float_to_half(0.75f),
+                                                  gpu::float_to_half(1.f) };
+                std::memcpy(texel.data(), halves, stride);
+            }
+            for (std::size_t i = 0; i < layout.levels[0].bytes(); i += stride) {
+                std::memcpy(&storage[i], texel.data(), stride);
+            }
+            gpu::build_mip_chain(workers, layout, c.filter, storage);
+            bool ok = true;
+            for (std::size_t i = 0; i < layout.bytes; i += stride) {
+                ok &= max_difference(c.format,
+                                     std::span(storage).subspan(i, stride),
+                                     texel) <= c.tolerance;
+            }
+            expect(ok);
+        }
+    };
+}
@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include <span>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+import lib;
+
+namespace {
+    constexpr std::size_t k_matrices = 100'000;
+
+    // Inverse transpose of the upper 3x3 by Gauss-Jordan in double.
+    void reference_inverse_transpose(const math::float4x4& p_m, double (&p_out)[3][3]) {
+        double a[3][6] = {};
+        const float* m = &p_m.columns[0].x;
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 3; ++c) {
+                a[r][c] = m[c * 4 + r];
+            }
+            a[r][3 + r] = 1.0;
+        }
+        for (int p = 0; p < 3; ++p) {
+            int pivot = p;
+            for (int r = p + 1; r < 3; ++r) {
+                if (std::abs(a[r][p]) > std::abs(a[pivot][p])) {
+                    pivot = r;
+                }
+            }
+            std::swap(a[p], a[pivot]);
+            const double scale = 1.0 / a[p][p];
+            for (double& v : a[p]) {
+                v *= scale;
+            }
+            for (int r = 0; r < 3; ++r) {
+                if (r != p) {
+                    const double f = a[r][p];
+                    for (int k = 0; k < 6; ++k) {
+                        a[r][k] -= f * a[p][k];
+                    }
+                }
+            }
+        }
+        // Element (r, c) of the transpose is (c, r) of the inverse.
+        for (int c = 0; c < 3; ++c) {
+            for (int r = 0; r < 3; ++r) {
+                p_out[c][r] = a[c][3 + r];
+            }
+        }
+    }
+
+    // Frobenius error against the reference, relative to its norm.
+    double relative_error(const math::float3x3& p_result, const math::float4x4& p_m) {
+        double reference[3][3];
+        reference_inverse_transpose(p_m, reference);
+        double error = 0.0;
+        double norm = 0.0;
+        for (int c = 0; c < 3; ++c) {
+            const float got[] = { p_result.columns[c].x, p_result.columns[c].y,
+                                  p_result.columns[c].z };
+            for (int r = 0; r < 3; ++r) {
+                error += (got[r] - reference[c][r]) * (got[r] - reference[c][r]);
+                norm += reference[c][r] * reference[c][r];
+            }
+        }
+        return std::sqrt(error / norm);
+    }
+
+    // Rotation, scale and translation, scaled unevenly unless p_uniform,
+    // sheared now and then and mirrored now and then.
+    math::float4x4 random_transform(std::mt19937& p_rng, bool p_uniform) {
+        std::uniform_real_distribution<float> angle(-3.f, 3.f);
+        std::uniform_real_distribution<float> scale(0.2f, 5.f);
+        std::uniform_real_distribution<float> offset(-100.f, 100.f);
+        std::uniform_real_distribution<float> unit(0.f, 1.f);
+        const float s = scale(p_rng);
+        math::float3 scales = { s, s, s };
+        if (!p_uniform) {
+            scales = { scale(p_rng), scale(p_rng), scale(p_rng) };
+        }
+        if (unit(p_rng) < 0.25f) {
+            scales.x = -scales.x;
+        }
+        math::float4x4 m = math::make_translate({ offset(p_rng), offset(p_rng),
+                                                  offset(p_rng) }) *
+                           math::make_y_rotate(angle(p_rng)) *
+                           math::make_x_rotate(angle(p_rng)) *
+                           math::make_scale(scales);
+        if (!p_uniform && unit(p_rng) < 0.5f) {
+            math::float4x4 shear = math::make_identity();
+            shear.columns[1].x = unit(p_rng);
+            m = m * shear;
+        }
+        return m;
+    }
+
+    bool all_finite(const math::float3x3& p_m) {
+        for (const math::float3& column : p_m.columns) {
+            if (!std::isfinite(column.x) || !std::isfinite(column.y) ||
+                !std::isfinite(column.z)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    double worst_error(std::span<const math::float4x4> p_transforms,
+                       std::span<const math::float3x3> p_results) {
+        double worst = 0.0;
+        for (std::size_t i = 0; i < p_transforms.size(); ++i) {
+            worst = std::max(worst, relative_error(p_results[i], p_transforms[i]));
+        }
+        return worst;
+    }
+}
+
+int
+main() {
+    using namespace boost::ut;
+    std::mt19937 rng(23);
+
+    std::vector<math::float4x4> general(k_matrices);
+    std::vector<math::float4x4> uniform(k_matrices);
+    for (std::size_t i = 0; i < k_matrices; ++i) {
+        general[i] = random_transform(rng, false);
+        uniform[i] = random_transform(rng, true);
+    }
+    std::vector<math::float3x3> results(k_matrices);
+
+    "general matrices within 1e-5 of double"_test = [&] {
+        math::normal_transforms(general, results);
+        expect(worst_error(general, results) < 1e-5);
+        for (std::size_t i = 0; i < k_matrices; ++i) {
+            results[i] = math::normal_transform(general[i]);
+        }
+        expect(worst_error(general, results) < 1e-5);
+    };
+
+    "uniform fast path within 1e-5 of double"_test = [&] {
+        math::normal_transforms(uniform, results);
+        expect(worst_error(uniform, results) < 1e-5);
+    };
+
+    "mixed blocks and tails"_test = [&] {
+        // Uniform and general matrices in the same blocks, and every tail.
+        std::vector<math::float4x4> mixed;
+        for (std::size_t i = 0; i < 64; ++i) {
+            mixed.push_back(i % 5 == 0 ? general[i] : uniform[i]);
+        }
+        bool ok = true;
+        for (std::size_t count = 0; count <= mixed.size(); ++count) {
+            std::vector<math::float3x3> out(count);
+            math::normal_transforms(std::span(mixed).first(count), out);
+            ok &= worst_error(std::span(mixed).first(count), out) < 1e-5;
+        }
+        expect(ok);
+    };
+
+    "singular matrices give cofactors"_test = [] {
+        std::vector<math::float4x4> singular = { math::make_scale({ 1.f, 0.f, 2.f }),
+                                                 math::make_scale({ 0.f, 0.f, 0.f }),
+                                                 math::make_identity() };
+        std::vector<math::float3x3> out(singular.size());
+        math::normal_transforms(singular, out);
+        const math::float3x3 scalar = math::normal_transform(singular[0]);
+        // Cofactors of diag(1, 0, 2) are diag(0, 2, 0).
+        expect(std::ranges::all_of(out, all_finite));
+        expect(out[0].columns[1].y == 2.f && out[0].columns[0].x == 0.f &&
+               scalar.columns[1].y == 2.f && out[2].columns[2].z == 1.f);
+    };
+
+    "instance normals stay perpendicular"_test = [&] {
+        // Instances scaled unevenly: normals must stay perpendicular to
+        // the surfaces they belong to.
+        std::vector<shader_types::instance_data> instances(1000);
+        for (std::size_t i = 0; i < instances.size(); ++i) {
+            instances[i].instanceTransform = general[i];
+        }
+        math::update_normal_transforms(instances);
+        std::normal_distribution<float> direction;
+        bool ok = true;
+        bool discard_wrong = false;
+        for (const shader_types::instance_data& instance : instances) {
+            const math::float3 n =
+              math::normalize({ direction(rng), direction(rng), direction(rng) });
+            const math::float3 t = math::normalize(
+              math::cross(n, { direction(rng), direction(rng), direction(rng) }));
+            const math::float3x3 model = math::discard_translation(instance.instanceTransform);
+            const math::float3 world_t = math::normalize(model * t);
+            ok &= std::abs(math::dot(
+                    math::normalize(instance.instanceNormalTransform * n), world_t)) <
+                  1e-4f;
+            discard_wrong |=
+              std::abs(math::dot(math::normalize(model * n), world_t)) > 1e-2f;
+        }
+        expect(ok && discard_wrong);
+    };
+}
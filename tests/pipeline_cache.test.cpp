@@ -0,0 +1,207 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+import lib;
+
+namespace {
+    constexpr std::size_t k_pipelines = 16;
+    constexpr std::size_t k_source_bytes = 1024;
+
+    struct pipeline_source {
+        std::string source;
+        std::uint32_t color_format;
+        std::uint32_t depth_format;
+    };
+
+    std::vector<pipeline_source> make_sources() {
+        std::vector<pipeline_source> sources;
+        for (std::size_t i = 0; i < k_pipelines; ++i) {
+            std::string source = std::format("// pipeline {:04}\n", i);
+            while (source.size() < k_source_bytes) {
+                source += "float4 shade(float4 c) { return c * 0.5; }\n";
+            }
+            sources.push_back({ std::move(source), 81, 250 });
+        }
+        return sources;
+    }
+
+    gpu::pipeline_key key_of(const pipeline_source& p_source) {
+        return gpu::pipeline_hasher{}
+          .add(p_source.source)
+          .add(std::string_view("vertexMain"))
+          .add(std::string_view("fragmentMain"))
+          .add(p_source.color_format)
+          .add(p_source.depth_format)
+          .finish();
+    }
+
+    // Builds every pipeline through the cache, returning how many compiled.
+    std::size_t build_all(gpu::pipeline_cache& p_cache,
+                          const std::vector<pipeline_source>& p_sources) {
+        gpu::fake_shader_compiler compiler;
+        for (const pipeline_source& source : p_sources) {
+            p_cache.load_or_compile(key_of(source),
+                                    [&] { return compiler(source.source); });
+        }
+        return compiler.compile_count();
+    }
+
+    std::size_t count_files(const std::filesystem::path& p_directory) {
+        std::size_t files = 0;
+        for (const auto& file :
+             std::filesystem::directory_iterator(p_directory)) {
+            files += file.is_regular_file() ? 1 : 0;
+        }
+        return files;
+    }
+
+    // A fresh directory per test, removed again when the test ends.
+    struct scratch_directory {
+        explicit scratch_directory(std::string_view p_name)
+          : path(std::filesystem::temp_directory_path() /
+                 "metal-cpp-pipeline-cache-test" / p_name) {
+            std::filesystem::remove_all(path);
+        }
+        ~scratch_directory() { std::filesystem::remove_all(path); }
+
+        std::filesystem::path path;
+    };
+}
+
+int
+main() {
+    using namespace boost::ut;
+    const std::vector<pipeline_source> sources = make_sources();
+
+    "warm start compiles nothing"_test = [&] {
+        scratch_directory directory("warm");
+        {
+            gpu::pipeline_cache cache(directory.path);
+            expect(build_all(cache, sources) == k_pipelines);
+        }
+        gpu::pipeline_cache cache(directory.path);
+        expect(build_all(cache, sources) == 0);
+        expect(cache.stats().hits == k_pipelines);
+    };
+
+    "source and state changes recompile"_test = [&] {
+        scratch_directory directory("changes");
+        {
+            gpu::pipeline_cache cache(directory.path);
+            build_all(cache, sources);
+        }
+        std::vector<pipeline_source> edited = sources;
+        edited[3].source += "// edited\n";
+        edited[7].depth_format = 252;
+        gpu::pipeline_cache cache(directory.path);
+        expect(build_all(cache, edited) == 2);
+    };
+
+    "corrupt payload recompiles"_test = [&] {
+        scratch_directory directory("corrupt");
+        gpu::pipeline_cache cache(directory.path);
+        build_all(cache, sources);
+
+        // Corrupt one payload in place, keeping its size.
+        const auto path = cache.find(key_of(sources[0]));
+        expect(path.has_value());
+        std::fstream file(*path, std::ios::binary | std::ios::in |
+                                   std::ios::out);
+        file.seekp(4);
+        file.put('X');
+        file.close();
+        expect(build_all(cache, sources) == 1);
+        expect(cache.stats().corrupt == 1);
+    };
+
+    "stale leftovers are swept, fresh ones kept"_test = [&] {
+        scratch_directory directory("leftovers");
+        {
+            gpu::pipeline_cache cache(directory.path);
+            build_all(cache, sources);
+        }
+        // Leftovers from a store interrupted before its rename. While
+        // fresh they may belong to another process's store in flight.
+        const std::filesystem::path partial =
+          directory.path / "0123456789abcdef.bin.tmp.1.2.0";
+        const std::filesystem::path orphan =
+          directory.path / "fedcba9876543210.bin";
+        std::ofstream(partial) << "partial";
+        std::ofstream(orphan) << "orphan";
+        {
+            gpu::pipeline_cache cache(directory.path);
+            // Indexed payloads, the index, its lock and the two leftovers.
+            expect(count_files(directory.path) == cache.entry_count() + 4);
+        }
+        for (const std::filesystem::path& path : { partial, orphan }) {
+            std::filesystem::last_write_time(
+              path, std::filesystem::last_write_time(path) -
+                      std::chrono::hours(1));
+        }
+        gpu::pipeline_cache cache(directory.path);
+        expect(count_files(directory.path) == cache.entry_count() + 2);
+    };
+
+    // Two processes sharing the directory, each storing what the other
+    // has not seen. Neither index write may drop the other's.
+    "shared directory keeps both stores"_test = [&] {
+        scratch_directory directory("shared");
+        gpu::fake_shader_compiler compiler;
+        {
+            gpu::pipeline_cache first(directory.path);
+            gpu::pipeline_cache second(directory.path);
+            first.store(key_of(sources[0]), compiler(sources[0].source));
+            second.store(key_of(sources[1]), compiler(sources[1].source));
+            first.flush();
+        }
+        gpu::pipeline_cache reopened(directory.path);
+        expect(reopened.load(key_of(sources[0])).has_value());
+        expect(reopened.load(key_of(sources[1])).has_value());
+    };
+
+    "version bump recompiles"_test = [&] {
+        scratch_directory directory("version");
+        {
+            gpu::pipeline_cache cache(directory.path);
+            build_all(cache, sources);
+        }
+        gpu::pipeline_cache cache(directory.path, { .version = 2 });
+        expect(build_all(cache, sources) == k_pipelines);
+    };
+
+    // Room for half the pipelines, opening evicts the least recently used
+    // half, which is the first half stored.
+    "eviction keeps the recently used half"_test = [&] {
+        scratch_directory directory("eviction");
+        {
+            gpu::pipeline_cache cache(directory.path);
+            build_all(cache, sources);
+        }
+        const std::uintmax_t entry_bytes =
+          gpu::fake_shader_compiler{}(sources[0].source).size();
+        gpu::pipeline_cache cache(
+          directory.path,
+          { .max_bytes = entry_bytes * (k_pipelines / 2) + 64 });
+        expect(cache.stats().evictions == k_pipelines / 2);
+
+        const std::vector<pipeline_source> first_half(
+          sources.begin(), sources.begin() + k_pipelines / 2);
+        const std::vector<pipeline_source> second_half(
+          sources.begin() + k_pipelines / 2, sources.end());
+        expect(build_all(cache, second_half) == 0);
+        expect(build_all(cache, first_half) == k_pipelines / 2);
+        expect(build_all(cache, first_half) == 0);
+    };
+
+    std::filesystem::remove_all(std::filesystem::temp_directory_path() /
+                                "metal-cpp-pipeline-cache-test");
+}
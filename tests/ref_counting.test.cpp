@@ -0,0 +1,101 @@
+#include <utility>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+import lib;
+
+namespace {
+    struct counts {
+        int retains;
+        int releases;
+        bool destroyed;
+    };
+
+    // Runs p_fn against a fresh object (count 1, like a new* result) and
+    // returns the refcount traffic it caused.
+    template<typename Fn>
+    counts run(Fn&& p_fn) {
+        ns::mock_object object;
+        p_fn(object);
+        return { object.retains(), object.releases(), object.destroyed() };
+    }
+
+    bool matches(const counts& p_counts, int p_retains, int p_releases) {
+        return p_counts.retains == p_retains &&
+               p_counts.releases == p_releases && p_counts.destroyed;
+    }
+}
+
+int
+main() {
+    using namespace boost::ut;
+
+    "adopt releases once"_test = [] {
+        expect(matches(run([](ns::mock_object& p_object) {
+                           auto owner = ns::adopt(&p_object);
+                       }),
+                       0, 1));
+    };
+
+    "moves transfer ownership without traffic"_test = [] {
+        expect(matches(run([](ns::mock_object& p_object) {
+                           auto a = ns::adopt(&p_object);
+                           auto b = std::move(a);
+                           ns::ref<ns::mock_object> c;
+                           c = std::move(b);
+                       }),
+                       0, 1));
+    };
+
+    "retain takes its own reference"_test = [] {
+        expect(matches(run([](ns::mock_object& p_object) {
+                           auto owner = ns::retain(&p_object);
+                           // The borrowed reference is dropped by whoever
+                           // handed it out.
+                           p_object.release();
+                       }),
+                       1, 2));
+    };
+
+    "detach hands the reference back"_test = [] {
+        expect(matches(run([](ns::mock_object& p_object) {
+                           auto owner = ns::adopt(&p_object);
+                           owner.detach()->release();
+                       }),
+                       0, 1));
+    };
+
+    "reset releases once"_test = [] {
+        expect(matches(run([](ns::mock_object& p_object) {
+                           auto owner = ns::adopt(&p_object);
+                           owner.reset();
+                           owner.reset();
+                       }),
+                       0, 1));
+    };
+
+    "shared copies retain, self assignment does not"_test = [] {
+        expect(matches(run([](ns::mock_object& p_object) {
+                           ns::shared_ref<ns::mock_object> a =
+                             ns::adopt(&p_object);
+                           auto b = a;
+                           ns::shared_ref<ns::mock_object> c;
+                           c = b;
+                           c = c;
+                           auto d = std::move(c);
+                       }),
+                       3, 4));
+    };
+
+    "vector growth moves handles"_test = [] {
+        expect(matches(run([](ns::mock_object& p_object) {
+                           std::vector<ns::ref<ns::mock_object>> owners;
+                           owners.push_back(ns::adopt(&p_object));
+                           for (int i = 0; i < 64; ++i) {
+                               owners.emplace_back();
+                           }
+                       }),
+                       0, 1));
+    };
+}
@@ -0,0 +1,97 @@
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+import lib;
+
+namespace {
+    using compute::uint3;
+
+    constexpr uint3 k_grid = { 128, 128, 1 };
+    constexpr std::uint32_t k_max_total_threads = 1024;
+    constexpr std::uint32_t k_execution_width = 32;
+    constexpr uint3 k_fastest = { 32, 8, 1 };
+
+    // Deterministic stand-in for a dispatch, k_fastest always wins.
+    double fake_ns(uint3 p_threadgroup) {
+        if (p_threadgroup == k_fastest) {
+            return 100.0;
+        }
+        return 200.0 + p_threadgroup.x + p_threadgroup.y;
+    }
+}
+
+int
+main() {
+    using namespace boost::ut;
+    const std::filesystem::path table =
+      std::filesystem::temp_directory_path() /
+      "metal-cpp-threadgroup-tuner-test" / "threadgroups";
+    std::filesystem::remove_all(table.parent_path());
+
+    const gpu::pipeline_key kernel =
+      gpu::pipeline_hasher{}.add(std::string_view("mandelbrot_set")).finish();
+    const compute::tuning_key key =
+      compute::tuning_key::make(kernel, "cpu dispatcher", k_grid);
+    const std::vector<uint3> candidates = compute::candidate_threadgroups(
+      k_grid, k_max_total_threads, k_execution_width);
+
+    "candidates fit the grid and SIMD width"_test = [&] {
+        expect(!candidates.empty());
+        for (const uint3& shape : candidates) {
+            expect(shape.volume() <= k_max_total_threads &&
+                   shape.volume() % k_execution_width == 0 &&
+                   (shape.x <= k_grid.x || shape.y == 1) &&
+                   shape.y <= k_grid.y && shape.z == 1);
+        }
+    };
+
+    "no candidates gives no result"_test = [&] {
+        compute::threadgroup_tuner tuner(table, { .samples = 3 });
+        const compute::tuning_key unshaped =
+          compute::tuning_key::make(kernel, "no candidates", k_grid);
+        expect(!tuner.tune(unshaped, {}, fake_ns).has_value());
+        expect(tuner.stats().measurements == 0 && tuner.entry_count() == 0);
+    };
+
+    "cold tuner measures every candidate"_test = [&] {
+        compute::threadgroup_tuner tuner(table, { .samples = 3 });
+        const std::optional<compute::tuning_result> cold =
+          tuner.tune(key, candidates, fake_ns);
+        expect(cold.has_value() && cold->threadgroup == k_fastest);
+        expect(tuner.stats().measurements == candidates.size() * 4 &&
+               tuner.stats().tunings == 1);
+    };
+
+    "warm tuner reuses the table"_test = [&] {
+        compute::threadgroup_tuner tuner(table, { .samples = 3 });
+        const std::optional<compute::tuning_result> warm =
+          tuner.tune(key, candidates, fake_ns);
+        expect(warm.has_value() && warm->threadgroup == k_fastest);
+        expect(tuner.stats().hits == 1 && tuner.stats().measurements == 0);
+
+        const compute::tuning_key other_device =
+          compute::tuning_key::make(kernel, "another device", k_grid);
+        tuner.tune(other_device, candidates, fake_ns);
+        expect(tuner.stats().tunings == 1 && tuner.entry_count() == 2);
+    };
+
+    "damaged line skipped"_test = [&] {
+        std::ofstream(table, std::ios::app) << "zz-not-hex 1 2\n";
+        compute::threadgroup_tuner tuner(table, { .samples = 3 });
+        expect(tuner.find(key).has_value());
+    };
+
+    "version bump discards the table"_test = [&] {
+        compute::threadgroup_tuner tuner(table,
+                                         { .version = 2, .samples = 3 });
+        expect(!tuner.find(key).has_value() && tuner.entry_count() == 0);
+    };
+
+    std::filesystem::remove_all(table.parent_path());
+}
@@ -0,0 +1,334 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+import lib;
+
+namespace {
+    using math::simd::precision;
+    using math::simd::vfloat;
+
+    constexpr std::size_t k_lanes = math::simd::lanes;
+    constexpr std::size_t k_block = 4096;
+    constexpr double k_infinite_error = std::numeric_limits<double>::infinity();
+
+    // Error of p_got in units of the last place of the float nearest
+    // p_want. Below the normal range the unit is the subnormal spacing.
+    double ulp_error(float p_got, double p_want) {
+        if (std::isnan(p_want)) {
+            return std::isnan(p_got) ? 0.0 : k_infinite_error;
+        }
+        const float rounded = static_cast<float>(p_want);
+        if (std::isinf(p_got) || std::isinf(rounded)) {
+            return p_got == rounded ? 0.0 : k_infinite_error;
+        }
+        // 2^(e - 23) for the binade p_want rounds into, built from the
+        // exponent field, which is cheaper than ilogb and ldexp.
+        const std::uint64_t field =
+          std::max<std::uint32_t>((std::bit_cast<std::uint32_t>(rounded) >> 23) & 0xff, 1);
+        const double unit = std::bit_cast<double>((field + 1023 - 150) << 52);
+        return std::abs(p_got - p_want) / unit;
+    }
+
+    // Applies p_fn to p_count floats, simd::lanes at a time. p_count is a
+    // multiple of the lane count.
+    template<typename Fn>
+    void apply(const float* p_in, float* p_out, std::size_t p_count, Fn&& p_fn) {
+        for (std::size_t i = 0; i < p_count; i += k_lanes) {
+            p_fn(vfloat::load(p_in + i)).store(p_out + i);
+        }
+    }
+
+    // Worst ulp error of p_fn against p_reference over every float whose
+    // bits are in [p_first, p_last], split across the scheduler's threads.
+    template<typename Fn, typename Reference>
+    double sweep(jobs::scheduler& p_scheduler,
+                 std::uint32_t p_first,
+                 std::uint32_t p_last,
+                 Fn&& p_fn,
+                 Reference&& p_reference) {
+        const std::size_t count = std::size_t{ p_last } - p_first + 1;
+        const std::size_t blocks = (count + k_block - 1) / k_block;
+        std::vector<double> worst(blocks, 0.0);
+        p_scheduler.parallel_for(blocks, 64, [&](std::size_t p_begin, std::size_t p_end) {
+            alignas(32) float in[k_block];
+            alignas(32) float out[k_block];
+            for (std::size_t b = p_begin; b < p_end; ++b) {
+                const std::size_t first = b * k_block;
+                const std::size_t n = std::min(k_block, count - first);
+                for (std::size_t i = 0; i < k_block; ++i) {
+                    const std::size_t index = first + std::min(i, n - 1);
+                    in[i] = std::bit_cast<float>(
+                      static_cast<std::uint32_t>(p_first + index));
+                }
+                apply(in, out, k_block, p_fn);
+                double block_worst = 0.0;
+                for (std::size_t i = 0; i < n; ++i) {
+                    block_worst =
+                      std::max(block_worst, ulp_error(out[i], p_reference(in[i])));
+                }
+                worst[b] = block_worst;
+            }
+        });
+        return *std::ranges::max_element(worst);
+    }
+
+    // Worst ulp and relative error of a binary function over sampled
+    // arguments, skipping results the reference puts outside the normal
+    // range when p_normal_only.
+    struct sampled_error {
+        double ulp = 0.0;
+        double relative = 0.0;
+    };
+
+    template<typename Fn, typename Reference>
+    sampled_error sample(const std::vector<float>& p_a,
+                         const std::vector<float>& p_b,
+                         Fn&& p_fn,
+                         Reference&& p_reference,
+                         bool p_normal_only) {
+        sampled_error error;
+        alignas(32) float out[k_lanes];
+        for (std::size_t i = 0; i < p_a.size(); i += k_lanes) {
+            p_fn(vfloat::load(&p_a[i]), vfloat::load(&p_b[i])).store(out);
+            for (std::size_t j = 0; j < k_lanes; ++j) {
+                const double want = p_reference(p_a[i + j], p_b[i + j]);
+                const bool normal = std::abs(want) >= std::numeric_limits<float>::min() &&
+                                    std::abs(want) <= std::numeric_limits<float>::max();
+                if (p_normal_only && !normal) {
+                    continue;
+                }
+                error.ulp = std::max(error.ulp, ulp_error(out[j], want));
+                if (normal) {
+                    error.relative =
+                      std::max(error.relative, std::abs(out[j] - want) / std::abs(want));
+                }
+            }
+        }
+        return error;
+    }
+
+    // Bitwise equal, or both NaN.
+    bool same(float p_a, float p_b) {
+        return std::bit_cast<std::uint32_t>(p_a) == std::bit_cast<std::uint32_t>(p_b) ||
+               (std::isnan(p_a) && std::isnan(p_b));
+    }
+
+    float lane0(vfloat p_v) {
+        alignas(32) float out[k_lanes];
+        p_v.store(out);
+        return out[0];
+    }
+
+    constexpr std::uint32_t bits(float p_x) { return std::bit_cast<std::uint32_t>(p_x); }
+}
+
+int
+main() {
+    using namespace boost::ut;
+    jobs::scheduler scheduler;
+    std::mt19937 rng(23);
+
+    // sincos is odd and even exactly, the quadrant rounding being
+    // symmetric, so the sweeps cover non-negative arguments.
+    "sin, every float |x| <= 8192, within 1 ulp"_test = [&] {
+        expect(sweep(
+                 scheduler, 0, bits(8192.f),
+                 [](vfloat p_x) { return math::simd::sin(p_x); },
+                 [](float p_x) { return std::sin(double{ p_x }); }) <= 1.0);
+    };
+    "cos, every float |x| <= 8192, within 1 ulp"_test = [&] {
+        expect(sweep(
+                 scheduler, 0, bits(8192.f),
+                 [](vfloat p_x) { return math::simd::cos(p_x); },
+                 [](float p_x) { return std::cos(double{ p_x }); }) <= 1.0);
+    };
+
+    // Every negative float from -0 to -inf, then every positive one.
+    "exp, every float, within 1 ulp"_test = [&] {
+        const auto exp = [](vfloat p_x) { return math::simd::exp(p_x); };
+        const auto reference = [](float p_x) { return std::exp(double{ p_x }); };
+        expect(sweep(scheduler, bits(-0.f),
+                     bits(-std::numeric_limits<float>::infinity()), exp,
+                     reference) <= 1.0);
+        expect(sweep(scheduler, 0, bits(std::numeric_limits<float>::infinity()),
+                     exp, reference) <= 1.0);
+    };
+
+    // atan2(y, 1) is atan, and copy_sign makes it odd in y.
+    "atan2(y, 1), every float y >= 0, within 2 ulp"_test = [&] {
+        expect(sweep(
+                 scheduler, 0, bits(std::numeric_limits<float>::infinity()),
+                 [](vfloat p_y) {
+                     return math::simd::atan2(p_y, vfloat::splat(1.f));
+                 },
+                 [](float p_y) { return std::atan2(double{ p_y }, 1.0); }) <=
+               2.0);
+    };
+
+    "sin odd and cos even, bit for bit"_test = [&] {
+        std::uniform_real_distribution<float> angle(-8192.f, 8192.f);
+        bool ok = true;
+        for (int i = 0; i < 100'000; ++i) {
+            const float x = angle(rng);
+            vfloat s, c, ns, nc;
+            math::simd::sincos(vfloat::splat(x), s, c);
+            math::simd::sincos(vfloat::splat(-x), ns, nc);
+            ok &= same(lane0(ns), -lane0(s)) && same(lane0(nc), lane0(c));
+        }
+        expect(ok);
+    };
+
+    // Arguments spread over magnitudes, with zeros, infinities, NaNs and
+    // subnormals mixed in.
+    std::uniform_real_distribution<float> mantissa(1.f, 2.f);
+    std::uniform_int_distribution<int> exponent(-140, 127);
+    std::uniform_int_distribution<int> special(0, 31);
+    const auto wide = [&] {
+        const float values[] = { 0.f, std::numeric_limits<float>::infinity(),
+                                 std::numeric_limits<float>::quiet_NaN(),
+                                 std::numeric_limits<float>::denorm_min() };
+        const int pick = special(rng);
+        float x = pick < 4 ? values[pick] : std::ldexp(mantissa(rng), exponent(rng));
+        return special(rng) < 16 ? -x : x;
+    };
+    const std::size_t samples = 1 << 20;
+    std::vector<float> ys(samples);
+    std::vector<float> xs(samples);
+    for (std::size_t i = 0; i < samples; ++i) {
+        ys[i] = wide();
+        xs[i] = wide();
+    }
+    const auto atan2_reference = [](float p_y, float p_x) {
+        return std::atan2(double{ p_y }, double{ p_x });
+    };
+    "atan2, all quadrants and specials, 2 ulp"_test = [&] {
+        const sampled_error error = sample(
+          ys, xs,
+          [](vfloat p_y, vfloat p_x) { return math::simd::atan2(p_y, p_x); },
+          atan2_reference, false);
+        expect(error.ulp <= 2.0);
+    };
+
+    // pow over bases near one with large exponents, where the error of a
+    // plain exp(y log x) grows, and over the whole range.
+    std::uniform_real_distribution<float> near_one(0.99f, 1.01f);
+    std::uniform_real_distribution<float> large(-8000.f, 8000.f);
+    std::uniform_real_distribution<float> moderate(-40.f, 40.f);
+    std::uniform_real_distribution<float> positive(0.f, 100.f);
+    std::vector<float> bases(samples);
+    std::vector<float> powers(samples);
+    for (std::size_t i = 0; i < samples; ++i) {
+        switch (i % 4) {
+            case 0:
+                bases[i] = near_one(rng);
+                powers[i] = large(rng);
+                break;
+            case 1:
+                bases[i] = positive(rng);
+                powers[i] = moderate(rng);
+                break;
+            case 2:
+                bases[i] = -positive(rng);
+                powers[i] = std::round(moderate(rng));
+                break;
+            default:
+                bases[i] = wide();
+                powers[i] = special(rng) < 8 ? wide() : moderate(rng);
+                break;
+        }
+    }
+    const auto pow_reference = [](float p_x, float p_y) {
+        return std::pow(double{ p_x }, double{ p_y });
+    };
+    "pow, sampled with specials, within 2 ulp"_test = [&] {
+        const sampled_error error = sample(
+          bases, powers,
+          [](vfloat p_x, vfloat p_y) { return math::simd::pow(p_x, p_y); },
+          pow_reference, false);
+        expect(error.ulp <= 2.0);
+    };
+
+    "atan2 and pow special cases"_test = [&] {
+        // Signed zeros, infinities and NaNs as C defines them.
+        const float inf = std::numeric_limits<float>::infinity();
+        const float nan = std::numeric_limits<float>::quiet_NaN();
+        const float values[] = { 0.f, -0.f, 1.f, -1.f, 0.5f, -0.5f, 2.f, -2.f, 3.f,
+                                 -3.f, 2.5f, -2.5f, inf, -inf, nan, 1e-40f, -1e-40f };
+        bool atan2_ok = true;
+        bool pow_ok = true;
+        for (float a : values) {
+            for (float b : values) {
+                atan2_ok &= same(lane0(math::simd::atan2(vfloat::splat(a), vfloat::splat(b))),
+                                 static_cast<float>(atan2_reference(a, b))) ||
+                            ulp_error(lane0(math::simd::atan2(vfloat::splat(a),
+                                                              vfloat::splat(b))),
+                                      atan2_reference(a, b)) <= 2.0;
+                pow_ok &= same(lane0(math::simd::pow(vfloat::splat(a), vfloat::splat(b))),
+                               std::pow(a, b));
+            }
+        }
+        expect(atan2_ok);
+        expect(pow_ok);
+    };
+
+    "fast sincos and exp"_test = [&] {
+        double fast_sin_error = 0.0;
+        double fast_exp_error = 0.0;
+        std::uniform_real_distribution<float> angle(-256.f, 256.f);
+        std::uniform_real_distribution<float> argument(-87.f, 88.f);
+        for (int i = 0; i < 1'000'000; ++i) {
+            const float x = angle(rng);
+            vfloat s, c;
+            math::simd::sincos<precision::fast>(vfloat::splat(x), s, c);
+            fast_sin_error = std::max({ fast_sin_error,
+                                        std::abs(lane0(s) - std::sin(double{ x })),
+                                        std::abs(lane0(c) - std::cos(double{ x })) });
+            const float e = argument(rng);
+            const double want = std::exp(double{ e });
+            fast_exp_error = std::max(
+              fast_exp_error,
+              std::abs(lane0(math::simd::exp<precision::fast>(vfloat::splat(e))) - want) /
+                want);
+        }
+        expect(fast_sin_error <= 1.1e-5);
+        expect(fast_exp_error <= 1e-5);
+    };
+
+    "fast atan2 within 2e-5 relative"_test = [&] {
+        const sampled_error error = sample(
+          ys, xs,
+          [](vfloat p_y, vfloat p_x) {
+              return math::simd::atan2<precision::fast>(p_y, p_x);
+          },
+          atan2_reference, true);
+        expect(error.relative <= 2e-5);
+    };
+
+    "fast pow within 1.1e-5 (1 + |y|) relative"_test = [&] {
+        double fast_pow_error = 0.0;
+        alignas(32) float out[k_lanes];
+        for (std::size_t i = 0; i < samples; i += k_lanes) {
+            math::simd::pow<precision::fast>(vfloat::load(&bases[i]),
+                                             vfloat::load(&powers[i]))
+              .store(out);
+            for (std::size_t j = 0; j < k_lanes; ++j) {
+                const double want = pow_reference(bases[i + j], powers[i + j]);
+                if (std::abs(want) >= std::numeric_limits<float>::min() &&
+                    std::abs(want) <= std::numeric_limits<float>::max()) {
+                    fast_pow_error = std::max(
+                      fast_pow_error, std::abs(out[j] - want) / std::abs(want) /
+                                        (1.0 + std::abs(powers[i + j])));
+                }
+            }
+        }
+        expect(fast_pow_error <= 1.1e-5);
+    };
+}
@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+import lib;
+
+namespace {
+    // Odd on purpose, so the last block is a partial one.
+    constexpr std::size_t k_vertices = 10'003;
+
+    std::vector<shader_types::vertex_data> make_mesh() {
+        std::mt19937 random(17);
+        std::uniform_real_distribution<float> x(-3.f, 5.f);
+        std::uniform_real_distribution<float> y(0.f, 2.f);
+        std::uniform_real_distribution<float> z(-0.5f, 0.5f);
+        std::uniform_real_distribution<float> uv(-1.f, 3.f);
+        std::normal_distribution<float> direction;
+
+        std::vector<shader_types::vertex_data> mesh(k_vertices);
+        for (shader_types::vertex_data& vertex : mesh) {
+            math::float3 n = { direction(random),
+                               direction(random),
+                               direction(random) };
+            const float length = std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+            vertex = { .position = { x(random), y(random), z(random) },
+                       .normal = { n.x / length, n.y / length, n.z / length },
+                       .texcoord = { uv(random), uv(random) } };
+        }
+        // Axis-aligned normals sit on the octahedron's edges and folds.
+        const math::float3 axes[] = { { 1.f, 0.f, 0.f },  { -1.f, 0.f, 0.f },
+                                      { 0.f, 1.f, 0.f },  { 0.f, -1.f, 0.f },
+                                      { 0.f, 0.f, 1.f },  { 0.f, 0.f, -1.f },
+                                      { 0.f, -0.f, -1.f } };
+        for (std::size_t i = 0; i < std::size(axes); ++i) {
+            mesh[i].normal = axes[i];
+        }
+        return mesh;
+    }
+
+    bool same_bytes(const auto& p_a, const auto& p_b) {
+        return p_a.size() == p_b.size() &&
+               std::memcmp(p_a.data(),
+                           p_b.data(),
+                           p_a.size() * sizeof(p_a[0])) == 0;
+    }
+}
+
+int
+main() {
+    using namespace boost::ut;
+    const std::vector<shader_types::vertex_data> mesh = make_mesh();
+    const shader_types::vertex_quantization quantization =
+      gpu::make_vertex_quantization(mesh);
+    std::vector<shader_types::packed_vertex_data> packed(k_vertices);
+    std::vector<shader_types::vertex_data> unpacked(k_vertices);
+    gpu::pack_vertices(quantization, mesh, packed);
+    gpu::unpack_vertices(quantization, packed, unpacked);
+
+    "simd pack matches pack_vertex"_test = [&] {
+        std::vector<shader_types::packed_vertex_data> packed_scalar(k_vertices);
+        for (std::size_t i = 0; i < k_vertices; ++i) {
+            packed_scalar[i] = gpu::pack_vertex(quantization, mesh[i]);
+        }
+        expect(same_bytes(packed, packed_scalar));
+    };
+
+    // Decoding is multiply-adds, which the compiler may fuse in the scalar
+    // code, so allow an ulp or two.
+    "simd unpack matches unpack_vertex"_test = [&] {
+        float difference = 0.f;
+        for (std::size_t i = 0; i < k_vertices; ++i) {
+            const shader_types::vertex_data& a = unpacked[i];
+            const shader_types::vertex_data b =
+              gpu::unpack_vertex(quantization, packed[i]);
+            difference = std::max({ difference,
+                                    std::abs(a.position.x - b.position.x),
+                                    std::abs(a.position.y - b.position.y),
+                                    std::abs(a.position.z - b.position.z),
+                                    std::abs(a.normal.x - b.normal.x),
+                                    std::abs(a.normal.y - b.normal.y),
+                                    std::abs(a.normal.z - b.normal.z),
+                                    std::abs(a.texcoord.x - b.texcoord.x),
+                                    std::abs(a.texcoord.y - b.texcoord.y) });
+        }
+        expect(difference < 1e-6f);
+    };
+
+    // Round trip error, in quantization steps for positions and texcoords
+    // and in radians for normals.
+    "round trip within the quantization error"_test = [&] {
+        float position_steps = 0.f;
+        float texcoord_steps = 0.f;
+        double normal_radians = 0.0;
+        for (std::size_t i = 0; i < k_vertices; ++i) {
+            const shader_types::vertex_data& in = mesh[i];
+            const shader_types::vertex_data& out = unpacked[i];
+            position_steps = std::max(
+              { position_steps,
+                std::abs(out.position.x - in.position.x) /
+                  quantization.positionScale.x,
+                std::abs(out.position.y - in.position.y) /
+                  quantization.positionScale.y,
+                std::abs(out.position.z - in.position.z) /
+                  quantization.positionScale.z });
+            texcoord_steps = std::max(
+              { texcoord_steps,
+                std::abs(out.texcoord.x - in.texcoord.x) /
+                  quantization.texcoordScale.x,
+                std::abs(out.texcoord.y - in.texcoord.y) /
+                  quantization.texcoordScale.y });
+            // atan2 stays accurate for tiny angles, acos of a dot product
+            // near one does not.
+            const double a[3] = { in.normal.x, in.normal.y, in.normal.z };
+            const double b[3] = { out.normal.x, out.normal.y, out.normal.z };
+            const double cross[3] = { a[1] * b[2] - a[2] * b[1],
+                                      a[2] * b[0] - a[0] * b[2],
+                                      a[0] * b[1] - a[1] * b[0] };
+            normal_radians = std::max(
+              normal_radians,
+              std::atan2(std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] +
+                                   cross[2] * cross[2]),
+                         a[0] * b[0] + a[1] * b[1] + a[2] * b[2]));
+        }
+        // Half a step plus float rounding of offset + scale * steps.
+        expect(position_steps < 0.52f);
+        expect(texcoord_steps < 0.52f);
+        expect(normal_radians < 1e-4);
+    };
+
+    "flat mesh decodes exactly"_test = [] {
+        const shader_types::vertex_data flat[] = {
+            { .position = { 1.f, 2.f, 3.f },
+              .normal = { 0.f, 0.f, 1.f },
+              .texcoord = { 0.5f, 0.5f } },
+            { .position = { 1.f, 2.f, 3.f },
+              .normal = { 0.f, 0.f, 1.f },
+              .texcoord = { 0.5f, 0.5f } }
+        };
+        const shader_types::vertex_quantization q =
+          gpu::make_vertex_quantization(flat);
+        const shader_types::vertex_data out =
+          gpu::unpack_vertex(q, gpu::pack_vertex(q, flat[0]));
+        expect(out.position.x == 1.f && out.position.y == 2.f &&
+               out.position.z == 3.f && out.normal.z == 1.f);
+    };
+}